@@ -1,6 +1,7 @@
 use std::env;
 use std::fmt::Display;
-use std::process::Command;
+use std::io::{BufRead, BufReader, Write};
+use std::process::{Child, ChildStdin, ChildStdout, Command, Stdio};
 
 use once_cell::sync::Lazy;
 use serde::Deserialize;
@@ -62,6 +63,12 @@ pub enum CallPkgDbError {
     ParseJSON(#[source] serde_json::Error),
     #[error("call to pkgdb failed")]
     PkgDbCall(#[source] std::io::Error),
+    #[error("pkgdb session closed unexpectedly")]
+    SessionClosed,
+    #[error("couldn't parse pkgdb session response")]
+    ParseSessionResponse(#[source] serde_json::Error),
+    #[error("pkgdb session response id {actual:?} didn't match request id {expected}")]
+    SessionIdMismatch { expected: u64, actual: Option<u64> },
 }
 
 /// Call pkgdb and try to parse JSON or error JSON.
@@ -82,6 +89,110 @@ pub fn call_pkgdb(mut pkgdb_cmd: Command) -> Result<Value, CallPkgDbError> {
     }
 }
 
+/// A persistent `pkgdb session` child serving several commands over
+/// stdin/stdout JSON-RPC.
+///
+/// Each request is one JSON line `{"id": n, "args": [..]}` and each response
+/// one JSON line `{"id": n, "exit": code, "stdout": captured_output}`,
+/// so an operation that locks and then builds an environment pays one
+/// process spawn instead of one per command.
+pub struct PkgDbSession {
+    child: Child,
+    /// `None` only while dropping, where taking it closes the pipe.
+    stdin: Option<ChildStdin>,
+    stdout: BufReader<ChildStdout>,
+    next_id: u64,
+}
+
+#[derive(Deserialize)]
+struct SessionResponse {
+    /// Echo of the request id; `None` when the session echoed `null`.
+    #[serde(default)]
+    id: Option<u64>,
+    exit: i32,
+    stdout: String,
+    #[serde(default)]
+    error: Option<String>,
+}
+
+impl PkgDbSession {
+    /// Spawn a `pkgdb session` child with piped stdin/stdout.
+    pub fn start() -> Result<Self, CallPkgDbError> {
+        let mut child = Command::new(&*PKGDB_BIN)
+            .arg("session")
+            .stdin(Stdio::piped())
+            .stdout(Stdio::piped())
+            .spawn()
+            .map_err(CallPkgDbError::PkgDbCall)?;
+        let stdin = child.stdin.take().ok_or(CallPkgDbError::SessionClosed)?;
+        let stdout = child
+            .stdout
+            .take()
+            .map(BufReader::new)
+            .ok_or(CallPkgDbError::SessionClosed)?;
+        Ok(Self {
+            child,
+            stdin: Some(stdin),
+            stdout,
+            next_id: 0,
+        })
+    }
+
+    /// Issue one command to the session and parse its captured stdout,
+    /// with the same success/error JSON handling as [call_pkgdb].
+    pub fn call(&mut self, args: &[impl AsRef<str>]) -> Result<Value, CallPkgDbError> {
+        let id = self.next_id;
+        self.next_id += 1;
+        let args: Vec<&str> = args.iter().map(|arg| arg.as_ref()).collect();
+        let request = serde_json::json!({ "id": id, "args": args });
+        let stdin = self.stdin.as_mut().ok_or(CallPkgDbError::SessionClosed)?;
+        writeln!(stdin, "{request}").map_err(CallPkgDbError::PkgDbCall)?;
+        stdin.flush().map_err(CallPkgDbError::PkgDbCall)?;
+
+        let mut line = String::new();
+        let read = self
+            .stdout
+            .read_line(&mut line)
+            .map_err(CallPkgDbError::PkgDbCall)?;
+        if read == 0 {
+            return Err(CallPkgDbError::SessionClosed);
+        }
+        let response: SessionResponse =
+            serde_json::from_str(&line).map_err(CallPkgDbError::ParseSessionResponse)?;
+        // A desynced stream would otherwise pair this response with the
+        // wrong request; ids are strictly sequential, so any mismatch means
+        // the session can no longer be trusted.
+        if response.id != Some(id) {
+            return Err(CallPkgDbError::SessionIdMismatch {
+                expected: id,
+                actual: response.id,
+            });
+        }
+        if let Some(error) = response.error {
+            return Err(CallPkgDbError::PkgDbCall(std::io::Error::new(
+                std::io::ErrorKind::Other,
+                error,
+            )));
+        }
+        if response.exit != 0 {
+            match serde_json::from_str::<PkgDbError>(&response.stdout) {
+                Ok(pkgdb_err) => Err(pkgdb_err)?,
+                Err(e) => Err(CallPkgDbError::ParsePkgDbError(e))?,
+            }
+        }
+        serde_json::from_str(&response.stdout).map_err(CallPkgDbError::ParseJSON)
+    }
+}
+
+impl Drop for PkgDbSession {
+    fn drop(&mut self) {
+        // Closing stdin ends the session loop; reap the child so it never
+        // outlives its parent as a zombie.
+        drop(self.stdin.take());
+        let _ = self.child.wait();
+    }
+}
+
 /// A struct representing error messages coming from pkgdb
 #[derive(Debug, PartialEq)]
 pub struct PkgDbError {
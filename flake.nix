@@ -18,8 +18,6 @@
   # drop once bear is no longer broken in a newer release
   inputs.nixpkgs-bear.url = "github:NixOS/nixpkgs/release-23.05";
 
-  inputs.floco.url = "github:aakropotkin/floco";
-  inputs.floco.inputs.nixpkgs.follows = "nixpkgs";
 
   inputs.sqlite3pp.url = "github:aakropotkin/sqlite3pp";
   inputs.sqlite3pp.inputs.nixpkgs.follows = "nixpkgs";
@@ -43,7 +41,6 @@
   outputs =
     { self
     , nixpkgs
-    , floco
     , sqlite3pp
     , parser-util
     , pre-commit-hooks
@@ -91,23 +88,6 @@
         nix = final.callPackage ./pkgs/nix { };
       };
 
-      # Cherry pick `semver' recipe from `floco'.
-      overlays.semver = final: prev: {
-        semver =
-          let
-            base = final.callPackage "${floco}/fpkgs/semver" {
-              nixpkgs = throw (
-                "`nixpkgs' should not be references when `pkgsFor' "
-                + "is provided"
-              );
-              inherit (final) lib;
-              pkgsFor = final;
-              nodePackage = final.nodejs;
-            };
-          in
-          base.overrideAttrs (prevAttrs: { preferLocalBuild = false; });
-      };
-
       # bear is broken in release 23.11 on darwin
       overlays.bear = final: prev: {
         inherit (inputs.nixpkgs-bear.legacyPackages.${prev.system}) bear;
@@ -118,7 +98,6 @@
       overlays.deps = nixpkgs.lib.composeManyExtensions [
         parser-util.overlays.default # for `parser-util'
         overlays.nlohmann
-        overlays.semver
         overlays.nix
         overlays.bear
         sqlite3pp.overlays.default
@@ -35,6 +35,26 @@ forceTrivialValue( nix::EvalState & state,
                    nix::PosIdx      pos = nix::noPos );
 
 
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Number of times a flake-ref locking primop has fired in
+ *        this process.
+ *
+ * `builtins.resolve` and `builtins.getFingerprint` lock flake refs at
+ * evaluation time, so even a pure evaluation that calls them is not
+ * determined by its expression text.
+ * Callers caching rendered results snapshot this counter around an
+ * evaluation and skip caching when it moved.
+ */
+[[nodiscard]] unsigned
+flakeRefPrimopCalls();
+
+/** @brief Record that a flake-ref locking primop fired. */
+void
+noteFlakeRefPrimopCall();
+
+
 /* -------------------------------------------------------------------------- */
 
 /**
@@ -52,6 +52,31 @@ void
 initNix();
 
 
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Share one default store connection across all @a NixStoreMixin
+ *        instances in this process.
+ *
+ * One-shot invocations construct a single command object, so each naturally
+ * opens one store; long-lived serving modes ( `pkgdb daemon`/`pkgdb session` )
+ * construct fresh command objects per request and enable sharing so every
+ * request reuses the same connection instead of re-handshaking with
+ * the daemon.
+ */
+void
+enableStoreSharing();
+
+/**
+ * @brief Open the systems default `nix` store.
+ *
+ * Returns the process-shared connection when @a enableStoreSharing has been
+ * called, otherwise opens a fresh connection.
+ */
+[[nodiscard]] std::shared_ptr<nix::Store>
+openDefaultStore();
+
+
 /* -------------------------------------------------------------------------- */
 
 /** @brief Mixin which provides a lazy handle to a `nix` store connection. */
@@ -87,25 +112,33 @@ public:
    */
   explicit NixStoreMixin( const nix::ref<nix::Store> & store )
     : store( static_cast<std::shared_ptr<nix::Store>>( store ) )
-  {
-    initNix();
-  }
+  {}
 
   /**
    * @brief Construct `NixStoreMixin` using the systems default `nix` store.
+   *
+   * Construction is free: global `nix` setup and the store connection are
+   * both deferred to @a getStore, so commands which never touch the store
+   * ( e.g. queries against an existing database ) skip daemon handshake
+   * and store-dir discovery entirely.
    */
-  NixStoreMixin() { initNix(); }
+  NixStoreMixin() = default;
 
 
   /**
    * @brief Lazily open a `nix` store connection.
    *
+   * Performs one time `nix` global setup on first use.
    * Connection remains open for lifetime of object.
    */
   nix::ref<nix::Store>
   getStore()
   {
-    if ( this->store == nullptr ) { this->store = nix::openStore(); }
+    if ( this->store == nullptr )
+      {
+        initNix();
+        this->store = openDefaultStore();
+      }
     return static_cast<nix::ref<nix::Store>>( this->store );
   }
 
@@ -0,0 +1,116 @@
+/* ========================================================================== *
+ *
+ * @file flox/core/trace.hh
+ *
+ * @brief Chrome trace-event span instrumentation.
+ *
+ *
+ * -------------------------------------------------------------------------- */
+
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <utility>
+
+#include <nlohmann/json.hpp>
+
+
+/* -------------------------------------------------------------------------- */
+
+namespace flox {
+
+/* -------------------------------------------------------------------------- */
+
+/** @brief Whether span tracing is active.
+ * Enabled by pointing `FLOX_TRACE` at an output file. */
+[[nodiscard]] bool
+traceEnabled();
+
+
+/**
+ * @brief Record one completed span in the trace file.
+ *
+ * Events use the Chrome trace-event "complete" form, so the output loads
+ * directly into `chrome://tracing`/Perfetto as a flame chart.
+ * No-op unless @a traceEnabled.
+ */
+void
+recordTraceSpan( const std::string &                          name,
+                 const std::chrono::steady_clock::time_point & start,
+                 const std::chrono::steady_clock::time_point & end,
+                 const nlohmann::json &                        args );
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief RAII span: times from construction to destruction.
+ *
+ * Counters attached with @a addArg appear in the span's `args` in the
+ * flame chart.  Costs two branch-predicted checks when tracing is off.
+ */
+class TraceSpan
+{
+
+private:
+
+  std::string                           name;
+  nlohmann::json                        args;
+  std::chrono::steady_clock::time_point start;
+  bool                                  enabled;
+
+
+public:
+
+  explicit TraceSpan( std::string name )
+    : name( std::move( name ) )
+    , args( nlohmann::json::object() )
+    , enabled( traceEnabled() )
+  {
+    if ( this->enabled ) { this->start = std::chrono::steady_clock::now(); }
+  }
+
+  TraceSpan( const TraceSpan & ) = delete;
+  TraceSpan( TraceSpan && )      = delete;
+  TraceSpan &
+  operator=( const TraceSpan & )
+    = delete;
+  TraceSpan &
+  operator=( TraceSpan && )
+    = delete;
+
+  ~TraceSpan()
+  {
+    if ( this->enabled )
+      {
+        recordTraceSpan( this->name,
+                         this->start,
+                         std::chrono::steady_clock::now(),
+                         this->args );
+      }
+  }
+
+
+  /** @brief Attach a counter ( rows, packages, evals, ... ) to the span. */
+  template<typename T>
+  void
+  addArg( const std::string & key, const T & value )
+  {
+    if ( this->enabled ) { this->args[key] = value; }
+  }
+
+
+}; /* End class `TraceSpan' */
+
+
+/* -------------------------------------------------------------------------- */
+
+}  // namespace flox
+
+
+/* -------------------------------------------------------------------------- *
+ *
+ *
+ *
+ * ========================================================================== */
@@ -11,6 +11,7 @@
 
 #include <chrono>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include <nix/eval-cache.hh>
@@ -33,6 +34,15 @@ namespace flox {
  */
 using AttrPath = std::vector<std::string>;
 
+/**
+ * @brief A non-owning view of an attribute path, with components pointing
+ *        into the buffer they were split from.
+ *
+ * Only valid while the underlying buffer is alive; produced
+ * by @a splitAttrPathView for read-only consumers.
+ */
+using AttrPathView = std::vector<std::string_view>;
+
 /**
  * @brief An attribute path which may contain `null` members to
  *        represent _globs_.
@@ -11,6 +11,7 @@
 
 #include <filesystem>
 #include <initializer_list>
+#include <optional>
 #include <sstream>
 #include <string>  // For `std::string' and `std::string_view'
 #include <string_view>
@@ -329,6 +330,18 @@ readAndCoerceJSON( const std::filesystem::path & path );
 [[nodiscard]] std::vector<std::string>
 splitAttrPath( std::string_view path );
 
+/**
+ * @brief Split an attribute path string without copying its components.
+ *
+ * Components are views into @a path ( outer quotes trimmed ) and are only
+ * valid while it is alive.
+ * @return `std::nullopt` when a component contains escape characters and
+ *         cannot be represented as a view; callers should fall back
+ *         to @a splitAttrPath.
+ */
+[[nodiscard]] std::optional<std::vector<std::string_view>>
+splitAttrPathView( std::string_view path );
+
 
 /* -------------------------------------------------------------------------- */
 
@@ -475,6 +488,15 @@ concatStringsSep( const std::string_view sep, const Container & strings )
 
 /* -------------------------------------------------------------------------- */
 
+/** Compile-time verbosity ceiling.
+ * Log sites above this level are dead code the compiler eliminates
+ * entirely, message construction included.  Builds may lower it, e.g.
+ * `-DPKGDB_MAX_VERBOSITY=nix::Verbosity::lvlDebug` strips `traceLog'
+ * sites from hot loops. */
+#ifndef PKGDB_MAX_VERBOSITY
+#  define PKGDB_MAX_VERBOSITY nix::Verbosity::lvlVomit
+#endif
+
 /** @brief Print a log message with the provided log level.
  *
  * This is a macro so that any allocations needed for msg can be optimized out.
@@ -484,7 +506,11 @@ concatStringsSep( const std::string_view sep, const Container & strings )
    * https://github.com/NixOS/nix/blob/09a6e8e7030170611a833612b9f40b9a10778c18/src/libutil/logging.cc#L64 \
    * for lvl to verbosity comparison                                                                       \
    */                                                                                                      \
-  if ( ! ( ( lvl ) > nix::verbosity ) ) { nix::logger->log( lvl, msg ); }
+  if ( ( ( lvl ) <= ( PKGDB_MAX_VERBOSITY ) )                                                              \
+       && ( ! ( ( lvl ) > nix::verbosity ) ) )                                                             \
+    {                                                                                                      \
+      nix::logger->log( lvl, msg );                                                                        \
+    }
 
 /** @brief Prints a log message to `stderr` when called with `-vvvv`. */
 #define traceLog( msg ) printLog( nix::Verbosity::lvlVomit, msg )
@@ -0,0 +1,147 @@
+/* ========================================================================== *
+ *
+ * @file flox/daemon.hh
+ *
+ * @brief Executable command helpers, argument parsers, etc.
+ *
+ *
+ * -------------------------------------------------------------------------- */
+
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <argparse/argparse.hpp>
+
+#include "flox/core/command.hh"
+#include "flox/core/exceptions.hh"
+#include "flox/core/nix-state.hh"
+
+
+/* -------------------------------------------------------------------------- */
+
+namespace flox {
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @class flox::DaemonException
+ * @brief An exception thrown by the `pkgdb daemon' socket server.
+ * @{
+ */
+FLOX_DEFINE_EXCEPTION( DaemonException, EC_FAILURE, "daemon error" )
+/** @} */
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Serve the `pkgdb` command surface over a unix socket.
+ *
+ * A long-lived process keeps nix libstore/libexpr initialization, parsed
+ * configuration, and in-process caches warm, so each served request pays
+ * only its own work rather than full process startup.
+ *
+ * Protocol: each request is a 4-byte network-order length followed by a
+ * JSON object `{ "args": [ ... ] }` holding a `pkgdb` argument vector
+ * ( without the program name ).  Each response is framed the same way and
+ * holds `{ "exit": <code>, "stdout": <captured output> }`.
+ */
+class DaemonCommand : flox::NixState
+{
+
+private:
+
+  /** Dispatch a `pkgdb` argument vector through the normal command table. */
+  std::function<int( const std::vector<std::string> & )> dispatch;
+
+  std::string socketPath;
+
+  command::VerboseParser parser;
+
+  /** @brief Serve a single accepted connection until it closes. */
+  void
+  serveConnection( int conn );
+
+
+public:
+
+  explicit DaemonCommand(
+    std::function<int( const std::vector<std::string> & )> dispatch );
+
+  [[nodiscard]] command::VerboseParser &
+  getParser()
+  {
+    return this->parser;
+  }
+
+  /**
+   * @brief Execute the `daemon` routine.
+   * @return `EXIT_SUCCESS` or `EXIT_FAILURE`.
+   */
+  int
+  run();
+
+
+}; /* End class `DaemonCommand' */
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Serve a sequence of `pkgdb` commands over stdin/stdout.
+ *
+ * Unlike @a flox::DaemonCommand this needs no socket: a parent process
+ * spawns one `pkgdb session` child and issues several commands through its
+ * pipes, halving process spawns for operations that call `pkgdb` more than
+ * once ( e.g. lock followed by buildenv ).
+ *
+ * Protocol: one JSON object per line on stdin, `{ "id": <n>, "args": [...] }`;
+ * one response per line on stdout, `{ "id": <n>, "exit": <code>,
+ * "stdout": <captured output> }`.  The session ends at end-of-stream.
+ */
+class SessionCommand : flox::NixState
+{
+
+private:
+
+  /** Dispatch a `pkgdb` argument vector through the normal command table. */
+  std::function<int( const std::vector<std::string> & )> dispatch;
+
+  command::VerboseParser parser;
+
+
+public:
+
+  explicit SessionCommand(
+    std::function<int( const std::vector<std::string> & )> dispatch );
+
+  [[nodiscard]] command::VerboseParser &
+  getParser()
+  {
+    return this->parser;
+  }
+
+  /**
+   * @brief Execute the `session` routine.
+   * @return `EXIT_SUCCESS` or `EXIT_FAILURE`.
+   */
+  int
+  run();
+
+
+}; /* End class `SessionCommand' */
+
+
+/* -------------------------------------------------------------------------- */
+
+}  // namespace flox
+
+
+/* -------------------------------------------------------------------------- *
+ *
+ *
+ *
+ * ========================================================================== */
@@ -66,7 +66,14 @@ private:
   std::optional<std::string> _semver;
   System                     _system;
   Subtree                    _subtree;
-  std::optional<std::string> _license;
+
+  /* `meta' fields are lazily evaluated on first access and memoized;
+   * forcing `meta' eagerly for every derivation is a large fraction of
+   * scrape CPU and many consumers never read these. */
+  mutable std::optional<std::optional<std::string>> _license;
+  mutable std::optional<std::optional<bool>>        _broken;
+  mutable std::optional<std::optional<bool>>        _unfree;
+  mutable std::optional<std::optional<std::string>> _description;
 
 
   void
@@ -153,12 +160,6 @@ public:
     return this->_subtree;
   }
 
-  [[nodiscard]] nix::DrvName
-  getParsedDrvName() const override
-  {
-    return { this->_fullName };
-  }
-
   [[nodiscard]] std::optional<std::string>
   getVersion() const override
   {
@@ -173,11 +174,7 @@ public:
   }
 
   [[nodiscard]] std::optional<std::string>
-  getLicense() const override
-  {
-    if ( this->_license.has_value() ) { return this->_license; }
-    return std::nullopt;
-  }
+  getLicense() const override;
 
   [[nodiscard]] std::vector<std::string>
   getOutputs() const override
@@ -188,21 +185,7 @@ public:
   }
 
   [[nodiscard]] std::optional<std::string>
-  getDescription() const override
-  {
-    if ( ! this->_hasMetaAttr ) { return std::nullopt; }
-    MaybeCursor description
-      = this->_cursor->getAttr( "meta" )->maybeGetAttr( "description" );
-    if ( description == nullptr ) { return std::nullopt; }
-    try
-      {
-        return description->getString();
-      }
-    catch ( ... )
-      {
-        return std::nullopt;
-      }
-  }
+  getDescription() const override;
 
 
 }; /* End class `FlakePackage' */
@@ -157,6 +157,20 @@ void
 ensureFlakeIsDownloaded( std::function<void()> lambda );
 
 
+/**
+ * @brief Execute several download lambdas concurrently, one child process
+ *        each, and wait for all of them.
+ *
+ * The children populate the shared local `nix` store and fetcher caches, so
+ * the underlying fetches are independent of one another; this runs them in
+ * parallel where @a ensureFlakeIsDownloaded would serialize on the network.
+ * Failure handling matches the single-download form: the first non-zero
+ * child exit status is propagated via `exit` after all children are reaped.
+ */
+void
+ensureFlakesAreDownloaded( const std::vector<std::function<void()>> & lambdas );
+
+
 }  // namespace flox
 
 
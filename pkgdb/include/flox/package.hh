@@ -131,6 +131,10 @@ public:
   /**
    * @return The parsed "package name" prefix of @a this package's
    *         `name` field.
+   *
+   * Parsing runs on every call because `nix::DrvName` can be neither
+   * copied nor moved; prefer @a getPname and @a getVersion, which
+   * concrete implementations answer from pre-parsed fields.
    */
   [[nodiscard]] virtual nix::DrvName
   getParsedDrvName() const
@@ -142,13 +146,23 @@ public:
    * @return `std::nullopt` iff @a this package does not use semantic
    *         versioning, otherwise a normalized semantic version number
    *         coerces from @a this package's `version` information.
+   *
+   * The coercion is memoized; serializing a package repeatedly only pays
+   * for the regex driven @a versions::coerceSemver pass once.
    */
   [[nodiscard]] virtual std::optional<std::string>
   getSemver() const
   {
-    std::optional<std::string> version = this->getVersion();
-    if ( ! version.has_value() ) { return std::nullopt; }
-    return versions::coerceSemver( *version );
+    if ( ! this->semverMemo.has_value() )
+      {
+        std::optional<std::string> version = this->getVersion();
+        if ( version.has_value() )
+          {
+            this->semverMemo.emplace( versions::coerceSemver( *version ) );
+          }
+        else { this->semverMemo.emplace( std::nullopt ); }
+      }
+    return *this->semverMemo;
   }
 
   /**
@@ -172,6 +186,12 @@ public:
   getInfo( bool withDescription = false ) const;
 
 
+private:
+
+  /** Memoized @a getSemver result ( outer `nullopt` = not yet computed ). */
+  mutable std::optional<std::optional<std::string>> semverMemo;
+
+
 }; /* End class `Package' */
 
 
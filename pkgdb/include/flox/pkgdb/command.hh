@@ -112,6 +112,48 @@ public:
 }; /* End class `ScrapeCommand' */
 
 
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Merge partial scrape shard databases into a single database.
+ *
+ * Shards are produced by `pkgdb scrape --shard K/N` runs against the same
+ * flake, each holding a deterministic slice of the attribute pages; merging
+ * every shard yields the database a single full scrape would have produced.
+ */
+class MergeShardsCommand
+{
+
+private:
+
+  command::VerboseParser             parser;
+  std::filesystem::path              targetPath; /**< Merged database path. */
+  std::vector<std::filesystem::path> shardPaths; /**< Shards to absorb. */
+  /** Prefixes to mark complete once every shard has been absorbed. */
+  std::vector<flox::AttrPath> donePrefixes;
+
+
+public:
+
+  MergeShardsCommand();
+
+  [[nodiscard]] command::VerboseParser &
+  getParser()
+  {
+    return this->parser;
+  }
+
+  /**
+   * @brief Execute the `merge-shards` routine.
+   * @return `EXIT_SUCCESS` or `EXIT_FAILURE`.
+   */
+  int
+  run();
+
+
+}; /* End class `MergeShardsCommand' */
+
+
 /* -------------------------------------------------------------------------- */
 
 /**
@@ -129,6 +171,8 @@ public:
  *   + Dump the `LockedFlake` table including fingerprint, locked-ref, etc.
  * - `pkgdb get db FLAKE-REF`
  *   + Print the absolute path to the associated flake's db.
+ * - `pkgdb get pkgs DB-PATH [ATTRS...]`
+ *   + Stream every package ( optionally under `ATTRS` ) as JSON lines.
  */
 class GetCommand
   : public PkgDbMixin<PkgDbReadOnly>
@@ -144,7 +188,9 @@ private:
   command::VerboseParser pFlake; /**< `get flake` parser */
   command::VerboseParser pDb;    /**< `get db`    parser */
   command::VerboseParser pPkg;   /**< `get pkg`   parser */
+  command::VerboseParser pPkgs;  /**< `get pkgs`  parser */
   bool                   isPkg = false;
+  bool                   batch = false;
   row_id                 id    = 0;
 
   /**
@@ -189,6 +235,25 @@ private:
   int
   runPkg();
 
+  /**
+   * @brief Execute the `get pkg --batch` routine.
+   *
+   * Reads newline-delimited targets ( row ids, dotted attribute paths, or
+   * JSON arrays of attribute names ) from `STDIN` and streams one JSON
+   * result per line over the single open database connection, so callers
+   * hydrating many packages pay process startup once.
+   * @return `EXIT_SUCCESS` or `EXIT_FAILURE`.
+   */
+  int
+  runPkgBatch();
+
+  /**
+   * @brief Execute the `get pkgs` routine.
+   * @return `EXIT_SUCCESS` or `EXIT_FAILURE`.
+   */
+  int
+  runPkgs();
+
 
 public:
 
@@ -211,6 +276,84 @@ public:
 }; /* End class `GetCommand' */
 
 
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Report pre-aggregated per-prefix statistics from the `Stats` table.
+ *
+ * Databases predating the table ( or prefixes not yet re-scraped ) fall back
+ * to live aggregation over `Packages`.
+ */
+class StatsCommand
+  : public PkgDbMixin<PkgDbReadOnly>
+  , public command::AttrPathMixin
+{
+
+private:
+
+  command::VerboseParser parser;
+
+
+public:
+
+  StatsCommand();
+
+  [[nodiscard]] command::VerboseParser &
+  getParser()
+  {
+    return this->parser;
+  }
+
+  /**
+   * @brief Execute the `stats` routine.
+   * @return `EXIT_SUCCESS` or `EXIT_FAILURE`.
+   */
+  int
+  run();
+
+
+}; /* End class `StatsCommand' */
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Load popularity ranks into `Packages.popularityRank` so search
+ *        ordering can surface mainstream packages first.
+ *
+ * The dataset is a JSON object mapping `pname` to an integer rank
+ * ( lower is more popular ).
+ */
+class LoadRanksCommand : public PkgDbMixin<PkgDb>
+{
+
+private:
+
+  command::VerboseParser parser;
+  std::filesystem::path  ranksPath;
+
+
+public:
+
+  LoadRanksCommand();
+
+  [[nodiscard]] command::VerboseParser &
+  getParser()
+  {
+    return this->parser;
+  }
+
+  /**
+   * @brief Execute the `load-ranks` routine.
+   * @return `EXIT_SUCCESS` or `EXIT_FAILURE`.
+   */
+  int
+  run();
+
+
+}; /* End class `LoadRanksCommand' */
+
+
 /* -------------------------------------------------------------------------- */
 
 class ListCommand
@@ -265,6 +408,9 @@ private:
   /** minimum age of files not being accessed. */
   int gcStaleAgeDays = 30;
 
+  /** maximum number of databases deleted per run ( 0 = unlimited ). */
+  int gcMaxDelete = 0;
+
   /** Cache dir to collect garbage in */
   std::optional<std::filesystem::path> cacheDir;
 
@@ -290,6 +436,68 @@ public:
 
 /* -------------------------------------------------------------------------- */
 
+/**
+ * @brief Warm flake fetcher caches and package databases ahead of need.
+ *
+ * Takes a registry ( or the registry declared by a manifest ) and performs
+ * the fetch + scrape work that would otherwise happen interactively on the
+ * first `search' or `lock' against a fresh input.
+ * Runs at low scheduling priority so it is suitable for `cron' and
+ * login hooks.
+ */
+class PrefetchCommand : public PkgDbRegistryMixin
+{
+
+private:
+
+  command::VerboseParser parser;
+
+  /** The registry of inputs to fetch and scrape. */
+  RegistryRaw registryRaw;
+
+  /** Systems to scrape, defaulting to the current system. */
+  std::vector<System> systems;
+
+
+protected:
+
+  /** @return The registry assembled from the command line arguments. */
+  [[nodiscard]] RegistryRaw
+  getRegistryRaw() override
+  {
+    return this->registryRaw;
+  }
+
+  /** @return The list of systems to be scraped. */
+  [[nodiscard]] const std::vector<System> &
+  getSystems() override
+  {
+    return this->systems;
+  }
+
+
+public:
+
+  PrefetchCommand();
+
+  [[nodiscard]] command::VerboseParser &
+  getParser()
+  {
+    return this->parser;
+  }
+
+  /**
+   * @brief Execute the `prefetch` routine.
+   * @return `EXIT_SUCCESS` or `EXIT_FAILURE`.
+   */
+  int
+  run();
+
+
+}; /* End class `PrefetchCommand' */
+
+/* -------------------------------------------------------------------------- */
+
 }  // namespace flox::pkgdb
 
 
@@ -53,9 +53,23 @@ protected:
 
 private:
 
-  /** @brief Fill @a flox::RawPackage fields by reading them from @a pkgdb. */
+  /** Whether the rarely used columns have been read yet. */
+  mutable bool detailsLoaded = false;
+
+  /**
+   * @brief Fill the @a flox::RawPackage fields used by resolution.
+   *
+   * Only the cheap name/version columns are read here; the remaining
+   * columns ( outputs, description, etc. ) are loaded on first use by
+   * @a loadDetails so constructing thousands of candidates during group
+   * resolution doesn't drag whole rows through SQLite3.
+   */
+  void
+  initCoreFields( PkgDbReadOnly & pkgdb );
+
+  /** @brief Read and memoize the remaining columns on first use. */
   void
-  initRawPackage( PkgDbReadOnly & pkgdb );
+  loadDetails() const;
 
 
 public:
@@ -64,14 +78,35 @@ public:
     : pkgId( pkgId ), dbPath( pkgdb.dbPath )
   {
     this->path = pkgdb.getPackagePath( pkgId );
-    this->initRawPackage( pkgdb );
+    this->initCoreFields( pkgdb );
   }
 
   DbPackage( PkgDbReadOnly & pkgdb, const AttrPath & path )
     : pkgId( pkgdb.getPackageId( path ) ), dbPath( pkgdb.dbPath )
   {
     this->path = path;
-    this->initRawPackage( pkgdb );
+    this->initCoreFields( pkgdb );
+  }
+
+  [[nodiscard]] std::vector<std::string>
+  getOutputs() const override
+  {
+    this->loadDetails();
+    return this->outputs;
+  }
+
+  [[nodiscard]] std::vector<std::string>
+  getOutputsToInstall() const override
+  {
+    this->loadDetails();
+    return this->outputsToInstall;
+  }
+
+  [[nodiscard]] std::optional<std::string>
+  getDescription() const override
+  {
+    this->loadDetails();
+    return this->description;
   }
 
   /** @return The `Packages.id` of the package. */
@@ -19,6 +19,23 @@ namespace flox::pkgdb {
 
 /* -------------------------------------------------------------------------- */
 
+/**
+ * @brief Record a use of @a dbPath in the cache directory's access index.
+ *
+ * The index is a small registry database which lets `pkgdb gc` find stale
+ * databases without walking the filesystem.
+ * Failures are swallowed; the index is an optimization and must never block
+ * opening a database.
+ */
+void
+touchDbAccess( const std::filesystem::path & cacheDir,
+               const std::filesystem::path & dbPath );
+
+/** @brief Drop @a dbPath from the cache directory's access index. */
+void
+forgetDbAccess( const std::filesystem::path & cacheDir,
+                const std::filesystem::path & dbPath );
+
 /** @brief Find all stale databases in the cache directory. */
 [[nodiscard]] std::vector<std::filesystem::path>
 findStaleDatabases( const std::filesystem::path & cacheDir, int minAgeDays );
@@ -63,6 +63,16 @@ private:
    *   std::optional<std::vector<Subtree>> enabledSubtrees
    */
 
+  /**
+   * Whether @a dbPath was resolved from a fingerprint memo without locking
+   * the flake ( see @a resolveDbPath ).  When set, read connections load
+   * the fingerprint from the database's own `LockedFlake` row and real
+   * locking is deferred until evaluation or writes require it.
+   * Declared ( and thus initialized ) before @a dbPath, whose initializer
+   * sets it.
+   */
+  bool offlineDb = false;
+
   /** Path to the flake's pkgdb SQLite3 file. */
   std::filesystem::path dbPath;
 
@@ -81,6 +91,86 @@ private:
   /** The name of the input, used to emit output with shortnames. */
   std::optional<std::string> name;
 
+  /**
+   * Path to a previous-generation database used to seed an incremental
+   * scrape ( see @a findPreviousDb ), or `std::nullopt` if no usable
+   * previous database exists.
+   */
+  std::optional<std::filesystem::path> seedDbPath;
+
+  /**
+   * Path to a local snapshot of @a dbPath used for reads when the cache
+   * directory sits on a network filesystem ( see @a maybeSnapshotDb ), or
+   * `std::nullopt` when reads go to @a dbPath directly.
+   */
+  std::optional<std::filesystem::path> localDbPath;
+
+  /**
+   * Path to a host-wide read-only copy of this database being used in
+   * place of @a dbPath ( see `PKGDB_SHARED_CACHEDIR` ), or `std::nullopt`
+   * when the per-user database is used.
+   * Cleared by @a getDbReadWrite, which copies the shared database to
+   * @a dbPath before opening a write connection.
+   */
+  std::optional<std::filesystem::path> sharedDbPath;
+
+  /**
+   * @brief Resolve the database path for this input's flake-ref.
+   *
+   * Locking a flake through `nix` fetchers costs hundreds of milliseconds
+   * even when fully cached, so a memo mapping the unlocked flake-ref to
+   * its last locked fingerprint is kept beside the databases.  When the
+   * memo names a database that exists it is used without locking at all;
+   * otherwise the flake is locked and the memo refreshed.
+   * The memo is only trusted for fully locked refs, whose fingerprint
+   * cannot change, unless `PKGDB_OFFLINE` is set to also cover
+   * mutable refs.
+   * @param cacheDir Directory where databases are cached.
+   * @return Path to the database for this input.
+   */
+  [[nodiscard]] std::filesystem::path
+  resolveDbPath( const std::filesystem::path & cacheDir );
+
+  /**
+   * @brief Open a read-only connection to @a dbPath.
+   *
+   * Asserts the database's fingerprint against the locked flake, except
+   * on the offline fast path where the flake is deliberately not locked
+   * and the fingerprint is read from the database itself.
+   */
+  [[nodiscard]] std::shared_ptr<PkgDbReadOnly>
+  openDbReadOnly( const std::string & dbPath );
+
+  /**
+   * @brief Point the read connection at a local snapshot when the cache
+   *        directory is on a network filesystem.
+   *
+   * SQLite page reads over NFS are an order of magnitude slower than local
+   * disk and its locking there is fragile, so the database is mirrored
+   * into a runtime directory with the SQLite backup API and refreshed
+   * whenever the source file changes.  Writes always go to @a dbPath; the
+   * snapshot is re-synced when a write connection closes.
+   * Controlled by `PKGDB_LOCAL_SNAPSHOT`: `0` disables, `1` forces the
+   * snapshot even on local filesystems, unset auto-detects.
+   * @param force Re-copy even when mtimes match; needed after local
+   *              writes since WAL content may not touch the main
+   *              file's mtime.
+   */
+  void
+  maybeSnapshotDb( bool force = false );
+
+  /**
+   * @brief Locate the most recent database in the cache directory whose
+   *        flake _origin_ matches this input.
+   *
+   * The origin comparison ignores volatile locked fields ( `rev`,
+   * `narHash`, `lastModified`, and `revCount` ) so that two revisions of
+   * the same flake match.
+   * @return Path to the previous database, or `std::nullopt`.
+   */
+  [[nodiscard]] std::optional<std::filesystem::path>
+  findPreviousDb();
+
 
   /**
    * @brief Prepare database handles for use.
@@ -98,6 +188,20 @@ private:
   void
   init();
 
+  /**
+   * @brief Scrape an attribute path prefix using a pool of forked
+   *        worker processes.
+   *
+   * Workers claim pages from a shared counter and are long-lived, so each
+   * worker pays the eval state initialization cost once rather than once
+   * per page.
+   * Writes from the workers are serialized by the SQLite database lock.
+   * @param prefix Attribute path to scrape.
+   * @param jobs Number of worker processes to spawn.
+   */
+  void
+  scrapePrefixPool( const flox::AttrPath & prefix, unsigned jobs );
+
 
 public:
 
@@ -146,8 +250,7 @@ public:
               const std::filesystem::path & cacheDir = getPkgDbCachedir(),
               const std::string &           name     = "" )
     : FloxFlakeInput( store, input )
-    , dbPath( genPkgDbName( this->getFlake()->lockedFlake.getFingerprint(),
-                            cacheDir ) )
+    , dbPath( this->resolveDbPath( cacheDir ) )
     , name( name.empty() ? std::nullopt : std::make_optional( name ) )
   {
     this->init();
@@ -211,13 +314,17 @@ public:
 
   /**
    * @brief Get an identifier for this input.
+   *
+   * The locked ref stored in the database is preferred so that listing
+   * inputs never forces a flake lock.
    * @return The shortname of this input, or its locked flake-ref.
    */
   [[nodiscard]] std::string
   getNameOrURL()
   {
-    return this->name.value_or(
-      this->getFlake()->lockedFlake.flake.lockedRef.to_string() );
+    if ( this->name.has_value() ) { return *this->name; }
+    if ( this->dbRO != nullptr ) { return this->dbRO->getLockedRef().string; }
+    return this->getFlake()->lockedFlake.flake.lockedRef.to_string();
   }
 
   /** @brief Get a JSON representation of a row in the database. */
@@ -356,6 +463,39 @@ public:
 }; /* End class `PkgDbRegistryMixin' */
 
 
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Restrict scrape work to one deterministic shard of the page space.
+ *
+ * With @a count machines each running `pkgdb scrape --shard K/N` against the
+ * same flake, pages of top-level attributes are partitioned by
+ * `pageIdx % count == index` so that every page is evaluated by exactly one
+ * machine.  The partial databases produced this way are combined with
+ * `pkgdb merge-shards`.
+ * @param index Zero-based shard index, must be less than @a count.
+ * @param count Total number of shards; values below `2` disable sharding.
+ */
+void
+setScrapeShard( unsigned index, unsigned count );
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Publish @a dbPath to the host-wide database cache.
+ *
+ * No-op unless `PKGDB_SHARED_CACHEDIR` names a directory.  The database
+ * is copied under a temporary name and renamed into place read-only, so
+ * concurrent readers only ever see complete files; an existing entry for
+ * the same fingerprint is left alone.  Failures ( e.g. a root-owned cache
+ * the caller cannot write ) are silently ignored.
+ * @param dbPath Path to the scraped database to publish.
+ */
+void
+publishSharedDb( const std::filesystem::path & dbPath );
+
+
 /* -------------------------------------------------------------------------- */
 
 
@@ -81,6 +81,14 @@ struct PkgQueryArgs
    * Limit the number of results
    * TODO: limit is unused except in the search command. */
   std::optional<uint8_t> limit;
+
+  /**
+   * Resume a federated search after this position in the stable ranking.
+   * Produced as an opaque `next-page-token' by a previous page, so a
+   * follow-up page seeks past already-delivered rows instead of re-sending
+   * them.
+   */
+  std::optional<uint64_t> pageAfter;
   /**
    * Return a single result for each package descriptor used by `search` and
    * `install`. This is a bit hacky as pkgdb shouldn't really have knowledge of
@@ -172,6 +180,27 @@ void
 to_json( nlohmann::json & jto, const PkgQueryArgs & args );
 
 
+/* -------------------------------------------------------------------------- */
+
+/** @brief Ordered results of a federated query across several inputs. */
+struct FederatedResults
+{
+  /** `( input index, Packages.id )` pairs in globally ranked order. */
+  std::vector<std::pair<uint32_t, row_id>> rows;
+  /** Position of each row in the stable ranking, parallel to @a rows.
+   *  The last delivered position serves as the next page's cursor. */
+  std::vector<uint64_t> pageRanks;
+  /** Total number of matches before any `limit` was applied. */
+  size_t totalCount = 0;
+}; /* End struct `FederatedResults' */
+
+
+/* -------------------------------------------------------------------------- */
+
+/* Forward declaration. */
+class PkgQueryCursor;
+
+
 /* -------------------------------------------------------------------------- */
 
 /**
@@ -203,6 +232,14 @@ private:
   /** `( <PARAM-NAME>, <VALUE> )` pairs that need to be _bound_ by SQLite3. */
   std::unordered_map<std::string, std::string> binds;
 
+  /**
+   * Memoized SQL text produced by @a str().
+   * Only bind values differ between the input databases of one search, so
+   * the text is generated once and rebound per input instead of being
+   * rebuilt N times.
+   */
+  mutable std::optional<std::string> builtSql;
+
   /**
    * Final set of columns to expose after all filtering and ordering has been
    * performed on temporary fields.
@@ -288,10 +325,42 @@ private:
   void
   init();
 
+  /**
+   * @brief Generate the SQL text for @a str() from the clause streams.
+   *
+   * Called at most once per @a init(); @a str() memoizes the result.
+   */
+  [[nodiscard]] std::string
+  buildStr() const;
+
   /** @brief A helper to format and escape a string for use in a LIKE clause */
   std::string
   mkPatternString( const std::string & matchString );
 
+  /**
+   * @brief A helper to format and escape a string as a quoted phrase for use
+   *        in an FTS5 `MATCH` clause.
+   */
+  std::string
+  mkFtsMatchString( const std::string & matchString );
+
+  /**
+   * @brief Produce the inner `SELECT` statement against a single
+   *        `ATTACH`ed schema, used as one branch of a federated query.
+   * @param schema Name the database was `ATTACH`ed under.
+   * @param idx The input's index, exposed as the `inputRank` column.
+   */
+  [[nodiscard]] std::string
+  mkInnerSelect( const std::string & schema, size_t idx ) const;
+
+  /**
+   * @brief Produce an unbound `UNION ALL` statement querying every schema in
+   *        @a schemas with a single global `ORDER BY` and, when no `semver`
+   *        post-processing is required, `LIMIT`.
+   */
+  [[nodiscard]] std::string
+  strFederated( const std::vector<std::string> & schemas ) const;
+
 public:
 
   PkgQuery() { this->init(); }
@@ -314,6 +383,8 @@ public:
    * This must be run after @a init().
    * The returned string still needs to be processed to _bind_ host parameters
    * from @a binds before being executed.
+   * The text is memoized; querying several input databases with one
+   * @a PkgQuery only generates it once.
    * @return An unbound SQL query string.
    */
   [[nodiscard]] std::string
@@ -338,10 +409,95 @@ public:
   [[nodiscard]] std::vector<row_id>
   execute( sqlite3pp::database & pdb ) const;
 
+  /**
+   * @brief Begin streaming satisfactory rows from a given database.
+   *
+   * Unlike @a execute() no result set is materialized; rows are produced one
+   * at a time as the caller pulls them, so consumers with a `limit` can stop
+   * early without paying for the full result set.
+   * `semver` filtering is applied lazily per row.
+   */
+  [[nodiscard]] PkgQueryCursor
+  start( sqlite3pp::database & pdb ) const;
+
+  /**
+   * @brief Query several databases `ATTACH`ed to @a pdb under the names
+   *        @a schemas in a single statement.
+   *
+   * Results are ranked globally rather than per-input, and `limit` is pushed
+   * into SQL unless `semver` filtering must run as a post-processing step
+   * ( in which case trimming is left to the caller ).
+   */
+  [[nodiscard]] FederatedResults
+  executeFederated( sqlite3pp::database &            pdb,
+                    const std::vector<std::string> & schemas ) const;
+
+  /**
+   * @brief Run `EXPLAIN QUERY PLAN` for this query against @a pdb.
+   * @return One human-readable plan detail line per step.
+   */
+  [[nodiscard]] std::vector<std::string>
+  explain( sqlite3pp::database & pdb ) const;
+
+  /**
+   * @brief Resolve a batch of queries against @a pdb in a single statement.
+   *
+   * Each argset becomes a `UNION ALL` branch tagged with its index, so a
+   * whole descriptor group is answered in one pass over the database rather
+   * than one round-trip per descriptor.
+   * @return For each argset the first satisfactory `Packages.id`, if any,
+   *         in the same order as @a argsList.
+   */
+  [[nodiscard]] static std::vector<std::optional<row_id>>
+  executeMany( sqlite3pp::database &             pdb,
+               const std::vector<PkgQueryArgs> & argsList );
+
 
 }; /* End class `PkgQuery' */
 
 
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief A streaming cursor over the results of a @a PkgQuery.
+ *
+ * Wraps the underlying `sqlite3pp::query` so rows are stepped on demand
+ * instead of being collected up front.
+ * Created by @a PkgQuery::start().
+ */
+class PkgQueryCursor
+{
+
+private:
+
+  struct State; /* Defined in `pkg-query.cc'. */
+  std::shared_ptr<State> state;
+
+  explicit PkgQueryCursor( std::shared_ptr<State> state )
+    : state( std::move( state ) )
+  {}
+
+  friend class PkgQuery;
+
+
+public:
+
+  PkgQueryCursor() = default;
+
+  /**
+   * @brief Advance to the next satisfactory row.
+   *
+   * Rows failing a `semver` range are skipped here, with per-version
+   * satisfaction results memoized so each distinct version is checked once.
+   * @return The next `Packages.id`, or `std::nullopt` once exhausted.
+   */
+  [[nodiscard]] std::optional<row_id>
+  next();
+
+
+}; /* End class `PkgQueryCursor' */
+
+
 /* -------------------------------------------------------------------------- */
 
 }  // namespace flox::pkgdb
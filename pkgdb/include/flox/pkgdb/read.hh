@@ -11,6 +11,8 @@
 
 #include <filesystem>
 #include <functional>
+#include <memory>
+#include <ostream>
 #include <queue>
 #include <string>
 #include <thread>
@@ -46,6 +48,12 @@ namespace flox::pkgdb {
 /** SQLite3 busy timeout in milliseconds. */
 constexpr int DB_BUSY_TIMEOUT = 250 * 1000;
 
+/** SQLite3 `mmap_size` applied to read-only connections, in bytes. */
+constexpr long long DB_MMAP_SIZE = 256LL * 1024 * 1024;
+
+/** SQLite3 `cache_size` applied to read-only connections, in KiB. */
+constexpr int DB_CACHE_SIZE_KIB = 32 * 1024;
+
 
 /* -------------------------------------------------------------------------- */
 
@@ -99,7 +107,17 @@ operator<<( std::ostream & oss, const SqlVersions & versions );
 
 
 /** The current SQLite3 schema versions. */
-constexpr SqlVersions sqlVersions = { .tables = 2, .views = 4 };
+constexpr SqlVersions sqlVersions = { .tables = 11, .views = 9 };
+
+/**
+ * Value stamped into `PRAGMA application_id` to identify pkgdb files
+ * ( spells "FLOX" ).
+ * Databases carrying it mirror their schema versions into
+ * `PRAGMA user_version` as `( tables << 16 ) | views`, letting
+ * @a PkgDbReadOnly::getDbVersion answer from the file header instead of
+ * querying the `DbVersions` table.
+ */
+constexpr int pkgDbApplicationId = 0x464C4F58;
 
 
 /* -------------------------------------------------------------------------- */
@@ -132,6 +150,50 @@ genPkgDbName( const Fingerprint &           fingerprint,
               const std::filesystem::path & cacheDir = getPkgDbCachedir() );
 
 
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Convert a description to its stored form.
+ *
+ * Descriptions longer than a small threshold are stored as `zstd` frames to
+ * shrink the database; short ones ( the common case ) and inputs that are
+ * already compressed are returned unchanged.
+ */
+std::string
+compressDescription( const std::string & description );
+
+/**
+ * @brief Convert a stored description back to plain text.
+ *
+ * Plain text rows ( including all rows written by older databases ) pass
+ * through unchanged.
+ */
+std::string
+decompressDescription( const std::string & stored );
+
+/**
+ * @brief Read a stored description column from @a row with its
+ *        explicit length.
+ *
+ * `zstd` frames contain NUL bytes, so the C-string backed `std::string`
+ * accessor would truncate them mid-frame.
+ * @return The raw stored bytes, or an empty string for a `NULL` column.
+ */
+[[nodiscard]] std::string
+getStoredDescription( const sqlite3pp::query::rows & row, int col );
+
+/**
+ * @brief Register pkgdb's custom SQL functions on a database connection.
+ *
+ * Currently this registers `uncompress_description`, used by views to expose
+ * plain text descriptions regardless of their stored form.
+ * @return An opaque handle which must be kept alive as long as the connection
+ *         may invoke the registered functions.
+ */
+[[nodiscard]] std::shared_ptr<void>
+registerSqlFunctions( SQLiteDb & pdb );
+
+
 /* -------------------------------------------------------------------------- */
 
 /**
@@ -145,9 +207,14 @@ class PkgDbReadOnly
 
 public:
 
-  Fingerprint           fingerprint; /**< Unique hash of associated flake. */
-  std::filesystem::path dbPath;      /**< Absolute path to database. */
-  SQLiteDb              db;          /**< SQLite3 database handle. */
+  /**
+   * Unique hash of associated flake.
+   * Loaded lazily from database metadata - use @a getFingerprint unless you
+   * know the field has already been filled.
+   */
+  Fingerprint           fingerprint;
+  std::filesystem::path dbPath; /**< Absolute path to database. */
+  SQLiteDb              db;     /**< SQLite3 database handle. */
 
   /** @brief Locked _flake reference_ for database's flake. */
   struct LockedFlakeRef
@@ -156,7 +223,25 @@ public:
     /** Exploded form of URI as an attr-set. */
     nlohmann::json attrs = nlohmann::json::object();
   };
-  struct LockedFlakeRef lockedRef; /**< Locked _flake reference_. */
+  /**
+   * Locked _flake reference_.
+   * Loaded lazily from database metadata - use @a getLockedRef unless you
+   * know the field has already been filled.
+   */
+  struct LockedFlakeRef lockedRef;
+
+protected:
+
+  /** Whether `LockedFlake` metadata has been read from the database. */
+  bool lockedFlakeLoaded = false;
+
+  /**
+   * Keeps custom SQL functions registered by @a registerSqlFunctions alive
+   * for the lifetime of the connection.
+   */
+  std::shared_ptr<void> sqlFunctions;
+
+public:
 
 
   /* Errors */
@@ -215,7 +300,7 @@ public:
    * @param dbPath Absolute path to database file.
    */
   explicit PkgDbReadOnly( std::string_view dbPath )
-    : fingerprint( nix::htSHA256 ) /* Filled by `loadLockedFlake' later */
+    : fingerprint( nix::htSHA256 ) /* Filled on first metadata access */
     , dbPath( dbPath )
   {
     this->init();
@@ -265,6 +350,41 @@ public:
   SqlVersions
   getDbVersion();
 
+  /**
+   * @brief Read the schema version from the `DbVersions` table.
+   *
+   * Fallback for databases created before versions were mirrored into
+   * `PRAGMA user_version`; @a getDbVersion prefers the header fields.
+   */
+  SqlVersions
+  getDbVersionFromTable();
+
+  /**
+   * @brief Get the flake fingerprint associated with this database.
+   *
+   * `LockedFlake` metadata is parsed on first access so queries which only
+   * touch `Packages` never pay for it.
+   */
+  [[nodiscard]] const Fingerprint &
+  getFingerprint()
+  {
+    if ( ! this->lockedFlakeLoaded ) { this->loadLockedFlake(); }
+    return this->fingerprint;
+  }
+
+  /**
+   * @brief Get the locked _flake reference_ associated with this database.
+   *
+   * `LockedFlake` metadata is parsed on first access so queries which only
+   * touch `Packages` never pay for it.
+   */
+  [[nodiscard]] const LockedFlakeRef &
+  getLockedRef()
+  {
+    if ( ! this->lockedFlakeLoaded ) { this->loadLockedFlake(); }
+    return this->lockedRef;
+  }
+
   /**
    * @brief Get the `AttrSet.id` for a given path.
    * @param path An attribute path prefix such as `packages.x86_64-linux` or
@@ -274,6 +394,16 @@ public:
   row_id
   getAttrSetId( const flox::AttrPath & path );
 
+  /**
+   * @brief Get the `AttrSet.id` for a given path without owning its
+   *        components.
+   * @param path A view of an attribute path prefix, e.g. as produced
+   *             by @a splitAttrPathView.
+   * @return A unique `row_id` ( unsigned 64bit int ) associated with @a path.
+   */
+  row_id
+  getAttrSetId( const flox::AttrPathView & path );
+
   /**
    * @brief Check to see if database has and attribute set at @a path.
    * @param path An attribute path prefix such as `packages.x86_64-linux` or
@@ -361,6 +491,18 @@ public:
   std::vector<row_id>
   getPackages( const PkgQueryArgs & params );
 
+  /**
+   * @brief Resolve a batch of queries in a single pass over the database.
+   *
+   * All argsets are compiled into one `UNION ALL` statement, so resolving a
+   * whole descriptor group costs one round-trip instead of one per
+   * descriptor.
+   * @return The first satisfactory `Packages.id` per argset ( if any ),
+   *         in the same order as @a argsList.
+   */
+  std::vector<std::optional<row_id>>
+  queryMany( const std::vector<PkgQueryArgs> & argsList );
+
   /**
    * @brief Get metadata about a single package.
    *
@@ -383,17 +525,65 @@ public:
   nlohmann::json
   getPackage( const flox::AttrPath & path );
 
+  /**
+   * @brief Write one JSON object per line for every package to @a out.
+   *
+   * Rows are serialized and written as they stream off the query cursor, so
+   * memory usage is constant regardless of result size; this is the bulk
+   * export path for piping package metadata into downstream tools.
+   * @param out The stream to write to.
+   * @param prefix An optional attribute path; when given only packages under
+   *               that prefix are emitted.
+   */
+  void
+  streamPackages( std::ostream &                        out,
+                  const std::optional<flox::AttrPath> & prefix = std::nullopt );
+
   [[nodiscard]] nix::FlakeRef
-  getLockedFlakeRef() const
+  getLockedFlakeRef()
   {
     return nix::FlakeRef::fromAttrs(
-      nix::fetchers::jsonToAttrs( this->lockedRef.attrs ) );
+      nix::fetchers::jsonToAttrs( this->getLockedRef().attrs ) );
   }
 
 
 }; /* End class `PkgDbReadOnly' */
 
 
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Open a read-only database connection from a process-wide pool.
+ *
+ * Within one invocation the same fingerprint database is often opened by
+ * several callers ( search, resolution, locking ); pooling lets them share a
+ * single connection along with its page cache and registered SQL functions.
+ * The pool holds weak references, so a connection closes once every handle to
+ * it has been dropped.
+ */
+[[nodiscard]] std::shared_ptr<PkgDbReadOnly>
+openPkgDbReadOnly( const std::string & dbPath );
+
+/**
+ * @brief As above, but additionally asserts that the database's fingerprint
+ *        matches @a fingerprint.
+ */
+[[nodiscard]] std::shared_ptr<PkgDbReadOnly>
+openPkgDbReadOnly( const Fingerprint & fingerprint, const std::string & dbPath );
+
+/**
+ * @brief Control whether pooled read-only handles outlive their last user.
+ *
+ * One-shot invocations want the default weak-reference behavior so
+ * connections close promptly; long-lived serving modes
+ * ( `pkgdb daemon`/`pkgdb session` ) enable retention so consecutive
+ * commands against the same database are pool hits rather than re-opens.
+ * Disabling retention releases all retained handles.
+ */
+void
+setDbHandleRetention( bool retain );
+
+
 /* -------------------------------------------------------------------------- */
 
 /**
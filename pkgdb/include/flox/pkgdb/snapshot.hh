@@ -0,0 +1,111 @@
+/* ========================================================================== *
+ *
+ * @file flox/pkgdb/snapshot.hh
+ *
+ * @brief Frozen read-only snapshots of package databases.
+ *
+ * A snapshot is a single memory-mapped file emitted after a scrape which
+ * serves exact `name'/`pname'/`attrName' lookups without opening SQLite3.
+ * It holds pre-rendered package records and a sorted hash index over the
+ * name columns, so interactive `search' invocations against a warm file
+ * cost a binary search and a few string compares.
+ *
+ * Snapshots are an optimization only: they are regenerated wholesale, never
+ * mutated, and every reader falls back to the database when the file is
+ * missing, stale, or the query needs SQL.
+ *
+ *
+ * -------------------------------------------------------------------------- */
+
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "flox/pkgdb/pkg-query.hh"
+
+
+/* -------------------------------------------------------------------------- */
+
+namespace flox::pkgdb {
+
+/* -------------------------------------------------------------------------- */
+
+/** @brief Get the snapshot filename associated with a database path. */
+[[nodiscard]] std::filesystem::path
+genDbSnapshotName( const std::filesystem::path & dbPath );
+
+
+/**
+ * @brief Write ( or replace ) the snapshot for the database at @a dbPath.
+ *
+ * The file is produced in a temporary location and renamed into place so
+ * concurrent readers always see a complete snapshot.
+ */
+void
+writeDbSnapshot( const std::filesystem::path & dbPath );
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @class flox::pkgdb::PkgDbSnapshot
+ * @brief A memory-mapped read-only view of a database snapshot.
+ */
+class PkgDbSnapshot
+{
+
+private:
+
+  /** Mapped file contents; defined in `snapshot.cc'. */
+  struct State;
+  std::shared_ptr<State> state;
+
+  explicit PkgDbSnapshot( std::shared_ptr<State> state )
+    : state( std::move( state ) )
+  {}
+
+
+public:
+
+  /**
+   * @brief Open the snapshot for @a dbPath if one exists and is at least as
+   *        new as the database itself.
+   * @return The snapshot, or `nullptr` when unusable.
+   */
+  [[nodiscard]] static std::shared_ptr<PkgDbSnapshot>
+  tryOpen( const std::filesystem::path & dbPath );
+
+  /**
+   * @brief Whether @a params can be answered from a snapshot.
+   *
+   * Only exact `name'/`pname'/`pnameOrAttrName' lookups qualify; anything
+   * needing pattern matching, version constraints, or deduplication goes
+   * through SQL.
+   */
+  [[nodiscard]] static bool
+  supports( const PkgQueryArgs & params );
+
+  /**
+   * @brief Look up packages matching @a params.
+   * @return Pre-rendered JSON records in scrape-time relevance order.
+   */
+  [[nodiscard]] std::vector<std::string>
+  lookup( const PkgQueryArgs & params ) const;
+
+
+}; /* End class `PkgDbSnapshot' */
+
+
+/* -------------------------------------------------------------------------- */
+
+}  // namespace flox::pkgdb
+
+
+/* -------------------------------------------------------------------------- *
+ *
+ *
+ *
+ * ========================================================================== */
@@ -9,8 +9,14 @@
 
 #pragma once
 
+#include <map>
+#include <memory>
+#include <optional>
 #include <stack>
 #include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include "flox/pkgdb/read.hh"
 
@@ -31,6 +37,109 @@ using Target = std::tuple<flox::AttrPath, flox::Cursor, row_id>;
 using Todos = std::stack<Target, std::list<Target>>;
 
 
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Number of attributes processed between intra-page commits during a scrape.
+ * This bounds how much evaluation a crashed scrape has to repeat on resume.
+ */
+constexpr std::size_t SCRAPE_CHECKPOINT_INTERVAL = 500;
+
+
+/* -------------------------------------------------------------------------- */
+
+/* Scrape rules */
+
+/**
+ * @brief Allow/deny attribute path rules compiled into a prefix trie and
+ *        consulted before any cursor forcing during a scrape.
+ *
+ * Rules are loaded from the JSON file named by `PKGDB_SCRAPE_RULES`:
+ * `{ "allow": [ "legacyPackages.*.darwin" ], "deny": [ "*.*.tests" ] }`.
+ * A `*` component matches any attribute name; the most specific matching
+ * rule wins and unmatched paths are allowed.
+ * Skipping evaluation entirely is the cheapest optimization available, so
+ * the trie is consulted before a child cursor is forced.
+ */
+class ScrapeRules
+{
+
+private:
+
+  struct Node
+  {
+    std::map<std::string, Node> children;
+    std::optional<bool>         allow;
+  };
+
+  Node root;
+
+
+public:
+
+  /** @brief Compile a single dotted pattern into the trie. */
+  void
+  addRule( const flox::AttrPath & pattern, bool allow );
+
+  /** @return The verdict for @a path; unmatched paths are allowed. */
+  [[nodiscard]] bool
+  allowed( const flox::AttrPath & path ) const;
+
+  /** @return Whether no rules are loaded. */
+  [[nodiscard]] bool
+  empty() const
+  {
+    return this->root.children.empty();
+  }
+
+  /** @brief Get rules loaded ( once ) from `PKGDB_SCRAPE_RULES`. */
+  [[nodiscard]] static const ScrapeRules &
+  get();
+
+
+}; /* End class `ScrapeRules' */
+
+
+/* -------------------------------------------------------------------------- */
+
+/* Progress event stream */
+
+/**
+ * @brief Whether newline-delimited JSON progress events are enabled.
+ *
+ * Enabled by `pkgdb scrape --progress-json` or the environment variable
+ * `PKGDB_PROGRESS_JSON`.
+ */
+[[nodiscard]] bool
+progressJsonEnabled();
+
+/** @brief Enable/disable the JSON progress event stream. */
+void
+setProgressJsonEnabled( bool enabled );
+
+/**
+ * @brief Emit a single JSON progress event to `STDERR`.
+ *
+ * Events carry the given @a fields plus `event`, a millisecond timestamp,
+ * and the process' peak RSS; each event is a single atomic line so streams
+ * from concurrent scrape workers interleave cleanly.
+ * No-op unless @a progressJsonEnabled.
+ */
+void
+emitProgressEvent( const std::string & event, nlohmann::json fields );
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Get the path to `nix`'s eval-cache database for a fingerprint.
+ * @return The path to the eval-cache database, or `std::nullopt` if no
+ *         cache exists for @a fingerprint.
+ */
+std::optional<std::filesystem::path>
+genEvalCachePath( const Fingerprint & fingerprint );
+
+
 /* -------------------------------------------------------------------------- */
 
 /**
@@ -40,6 +149,34 @@ using Todos = std::stack<Target, std::list<Target>>;
 class PkgDb : public PkgDbReadOnly
 {
 
+private:
+
+  /* Prepared statements for the hot insert paths.
+   * Statement compilation is a measurable fraction of scrape write time, so
+   * these are prepared on first use and rebound per row for the life of
+   * the connection. */
+  std::unique_ptr<sqlite3pp::command> stmtInsertAttrSet;
+  std::unique_ptr<sqlite3pp::query>   qryAttrSetId;
+  std::unique_ptr<sqlite3pp::query>   qryDescriptionId;
+  std::unique_ptr<sqlite3pp::command> stmtInsertDescription;
+  std::unique_ptr<sqlite3pp::command> stmtInsertPackage;
+
+  /* Session-local `done' bookkeeping.
+   * `completedAttrSet' is a SQL round trip per scrape target and
+   * `setPrefixDone' fires a subtree UPDATE per completed set; both
+   * interleave with the insert batch.  Scrapes instead consult/extend this
+   * cache and queue completed subtrees, flushing the `done' column in one
+   * pass at transaction boundaries ( see @a flushDonePrefixes ). */
+  std::unordered_set<row_id> doneAttrSets;
+  std::vector<row_id>        pendingDonePrefixes;
+
+  /* Session cache for description deduplication.
+   * Descriptions repeat heavily across nixpkgs variants, so after the
+   * first occurrence pays the SELECT-then-INSERT ( and compression ),
+   * repeats resolve here without touching SQLite at all. */
+  std::unordered_map<std::string, row_id> descriptionIds;
+
+
   /* Internal Helpers */
 
 protected:
@@ -53,6 +190,31 @@ protected:
   void
   init();
 
+
+public:
+
+  /**
+   * @brief Apply any pending schema migrations in a transaction.
+   *
+   * Steps are ordered and upgrade the tables schema one version at a time;
+   * see `pkgdb/migrations.hh`.
+   * @return `true` iff the database is at the current tables version
+   *         afterwards.  `false` means no migration path exists and the
+   *         caller should fall back to re-scraping.
+   */
+  bool
+  migrate();
+
+  /**
+   * @brief Whether an unbroken chain of migration steps exists from
+   *        @a tablesVersion to the current tables schema version.
+   */
+  [[nodiscard]] static bool
+  canMigrateFrom( unsigned tablesVersion );
+
+
+protected:
+
   /* Constructors */
 
 public:
@@ -212,6 +374,133 @@ public:
               std::string_view     attrName,
               const flox::Cursor & cursor );
 
+  /* Eval-cache import */
+
+  /**
+   * @brief Populate @a this database for @a prefix directly from `nix`'s
+   *        eval-cache SQLite database, without instantiating eval values.
+   *
+   * Only succeeds when every attribute under @a prefix was previously
+   * evaluated and cached; any miss rolls the import back so the caller can
+   * fall back to cursor evaluation.
+   * @param evalCachePath Path to the eval-cache database for this flake's
+   *                      fingerprint ( see @a genEvalCachePath ).
+   * @param prefix Attribute path prefix to import.
+   * @return Whether the prefix was fully imported.
+   */
+  bool
+  importEvalCache( const std::filesystem::path & evalCachePath,
+                   const flox::AttrPath &        prefix );
+
+  /* Incremental scraping */
+
+  /** Whether a _seed_ database is attached ( see @a attachSeed ). */
+  bool seeded = false;
+
+  /**
+   * @brief Attach a previous-generation database to seed an
+   *        incremental scrape.
+   *
+   * While a seed is attached @a addPackage will copy rows from the seed for
+   * attributes whose cheap identity ( the `name` attribute ) is unchanged,
+   * skipping the expensive `meta` evaluation entirely.
+   * @param seedPath Absolute path to the previous database file.
+   */
+  void
+  attachSeed( const std::filesystem::path & seedPath );
+
+  /**
+   * @brief Try to copy a package row from the seed database.
+   *
+   * The row is matched by its absolute attribute path and `name`; a miss
+   * means the attribute is new or changed and must be fully evaluated.
+   * @param parentId The `pathId` associated with the parent path.
+   * @param attrName The name of the attribute to be added.
+   * @param name The derivation `name` of the candidate package.
+   * @return Whether a row was copied.
+   */
+  bool
+  copySeedPackage( row_id              parentId,
+                   std::string_view    attrName,
+                   const std::string & name );
+
+  /**
+   * @brief Copy all rows from a _shard_ database into @a this database.
+   *
+   * The shard must use the same schema as @a this database, but may have
+   * been populated independently so its `AttrSets`, `Descriptions`, and
+   * `Packages` _row ids_ are remapped as rows are copied.
+   *
+   * The shard is `ATTACH`ed to @a this connection and bulk-copied inside a
+   * single transaction.
+   * @param shardPath Absolute path to the shard database file.
+   */
+  void
+  absorbShard( const std::filesystem::path & shardPath );
+
+  /* Checkpoints */
+
+  /**
+   * @brief Get the number of attributes already committed for a page.
+   * @param prefixId `AttrSets.id` for the prefix being scraped.
+   * @param pageIdx The page being processed.
+   * @return Count of attributes committed for the page, `0` for a
+   *         fresh page.
+   */
+  [[nodiscard]] std::size_t
+  getScrapeProgress( row_id prefixId, std::size_t pageIdx );
+
+  /**
+   * @brief Record the number of attributes committed for a page.
+   *
+   * Written in the same transaction as the page's rows so the checkpoint
+   * can never run ahead of the data it describes.
+   * @param prefixId `AttrSets.id` for the prefix being scraped.
+   * @param pageIdx The page being processed.
+   * @param doneCount Count of attributes committed for the page.
+   */
+  void
+  setScrapeProgress( row_id prefixId, std::size_t pageIdx,
+                     std::size_t doneCount );
+
+  /* Eval-failure memo */
+
+  /**
+   * @brief Memoize an attribute that threw a `nix::EvalError`.
+   *
+   * Later scrapes consult the memo and skip the attribute instead of
+   * repeating the eval; failures run all the way to their throw point, so
+   * they are the most expensive attributes to revisit.
+   * The memo lives in this database, which is keyed by the flake
+   * fingerprint, so entries never outlive the revision ( and eval cache )
+   * that produced them.
+   * @param parentId `AttrSets.id` of the containing attribute set.
+   * @param attrName The attribute that failed to evaluate.
+   * @param errorMsg The eval error message ( stored for debugging only ).
+   */
+  void
+  addEvalFailure( row_id           parentId,
+                  std::string_view attrName,
+                  std::string_view errorMsg );
+
+  /**
+   * @brief Get the memoized eval failures for one attribute set.
+   * @param parentId `AttrSets.id` of the attribute set.
+   * @return Names of child attributes known to fail evaluation.
+   */
+  [[nodiscard]] std::unordered_set<std::string>
+  getEvalFailures( row_id parentId );
+
+  /**
+   * @brief Drop memoized eval failures for @a prefix and its children,
+   *        forcing them to be re-evaluated by the next scrape.
+   *
+   * Used by `pkgdb scrape --force` alongside clearing `done` flags.
+   * @param prefix Attribute set prefix to be cleared.
+   */
+  void
+  clearEvalFailures( const flox::AttrPath & prefix );
+
   /* Updates */
 
   /**
@@ -232,6 +521,85 @@ public:
   void
   setPrefixDone( const flox::AttrPath & prefix, bool done );
 
+  /**
+   * @brief Whether @a row is _done_, consulting the session cache first.
+   *
+   * Falls back to @a completedAttrSet and caches a positive answer; rows
+   * never go from _done_ back to pending within one scrape session.
+   * @param row `AttrSets.id` to check.
+   */
+  [[nodiscard]] bool
+  completedAttrSetCached( row_id row );
+
+  /**
+   * @brief Queue @a prefixId as _done_, deferring the column update.
+   *
+   * The session cache answers @a completedAttrSetCached immediately; the
+   * `done` column itself is written by the next @a flushDonePrefixes so
+   * subtree UPDATEs never interleave with the insert batch.
+   * @param prefixId `AttrSets.id` of the completed subtree root.
+   */
+  void
+  queuePrefixDone( row_id prefixId );
+
+  /**
+   * @brief Flush queued subtree completions to the `done` column.
+   *
+   * Called at transaction boundaries so completions persist with the same
+   * commit as the rows they cover.
+   */
+  void
+  flushDonePrefixes();
+
+  /**
+   * @brief Drop session caches ( done flags, description ids ).
+   *
+   * Required after deleting rows out from under a live connection, e.g.
+   * when test fixtures clear tables between cases; scrapes never need it.
+   */
+  void
+  clearSessionCaches()
+  {
+    this->doneAttrSets.clear();
+    this->pendingDonePrefixes.clear();
+    this->descriptionIds.clear();
+  }
+
+  /**
+   * @brief Record the wall-clock scrape duration for @a prefix in `Stats`.
+   *
+   * The remaining `Stats` columns are refreshed by @a setPrefixDone; the
+   * duration is recorded separately since only the scrape driver sees the
+   * whole run.
+   * @param prefix Attribute set prefix that was scraped.
+   * @param millis Wall-clock duration of the scrape in milliseconds.
+   */
+  void
+  recordScrapeDuration( const flox::AttrPath & prefix, long long millis );
+
+  /**
+   * @brief Refresh SQLite3 planner statistics.
+   *
+   * Run after a scrape completes so readers plan against real table
+   * shapes instead of guesses.
+   */
+  void
+  analyze();
+
+  /**
+   * @brief Load popularity ranks from a dataset into
+   *        `Packages.popularityRank`.
+   *
+   * The dataset is a JSON object mapping `pname` to an integer rank
+   * ( lower is more popular ); packages absent from the dataset keep
+   * their previous rank.  Applied in one transaction with a single
+   * prepared statement.
+   * @param ranksPath Path to the dataset file.
+   * @return Number of `Packages` rows now carrying a rank.
+   */
+  std::size_t
+  loadPopularityRanks( const std::filesystem::path & ranksPath );
+
   /**
    * @brief Scrape package definitions from an attribute set.
    *
@@ -246,13 +614,26 @@ public:
    *               and a SQLite _row id_.
    * @param pageSize The size of chunks to process at a time.
    * @param pageIdx The specific page to process in this invocation.
+   * @param markPrefixDone Whether to mark the prefix _done_ when the last
+   *                       page is processed.
+   *                       Concurrent scrapers process pages out of order and
+   *                       must mark the prefix _done_ themselves once every
+   *                       page has been committed.
+   * @param hitWatermark When non-null, the page is ended early if the
+   *                     process' resident set exceeds the RSS watermark
+   *                     ( `PKGDB_SCRAPE_RSS_WATERMARK_MB` ), and `true` is
+   *                     stored here.
+   *                     Progress survives in `ScrapeProgress` so a fresh
+   *                     process resumes the same page past completed work.
    * @return True if the entire attribute set has been processed.
    */
   bool
   scrape( nix::SymbolTable & syms,
           const Target &     target,
           std::size_t        pageSize,
-          std::size_t        pageIdx );
+          std::size_t        pageIdx,
+          bool               markPrefixDone = true,
+          bool *             hitWatermark   = nullptr );
 
 
 }; /* End class `PkgDb' */
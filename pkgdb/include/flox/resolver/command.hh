@@ -11,6 +11,8 @@
 
 #include <filesystem>
 #include <optional>
+#include <string>
+#include <vector>
 
 #include "flox/resolver/manifest-raw.hh"
 #include "flox/resolver/mixins.hh"
@@ -29,8 +31,22 @@ class LockCommand : public GAEnvironmentMixin
 
 private:
 
+  /** Lock several manifests in one invocation, sharing setup. */
+  bool batch = false;
+
+  /** Manifest paths to lock in batch mode. */
+  std::vector<std::string> batchPaths;
+
   command::VerboseParser parser;
 
+  /**
+   * @brief Execute the `lock` routine for a batch of manifests, sharing one
+   *        store connection and one set of scraped databases.
+   * @return `EXIT_SUCCESS` or `EXIT_FAILURE`.
+   */
+  int
+  runBatch();
+
 
 public:
 
@@ -146,6 +162,9 @@ private:
 
   std::optional<std::vector<std::string>> groupsOrIIDS;
 
+  /** Report what would change without re-locking the environment. */
+  bool dryRun = false;
+
   command::VerboseParser parser;
 
 
@@ -267,7 +267,12 @@ public:
   explicit ManifestDescriptor( const std::string_view & descriptor )
     : ManifestDescriptor( ManifestDescriptorRaw( descriptor ) ) {};
 
-  explicit ManifestDescriptor( const ManifestDescriptorRaw & raw );
+  explicit ManifestDescriptor( const ManifestDescriptorRaw & raw )
+    : ManifestDescriptor( ManifestDescriptorRaw( raw ) )
+  {}
+
+  /** @brief Consume @a raw, moving its fields rather than copying them. */
+  explicit ManifestDescriptor( ManifestDescriptorRaw && raw );
 
   explicit ManifestDescriptor( std::string_view              installID,
                                const ManifestDescriptorRaw & raw )
@@ -316,6 +321,32 @@ public:
 void
 to_json( nlohmann::json & jto, const ManifestDescriptor & descriptor );
 
+/**
+ * @brief Convert a JSON object produced by @a to_json back to an
+ *        @a flox::resolver::ManifestDescriptor.
+ *
+ * Used to rehydrate memoized parse results; the fields mirror
+ * @a to_json exactly.
+ */
+void
+from_json( const nlohmann::json & jfrom, ManifestDescriptor & descriptor );
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Construct a @a flox::resolver::ManifestDescriptor for an install
+ *        entry, memoizing the parse on disk.
+ *
+ * Descriptor parsing is regex-heavy and re-runs on every invocation even
+ * though manifests rarely change; results are cached keyed by a hash of the
+ * raw entry so repeat invocations skip re-parsing.
+ * Honors `PKGDB_RESOLUTION_CACHE=0` to disable.
+ */
+[[nodiscard]] ManifestDescriptor
+getManifestDescriptor( std::string_view              installID,
+                       const ManifestDescriptorRaw & raw );
+
 /* -------------------------------------------------------------------------- */
 
 /**
@@ -9,9 +9,11 @@
 
 #pragma once
 
+#include <future>
 #include <memory>
 #include <optional>
 #include <string_view>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -139,6 +141,50 @@ private:
 
   std::shared_ptr<Registry<pkgdb::PkgDbInputFactory>> dbs;
 
+  /**
+   * Registry inputs indexed by flake fingerprint ( base16 ).
+   * Built once so matching a group's previously locked input against the
+   * registry is a hash lookup instead of flake-ref comparisons, and a
+   * matching input is reused rather than re-fetched.
+   */
+  std::optional<
+    std::unordered_map<std::string, std::shared_ptr<pkgdb::PkgDbInput>>>
+    fingerprintedInputs;
+
+  /** @brief Lazily initialize and return @a fingerprintedInputs. */
+  [[nodiscard]] const std::unordered_map<std::string,
+                                         std::shared_ptr<pkgdb::PkgDbInput>> &
+  getFingerprintedInputs();
+
+  /** @brief A background scrape of a registry input ( pipelined mode ). */
+  struct PipelinedScrape
+  {
+    /** Completion of the input's whole scrape. */
+    std::shared_future<void> future;
+    /** Subtrees the input scrapes, resolved before launch. */
+    std::vector<Subtree> subtrees;
+  }; /* End struct `PipelinedScrape' */
+
+  /**
+   * Background scrapes keyed by input fingerprint ( base16 ).
+   * Populated only when `PKGDB_SCRAPE_PIPELINE` is set; resolution then
+   * blocks on the specific prefixes a query needs via
+   * @a awaitScrapedPrefixes rather than on the whole scrape.
+   */
+  std::unordered_map<std::string, PipelinedScrape> pipelinedScrapes;
+
+  /**
+   * @brief Block until the prefixes @a args queries in @a input have been
+   *        fully scraped ( pipelined mode only ).
+   *
+   * Polls the `done` flag of each `( subtree, system )` prefix the query
+   * touches, returning as soon as those prefixes are complete or the whole
+   * scrape finishes ( propagating its failure, if any ).
+   */
+  void
+  awaitScrapedPrefixes( const pkgdb::PkgDbInput &   input,
+                        const pkgdb::PkgQueryArgs & args );
+
 
   static LockedPackageRaw
   lockPackage( const LockedInputRaw & input,
@@ -195,10 +241,14 @@ private:
   /**
    * @brief Try to resolve a group of descriptors in a given package database.
    *
-   * @return InstallID of the package that can't be resolved if resolution
+   * All descriptors are compiled into a single batched statement, so one
+   * pass over the database yields either a complete assignment or the full
+   * set of unsatisfiable descriptors.
+   *
+   * @return InstallIDs of the packages that can't be resolved if resolution
    *         fails, otherwise a set of resolved packages for the system.
    */
-  [[nodiscard]] std::variant<InstallID, SystemPackages>
+  [[nodiscard]] std::variant<std::vector<InstallID>, SystemPackages>
   tryResolveGroupIn( const InstallDescriptors & group,
                      const pkgdb::PkgDbInput &  input,
                      const System &             system );
@@ -226,11 +276,15 @@ private:
    *        This is a helper function of
    *        @a flox::resolver::Environment::createLockfile().
    *
-   * This must be called after @a lockfileRaw is initialized.
    * This is only intended to be called from
-   * @a flox::resolver::Environment::createLockfile().
+   * @a flox::resolver::Environment::createLockfile(), which initializes the
+   * lazily constructed shared state ( the package registry, combined query
+   * arguments, and old lockfile ) beforehand so that systems may be locked
+   * on separate threads.
+   *
+   * @return The resolved packages for @a system.
    */
-  void
+  [[nodiscard]] SystemPackages
   lockSystem( const System & system );
 
 
@@ -300,6 +354,35 @@ public:
     , oldLockfile( std::move( oldLockfile ) )
   {}
 
+  /**
+   * @brief Construct an environment sharing an existing store connection.
+   *
+   * Used by batch locking so many environments reuse one `nix` store
+   * handle instead of opening one per environment.
+   */
+  Environment( const nix::ref<nix::Store> &  store,
+               std::optional<GlobalManifest> globalManifest,
+               EnvironmentManifest           manifest,
+               std::optional<Lockfile>       oldLockfile = std::nullopt )
+    : NixStoreMixin( store )
+    , globalManifest( std::move( globalManifest ) )
+    , manifest( std::move( manifest ) )
+    , oldLockfile( std::move( oldLockfile ) )
+  {}
+
+  /**
+   * @brief Share an already initialized set of package databases.
+   *
+   * Used by batch locking to reuse scraped inputs and open read connections
+   * across environments; the caller must ensure @a dbs was built from a
+   * combined registry identical to this environment's.
+   */
+  void
+  sharePkgDbRegistry( std::shared_ptr<Registry<pkgdb::PkgDbInputFactory>> dbs )
+  {
+    this->dbs = std::move( dbs );
+  }
+
   [[nodiscard]] const std::optional<GlobalManifest> &
   getGlobalManifest() const
   {
@@ -372,6 +455,22 @@ public:
   [[nodiscard]] Lockfile
   createLockfile();
 
+  /**
+   * @brief Report which locked packages would resolve to a newer version,
+   *        without re-locking the environment.
+   *
+   * Each locked package in scope ( per @a upgrades ) is probed with a query
+   * pinned to its locked attr-path, so no match ranking is performed and the
+   * probe reduces to a version lookup.
+   * An order of magnitude cheaper than @a createLockfile, at the cost of not
+   * detecting packages whose attr-path itself would change.
+   *
+   * @return An object mapping `system -> install ID -> { current, latest,
+   *          input }` for packages whose version would change.
+   */
+  [[nodiscard]] nlohmann::json
+  previewUpgrades();
+
 
 }; /* End class `Environment' */
 
@@ -62,10 +62,10 @@ struct LockedInputRaw
   operator=( LockedInputRaw && )
     = default;
 
-  explicit LockedInputRaw( const pkgdb::PkgDbReadOnly & pdb )
-    : fingerprint( pdb.fingerprint )
-    , url( pdb.lockedRef.string )
-    , attrs( pdb.lockedRef.attrs )
+  explicit LockedInputRaw( pkgdb::PkgDbReadOnly & pdb )
+    : fingerprint( pdb.getFingerprint() )
+    , url( pdb.getLockedRef().string )
+    , attrs( pdb.getLockedRef().attrs )
   {}
 
   explicit LockedInputRaw( const pkgdb::PkgDbInput & input )
@@ -183,7 +183,11 @@ struct LockfileRaw
   ManifestRaw                                manifest;
   RegistryRaw                                registry;
   std::unordered_map<System, SystemPackages> packages;
-  unsigned                                   lockfileVersion = 0;
+  /** Serialization format.
+   * Version 1 writes each distinct locked input once in a toplevel
+   * `inputs' table and references it from `packages' by fingerprint;
+   * version 0 inlines inputs into every locked package. */
+  unsigned lockfileVersion = 0;
 
 
   ~LockfileRaw()                     = default;
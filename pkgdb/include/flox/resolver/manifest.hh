@@ -13,6 +13,7 @@
 #include <optional>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -289,6 +290,13 @@ private:
    */
   InstallDescriptors descriptors;
 
+  /**
+   * @a descriptors grouped by group name, computed once alongside them.
+   * Several routines re-group per call otherwise, copying every descriptor
+   * each time an environment is checked or locked.
+   */
+  Groups groupedDescriptors;
+
 
   /**
    * @brief Assert the validity of the manifest, throwing an exception if it
@@ -304,16 +312,20 @@ private:
   {
     const auto & raw = this->getManifestRaw();
     raw.check();
-    std::optional<std::vector<std::string>> maybeSystems;
-    if ( auto maybeOpts = raw.options; maybeOpts.has_value() )
+    /* Index `options.systems' once so the membership test below is a hash
+     * lookup; generated manifests carry hundreds of descriptors and this
+     * check runs on every command. */
+    std::optional<std::unordered_set<std::string>> allowedSystems;
+    if ( raw.options.has_value() && raw.options->systems.has_value() )
       {
-        maybeSystems = maybeOpts->systems;
+        allowedSystems.emplace( raw.options->systems->begin(),
+                                raw.options->systems->end() );
       }
 
     for ( const auto & [iid, desc] : this->descriptors )
       {
         if ( ! desc.systems.has_value() ) { continue; }
-        if ( ! maybeSystems.has_value() )
+        if ( ! allowedSystems.has_value() )
           {
             throw InvalidManifestFileException(
               "descriptor `install." + iid
@@ -322,8 +334,7 @@ private:
           }
         for ( const auto & system : *desc.systems )
           {
-            if ( std::find( maybeSystems->begin(), maybeSystems->end(), system )
-                 == maybeSystems->end() )
+            if ( ! allowedSystems->contains( system ) )
               {
                 std::stringstream msg;
                 msg << "descriptor `install." << iid << "' specifies system `"
@@ -342,10 +353,13 @@ private:
     if ( ! this->manifestRaw.install.has_value() ) { return; }
     for ( const auto & [iid, raw] : *this->manifestRaw.install )
       {
-        /* An empty/null descriptor uses `name' of the attribute. */
+        /* An empty/null descriptor uses `name' of the attribute.
+         * Parses are memoized on disk so repeat invocations over an
+         * unchanged manifest skip the regex-heavy parse. */
         if ( raw.has_value() )
           {
-            this->descriptors.emplace( iid, ManifestDescriptor( iid, *raw ) );
+            this->descriptors.emplace( iid,
+                                       getManifestDescriptor( iid, *raw ) );
           }
         else
           {
@@ -355,6 +369,8 @@ private:
           }
       }
     this->check();
+    this->groupedDescriptors
+      = flox::resolver::getGroupedDescriptors( this->descriptors );
   }
 
 
@@ -397,10 +413,10 @@ public:
    *        returning those without a group field in the group named
    *        TOPLEVEL_GROUP_NAME.
    */
-  [[nodiscard]] Groups
+  [[nodiscard]] const Groups &
   getGroupedDescriptors() const
   {
-    return flox::resolver::getGroupedDescriptors( this->descriptors );
+    return this->groupedDescriptors;
   }
 
 
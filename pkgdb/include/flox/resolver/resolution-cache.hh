@@ -0,0 +1,195 @@
+/* ========================================================================== *
+ *
+ * @file flox/resolver/resolution-cache.hh
+ *
+ * @brief An on-disk cache of descriptor resolutions.
+ *
+ * Resolving a descriptor against a fingerprinted database is deterministic:
+ * the database contents are keyed by the flake fingerprint and never change
+ * once scraped.
+ * Caching `( query, fingerprint ) -> attribute path` beside the databases
+ * lets repeat locks skip SQL resolution entirely.
+ * The attribute path is recorded rather than a raw row id because row ids
+ * are not stable: parallel scraping makes insertion order nondeterministic,
+ * and a garbage-collected database re-scraped under the same fingerprint
+ * renumbers its rows.
+ *
+ *
+ * -------------------------------------------------------------------------- */
+
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "flox/pkgdb/pkg-query.hh"
+#include "flox/pkgdb/read.hh"
+#include "flox/resolver/manifest.hh"
+
+
+/* -------------------------------------------------------------------------- */
+
+namespace flox::resolver {
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Whether the on-disk resolution cache is enabled.
+ *
+ * Enabled by default; set `PKGDB_RESOLUTION_CACHE=0` to resolve with SQL
+ * unconditionally.
+ */
+[[nodiscard]] bool
+useResolutionCache();
+
+
+/**
+ * @brief Produce the cache key for resolving @a args against the database
+ *        identified by @a fingerprint.
+ *
+ * The key hashes the fully filled query arguments, so any change to the
+ * descriptor, target system, or combined options produces a distinct key.
+ */
+[[nodiscard]] std::string
+resolutionCacheKey( const pkgdb::Fingerprint &  fingerprint,
+                    const pkgdb::PkgQueryArgs & args );
+
+
+/**
+ * @brief Look up a previously recorded resolution.
+ *
+ * The recorded attribute path is mapped back onto @a dbRO, so the returned
+ * row id is always valid for the current database; a path the database no
+ * longer contains reads as a miss.
+ *
+ * @return `std::nullopt` if nothing is cached for @a key, otherwise the
+ *          recorded result ( which may itself be an empty optional for a
+ *          cached _no match_ ).
+ */
+[[nodiscard]] std::optional<std::optional<pkgdb::row_id>>
+lookupCachedResolution( pkgdb::PkgDbReadOnly & dbRO, const std::string & key );
+
+
+/**
+ * @brief Record a resolution result ( including _no match_ ) for @a key.
+ *
+ * @a row is converted to its attribute path in @a dbRO before storage.
+ * Best effort: failures to write the cache never block resolution.
+ */
+void
+recordCachedResolution( pkgdb::PkgDbReadOnly &               dbRO,
+                        const std::string &                  key,
+                        const std::optional<pkgdb::row_id> & row );
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Produce the cache key for resolving a whole group, from the
+ *        per-descriptor keys of its members.
+ *
+ * The member keys already incorporate the database fingerprint, so the
+ * group key misses as soon as the input or any descriptor changes.
+ */
+[[nodiscard]] std::string
+groupResolutionCacheKey( const std::vector<std::string> & memberKeys );
+
+
+/**
+ * @brief Look up a previously recorded group failure.
+ * @return The install ID whose resolution failed, or `std::nullopt` if no
+ *          failure is recorded for @a key.
+ */
+[[nodiscard]] std::optional<std::string>
+lookupCachedGroupMiss( const std::string & key );
+
+
+/**
+ * @brief Record that resolving a group against an input failed at
+ *        @a failedId.
+ *
+ * Best effort: failures to write the cache never block resolution.
+ */
+void
+recordCachedGroupMiss( const std::string & key, const std::string & failedId );
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Produce the cache key for the parsed form of an install entry.
+ *
+ * Hashes the raw entry together with its install ID, so any edit to the
+ * entry produces a distinct key.
+ */
+[[nodiscard]] std::string
+descriptorCacheKey( std::string_view              installID,
+                    const ManifestDescriptorRaw & raw );
+
+
+/**
+ * @brief Look up a previously memoized descriptor parse.
+ * @return The parsed descriptor, or `std::nullopt` when unrecorded.
+ */
+[[nodiscard]] std::optional<ManifestDescriptor>
+lookupCachedDescriptor( const std::string & key );
+
+
+/**
+ * @brief Memoize the parsed form of an install entry.
+ *
+ * Best effort: failures to write the cache never block parsing.
+ */
+void
+recordCachedDescriptor( const std::string &        key,
+                        const ManifestDescriptor & descriptor );
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Produce the key recording which input satisfied @a group
+ *        for @a system.
+ *
+ * @a inputKeys names the registry inputs together with their locked flake
+ * fingerprints, in priority order.
+ * Including them makes the record miss as soon as any input, its revision,
+ * or the priority order changes; within one fixed registry a priority scan
+ * is deterministic, so replaying the recorded winner first cannot change
+ * which input a group locks to.
+ */
+[[nodiscard]] std::string
+preferredInputKey( const InstallDescriptors &       group,
+                   const System &                   system,
+                   const std::vector<std::string> & inputKeys );
+
+
+/**
+ * @brief Look up the registry input that last satisfied a group.
+ * @return The input's registry name, or `std::nullopt` when unrecorded.
+ */
+[[nodiscard]] std::optional<std::string>
+lookupPreferredInput( const std::string & key );
+
+
+/**
+ * @brief Record the registry input that satisfied a group.
+ *
+ * Best effort: failures to write the cache never block resolution.
+ */
+void
+recordPreferredInput( const std::string & key, const std::string & inputName );
+
+
+/* -------------------------------------------------------------------------- */
+
+}  // namespace flox::resolver
+
+
+/* -------------------------------------------------------------------------- *
+ *
+ *
+ *
+ * ========================================================================== */
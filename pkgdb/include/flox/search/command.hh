@@ -9,7 +9,9 @@
 
 #pragma once
 
+#include <cstdint>
 #include <functional>
+#include <optional>
 #include <vector>
 
 #include "flox/flox-flake.hh"
@@ -37,6 +39,21 @@ private:
   command::VerboseParser parser; /**< Query arguments and inputs parser */
   SearchParams           params; /**< Query arguments processor. */
   bool dumpQuery = false;        /**< Whether to print the SQL query. */
+  bool explain   = false;        /**< Whether to emit query-plan JSON. */
+  /** Whether to emit length-prefixed CBOR records instead of JSON lines. */
+  bool cborOutput = false;
+  /** Resume after this `next-page-token' from a previous page. */
+  std::optional<uint64_t> pageAfter;
+
+  /**
+   * @brief Write one result record to `stdout`.
+   *
+   * By default records print as JSON lines; with `--format cbor` each record
+   * is written as a 4-byte network-order length followed by its CBOR
+   * encoding, letting binary consumers skip text re-parsing.
+   */
+  void
+  emitRecord( const nlohmann::json & record ) const;
 
   /**
    * @brief Add options to allow flags such as `--pname PNAME` and
@@ -10,11 +10,12 @@
 
 #pragma once
 
+#include <exception>
 #include <list>
-#include <nix/util.hh>
 #include <optional>
 #include <regex>
 #include <string>
+#include <string_view>
 
 
 /* -------------------------------------------------------------------------- */
@@ -105,18 +106,54 @@ coerceSemver( std::string_view version );
 
 /* -------------------------------------------------------------------------- */
 
+/** @brief Pre-parsed components of a _semantic version_ string. */
+struct SemverParts
+{
+  unsigned major = 0;
+  unsigned minor = 0;
+  unsigned patch = 0;
+  /** Pre-release tag without its leading `-`, if any. */
+  std::optional<std::string> preTag;
+}; /* End struct `SemverParts' */
+
 /**
- * @brief Invokes `node-semver` by `exec`.
+ * @brief Split a _semantic version_ string into its numeric components.
  *
- * @param args List of arguments to pass to `semver` executable.
- * @return Pair of error-code and output string.
+ * @param semver A string as produced by @a coerceSemver.
+ * @return `std::nullopt` iff @a semver is not a valid _semantic version_.
+ *         The parsed components otherwise.
+ */
+std::optional<SemverParts>
+parseSemverParts( const std::string & semver );
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Encode a version ( or pre-release tag ) as a sort key whose binary
+ *        ordering follows version precedence rules.
+ *
+ * Identifiers are compared numerically when they are numbers and
+ * lexicographically otherwise, with numbers ranking below alphanumerics;
+ * a version extending another sorts after it.
+ * This is registered as the `version_sort_key` SQL function so `ORDER BY`
+ * can rank versions inside SQLite.
  */
-std::pair<int, std::string>
-runSemver( const std::list<std::string> & args );
+std::string
+versionSortKey( const std::string & version );
+
+
+/* -------------------------------------------------------------------------- */
 
 /**
  * @brief Filter a list of versions by a `node-semver` _semantic version range_.
  *
+ * The range grammar is processed natively, following `node-semver`'s
+ * `--include-prerelease --loose` semantics; no subprocess is spawned.
+ * Results are memoized for the life of the process keyed by the
+ * ( range, version list ) pair, so descriptors sharing a pinned range pay
+ * for one evaluation per distinct candidate set across a resolution run.
+ *
  * @param range A _semantic version range_ as taken by `node-semver`.
  * @param versions A list of _semantic versions_ to filter.
  * @return The list of _semantic versions_ from @a versions which fall in the
@@ -8,12 +8,22 @@
  * -------------------------------------------------------------------------- */
 
 #include <algorithm>
+#include <chrono>
+#include <dirent.h>
+#include <exception>
+#include <future>
+#include <map>
+#include <optional>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <tuple>
+#include <utility>
+#include <vector>
 
 #include <nix/util.hh>
 
 #include "flox/buildenv/realise.hh"
+#include "flox/pkgdb/write.hh"
 
 
 /* -------------------------------------------------------------------------- */
@@ -22,208 +32,217 @@ namespace flox::buildenv {
 
 /* -------------------------------------------------------------------------- */
 
-struct BuildEnvState
+/** A source entry contributing to one destination path. */
+struct PlanEntry
 {
-  std::map<std::string, Priority> priorities {};
-  unsigned long                   symlinks = 0;
-};
+  std::string   srcFile;
+  Priority      priority;
+  unsigned char type;
+}; /* End struct `PlanEntry' */
 
 
 /* -------------------------------------------------------------------------- */
 
-
-/* For each activated package, create symlinks */
-// todo: break this function up to reduce complexity
-// NOLINTBEGIN(readability-function-cognitive-complexity)
-static void
-createLinks( BuildEnvState &     state,
-             const std::string & srcDir,
-             const std::string & dstDir,
-             const Priority &    priority )
+/** @brief Whether @a srcFile names a directory.
+ * Uses the `readdir' reported type where the filesystem provided one; only
+ * symlinks ( which must be followed ) and `DT_UNKNOWN' entries pay a `stat'
+ * round-trip.
+ * @return `std::nullopt` for a dangling symlink, which is warned about and
+ *         dropped from the plan.
+ */
+static std::optional<bool>
+srcIsDirectory( const std::string & srcFile, unsigned char entType )
 {
-  nix::DirEntries srcFiles;
-
-  try
-    {
-      srcFiles = nix::readDirectory( srcDir );
-    }
-  catch ( nix::SysError & e )
+  if ( entType == DT_DIR ) { return true; }
+  if ( ( entType != DT_UNKNOWN ) && ( entType != DT_LNK ) ) { return false; }
+  struct stat srcSt
+  {};
+  if ( stat( srcFile.c_str(), &srcSt ) == -1 )
     {
-      if ( e.errNo == ENOTDIR )
+      if ( errno == ENOENT || errno == ENOTDIR )
         {
-          nix::warn(
-            "not including '%s' in the user environment because it's not a "
-            "directory",
-            srcDir );
-          return;
+          nix::warn( "skipping dangling symlink '%s'", srcFile );
+          return std::nullopt;
         }
-      throw;
+      throw nix::SysError( "getting status of '%1%'", srcFile );
     }
+  return S_ISDIR( srcSt.st_mode );
+}
+
+
+/* -------------------------------------------------------------------------- */
 
-  for ( const auto & ent : srcFiles )
+/* Resolve all sources contributing to one destination path and emit the
+ * resulting links.
+ *
+ * The destination tree starts empty, so conflicts are settled entirely in
+ * memory before anything touches disk: a path contributed by a single
+ * source becomes one symlink regardless of how deep its tree is, and only
+ * paths where several packages genuinely overlap are expanded into real
+ * directories and recursed into.  Sources arrive in package order, which
+ * carries the priority semantics. */
+// todo: break this function up to reduce complexity
+// NOLINTBEGIN(readability-function-cognitive-complexity)
+static unsigned long
+emitPlannedEntry( const std::string &            dstFile,
+                  const std::vector<PlanEntry> & sources )
+{
+  /* Classify the sources, dropping dangling symlinks and the special-cased
+   * files below, which don't show up in user profiles either because they
+   * are useless or because they would cause pointless collisions
+   * (e.g., each Python package brings its own
+   * `$out/lib/pythonX.Y/site-packages/easy-install.pth'.)
+   */
+  std::vector<std::pair<const PlanEntry *, bool>> classified;
+  for ( const auto & source : sources )
     {
-      if ( ent.name[0] == '.' )
+      if ( nix::hasSuffix( source.srcFile, "/propagated-build-inputs" )
+           || nix::hasSuffix( source.srcFile, "/nix-support" )
+           || nix::hasSuffix( source.srcFile, "/perllocal.pod" )
+           || nix::hasSuffix( source.srcFile, "/info/dir" )
+           || nix::hasSuffix( source.srcFile, "/log" )
+           || nix::hasSuffix( source.srcFile, "/manifest.nix" )
+           || nix::hasSuffix( source.srcFile, "/manifest.json" ) )
         {
-          /* not matched by glob */
           continue;
         }
-      auto srcFile = srcDir + "/" + ent.name;
-      auto dstFile = dstDir + "/" + ent.name;
-
-      struct stat srcSt
-      {};
-      try
+      auto isDir = srcIsDirectory( source.srcFile, source.type );
+      if ( ! isDir.has_value() ) { continue; }
+      classified.emplace_back( &source, *isDir );
+    }
+  if ( classified.empty() ) { return 0; }
+
+  /* Settle the contributors in memory, in package order, mirroring the
+   * sequential link pass this plan replaced: directories merge, files
+   * resolve by priority, and a file may also displace a single weaker
+   * directory contributor ( which the old pass still held as a plain
+   * symlink, subject to the same priority comparison ).  A directory
+   * arriving after a file, or a file meeting an already-merged directory,
+   * is a hard collision reported with the messages the link pass always
+   * used. */
+  const PlanEntry *              fileWinner = nullptr;
+  std::vector<const PlanEntry *> dirs;
+  for ( const auto & [entry, isDir] : classified )
+    {
+      if ( isDir )
         {
-          if ( stat( srcFile.c_str(), &srcSt ) == -1 )
+          if ( fileWinner != nullptr )
             {
-              throw nix::SysError( "getting status of '%1%'", srcFile );
+              throw nix::Error(
+                "collision between '%1%' and non-directory '%2%'",
+                entry->srcFile,
+                fileWinner->srcFile );
             }
+          dirs.emplace_back( entry );
+          continue;
         }
-      catch ( nix::SysError & e )
+
+      /* A file never merges into an expanded directory. */
+      if ( 1 < dirs.size() )
         {
-          if ( e.errNo == ENOENT || e.errNo == ENOTDIR )
-            {
-              nix::warn( "skipping dangling symlink '%s'", dstFile );
-              continue;
-            }
-          throw;
+          throw nix::Error(
+            "collision between non-directory '%1%' and directory '%2%'",
+            entry->srcFile,
+            dstFile );
         }
 
-      /* The files below are special-cased so that they don't show
-       * up in user profiles, either because they are useless,
-       * or because they would cause pointless collisions
-       * (e.g., each Python package brings its own
-       * `$out/lib/pythonX.Y/site-packages/easy-install.pth'.)
-       */
-      if ( nix::hasSuffix( srcFile, "/propagated-build-inputs" )
-           || nix::hasSuffix( srcFile, "/nix-support" )
-           || nix::hasSuffix( srcFile, "/perllocal.pod" )
-           || nix::hasSuffix( srcFile, "/info/dir" )
-           || nix::hasSuffix( srcFile, "/log" )
-           || nix::hasSuffix( srcFile, "/manifest.nix" )
-           || nix::hasSuffix( srcFile, "/manifest.json" ) )
+      const PlanEntry * prev = dirs.empty() ? fileWinner : dirs.front();
+      if ( prev == nullptr )
         {
+          fileWinner = entry;
           continue;
         }
-      // todo: understand and document these branches
-      // the short description is:
-      // link directories in the source directory to the target directory
-      // if the directory already exists, create a directory
-      // and recursively link the contents.
-      // Handle file type mismatches and conflicts with priority.
-      if ( S_ISDIR( srcSt.st_mode ) )
+      auto prevPriority = prev->priority;
+
+      // if the existing winner has a higher (numerically lower)
+      // priority -> skip
+      if ( prevPriority.priority < entry->priority.priority ) { continue; }
+
+      // if the contender and winner have the same priority
+      if ( prevPriority.priority == entry->priority.priority )
         {
-          struct stat dstSt
-          {};
-          auto res = lstat( dstFile.c_str(), &dstSt );
-          if ( res == 0 )
+
+          // ... and have different parents -> conflict
+          if ( prevPriority.parentPath != entry->priority.parentPath )
             {
-              if ( S_ISDIR( dstSt.st_mode ) )
-                {
-                  createLinks( state, srcFile, dstFile, priority );
-                  continue;
-                }
-
-              if ( S_ISLNK( dstSt.st_mode ) )
-                {
-                  auto        target = nix::canonPath( dstFile, true );
-                  struct stat canonSt
-                  {};
-                  if ( lstat( target.c_str(), &canonSt ) != 0 )
-                    {
-                      throw nix::SysError( "getting status of '%1%'", target );
-                    }
-                  if ( ! S_ISDIR( canonSt.st_mode ) )
-                    {
-                      throw nix::Error(
-                        "collision between '%1%' and non-directory '%2%'",
-                        srcFile,
-                        target );
-                    }
-                  if ( unlink( dstFile.c_str() ) == -1 )
-                    {
-                      throw nix::SysError( "unlinking '%1%'", dstFile );
-                    }
-
-                  const auto dirPermissions = 0755;
-                  if ( mkdir( dstFile.c_str(), dirPermissions ) == -1 )
-                    {
-                      throw nix::SysError( "creating directory '%1%'",
-                                           dstFile );
-                    }
-                  createLinks( state,
-                               target,
-                               dstFile,
-                               state.priorities[dstFile] );
-                  createLinks( state, srcFile, dstFile, priority );
-                  continue;
-                }
+              throw FileConflict( prev->srcFile,
+                                  entry->srcFile,
+                                  entry->priority.priority );
             }
-          else if ( errno != ENOENT )
+
+          // ... and the winner has a higher (numerically lower)
+          // internal priority -> skip
+          if ( prevPriority.internalPriority
+               < entry->priority.internalPriority )
             {
-              throw nix::SysError( "getting status of '%1%'", dstFile );
+              continue;
             }
         }
-      else
+
+      /* The contender wins; a displaced directory contributor is dropped
+       * exactly as the old pass unlinked its symlink. */
+      fileWinner = entry;
+      dirs.clear();
+    }
+
+  if ( fileWinner != nullptr )
+    {
+      nix::createSymlink( fileWinner->srcFile, dstFile );
+      return 1;
+    }
+
+  if ( dirs.size() == 1 )
+    {
+      /* Sole contributor: the whole tree becomes one symlink. */
+      nix::createSymlink( dirs.front()->srcFile, dstFile );
+      return 1;
+    }
+
+  /* Genuine overlap: expand into a real directory and plan one level
+   * down, grouping each directory's entries by name. */
+  const auto dirPermissions = 0755;
+  if ( mkdir( dstFile.c_str(), dirPermissions ) == -1 )
+    {
+      throw nix::SysError( "creating directory '%1%'", dstFile );
+    }
+  std::map<std::string, std::vector<PlanEntry>> children;
+  for ( const auto * entry : dirs )
+    {
+      nix::DirEntries srcFiles;
+      try
+        {
+          srcFiles = nix::readDirectory( entry->srcFile );
+        }
+      catch ( nix::SysError & e )
         {
-          struct stat dstSt
-          {};
-          auto res = lstat( dstFile.c_str(), &dstSt );
-          if ( res == 0 )
+          if ( e.errNo == ENOTDIR )
             {
-              if ( S_ISLNK( dstSt.st_mode ) )
-                {
-                  auto prevPriority = state.priorities[dstFile];
-
-                  // if the existing dest has a higher (numerically lower)
-                  // priority -> skip
-                  if ( prevPriority.priority < priority.priority ) { continue; }
-
-                  // if src and dst have the same priority
-                  if ( prevPriority.priority == priority.priority )
-                    {
-
-                      // ... and have different parents -> conflict
-                      if ( prevPriority.parentPath != priority.parentPath )
-                        {
-                          throw FileConflict( nix::readLink( dstFile ),
-                                              srcFile,
-                                              priority.priority );
-                        }
-
-                      // ... and dest has a higher (numerically lower)
-                      // internal priority -> skip
-                      if ( prevPriority.internalPriority
-                           < priority.internalPriority )
-                        {
-                          continue;
-                        }
-                    }
-
-
-                  if ( unlink( dstFile.c_str() ) == -1 )
-                    {
-                      throw nix::SysError( "unlinking '%1%'", dstFile );
-                    }
-                }
-              else if ( S_ISDIR( dstSt.st_mode ) )
-                {
-                  throw nix::Error(
-                    "collision between non-directory '%1%' and directory '%2%'",
-                    srcFile,
-                    dstFile );
-                }
+              nix::warn( "not including '%s' in the user environment "
+                         "because it's not a directory",
+                         entry->srcFile );
+              continue;
             }
-          else if ( errno != ENOENT )
+          throw;
+        }
+      for ( const auto & ent : srcFiles )
+        {
+          if ( ent.name[0] == '.' )
             {
-              throw nix::SysError( "getting status of '%1%'", dstFile );
+              /* not matched by glob */
+              continue;
             }
+          children[ent.name].emplace_back(
+            PlanEntry { entry->srcFile + "/" + ent.name,
+                        entry->priority,
+                        ent.type } );
         }
-
-      nix::createSymlink( srcFile, dstFile );
-      state.priorities[dstFile] = priority;
-      state.symlinks++;
     }
+  unsigned long symlinks = 0;
+  for ( const auto & [name, childSources] : children )
+    {
+      symlinks += emitPlannedEntry( dstFile + "/" + name, childSources );
+    }
+  return symlinks;
 }
 // NOLINTEND(readability-function-cognitive-complexity)
 
@@ -235,7 +254,11 @@ createLinks( BuildEnvState &     state,
 void
 buildEnvironment( const std::string & out, std::vector<RealisedPackage> & pkgs )
 {
-  BuildEnvState state;
+  auto planStarted = std::chrono::steady_clock::now();
+
+  /* Ordered list of packages to link, gathered before any links are made so
+   * the link pass can be sharded and run in parallel. */
+  std::vector<std::pair<std::string, Priority>> order;
 
   std::set<std::string> done;
   std::set<std::string> postponed;
@@ -243,7 +266,7 @@ buildEnvironment( const std::string & out, std::vector<RealisedPackage> & pkgs )
   auto addPkg = [&]( const std::string & pkgDir, const Priority & priority )
   {
     if ( ! done.insert( pkgDir ).second ) { return; }
-    createLinks( state, pkgDir, out, priority );
+    order.emplace_back( pkgDir, priority );
 
     try
       {
@@ -276,6 +299,34 @@ buildEnvironment( const std::string & out, std::vector<RealisedPackage> & pkgs )
       }
   };
 
+  /* Collapse duplicate store paths before anything else.  Several manifest
+   * entries routinely resolve to the same derivation across groups; each
+   * path should contribute its tree once, at the strongest ( numerically
+   * lowest ) priority any occurrence carries, and is active if any
+   * occurrence is. */
+  {
+    std::map<std::string, size_t> seen;
+    std::vector<RealisedPackage>  deduped;
+    deduped.reserve( pkgs.size() );
+    for ( auto & pkg : pkgs )
+      {
+        auto [itr, fresh] = seen.emplace( pkg.path, deduped.size() );
+        if ( fresh )
+          {
+            deduped.emplace_back( std::move( pkg ) );
+            continue;
+          }
+        RealisedPackage & kept = deduped[itr->second];
+        kept.active            = kept.active || pkg.active;
+        auto keptP             = std::tie( kept.priority.priority,
+                               kept.priority.internalPriority );
+        auto pkgP              = std::tie( pkg.priority.priority,
+                              pkg.priority.internalPriority );
+        if ( pkgP < keptP ) { kept.priority = pkg.priority; }
+      }
+    pkgs = std::move( deduped );
+  }
+
   /* Symlink to the packages that have been installed explicitly by the user.
    * Process in priority order to reduce unnecessary symlink/unlink steps.
    *
@@ -284,7 +335,7 @@ buildEnvironment( const std::string & out, std::vector<RealisedPackage> & pkgs )
    * between outputs of the same derivation.
    *
    * The handling of internal priorities for outputs of the same derivation
-   * is performed in `buildenv::createLinks'. */
+   * is performed in `emitPlannedEntry'. */
   std::sort( pkgs.begin(),
              pkgs.end(),
              []( const RealisedPackage & first, const RealisedPackage & second )
@@ -334,11 +385,106 @@ buildEnvironment( const std::string & out, std::vector<RealisedPackage> & pkgs )
         }
     }
 
+  /* Shard the link pass by top-level entry name ( `bin', `lib', `share',
+   * ... ).  Shards touch disjoint destination paths, so each plans and
+   * emits independently with no locking, while the package order - and with
+   * it the priority semantics - is preserved exactly within each shard. */
+  std::map<std::string, std::vector<PlanEntry>> shards;
+  for ( const auto & [pkgDir, priority] : order )
+    {
+      nix::DirEntries entries;
+      try
+        {
+          entries = nix::readDirectory( pkgDir );
+        }
+      catch ( nix::SysError & e )
+        {
+          if ( e.errNo == ENOTDIR )
+            {
+              nix::warn( "not including '%s' in the user environment because "
+                         "it's not a directory",
+                         pkgDir );
+              continue;
+            }
+          throw;
+        }
+      for ( const auto & ent : entries )
+        {
+          if ( ent.name[0] == '.' )
+            {
+              /* not matched by glob */
+              continue;
+            }
+          shards[ent.name].emplace_back(
+            PlanEntry { pkgDir + "/" + ent.name, priority, ent.type } );
+        }
+    }
+
+  pkgdb::emitProgressEvent(
+    "phase-done",
+    { { "phase", "link-plan" },
+      { "packages", order.size() },
+      { "shards", shards.size() },
+      { "ms",
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now() - planStarted )
+          .count() } } );
+  auto emitStarted = std::chrono::steady_clock::now();
+
+  auto processShard
+    = [&out]( const std::string & name, const std::vector<PlanEntry> & tasks )
+  { return emitPlannedEntry( out + "/" + name, tasks ); };
+
+  unsigned long symlinks = 0;
+  if ( shards.size() <= 1 )
+    {
+      for ( const auto & [name, tasks] : shards )
+        {
+          symlinks += processShard( name, tasks );
+        }
+    }
+  else
+    {
+      std::vector<std::future<unsigned long>> futures;
+      futures.reserve( shards.size() );
+      for ( const auto & [name, tasks] : shards )
+        {
+          futures.emplace_back( std::async( std::launch::async,
+                                            processShard,
+                                            std::cref( name ),
+                                            std::cref( tasks ) ) );
+        }
+      /* Drain every shard before propagating a failure so no thread is
+       * still linking when we unwind. */
+      std::exception_ptr failure;
+      for ( auto & future : futures )
+        {
+          try
+            {
+              symlinks += future.get();
+            }
+          catch ( ... )
+            {
+              if ( failure == nullptr ) { failure = std::current_exception(); }
+            }
+        }
+      if ( failure != nullptr ) { std::rethrow_exception( failure ); }
+    }
+
+  pkgdb::emitProgressEvent(
+    "phase-done",
+    { { "phase", "link-emit" },
+      { "symlinks", symlinks },
+      { "ms",
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now() - emitStarted )
+          .count() } } );
+
   if ( nix::lvlDebug <= nix::verbosity )
     {
       nix::logger->log(
         nix::lvlDebug,
-        nix::fmt( "created %d symlinks in user environment", state.symlinks ) );
+        nix::fmt( "created %d symlinks in user environment", symlinks ) );
     }
 }
 // NOLINTEND(readability-function-cognitive-complexity)
@@ -7,8 +7,15 @@
  *
  * -------------------------------------------------------------------------- */
 
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
 #include <filesystem>
 #include <fstream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
 
 #include <nix/command.hh>
 #include <nix/derivations.hh>
@@ -25,8 +32,13 @@
 #include <nix/store-api.hh>
 #include <nix/util.hh>
 #include <nlohmann/json.hpp>
+#include <sqlite3pp.hh>
 
 #include "flox/buildenv/realise.hh"
+#include "flox/core/trace.hh"
+#include "flox/core/util.hh"
+#include "flox/pkgdb/read.hh"
+#include "flox/pkgdb/write.hh"
 #include "flox/resolver/lockfile.hh"
 
 
@@ -92,6 +104,251 @@ fi
 )";
 
 
+/* -------------------------------------------------------------------------- */
+
+/* The cache lives in the versioned cache directory, so changes to the link
+ * pass which could alter the produced tree invalidate it naturally. */
+
+/** Filename of the built-environment memo kept alongside the databases. */
+static const char * environmentDbName = "environments.sqlite";
+
+/** SQL schema of the built-environment memo.
+ * @a storePath is the environment produced for a package set. */
+static const char * sql_environmentCache = R"SQL(
+CREATE TABLE IF NOT EXISTS EnvironmentCache (
+  key        TEXT PRIMARY KEY
+, storePath  TEXT NOT NULL
+)
+)SQL";
+
+/** SQL schema of the container builder memo.
+ * @a storePath is the builder produced for an environment. */
+static const char * sql_containerBuilderCache = R"SQL(
+CREATE TABLE IF NOT EXISTS ContainerBuilderCache (
+  key        TEXT PRIMARY KEY
+, storePath  TEXT NOT NULL
+)
+)SQL";
+
+/** SQL schema of the activation scripts memo.
+ * @a storePath is the script tree produced for one set of inputs. */
+static const char * sql_activationScriptsCache = R"SQL(
+CREATE TABLE IF NOT EXISTS ActivationScriptsCache (
+  key        TEXT PRIMARY KEY
+, storePath  TEXT NOT NULL
+)
+)SQL";
+
+
+/** @brief Whether the built-environment memo should be consulted.
+ * Set `PKGDB_BUILDENV_CACHE=0` to force a fresh link pass. */
+static bool
+useBuildenvCache()
+{
+  const char * maybeEnabled = std::getenv( "PKGDB_BUILDENV_CACHE" );
+  return ( maybeEnabled == nullptr )
+         || ( std::string_view( maybeEnabled ) != "0" );
+}
+
+
+/** @brief Open ( creating if necessary ) the built-environment memo. */
+static sqlite3pp::database
+openEnvironmentCache()
+{
+  std::filesystem::path cacheDir = pkgdb::getPkgDbCachedir();
+  std::filesystem::create_directories( cacheDir );
+  sqlite3pp::database edb( ( cacheDir / environmentDbName ).c_str() );
+  edb.set_busy_timeout( pkgdb::DB_BUSY_TIMEOUT );
+  edb.execute( sql_environmentCache );
+  edb.execute( sql_containerBuilderCache );
+  edb.execute( sql_activationScriptsCache );
+  return edb;
+}
+
+
+/** @brief Content key for a realised package set.
+ * Entries are sorted so that a reordered but otherwise identical set maps
+ * to the same environment; priority fields are part of each entry, so two
+ * sets that could link differently never collide. */
+static std::string
+environmentCacheKey( const std::vector<RealisedPackage> & pkgs )
+{
+  std::vector<std::string> entries;
+  entries.reserve( pkgs.size() );
+  for ( const auto & pkg : pkgs )
+    {
+      entries.emplace_back( pkg.path + ";" + ( pkg.active ? "1" : "0" ) + ";"
+                            + std::to_string( pkg.priority.priority ) + ";"
+                            + pkg.priority.parentPath + ";"
+                            + std::to_string( pkg.priority.internalPriority ) );
+    }
+  std::sort( entries.begin(), entries.end() );
+  std::string raw;
+  for ( const auto & entry : entries )
+    {
+      raw += entry;
+      raw += '\n';
+    }
+  return nix::hashString( nix::htSHA256, raw ).to_string( nix::Base16, false );
+}
+
+
+/** @brief Lookup a previously built environment for @a key.
+ * @return The environment's store path, or `std::nullopt` on a miss. */
+static std::optional<std::string>
+lookupCachedEnvironment( const std::string & key )
+{
+  try
+    {
+      sqlite3pp::database edb = openEnvironmentCache();
+      sqlite3pp::query    qry(
+        edb,
+        "SELECT storePath FROM EnvironmentCache WHERE key = ?" );
+      qry.bind( 1, key, sqlite3pp::copy );
+      auto itr = qry.begin();
+      if ( itr == qry.end() ) { return std::nullopt; }
+      return ( *itr ).get<std::string>( 0 );
+    }
+  catch ( ... )
+    { /* Best effort; an unreadable cache is a miss. */
+      return std::nullopt;
+    }
+}
+
+
+/** @brief Record the environment built for @a key. */
+static void
+recordCachedEnvironment( const std::string & key,
+                         const std::string & storePath )
+{
+  try
+    {
+      sqlite3pp::database edb = openEnvironmentCache();
+      sqlite3pp::command  cmd(
+        edb,
+        "INSERT INTO EnvironmentCache ( key, storePath ) VALUES ( ?, ? ) "
+         "ON CONFLICT ( key ) DO UPDATE SET storePath = excluded.storePath" );
+      cmd.bind( 1, key, sqlite3pp::copy );
+      cmd.bind( 2, storePath, sqlite3pp::copy );
+      cmd.execute();
+    }
+  catch ( ... )
+    { /* Best effort; never block realisation on the cache. */
+    }
+}
+
+
+/** @brief Lookup a previously instantiated container builder for @a key.
+ * @return The builder's store path, or `std::nullopt` on a miss. */
+static std::optional<std::string>
+lookupCachedContainerBuilder( const std::string & key )
+{
+  try
+    {
+      sqlite3pp::database edb = openEnvironmentCache();
+      sqlite3pp::query    qry(
+        edb,
+        "SELECT storePath FROM ContainerBuilderCache WHERE key = ?" );
+      qry.bind( 1, key, sqlite3pp::copy );
+      auto itr = qry.begin();
+      if ( itr == qry.end() ) { return std::nullopt; }
+      return ( *itr ).get<std::string>( 0 );
+    }
+  catch ( ... )
+    { /* Best effort; an unreadable cache is a miss. */
+      return std::nullopt;
+    }
+}
+
+
+/** @brief Record the container builder instantiated for @a key. */
+static void
+recordCachedContainerBuilder( const std::string & key,
+                              const std::string & storePath )
+{
+  try
+    {
+      sqlite3pp::database edb = openEnvironmentCache();
+      sqlite3pp::command  cmd(
+        edb,
+        "INSERT INTO ContainerBuilderCache ( key, storePath ) "
+         "VALUES ( ?, ? ) "
+         "ON CONFLICT ( key ) DO UPDATE SET storePath = excluded.storePath" );
+      cmd.bind( 1, key, sqlite3pp::copy );
+      cmd.bind( 2, storePath, sqlite3pp::copy );
+      cmd.execute();
+    }
+  catch ( ... )
+    { /* Best effort; never block containerization on the cache. */
+    }
+}
+
+
+/** @brief Lookup a previously generated script tree for @a key.
+ * @return The tree's store path, or `std::nullopt` on a miss. */
+static std::optional<std::string>
+lookupCachedActivationScripts( const std::string & key )
+{
+  try
+    {
+      sqlite3pp::database edb = openEnvironmentCache();
+      sqlite3pp::query    qry(
+        edb,
+        "SELECT storePath FROM ActivationScriptsCache WHERE key = ?" );
+      qry.bind( 1, key, sqlite3pp::copy );
+      auto itr = qry.begin();
+      if ( itr == qry.end() ) { return std::nullopt; }
+      return ( *itr ).get<std::string>( 0 );
+    }
+  catch ( ... )
+    { /* Best effort; an unreadable cache is a miss. */
+      return std::nullopt;
+    }
+}
+
+
+/** @brief Record the script tree generated for @a key. */
+static void
+recordCachedActivationScripts( const std::string & key,
+                               const std::string & storePath )
+{
+  try
+    {
+      sqlite3pp::database edb = openEnvironmentCache();
+      sqlite3pp::command  cmd(
+        edb,
+        "INSERT INTO ActivationScriptsCache ( key, storePath ) "
+         "VALUES ( ?, ? ) "
+         "ON CONFLICT ( key ) DO UPDATE SET storePath = excluded.storePath" );
+      cmd.bind( 1, key, sqlite3pp::copy );
+      cmd.bind( 2, storePath, sqlite3pp::copy );
+      cmd.execute();
+    }
+  catch ( ... )
+    { /* Best effort; never block realisation on the cache. */
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+/** @brief Emit a `phase-done' timing event for a realisation @a phase.
+ * Timing marks are always collected; emission is gated on
+ * `PKGDB_PROGRESS_JSON` inside @a pkgdb::emitProgressEvent. */
+static void
+emitPhaseDone( const char *                                  phase,
+               const std::chrono::steady_clock::time_point & started,
+               nlohmann::json fields = nlohmann::json::object() )
+{
+  fields.emplace( "phase", phase );
+  fields.emplace( "ms",
+                  std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - started )
+                    .count() );
+  pkgdb::emitProgressEvent( "phase-done", std::move( fields ) );
+}
+
+
 /* -------------------------------------------------------------------------- */
 
 static nix::StorePath
@@ -137,6 +394,30 @@ createEnvironmentStorePath(
   std::map<nix::StorePath, std::pair<std::string, resolver::LockedPackageRaw>> &
     originalPackage )
 {
+  /* A package set we already linked yields the same tree; reuse it when the
+   * store still holds the result, skipping the link pass entirely. */
+  std::optional<std::string> cacheKey;
+  if ( useBuildenvCache() )
+    {
+      cacheKey = environmentCacheKey( pkgs );
+      if ( auto cached = lookupCachedEnvironment( *cacheKey ) )
+        {
+          try
+            {
+              nix::StorePath cachedPath
+                = state.store->parseStorePath( *cached );
+              if ( state.store->isValidPath( cachedPath ) )
+                {
+                  debugLog( "reusing cached environment: " + ( *cached ) );
+                  return cachedPath;
+                }
+            }
+          catch ( ... )
+            { /* A stale or malformed record is a miss. */
+            }
+        }
+    }
+
   /* build the profile into a tempdir */
   auto tempDir = nix::createTempDir();
   try
@@ -161,7 +442,12 @@ createEnvironmentStorePath(
         filePath,
         err.priority ) );
     }
-  return addDirToStore( state, tempDir, references );
+  nix::StorePath path = addDirToStore( state, tempDir, references );
+  if ( cacheKey.has_value() )
+    {
+      recordCachedEnvironment( *cacheKey, state.store->printStorePath( path ) );
+    }
+  return path;
 }
 
 /* -------------------------------------------------------------------------- */
@@ -208,6 +494,7 @@ createFloxEnv( nix::EvalState &     state,
                resolver::Lockfile & lockfile,
                const System &       system )
 {
+  TraceSpan span( "createFloxEnv" );
   auto packages = lockfile.getLockfileRaw().packages.find( system );
   if ( packages == lockfile.getLockfileRaw().packages.end() )
     {
@@ -230,10 +517,13 @@ createFloxEnv( nix::EvalState &     state,
   /* Extract derivations */
   nix::StorePathSet                      references;
   std::vector<nix::StorePathWithOutputs> drvsToBuild;
+  std::vector<std::string>               drvIds;
+  std::vector<nix::StorePathSet>         drvOutputs;
   std::vector<RealisedPackage>           pkgs;
   std::map<nix::StorePath, std::pair<std::string, resolver::LockedPackageRaw>>
     originalPackage;
 
+  auto evalStarted = std::chrono::steady_clock::now();
   for ( auto const & [pId, package] : locked_packages )
     {
       // TODO: use `FloxFlake'
@@ -292,6 +582,7 @@ createFloxEnv( nix::EvalState &     state,
        * and the internal priority to the index of the output.
        * This way `buildenv::buildEnvironment` can resolve conflicts between
        * outputs of the same derivation. */
+      nix::StorePathSet packageOutputs;
       for ( auto [idx, output] : enumerate( package_drv->queryOutputs() ) )
         {
           /* Skip outputs without path */
@@ -305,36 +596,111 @@ createFloxEnv( nix::EvalState &     state,
                                  * package has more than 4 billion outputs. */
                                 static_cast<unsigned>( idx ) ) );
           references.insert( output.second.value() );
+          packageOutputs.insert( output.second.value() );
           originalPackage.insert( { output.second.value(), { pId, package } } );
         }
 
       /* Collect drvs that may yet need to be built. */
       if ( auto drvPath = package_drv->queryDrvPath() )
         {
-          /* Build derivation of pacakge in environment,
-           * rethrow errors as PackageBuildFailure. */
+          drvsToBuild.emplace_back( nix::StorePathWithOutputs { *drvPath, {} } );
+          drvIds.emplace_back( pId );
+          drvOutputs.emplace_back( std::move( packageOutputs ) );
+        }
+    }
+
+  emitPhaseDone( "package-eval",
+                 evalStarted,
+                 { { "packages", locked_packages.size() } } );
+  span.addArg( "packages", locked_packages.size() );
+  span.addArg( "evals", drvsToBuild.size() );
+
+  auto realiseStarted = std::chrono::steady_clock::now();
+
+  /* Settle validity for every output in one RPC rather than letting the
+   * scheduler probe path-by-path; derivations whose outputs are all present
+   * are dropped before the build call, so a warm store costs one daemon
+   * round-trip regardless of environment size. */
+  if ( ! drvsToBuild.empty() )
+    {
+      nix::StorePathSet validPaths = state.store->queryValidPaths( references );
+      std::vector<nix::StorePathWithOutputs> missingDrvs;
+      std::vector<std::string>               missingIds;
+      std::vector<nix::StorePathSet>         missingOutputs;
+      for ( auto [idx, drv] : enumerate( drvsToBuild ) )
+        {
+          bool allValid = ! drvOutputs.at( idx ).empty();
+          for ( const auto & output : drvOutputs.at( idx ) )
+            {
+              if ( ! validPaths.contains( output ) )
+                {
+                  allValid = false;
+                  break;
+                }
+            }
+          if ( allValid ) { continue; }
+          missingDrvs.emplace_back( drv );
+          missingIds.emplace_back( drvIds.at( idx ) );
+          missingOutputs.emplace_back( drvOutputs.at( idx ) );
+        }
+      drvsToBuild.swap( missingDrvs );
+      drvIds.swap( missingIds );
+      drvOutputs.swap( missingOutputs );
+    }
+
+  /* Realise all packages in one scheduler pass.
+   * Substitution is network bound, so handing the whole set to the store at
+   * once lets downloads run in parallel instead of one package at a time;
+   * `PKGDB_REALISE_JOBS` caps the download width. */
+  if ( ! drvsToBuild.empty() )
+    {
+      if ( const char * jobs = std::getenv( "PKGDB_REALISE_JOBS" ) )
+        {
           try
             {
-              auto storePathWithOutputs
-                = nix::StorePathWithOutputs { *drvPath, {} };
-              state.store->buildPaths(
-                nix::toDerivedPaths( { storePathWithOutputs } ) );
+              nix::settings.maxSubstitutionJobs.assign(
+                static_cast<unsigned>( std::stoul( jobs ) ) );
+            }
+          catch ( const std::exception & )
+            { /* An unparseable width keeps the default. */
             }
-          catch ( const nix::Error & e )
+        }
+      try
+        {
+          state.store->buildPaths( nix::toDerivedPaths( drvsToBuild ) );
+        }
+      catch ( const nix::Error & batchError )
+        {
+          /* Re-realise one at a time so the failure names its package,
+           * rethrown as PackageBuildFailure as before. */
+          for ( auto [idx, storePathWithOutputs] : enumerate( drvsToBuild ) )
             {
-              throw PackageBuildFailure(
-                "Failed to build package '" + pId + "'",
-                nix::filterANSIEscapes( e.what(), true ) );
+              try
+                {
+                  state.store->buildPaths(
+                    nix::toDerivedPaths( { storePathWithOutputs } ) );
+                }
+              catch ( const nix::Error & e )
+                {
+                  throw PackageBuildFailure(
+                    "Failed to build package '" + drvIds.at( idx ) + "'",
+                    nix::filterANSIEscapes( e.what(), true ) );
+                }
             }
+          throw PackageBuildFailure(
+            "Failed to build packages",
+            nix::filterANSIEscapes( batchError.what(), true ) );
         }
     }
+  emitPhaseDone( "package-realise",
+                 realiseStarted,
+                 { { "drvs", drvsToBuild.size() } } );
+
+  auto scriptsStarted = std::chrono::steady_clock::now();
 
   /* verbatim content of the activate script common to all shells */
   std::stringstream commonActivate;
 
-  auto tempDir = std::filesystem::path( nix::createTempDir() );
-  std::filesystem::create_directories( tempDir / "activate" );
-
   /* Add environment variables.
    * Read environment variables from the manifest and add them as exports to the
    * activate script. */
@@ -361,63 +727,107 @@ createFloxEnv( nix::EvalState &     state,
         }
     }
 
-  /* Add hook script.
-   * Write hook script to a temporary file and copy it to the environment.
-   * Add source command to the activate script. */
+  /* Resolve the hook script's content.
+   * The content ( rather than a temp file path ) feeds the cache key below
+   * and is written into the tree on a miss. */
   // TODO: is it script _xor_ file?
   // Currently it is assumed that `hook.script` and `hook.file` are
   // mutually exclusive.
   // If both are set, `hook.file` takes precedence.
+  std::optional<std::string> hookContent;
   if ( auto hook = lockfile.getManifest().getManifestRaw().hook )
     {
-      nix::Path script_path;
+      if ( auto file = hook->file )
+        {
+          hookContent = nix::readFile( file.value() );
+        }
+      else if ( auto script = hook->script ) { hookContent = script.value(); }
+    }
+  if ( hookContent.has_value() )
+    {
+      commonActivate << "source \"$FLOX_ENV/activate/hook.sh\"" << '\n';
+    }
 
-      /* Either set script path to a temporary file. */
-      if ( auto script = hook->script )
+  /* The script tree is fully determined by the static activation scripts
+   * and the manifest-derived content above, so identical inputs map to the
+   * store path generated last time and skip the tree build entirely. */
+  std::optional<std::string>    scriptsCacheKey;
+  std::optional<nix::StorePath> activationStorePath;
+  if ( useBuildenvCache() )
+    {
+      std::string raw = std::string( BASH_ACTIVATE_SCRIPT ) + ";"
+                        + ZSH_ACTIVATE_SCRIPT + ";" + SET_PROMPT_BASH_SH
+                        + ";" + SET_PROMPT_ZSH_SH + ";"
+                        + commonActivate.str() + ";"
+                        + hookContent.value_or( "" );
+      scriptsCacheKey = nix::hashString( nix::htSHA256, raw )
+                          .to_string( nix::Base16, false );
+      if ( auto cached = lookupCachedActivationScripts( *scriptsCacheKey ) )
         {
-          script_path = nix::createTempFile().second;
-          std::ofstream file( script_path );
-          file << script.value();
-          file.close();
+          try
+            {
+              nix::StorePath cachedPath
+                = state.store->parseStorePath( *cached );
+              if ( state.store->isValidPath( cachedPath ) )
+                {
+                  debugLog( "reusing cached activation scripts: "
+                            + ( *cached ) );
+                  activationStorePath = cachedPath;
+                }
+            }
+          catch ( ... )
+            { /* A stale or malformed record is a miss. */
+            }
         }
+    }
 
-      /* ...Or to the file specified in the manifest. */
-      if ( auto file = hook->file ) { script_path = file.value(); }
+  if ( ! activationStorePath.has_value() )
+    {
+      auto tempDir = std::filesystem::path( nix::createTempDir() );
+      std::filesystem::create_directories( tempDir / "activate" );
 
-      if ( ! script_path.empty() )
+      /* Add hook script.
+       * Write the hook to the environment and source it from the
+       * activate script. */
+      if ( hookContent.has_value() )
         {
-
-          std::filesystem::copy_file( script_path,
-                                      tempDir / "activate" / "hook.sh" );
+          std::ofstream hookScript( tempDir / "activate" / "hook.sh" );
+          hookScript << *hookContent;
+          hookScript.close();
           std::filesystem::permissions( tempDir / "activate" / "hook.sh",
                                         std::filesystem::perms::owner_exec,
                                         std::filesystem::perm_options::add );
-          commonActivate << "source \"$FLOX_ENV/activate/hook.sh\"" << '\n';
         }
-    }
 
-  /* Add bash activation script. */
-  std::ofstream bashActivate( tempDir / "activate" / "bash" );
-  /* If this gets bigger, we could factor this out into a file that gets
-   * sourced, like we do for zsh. */
-  bashActivate << BASH_ACTIVATE_SCRIPT << "\n";
-  bashActivate << "source " << SET_PROMPT_BASH_SH << "\n";
-  bashActivate << commonActivate.str();
-  bashActivate.close();
-
-  /* Add zsh activation script.
-   * Functionality shared between all environments is
-   * in `flox.zdotdir/.zshrc'. */
-  std::ofstream zshActivate( tempDir / "activate" / "zsh" );
-  zshActivate << ZSH_ACTIVATE_SCRIPT << "\n";
-  zshActivate << "source " << SET_PROMPT_ZSH_SH << "\n";
-  zshActivate << commonActivate.str();
-  zshActivate.close();
-
-  auto activationStorePath
-    = state.store->addToStore( "activation-scripts", tempDir );
-  references.insert( activationStorePath );
-  pkgs.emplace_back( state.store->printStorePath( activationStorePath ),
+      /* Add bash activation script. */
+      std::ofstream bashActivate( tempDir / "activate" / "bash" );
+      /* If this gets bigger, we could factor this out into a file that gets
+       * sourced, like we do for zsh. */
+      bashActivate << BASH_ACTIVATE_SCRIPT << "\n";
+      bashActivate << "source " << SET_PROMPT_BASH_SH << "\n";
+      bashActivate << commonActivate.str();
+      bashActivate.close();
+
+      /* Add zsh activation script.
+       * Functionality shared between all environments is
+       * in `flox.zdotdir/.zshrc'. */
+      std::ofstream zshActivate( tempDir / "activate" / "zsh" );
+      zshActivate << ZSH_ACTIVATE_SCRIPT << "\n";
+      zshActivate << "source " << SET_PROMPT_ZSH_SH << "\n";
+      zshActivate << commonActivate.str();
+      zshActivate.close();
+
+      activationStorePath
+        = state.store->addToStore( "activation-scripts", tempDir );
+      if ( scriptsCacheKey.has_value() )
+        {
+          recordCachedActivationScripts(
+            *scriptsCacheKey,
+            state.store->printStorePath( *activationStorePath ) );
+        }
+    }
+  references.insert( *activationStorePath );
+  pkgs.emplace_back( state.store->printStorePath( *activationStorePath ),
                      true,
                      buildenv::Priority() );
 
@@ -434,8 +844,13 @@ createFloxEnv( nix::EvalState &     state,
   pkgs.emplace_back( state.store->printStorePath( profileScriptsPath ),
                      true,
                      buildenv::Priority() );
+  emitPhaseDone( "activation-scripts", scriptsStarted );
 
-  return createEnvironmentStorePath( state, pkgs, references, originalPackage );
+  auto buildStarted = std::chrono::steady_clock::now();
+  auto environmentStorePath
+    = createEnvironmentStorePath( state, pkgs, references, originalPackage );
+  emitPhaseDone( "environment-build", buildStarted );
+  return environmentStorePath;
 }
 // NOLINTEND(readability-function-cognitive-complexity)
 
@@ -445,6 +860,37 @@ createContainerBuilder( nix::EvalState &       state,
                         const nix::StorePath & environmentStorePath,
                         const System &         system )
 {
+  /* The builder is a pure function of the environment path and the bundled
+   * builder expression; reuse a previous instantiation when the store still
+   * holds its result, skipping nixpkgs eval entirely. */
+  std::optional<std::string> cacheKey;
+  if ( useBuildenvCache() )
+    {
+      std::string raw = state.store->printStorePath( environmentStorePath )
+                        + ";" + CONTAINER_BUILDER_PATH + ";"
+                        + COMMON_NIXPKGS_URL + ";" + nix::nativeSystem + ";"
+                        + system;
+      cacheKey = nix::hashString( nix::htSHA256, raw )
+                   .to_string( nix::Base16, false );
+      if ( auto cached = lookupCachedContainerBuilder( *cacheKey ) )
+        {
+          try
+            {
+              nix::StorePath cachedPath
+                = state.store->parseStorePath( *cached );
+              if ( state.store->isValidPath( cachedPath ) )
+                {
+                  debugLog( "reusing cached container builder: "
+                            + ( *cached ) );
+                  return cachedPath;
+                }
+            }
+          catch ( ... )
+            { /* A stale or malformed record is a miss. */
+            }
+        }
+    }
+
   static const nix::FlakeRef nixpkgsRef
     = nix::parseFlakeRef( COMMON_NIXPKGS_URL );
 
@@ -536,6 +982,12 @@ createContainerBuilder( nix::EvalState &       state,
   // be nice, reset the original pure eval state
   nix::evalSettings.pureEval = pureEvalState;
 
+  if ( cacheKey.has_value() )
+    {
+      recordCachedContainerBuilder( *cacheKey,
+                                    state.store->printStorePath( outPath ) );
+    }
+
   return outPath;
 }
 
@@ -0,0 +1,349 @@
+/* ========================================================================== *
+ *
+ * @file daemon.cc
+ *
+ * @brief Serve the `pkgdb` command surface over a unix socket.
+ *
+ *
+ * -------------------------------------------------------------------------- */
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <nix/util.hh>
+#include <nlohmann/json.hpp>
+
+#include "flox/core/util.hh"
+#include "flox/daemon.hh"
+#include "flox/pkgdb/read.hh"
+
+
+/* -------------------------------------------------------------------------- */
+
+namespace flox {
+
+/* -------------------------------------------------------------------------- */
+
+/** @brief Read exactly @a len bytes, retrying on `EINTR`.
+ * @return `false` on a clean end-of-stream before any byte arrives. */
+static bool
+readFull( int conn, void * buffer, size_t len )
+{
+  auto * bytes = static_cast<char *>( buffer );
+  size_t done  = 0;
+  while ( done < len )
+    {
+      ssize_t got = read( conn, bytes + done, len - done );
+      if ( got == 0 )
+        {
+          if ( done == 0 ) { return false; }
+          throw DaemonException( "connection closed mid-frame" );
+        }
+      if ( got < 0 )
+        {
+          if ( errno == EINTR ) { continue; }
+          throw nix::SysError( "reading from daemon connection" );
+        }
+      done += static_cast<size_t>( got );
+    }
+  return true;
+}
+
+
+/** @brief Write exactly @a len bytes, retrying on `EINTR`. */
+static void
+writeFull( int conn, const void * buffer, size_t len )
+{
+  const auto * bytes = static_cast<const char *>( buffer );
+  size_t       done  = 0;
+  while ( done < len )
+    {
+      ssize_t put = write( conn, bytes + done, len - done );
+      if ( put < 0 )
+        {
+          if ( errno == EINTR ) { continue; }
+          throw nix::SysError( "writing to daemon connection" );
+        }
+      done += static_cast<size_t>( put );
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+/** @brief Run @a fun with `stdout` captured into the returned string. */
+static std::pair<int, std::string>
+captureStdout( const std::function<int()> & fun )
+{
+  std::cout.flush();
+  if ( fflush( stdout ) != 0 )
+    {
+      throw nix::SysError( "flushing stdout" );
+    }
+
+  nix::Path tempDir = nix::createTempDir();
+  /* One directory is created per served request and the handler can throw;
+   * the guard removes it on every path out so long-lived daemons and
+   * sessions don't accumulate temp dirs. */
+  nix::AutoDelete  delTempDir( tempDir, true );
+  nix::Path        tempFile = tempDir + "/stdout";
+  nix::AutoCloseFD tempFd( open( tempFile.c_str(),
+                                 O_RDWR | O_CREAT | O_TRUNC,
+                                 0600 ) );
+  if ( ! tempFd ) { throw nix::SysError( "creating '%1%'", tempFile ); }
+
+  int saved = dup( STDOUT_FILENO );
+  if ( saved < 0 ) { throw nix::SysError( "saving stdout" ); }
+  if ( dup2( tempFd.get(), STDOUT_FILENO ) < 0 )
+    {
+      close( saved );
+      throw nix::SysError( "redirecting stdout" );
+    }
+
+  int code = EXIT_FAILURE;
+  try
+    {
+      code = fun();
+    }
+  catch ( ... )
+    {
+      std::cout.flush();
+      fflush( stdout );
+      dup2( saved, STDOUT_FILENO );
+      close( saved );
+      throw;
+    }
+  std::cout.flush();
+  fflush( stdout );
+  dup2( saved, STDOUT_FILENO );
+  close( saved );
+
+  return { code, nix::readFile( tempFile ) };
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+DaemonCommand::DaemonCommand(
+  std::function<int( const std::vector<std::string> & )> dispatch )
+  : dispatch( std::move( dispatch ) ), parser( "daemon" )
+{
+  this->parser.add_description(
+    "Serve pkgdb commands over a unix socket with warm state" );
+  this->parser.add_argument( "--socket" )
+    .help( "path of the unix socket to listen on" )
+    .required()
+    .metavar( "PATH" )
+    .action( [&]( const std::string & path ) { this->socketPath = path; } );
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void
+DaemonCommand::serveConnection( int conn )
+{
+  for ( ;; )
+    {
+      uint32_t rawLen = 0;
+      if ( ! readFull( conn, &rawLen, sizeof( rawLen ) ) ) { return; }
+      uint32_t len = ntohl( rawLen );
+
+      std::string payload( len, '\0' );
+      if ( len != 0 ) { readFull( conn, payload.data(), len ); }
+
+      nlohmann::json response;
+      try
+        {
+          nlohmann::json request = nlohmann::json::parse( payload );
+          std::vector<std::string> args
+            = request.at( "args" ).get<std::vector<std::string>>();
+          if ( ( ! args.empty() ) && ( args.front() == "daemon" ) )
+            {
+              throw DaemonException( "refusing to serve nested 'daemon'" );
+            }
+
+          auto [code, output]
+            = captureStdout( [&]() { return this->dispatch( args ); } );
+          response = { { "exit", code }, { "stdout", output } };
+        }
+      catch ( const FloxException & err )
+        {
+          response = { { "exit", err.getErrorCode() },
+                       { "stdout", nlohmann::json( err ).dump() + "\n" } };
+        }
+      catch ( const std::exception & err )
+        {
+          response = { { "exit", EXIT_FAILURE },
+                       { "stdout", "" },
+                       { "error", err.what() } };
+        }
+
+      std::string body     = response.dump();
+      uint32_t    sendLen  = htonl( static_cast<uint32_t>( body.size() ) );
+      writeFull( conn, &sendLen, sizeof( sendLen ) );
+      writeFull( conn, body.data(), body.size() );
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+int
+DaemonCommand::run()
+{
+  /* Served requests construct fresh command objects; keep their store
+   * connections and read-only database handles warm across requests. */
+  enableStoreSharing();
+  pkgdb::setDbHandleRetention( true );
+
+  int sock = socket( AF_UNIX, SOCK_STREAM, 0 );
+  if ( sock < 0 ) { throw nix::SysError( "creating daemon socket" ); }
+
+  struct sockaddr_un addr
+  {};
+  addr.sun_family = AF_UNIX;
+  if ( sizeof( addr.sun_path ) <= this->socketPath.size() )
+    {
+      close( sock );
+      throw DaemonException( "socket path too long: '" + this->socketPath
+                             + "'" );
+    }
+  std::strncpy( addr.sun_path,
+                this->socketPath.c_str(),
+                sizeof( addr.sun_path ) - 1 );
+
+  /* A stale socket file from a previous daemon would block `bind'. */
+  (void) unlink( this->socketPath.c_str() );
+
+  if ( bind( sock,
+             reinterpret_cast<struct sockaddr *>( &addr ),
+             sizeof( addr ) )
+       < 0 )
+    {
+      close( sock );
+      throw nix::SysError( "binding '%1%'", this->socketPath );
+    }
+  if ( listen( sock, SOMAXCONN ) < 0 )
+    {
+      close( sock );
+      throw nix::SysError( "listening on '%1%'", this->socketPath );
+    }
+
+  infoLog( "pkgdb daemon listening on " + this->socketPath );
+
+  /* Serve connections one at a time; the point of the daemon is warm
+   * in-process state, which concurrent dispatch would race on. */
+  for ( ;; )
+    {
+      int conn = accept( sock, nullptr, nullptr );
+      if ( conn < 0 )
+        {
+          if ( errno == EINTR ) { continue; }
+          close( sock );
+          (void) unlink( this->socketPath.c_str() );
+          throw nix::SysError( "accepting daemon connection" );
+        }
+      try
+        {
+          this->serveConnection( conn );
+        }
+      catch ( const std::exception & err )
+        {
+          /* A broken client connection must not take the daemon down. */
+          nix::warn( "daemon connection failed: %s", err.what() );
+        }
+      close( conn );
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+SessionCommand::SessionCommand(
+  std::function<int( const std::vector<std::string> & )> dispatch )
+  : dispatch( std::move( dispatch ) ), parser( "session" )
+{
+  this->parser.add_description(
+    "Serve a sequence of pkgdb commands over stdin/stdout" );
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+int
+SessionCommand::run()
+{
+  /* Served commands construct fresh command objects; keep their store
+   * connections and read-only database handles warm across lines. */
+  enableStoreSharing();
+  pkgdb::setDbHandleRetention( true );
+
+  std::string line;
+  while ( std::getline( std::cin, line ) )
+    {
+      if ( line.empty() ) { continue; }
+
+      nlohmann::json response;
+      nlohmann::json requestId;
+      try
+        {
+          nlohmann::json request = nlohmann::json::parse( line );
+          if ( request.contains( "id" ) ) { requestId = request.at( "id" ); }
+          std::vector<std::string> args
+            = request.at( "args" ).get<std::vector<std::string>>();
+          if ( ( ! args.empty() )
+               && ( ( args.front() == "session" )
+                    || ( args.front() == "daemon" ) ) )
+            {
+              throw DaemonException( "refusing to serve nested '"
+                                     + args.front() + "'" );
+            }
+
+          auto [code, output]
+            = captureStdout( [&]() { return this->dispatch( args ); } );
+          response = { { "exit", code }, { "stdout", output } };
+        }
+      catch ( const FloxException & err )
+        {
+          response = { { "exit", err.getErrorCode() },
+                       { "stdout", nlohmann::json( err ).dump() + "\n" } };
+        }
+      catch ( const std::exception & err )
+        {
+          response = { { "exit", EXIT_FAILURE },
+                       { "stdout", "" },
+                       { "error", err.what() } };
+        }
+      response.emplace( "id", requestId );
+
+      /* Responses are written after stdout is restored, so command output
+       * never interleaves with the protocol stream. */
+      std::cout << response.dump() << std::endl;
+    }
+  return EXIT_SUCCESS;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+}  // namespace flox
+
+
+/* -------------------------------------------------------------------------- *
+ *
+ *
+ *
+ * ========================================================================== */
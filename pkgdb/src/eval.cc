@@ -7,11 +7,20 @@
  *
  * -------------------------------------------------------------------------- */
 
+#include <cstdlib>
+#include <filesystem>
 #include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unistd.h>
 
 #include <nix/eval.hh>
+#include <nix/globals.hh>
+#include <nix/hash.hh>
+#include <nix/util.hh>
 #include <nix/value-to-json.hh>
 
+#include "flox/core/expr.hh"
 #include "flox/eval.hh"
 
 
@@ -19,6 +28,35 @@
 
 namespace flox {
 
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Whether rendered evaluation results may be cached on disk.
+ *
+ * Controlled by the environment variable `PKGDB_EVAL_CACHE`; enabled unless
+ * set to `0`.
+ * Only pure evaluations are ever cached, since their results are
+ * deterministic for a given expression.
+ * Evaluations which lock flake refs through the `flox` primops are excluded
+ * even then; see `flakeRefPrimopCalls`.
+ */
+static bool
+evalResultCacheEnabled()
+{
+  const char * maybeCache = std::getenv( "PKGDB_EVAL_CACHE" );
+  return ( maybeCache == nullptr )
+         || ( std::string_view( maybeCache ) != "0" );
+}
+
+
+/** @brief Directory holding rendered evaluation results. */
+static std::filesystem::path
+getEvalResultCacheDir()
+{
+  return std::filesystem::path( nix::getCacheDir() ) / "flox" / "evals-v1";
+}
+
+
 /* -------------------------------------------------------------------------- */
 
 EvalCommand::EvalCommand() : parser( "eval" )
@@ -97,6 +135,55 @@ EvalCommand::EvalCommand() : parser( "eval" )
 int
 EvalCommand::run()
 {
+  /* Read the expression source up front so the cache key and a miss
+   * evaluation share it.
+   * `STDIN' expressions are never cached; consuming the stream to hash it
+   * would change how parse errors surface. */
+  std::optional<std::string> source;
+  if ( this->file.has_value() )
+    {
+      if ( ( *this->file ) != "-" )
+        {
+          source = nix::readFile( this->file->string() );
+        }
+    }
+  else if ( this->expr.has_value() ) { source = this->expr; }
+
+  /* Check for a previously rendered result before touching any `nix' state;
+   * hits respond without creating an evaluator or store connection.
+   * The rendering style is part of the key since the cache stores final
+   * output bytes. */
+  std::optional<std::filesystem::path> cachePath;
+  if ( source.has_value() && nix::evalSettings.pureEval
+       && evalResultCacheEnabled() )
+    {
+      std::string key = nix::fmt( "%s\n%d\n%s\n%s",
+                                  FLOX_PKGDB_VERSION,
+                                  static_cast<int>( this->style ),
+                                  nix::settings.thisSystem.get(),
+                                  *source );
+      cachePath
+        = getEvalResultCacheDir()
+          / nix::hashString( nix::htSHA256, key ).to_string( nix::Base32,
+                                                             false );
+      if ( std::filesystem::exists( *cachePath ) )
+        {
+          std::string cached = nix::readFile( cachePath->string() );
+          if ( this->style == STYLE_RAW ) { std::cout << cached; }
+          else { std::cout << cached << '\n'; }
+          std::cout.flush();
+          return EXIT_SUCCESS;
+        }
+    }
+
+  /* `builtins.resolve` and `builtins.getFingerprint` lock flake refs at
+   * evaluation time, so an expression calling either is not determined by
+   * its text even under pure evaluation.
+   * Snapshot the primop call counter here; if it moves during the eval the
+   * result is never recorded, which also guarantees no such entry can ever
+   * be served as a hit above. */
+  unsigned flakeRefCalls = flakeRefPrimopCalls();
+
   auto   state = this->getState();
   auto * value = state->allocValue();
   if ( this->file.has_value() )
@@ -128,30 +215,58 @@ EvalCommand::run()
 
   nix::NixStringContext context;
 
+  /* Results are rendered to a string so one code path both emits them and
+   * fills the cache. */
+  std::string rendered;
+
   switch ( this->style )
     {
       case STYLE_VALUE:
-        state->forceValueDeep( *value );
-        nix::logger->cout( "%s", nix::printValue( *state, *value ) );
-        break;
+        {
+          state->forceValueDeep( *value );
+          std::stringstream rendering;
+          rendering << nix::printValue( *state, *value );
+          rendered = rendering.str();
+          nix::logger->cout( "%s", rendered );
+          break;
+        }
 
       case STYLE_RAW:
-        nix::writeFull(
-          STDOUT_FILENO,
+        rendered = std::string(
           *state->coerceToString( nix::noPos,
                                   *value,
                                   context,
                                   "while generate eval command output" ) );
+        nix::writeFull( STDOUT_FILENO, rendered );
         break;
 
       case STYLE_JSON:
-        nix::logger->cout( "%s",
-                           nix::printValueAsJSON( *state,
-                                                  true,
-                                                  *value,
-                                                  nix::noPos,
-                                                  context,
-                                                  false ) );
+        rendered = nix::printValueAsJSON( *state,
+                                          true,
+                                          *value,
+                                          nix::noPos,
+                                          context,
+                                          false )
+                     .dump();
+        nix::logger->cout( "%s", rendered );
+    }
+
+  /* Fill the cache best-effort; a failure to write never fails the eval.
+   * The result lands under a temporary name first so concurrent readers
+   * only ever see complete entries. */
+  if ( cachePath.has_value() && ( flakeRefPrimopCalls() == flakeRefCalls ) )
+    {
+      try
+        {
+          std::filesystem::create_directories( cachePath->parent_path() );
+          std::filesystem::path tmpPath
+            = cachePath->string() + nix::fmt( ".%d", getpid() );
+          nix::writeFile( tmpPath.string(), rendered );
+          std::filesystem::rename( tmpPath, *cachePath );
+        }
+      catch ( const std::exception & )
+        { /* Ignore cache write failures. */
+        }
     }
 
   return EXIT_SUCCESS;
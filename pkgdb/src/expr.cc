@@ -33,6 +33,24 @@ forceTrivialValue( nix::EvalState &  state,
 }
 
 
+/* -------------------------------------------------------------------------- */
+
+/** Count of flake-ref locking primop calls; see `flakeRefPrimopCalls`. */
+static unsigned flakeRefPrimopCallCount = 0;
+
+unsigned
+flakeRefPrimopCalls()
+{
+  return flakeRefPrimopCallCount;
+}
+
+void
+noteFlakeRefPrimopCall()
+{
+  ++flakeRefPrimopCallCount;
+}
+
+
 /* -------------------------------------------------------------------------- */
 
 nix::FlakeRef
@@ -55,20 +55,10 @@ FlakePackage::init( bool checkDrv )
 
   this->_system = this->_pathS[1];
 
+  /* Only probe for the presence of `meta' here; its fields are evaluated
+   * lazily on first access. */
   MaybeCursor cursor = this->_cursor->maybeGetAttr( "meta" );
   this->_hasMetaAttr = cursor != nullptr;
-  if ( cursor != nullptr )
-    {
-      if ( cursor = cursor->maybeGetAttr( "license" ); cursor != nullptr )
-        {
-          try
-            {
-              this->_license = cursor->getAttr( "spdxId" )->getString();
-            }
-          catch ( ... )
-            {}
-        }
-    }
 
   cursor = this->_cursor->maybeGetAttr( "pname" );
   if ( cursor != nullptr )
@@ -128,35 +118,86 @@ FlakePackage::getOutputsToInstall() const
 std::optional<bool>
 FlakePackage::isBroken() const
 {
+  if ( this->_broken.has_value() ) { return *this->_broken; }
   if ( ! this->_hasMetaAttr ) { return std::nullopt; }
   try
     {
       MaybeCursor cursor
         = this->_cursor->getAttr( "meta" )->maybeGetAttr( "broken" );
-      if ( cursor == nullptr ) { return std::nullopt; }
-      return cursor->getBool();
+      if ( cursor == nullptr ) { this->_broken = std::optional<bool>(); }
+      else { this->_broken = std::make_optional( cursor->getBool() ); }
     }
   catch ( ... )
     {
-      return std::nullopt;
+      this->_broken = std::optional<bool>();
     }
+  return *this->_broken;
 }
 
 std::optional<bool>
 FlakePackage::isUnfree() const
 {
+  if ( this->_unfree.has_value() ) { return *this->_unfree; }
   if ( ! this->_hasMetaAttr ) { return std::nullopt; }
   try
     {
       MaybeCursor cursor
         = this->_cursor->getAttr( "meta" )->maybeGetAttr( "unfree" );
-      if ( cursor == nullptr ) { return std::nullopt; }
-      return cursor->getBool();
+      if ( cursor == nullptr ) { this->_unfree = std::optional<bool>(); }
+      else { this->_unfree = std::make_optional( cursor->getBool() ); }
     }
   catch ( ... )
     {
-      return std::nullopt;
+      this->_unfree = std::optional<bool>();
     }
+  return *this->_unfree;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+std::optional<std::string>
+FlakePackage::getLicense() const
+{
+  if ( this->_license.has_value() ) { return *this->_license; }
+  this->_license = std::optional<std::string>();
+  if ( ! this->_hasMetaAttr ) { return std::nullopt; }
+  try
+    {
+      MaybeCursor cursor
+        = this->_cursor->getAttr( "meta" )->maybeGetAttr( "license" );
+      if ( cursor != nullptr )
+        {
+          this->_license
+            = std::make_optional( cursor->getAttr( "spdxId" )->getString() );
+        }
+    }
+  catch ( ... )
+    {}
+  return *this->_license;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+std::optional<std::string>
+FlakePackage::getDescription() const
+{
+  if ( this->_description.has_value() ) { return *this->_description; }
+  this->_description = std::optional<std::string>();
+  if ( ! this->_hasMetaAttr ) { return std::nullopt; }
+  try
+    {
+      MaybeCursor cursor
+        = this->_cursor->getAttr( "meta" )->maybeGetAttr( "description" );
+      if ( cursor != nullptr )
+        {
+          this->_description = std::make_optional( cursor->getString() );
+        }
+    }
+  catch ( ... )
+    {}
+  return *this->_description;
 }
 
 
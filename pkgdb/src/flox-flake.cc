@@ -9,6 +9,7 @@
  * -------------------------------------------------------------------------- */
 
 #include <cassert>
+#include <cstdlib>
 #include <exception>
 #include <functional>
 #include <memory>
@@ -26,6 +27,7 @@
 #include <nix/value.hh>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "flox/core/types.hh"
@@ -91,6 +93,81 @@ ensureFlakeIsDownloaded( std::function<void()> lambda )
     }
 }
 
+/* -------------------------------------------------------------------------- */
+
+void
+ensureFlakesAreDownloaded( const std::vector<std::function<void()>> & lambdas )
+{
+  /* Nothing to overlap with a single download. */
+  if ( lambdas.size() < 2 )
+    {
+      for ( const auto & lambda : lambdas )
+        {
+          ensureFlakeIsDownloaded( lambda );
+        }
+      return;
+    }
+
+  std::vector<pid_t> pids;
+  pids.reserve( lambdas.size() );
+  for ( const auto & lambda : lambdas )
+    {
+      pid_t pid = fork();
+      if ( pid == -1 )
+        {
+          errorLog(
+            "ensureFlakesAreDownloaded: failed to fork for flake download!" );
+          exit( EXIT_FAILURE );
+        }
+      if ( pid == 0 )
+        {
+          lambda();
+          try
+            {
+              debugLog( "ensureFlakesAreDownloaded(child): finished, exiting" );
+              exit( EXIT_SUCCESS );
+            }
+          catch ( const std::exception & err )
+            {
+              debugLog( nix::fmt( "ensureFlakesAreDownloaded(child): "
+                                  "caught exception on exit: %s",
+                                  err.what() ) );
+              exit( EXIT_SUCCESS );
+            }
+        }
+      debugLog( nix::fmt( "ensureFlakesAreDownloaded: forked child: %d", pid ) );
+      pids.push_back( pid );
+    }
+
+  /* Reap every child before acting on failures so none are orphaned. */
+  std::optional<int> firstFailure;
+  bool               signalled = false;
+  for ( pid_t pid : pids )
+    {
+      int status = 0;
+      waitpid( pid, &status, 0 );
+      debugLog( nix::fmt( "ensureFlakesAreDownloaded: child %d is finished, "
+                          "exit code: %d, signal: %d",
+                          pid,
+                          WEXITSTATUS( status ),
+                          WTERMSIG( status ) ) );
+      if ( ! WIFEXITED( status ) ) { signalled = true; }
+      else if ( ( WEXITSTATUS( status ) != EXIT_SUCCESS )
+                && ( ! firstFailure.has_value() ) )
+        {
+          firstFailure = WEXITSTATUS( status );
+        }
+    }
+
+  /* The error has already been reported via the child, just pass along the
+   * exit code. */
+  if ( firstFailure.has_value() ) { exit( *firstFailure ); }
+  if ( signalled ) { throw LockFlakeException( "failed to lock flake" ); }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
 FloxFlake::FloxFlake( const nix::ref<nix::EvalState> & state,
                       const nix::FlakeRef &            ref )
 try : state( state ),
@@ -116,6 +193,32 @@ catch ( ... )
   }
 
 
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Detect whether the on-disk eval cache should also back
+ *        impure evaluations.
+ *
+ * `nix` keys its persistent eval cache by flake fingerprint, so every process
+ * on a host evaluating the same locked flake already shares one database;
+ * however it refuses to use it for impure evaluations since those may observe
+ * state outside the fingerprint.  Our scrape and search paths only read flake
+ * outputs - which are fully determined by the locked inputs - so on hosts that
+ * run many concurrent `pkgdb` invocations against one rev it is safe and very
+ * profitable to opt in with `PKGDB_SHARED_EVAL_CACHE`.
+ */
+static bool
+useSharedEvalCache()
+{
+  static const bool shared = []()
+  {
+    const char * env = std::getenv( "PKGDB_SHARED_EVAL_CACHE" );
+    return ( env != nullptr ) && ( std::string_view( env ) != "0" );
+  }();
+  return shared;
+}
+
+
 /* -------------------------------------------------------------------------- */
 
 nix::ref<nix::eval_cache::EvalCache>
@@ -125,7 +228,8 @@ FloxFlake::openEvalCache()
     {
       auto fingerprint = this->lockedFlake.getFingerprint();
       this->_cache     = std::make_shared<nix::eval_cache::EvalCache>(
-        ( nix::evalSettings.useEvalCache && nix::evalSettings.pureEval )
+        ( nix::evalSettings.useEvalCache
+          && ( nix::evalSettings.pureEval || useSharedEvalCache() ) )
               ? std::optional { std::cref( fingerprint ) }
               : std::nullopt,
         *this->state,
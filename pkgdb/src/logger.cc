@@ -7,10 +7,21 @@
  *
  * -------------------------------------------------------------------------- */
 
-#include <nix/logging.hh>
-#include <nix/util.hh>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include <nix/logging.hh>
+#include <nix/util.hh>
 
 #include "flox/core/nix-state.hh"
 
@@ -37,6 +48,205 @@ shouldANSI()
 }
 
 
+/* -------------------------------------------------------------------------- */
+
+/** @brief Whether bulk log emission should go through the ring buffer.
+ * Opt-in via `PKGDB_ASYNC_LOG`; synchronous emission stays the default so
+ * messages are never lost on a crash. */
+static bool
+useAsyncLog()
+{
+  static const bool enabled = []()
+  {
+    const char * maybeAsync = std::getenv( "PKGDB_ASYNC_LOG" );
+    return ( maybeAsync != nullptr )
+           && ( std::string_view( maybeAsync ) != "0" );
+  }();
+  return enabled;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief A bounded lock-free ring of pending log lines.
+ *
+ * Producers claim slots with a compare-and-swap and never block; a single
+ * background thread drains claimed slots in order and performs the actual
+ * `stderr` emission, taking the formatting-to-syscall cost off hot loops
+ * like the scrape walk.  When the ring is full the caller falls back to
+ * synchronous emission, so lines are delayed under pressure but never
+ * dropped.
+ */
+class LogRing
+{
+
+private:
+
+  /* Must be a power of two so slot indexing can mask instead of modulo. */
+  static constexpr size_t RING_SIZE = 1024;
+
+  struct Slot
+  {
+    std::atomic<size_t> seq;
+    nix::Verbosity      lvl;
+    std::string         msg;
+  }; /* End struct `Slot' */
+
+  std::vector<Slot>   slots;
+  std::atomic<size_t> enqueuePos { 0 };
+  size_t              dequeuePos = 0;
+  std::atomic<bool>   stopping { false };
+
+  /* The drainer thread only exists in the process that constructed the
+   * ring; forked children ( scrape workers, fetch helpers ) inherit the
+   * object but not the thread, and must neither push to it nor join it. */
+  pid_t ownerPid;
+
+  std::function<void( nix::Verbosity, const std::string & )> emit;
+
+  std::thread drainer;
+
+
+  /** @brief Pop one claimed slot; single consumer only. */
+  bool
+  tryPop( nix::Verbosity & lvl, std::string & msg )
+  {
+    Slot & slot = this->slots[this->dequeuePos % RING_SIZE];
+    size_t seq  = slot.seq.load( std::memory_order_acquire );
+    if ( static_cast<intptr_t>( seq )
+         - static_cast<intptr_t>( this->dequeuePos + 1 )
+         != 0 )
+      {
+        return false;
+      }
+    lvl = slot.lvl;
+    msg = std::move( slot.msg );
+    slot.seq.store( this->dequeuePos + RING_SIZE,
+                    std::memory_order_release );
+    ++this->dequeuePos;
+    return true;
+  }
+
+
+public:
+
+  explicit LogRing(
+    std::function<void( nix::Verbosity, const std::string & )> emit )
+    : slots( RING_SIZE ), ownerPid( getpid() ), emit( std::move( emit ) )
+  {
+    for ( size_t idx = 0; idx < RING_SIZE; ++idx )
+      {
+        this->slots[idx].seq.store( idx, std::memory_order_relaxed );
+      }
+    this->drainer = std::thread(
+      [this]()
+      {
+        nix::Verbosity lvl = nix::lvlError;
+        std::string    msg;
+        for ( ;; )
+          {
+            if ( this->tryPop( lvl, msg ) )
+              {
+                this->emit( lvl, msg );
+                continue;
+              }
+            if ( this->stopping.load( std::memory_order_acquire ) )
+              {
+                return;
+              }
+            std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+          }
+      } );
+  }
+
+  LogRing( const LogRing & ) = delete;
+  LogRing( LogRing && )      = delete;
+  LogRing &
+  operator=( const LogRing & )
+    = delete;
+  LogRing &
+  operator=( LogRing && )
+    = delete;
+
+  /** @brief Stop the drainer, flushing every claimed slot.  Idempotent. */
+  void
+  shutdown()
+  {
+    if ( this->stopping.exchange( true, std::memory_order_acq_rel ) )
+      {
+        return;
+      }
+    if ( getpid() != this->ownerPid )
+      {
+        /* Forked child: the drainer thread does not exist on this side of
+         * the fork, so joining would abort the process.  Drop the stale
+         * handle; the parent drains its own copy of the ring. */
+        this->drainer.detach();
+        return;
+      }
+    if ( this->drainer.joinable() ) { this->drainer.join(); }
+  }
+
+
+  ~LogRing() { this->shutdown(); }
+
+
+  /** @brief Claim a slot and store one line without blocking.
+   * @return `false` when the ring is full ( or in a forked child, where no
+   *         drainer exists ); the caller should emit synchronously instead. */
+  bool
+  tryPush( nix::Verbosity lvl, std::string && msg )
+  {
+    if ( getpid() != this->ownerPid ) { return false; }
+    size_t pos = this->enqueuePos.load( std::memory_order_relaxed );
+    for ( ;; )
+      {
+        Slot &   slot = this->slots[pos % RING_SIZE];
+        size_t   seq  = slot.seq.load( std::memory_order_acquire );
+        intptr_t dif
+          = static_cast<intptr_t>( seq ) - static_cast<intptr_t>( pos );
+        if ( dif == 0 )
+          {
+            if ( this->enqueuePos.compare_exchange_weak(
+                   pos,
+                   pos + 1,
+                   std::memory_order_relaxed ) )
+              {
+                slot.lvl = lvl;
+                slot.msg = std::move( msg );
+                slot.seq.store( pos + 1, std::memory_order_release );
+                return true;
+              }
+          }
+        else if ( dif < 0 ) { return false; }
+        else { pos = this->enqueuePos.load( std::memory_order_relaxed ); }
+      }
+  }
+
+
+}; /* End class `LogRing' */
+
+
+/* -------------------------------------------------------------------------- */
+
+/* The installed logger lives for the whole process ( `nix::logger' is never
+ * deleted ), so buffered lines are flushed from an `atexit' handler rather
+ * than a destructor.  `shutdown' itself is fork-aware, making the handler
+ * safe in children that inherit the ring. */
+static std::atomic<LogRing *> activeLogRing { nullptr };
+
+static void
+flushActiveLogRing()
+{
+  if ( LogRing * ring = activeLogRing.load( std::memory_order_acquire );
+       ring != nullptr )
+    {
+      ring->shutdown();
+    }
+}
+
+
 /* -------------------------------------------------------------------------- */
 
 /**
@@ -84,6 +294,11 @@ protected:
   }
 
 
+  /** The ring used for deferred emission, owned by this logger; only
+   * allocated when `PKGDB_ASYNC_LOG` enables the async path. */
+  std::unique_ptr<LogRing> logRing;
+
+
 public:
 
   bool systemd;        /**< Whether we should emit `systemd` style logs. */
@@ -96,7 +311,29 @@ public:
     , tty( isatty( STDERR_FILENO ) != 0 )
     , color( shouldANSI() )
     , printBuildLogs( printBuildLogs )
-  {}
+  {
+    if ( useAsyncLog() )
+      {
+        this->logRing = std::make_unique<LogRing>(
+          [this]( nix::Verbosity lvl, const std::string & msg )
+          { this->emit( lvl, msg ); } );
+        activeLogRing.store( this->logRing.get(),
+                             std::memory_order_release );
+        std::atexit( flushActiveLogRing );
+      }
+  }
+
+  ~FilteredLogger() override
+  {
+    /* Unregister before the ring is destroyed so the exit handler can
+     * never touch a dangling pointer. */
+    if ( LogRing * mine = this->logRing.get(); mine != nullptr )
+      {
+        activeLogRing.compare_exchange_strong( mine,
+                                               nullptr,
+                                               std::memory_order_acq_rel );
+      }
+  }
 
 
   /** @brief Whether the logger prints the whole build log. */
@@ -141,6 +378,22 @@ public:
         return;
       }
 
+    /* Chatty lines may be deferred to the drain thread; errors and
+     * warnings always emit synchronously and in order. */
+    if ( ( this->logRing != nullptr ) && ( nix::lvlTalkative <= lvl )
+         && this->logRing->tryPush( lvl, std::string( str ) ) )
+      {
+        return;
+      }
+
+    this->emit( lvl, std::string( str ) );
+  }
+
+
+  /** @brief Perform the actual `stderr` emission for one line. */
+  void
+  emit( nix::Verbosity lvl, const std::string & str )
+  {
     /* Handle `systemd' style log level prefixes. */
     std::string prefix;
     if ( systemd )
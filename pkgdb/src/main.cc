@@ -15,6 +15,7 @@
 #include <string>
 #include <string_view>
 #include <unistd.h>
+#include <vector>
 
 #include <nix/error.hh>
 #include <nix/util.hh>
@@ -23,6 +24,7 @@
 #include "flox/buildenv/command.hh"
 #include "flox/core/command.hh"
 #include "flox/core/exceptions.hh"
+#include "flox/daemon.hh"
 #include "flox/eval.hh"
 #include "flox/parse/command.hh"
 #include "flox/pkgdb/command.hh"
@@ -78,15 +80,27 @@ run( int argc, char * argv[] )
   flox::pkgdb::ScrapeCommand cmdScrape;
   prog.add_subparser( cmdScrape.getParser() );
 
+  flox::pkgdb::MergeShardsCommand cmdMergeShards;
+  prog.add_subparser( cmdMergeShards.getParser() );
+
   flox::pkgdb::GetCommand cmdGet;
   prog.add_subparser( cmdGet.getParser() );
 
   flox::pkgdb::ListCommand cmdList;
   prog.add_subparser( cmdList.getParser() );
 
+  flox::pkgdb::StatsCommand cmdStats;
+  prog.add_subparser( cmdStats.getParser() );
+
+  flox::pkgdb::LoadRanksCommand cmdLoadRanks;
+  prog.add_subparser( cmdLoadRanks.getParser() );
+
   flox::pkgdb::GCCommand cmdGC;
   prog.add_subparser( cmdGC.getParser() );
 
+  flox::pkgdb::PrefetchCommand cmdPrefetch;
+  prog.add_subparser( cmdPrefetch.getParser() );
+
   flox::search::SearchCommand cmdSearch;
   prog.add_subparser( cmdSearch.getParser() );
 
@@ -105,6 +119,27 @@ run( int argc, char * argv[] )
   flox::buildenv::BuildEnvCommand cmdBuildEnv;
   prog.add_subparser( cmdBuildEnv.getParser() );
 
+  /* The daemon and session modes re-enter `run' with the argument vectors
+   * they receive, constructing fresh command objects per request while nix
+   * state stays warm in-process. */
+  auto reenter = []( const std::vector<std::string> & args )
+  {
+    std::vector<std::string> argStrs;
+    argStrs.reserve( args.size() + 1 );
+    argStrs.emplace_back( "pkgdb" );
+    for ( const auto & arg : args ) { argStrs.emplace_back( arg ); }
+    std::vector<char *> argv;
+    argv.reserve( argStrs.size() );
+    for ( auto & arg : argStrs ) { argv.push_back( arg.data() ); }
+    return run( static_cast<int>( argv.size() ), argv.data() );
+  };
+
+  flox::DaemonCommand cmdDaemon( reenter );
+  prog.add_subparser( cmdDaemon.getParser() );
+
+  flox::SessionCommand cmdSession( reenter );
+  prog.add_subparser( cmdSession.getParser() );
+
 
   /* Parse Args */
   try
@@ -118,15 +153,27 @@ run( int argc, char * argv[] )
 
   /* Run subcommand */
   if ( prog.is_subcommand_used( "scrape" ) ) { return cmdScrape.run(); }
+  if ( prog.is_subcommand_used( "merge-shards" ) )
+    {
+      return cmdMergeShards.run();
+    }
   if ( prog.is_subcommand_used( "get" ) ) { return cmdGet.run(); }
   if ( prog.is_subcommand_used( "list" ) ) { return cmdList.run(); }
+  if ( prog.is_subcommand_used( "stats" ) ) { return cmdStats.run(); }
+  if ( prog.is_subcommand_used( "load-ranks" ) )
+    {
+      return cmdLoadRanks.run();
+    }
   if ( prog.is_subcommand_used( "gc" ) ) { return cmdGC.run(); }
+  if ( prog.is_subcommand_used( "prefetch" ) ) { return cmdPrefetch.run(); }
   if ( prog.is_subcommand_used( "search" ) ) { return cmdSearch.run(); }
   if ( prog.is_subcommand_used( "manifest" ) ) { return cmdManifest.run(); }
   if ( prog.is_subcommand_used( "parse" ) ) { return cmdParse.run(); }
   if ( prog.is_subcommand_used( "repl" ) ) { return cmdRepl.run(); }
   if ( prog.is_subcommand_used( "eval" ) ) { return cmdEval.run(); }
   if ( prog.is_subcommand_used( "buildenv" ) ) { return cmdBuildEnv.run(); }
+  if ( prog.is_subcommand_used( "daemon" ) ) { return cmdDaemon.run(); }
+  if ( prog.is_subcommand_used( "session" ) ) { return cmdSession.run(); }
 
   // TODO: better error for this,
   // likely only occurs if we add a new command without handling it (?)
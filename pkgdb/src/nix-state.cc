@@ -8,6 +8,8 @@
  * -------------------------------------------------------------------------- */
 
 #include <cstddef>
+#include <cstdlib>
+#include <string_view>
 
 #include <nix/config.hh>
 #include <nix/error.hh>
@@ -38,12 +40,22 @@ initNix()
   /* Set the BoehmGC ( used by `nix` ) to handle forking properly. */
   GC_set_handle_fork( 1 );
   nix::initGC();
-  /* Suppress benign warnings about `nix.conf'. */
-  nix::Verbosity oldVerbosity = nix::verbosity;
-  nix::verbosity              = nix::lvlError;
-  nix::initPlugins();
-  /* Restore verbosity to `nix' global setting */
-  nix::verbosity = oldVerbosity;
+  /* Plugin loading pays a `dlopen' scan per configured file; skip the call
+   * outright when no plugins are configured, which is the common case.
+   * `PKGDB_NIX_PLUGINS=0' forces the skip even when `nix.conf' lists some,
+   * for hot paths that are known not to need them. */
+  const char * maybePlugins = std::getenv( "PKGDB_NIX_PLUGINS" );
+  bool         skipPlugins  = ( maybePlugins != nullptr )
+                     && ( std::string_view( maybePlugins ) == "0" );
+  if ( ( ! skipPlugins ) && ( ! nix::settings.pluginFiles.get().empty() ) )
+    {
+      /* Suppress benign warnings about `nix.conf'. */
+      nix::Verbosity oldVerbosity = nix::verbosity;
+      nix::verbosity              = nix::lvlError;
+      nix::initPlugins();
+      /* Restore verbosity to `nix' global setting */
+      nix::verbosity = oldVerbosity;
+    }
 
   nix::evalSettings.enableImportFromDerivation.setDefault( false );
   nix::evalSettings.pureEval.setDefault( true );
@@ -60,6 +72,32 @@ initNix()
 }
 
 
+/* -------------------------------------------------------------------------- */
+
+/** Shared store connection, populated lazily once sharing is enabled. */
+static std::shared_ptr<nix::Store> sharedStore;
+static bool                        storeSharing = false;
+
+
+void
+enableStoreSharing()
+{
+  storeSharing = true;
+}
+
+
+std::shared_ptr<nix::Store>
+openDefaultStore()
+{
+  if ( storeSharing )
+    {
+      if ( sharedStore == nullptr ) { sharedStore = nix::openStore(); }
+      return sharedStore;
+    }
+  return nix::openStore();
+}
+
+
 /* -------------------------------------------------------------------------- */
 
 }  // namespace flox
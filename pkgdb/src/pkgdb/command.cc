@@ -130,14 +130,14 @@ PkgDbMixin<PkgDbReadOnly>::openPkgDb()
 
   if ( this->flake != nullptr )
     {
-      this->db = std::make_shared<PkgDbReadOnly>(
-        this->flake->lockedFlake.getFingerprint(),
-        static_cast<std::string>( *this->dbPath ) );
+      this->db
+        = openPkgDbReadOnly( this->flake->lockedFlake.getFingerprint(),
+                             static_cast<std::string>( *this->dbPath ) );
     }
   else
     {
-      this->db = std::make_shared<PkgDbReadOnly>(
-        static_cast<std::string>( *this->dbPath ) );
+      this->db
+        = openPkgDbReadOnly( static_cast<std::string>( *this->dbPath ) );
     }
 }
 
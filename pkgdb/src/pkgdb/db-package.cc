@@ -16,39 +16,66 @@ namespace flox::pkgdb {
 
 /* -------------------------------------------------------------------------- */
 
-// TODO: Conversion by JSON isn't efficient. Read values directly.
 void
-DbPackage::initRawPackage( PkgDbReadOnly & pkgdb )
+DbPackage::initCoreFields( PkgDbReadOnly & pkgdb )
 {
   sqlite3pp::query qry( pkgdb.db, R"SQL(
-      SELECT json_object(
-        'name',             name
-      , 'pname',            pname
-      , 'version',          version
-      , 'semver',           semver
-      , 'license',          license
-      , 'outputs',          json( outputs )
-      , 'outputsToInstall', json( outputsToInstall )
-      , 'broken',           CASE WHEN broken THEN json( 'true' )
-                                             ELSE json( 'false' )
-                            END
-      , 'unfree',           CASE WHEN unfree THEN json( 'true' )
-                                             ELSE json( 'false' )
-                            END
-      , 'description',      description
-      ) AS json
+      SELECT name, pname, version, semver, license, broken, unfree
+      FROM Packages WHERE ( id = ? )
+    )SQL" );
+  qry.bind( 1, static_cast<long long>( this->pkgId ) );
+  auto row = *qry.begin();
+
+  auto optText = []( const char * text ) -> std::optional<std::string>
+  { return ( text == nullptr ) ? std::nullopt
+                               : std::make_optional<std::string>( text ); };
+
+  this->name    = row.get<std::string>( 0 );
+  this->pname   = row.get<std::string>( 1 );
+  this->version = optText( row.get<const char *>( 2 ) );
+  this->semver  = optText( row.get<const char *>( 3 ) );
+  this->license = optText( row.get<const char *>( 4 ) );
+  this->broken  = ( row.get<const char *>( 5 ) == nullptr )
+                    ? std::nullopt
+                    : std::make_optional<bool>( row.get<int>( 5 ) != 0 );
+  this->unfree  = ( row.get<const char *>( 6 ) == nullptr )
+                    ? std::nullopt
+                    : std::make_optional<bool>( row.get<int>( 6 ) != 0 );
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void
+DbPackage::loadDetails() const
+{
+  if ( this->detailsLoaded ) { return; }
+  /* Getters are `const' on the `Package' interface; memoization writes
+   * through the inherited fields regardless. */
+  auto * self = const_cast<DbPackage *>( this );  // NOLINT
+
+  auto             pkgdb = openPkgDbReadOnly( this->dbPath.string() );
+  sqlite3pp::query qry( pkgdb->db, R"SQL(
+      SELECT json( outputs ), json( outputsToInstall )
+           , uncompress_description( Descriptions.description )
       FROM Packages
       LEFT OUTER JOIN Descriptions
-        ON ( Packages.descriptionId = Descriptions.id  )
+        ON ( Packages.descriptionId = Descriptions.id )
       WHERE ( Packages.id = ? )
     )SQL" );
   qry.bind( 1, static_cast<long long>( this->pkgId ) );
-  auto json = nlohmann::json::parse( ( *qry.begin() ).get<std::string>( 0 ) );
-  /* We have to stash our `path' because `from_json' would clear it. */
-  auto pathTmp = std::move( this->path );
-  from_json( json, dynamic_cast<RawPackage &>( *this ) );
-  /* Restore original `path'. */
-  this->path = std::move( pathTmp );
+  auto row = *qry.begin();
+
+  self->outputs = nlohmann::json::parse( row.get<std::string>( 0 ) )
+                    .get<std::vector<std::string>>();
+  self->outputsToInstall = nlohmann::json::parse( row.get<std::string>( 1 ) )
+                             .get<std::vector<std::string>>();
+  if ( const char * text = row.get<const char *>( 2 ); text != nullptr )
+    {
+      self->description = text;
+    }
+
+  self->detailsLoaded = true;
 }
 
 
@@ -0,0 +1,393 @@
+/* ========================================================================== *
+ *
+ * @file pkgdb/eval-cache-import.cc
+ *
+ * @brief Fast-path population of a @a PkgDb from `nix`'s own eval-cache
+ *        SQLite database.
+ *
+ * For flakes that have been evaluated before, everything a scrape would
+ * recompute through `Cursor` evaluation already sits in the eval-cache
+ * database opened by @a FloxFlake::openEvalCache.
+ * Reading it SQL-to-SQL turns a warm re-scrape into pure I/O.
+ *
+ *
+ * -------------------------------------------------------------------------- */
+
+#include <deque>
+#include <optional>
+#include <tuple>
+
+#include <nix/names.hh>
+#include <nix/util.hh>
+#include <sqlite3pp.hh>
+
+#include "flox/pkgdb/write.hh"
+#include "versions.hh"
+
+
+/* -------------------------------------------------------------------------- */
+
+namespace flox::pkgdb {
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Mirrors the private `AttrType` enum from `nix/src/libexpr/eval-cache.cc`.
+ * The eval-cache schema is not a public interface, which is why the importer
+ * bails out ( falling back to cursor evaluation ) whenever a row does not
+ * look exactly as expected.
+ */
+enum class CachedAttrType {
+  Placeholder   = 0,
+  FullAttrs     = 1,
+  String        = 2,
+  Missing       = 3,
+  Misc          = 4,
+  Failed        = 5,
+  Bool          = 6,
+  ListOfStrings = 7,
+  Int           = 8
+}; /* End enum `CachedAttrType' */
+
+
+/* -------------------------------------------------------------------------- */
+
+std::optional<std::filesystem::path>
+genEvalCachePath( const Fingerprint & fingerprint )
+{
+  std::string fpStr = fingerprint.to_string( nix::Base16, false );
+  /* Probe known eval-cache schema directories, newest first. */
+  for ( const auto * version : { "v5", "v4" } )
+    {
+      std::filesystem::path path = nix::getCacheDir();
+      path /= "nix";
+      path /= std::string( "eval-cache-" ) + version;
+      path /= fpStr + ".sqlite";
+      if ( std::filesystem::exists( path ) ) { return path; }
+    }
+  return std::nullopt;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+/** @brief A single row from the eval-cache `Attributes` table. */
+struct CachedAttr
+{
+  long long                  rowId;
+  CachedAttrType             type;
+  std::optional<std::string> value;
+}; /* End struct `CachedAttr' */
+
+
+/** @brief Lookup an attribute by parent _row id_ and name. */
+static std::optional<CachedAttr>
+lookupCachedAttr( sqlite3pp::database & cache,
+                  long long             parent,
+                  const std::string &   name )
+{
+  sqlite3pp::query qry( cache,
+                        "SELECT rowid, type, value FROM Attributes "
+                        "WHERE ( parent = ? ) AND ( name = ? )" );
+  qry.bind( 1, parent );
+  qry.bind( 2, name, sqlite3pp::nocopy );
+  auto itr = qry.begin();
+  if ( itr == qry.end() ) { return std::nullopt; }
+  auto row = *itr;
+  CachedAttr attr;
+  attr.rowId = row.get<long long>( 0 );
+  attr.type  = static_cast<CachedAttrType>( row.get<int>( 1 ) );
+  if ( row.column_type( 2 ) != SQLITE_NULL )
+    {
+      attr.value = row.get<std::string>( 2 );
+    }
+  return attr;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+bool
+PkgDb::importEvalCache( const std::filesystem::path & evalCachePath,
+                        const flox::AttrPath &        prefix )
+{
+  sqlite3pp::database cache( evalCachePath.c_str(), SQLITE_OPEN_READONLY );
+
+  /* Resolve the root then descend the prefix.
+   * Any miss means the cache never saw this subtree and we must fall back
+   * to cursor evaluation. */
+  auto root = lookupCachedAttr( cache, 0, "" );
+  if ( ! root.has_value() ) { return false; }
+  long long node = root->rowId;
+  for ( const auto & part : prefix )
+    {
+      auto child = lookupCachedAttr( cache, node, part );
+      if ( ( ! child.has_value() )
+           || ( child->type != CachedAttrType::FullAttrs ) )
+        {
+          return false;
+        }
+      node = child->rowId;
+    }
+
+  bool tryRecur = prefix.front() != "packages";
+
+  this->execute( "BEGIN TRANSACTION" );
+
+  /** Import one derivation node, or bail if required fields are missing. */
+  auto importPackage = [&]( long long           drvNode,
+                            row_id              parentId,
+                            const std::string & attrName ) -> bool
+  {
+    auto aname = lookupCachedAttr( cache, drvNode, "name" );
+    if ( ( ! aname.has_value() ) || ( aname->type != CachedAttrType::String )
+         || ( ! aname->value.has_value() ) )
+      {
+        return false;
+      }
+    const std::string & fullName = *aname->value;
+
+    nix::DrvName dname( fullName );
+
+    /* Cached lists are stored tab-separated. */
+    std::vector<std::string> outputs = { "out" };
+    if ( auto aouts = lookupCachedAttr( cache, drvNode, "outputs" );
+         aouts.has_value() && ( aouts->type == CachedAttrType::ListOfStrings )
+         && aouts->value.has_value() )
+      {
+        outputs = nix::tokenizeString<std::vector<std::string>>( *aouts->value,
+                                                                 "\t" );
+      }
+
+    std::optional<std::string> license;
+    std::optional<bool>        broken;
+    std::optional<bool>        unfree;
+    std::optional<std::string> description;
+    std::vector<std::string>   outputsToInstall = outputs;
+
+    if ( auto meta = lookupCachedAttr( cache, drvNode, "meta" );
+         meta.has_value() && ( meta->type == CachedAttrType::FullAttrs ) )
+      {
+        if ( auto attr = lookupCachedAttr( cache, meta->rowId, "description" );
+             attr.has_value() && ( attr->type == CachedAttrType::String ) )
+          {
+            description = attr->value;
+          }
+        if ( auto attr = lookupCachedAttr( cache, meta->rowId, "broken" );
+             attr.has_value() && ( attr->type == CachedAttrType::Bool )
+             && attr->value.has_value() )
+          {
+            broken = ( *attr->value == "1" );
+          }
+        if ( auto attr = lookupCachedAttr( cache, meta->rowId, "unfree" );
+             attr.has_value() && ( attr->type == CachedAttrType::Bool )
+             && attr->value.has_value() )
+          {
+            unfree = ( *attr->value == "1" );
+          }
+        if ( auto attr = lookupCachedAttr( cache, meta->rowId, "license" );
+             attr.has_value() && ( attr->type == CachedAttrType::FullAttrs ) )
+          {
+            if ( auto spdx
+                 = lookupCachedAttr( cache, attr->rowId, "spdxId" );
+                 spdx.has_value()
+                 && ( spdx->type == CachedAttrType::String ) )
+              {
+                license = spdx->value;
+              }
+          }
+        if ( auto attr
+             = lookupCachedAttr( cache, meta->rowId, "outputsToInstall" );
+             attr.has_value()
+             && ( attr->type == CachedAttrType::ListOfStrings )
+             && attr->value.has_value() )
+          {
+            outputsToInstall
+              = nix::tokenizeString<std::vector<std::string>>( *attr->value,
+                                                               "\t" );
+          }
+      }
+
+    sqlite3pp::command cmd( this->db, R"SQL(
+      INSERT OR REPLACE INTO Packages (
+        parentId, attrName, name, pname, version, semver
+      , major, minor, patch, preTag, license
+      , outputs, outputsToInstall, broken, unfree, descriptionId
+      ) VALUES ( ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ? )
+    )SQL" );
+    cmd.bind( 1, static_cast<long long>( parentId ) );
+    cmd.bind( 2, attrName, sqlite3pp::nocopy );
+    cmd.bind( 3, fullName, sqlite3pp::nocopy );
+    cmd.bind( 4, dname.name, sqlite3pp::nocopy );
+    if ( dname.version.empty() ) { cmd.bind( 5 ); }
+    else { cmd.bind( 5, dname.version, sqlite3pp::nocopy ); }
+    std::optional<std::string> semver
+      = dname.version.empty() ? std::nullopt
+                              : versions::coerceSemver( dname.version );
+    if ( semver.has_value() ) { cmd.bind( 6, *semver, sqlite3pp::copy ); }
+    else { cmd.bind( 6 ); }
+    std::optional<versions::SemverParts> semverParts
+      = semver.has_value() ? versions::parseSemverParts( *semver )
+                           : std::nullopt;
+    if ( semverParts.has_value() )
+      {
+        cmd.bind( 7, static_cast<long long>( semverParts->major ) );
+        cmd.bind( 8, static_cast<long long>( semverParts->minor ) );
+        cmd.bind( 9, static_cast<long long>( semverParts->patch ) );
+        if ( semverParts->preTag.has_value() )
+          {
+            cmd.bind( 10, *semverParts->preTag, sqlite3pp::copy );
+          }
+        else { cmd.bind( 10 ); }
+      }
+    else
+      {
+        /* binds NULL */
+        cmd.bind( 7 );
+        cmd.bind( 8 );
+        cmd.bind( 9 );
+        cmd.bind( 10 );
+      }
+    if ( license.has_value() ) { cmd.bind( 11, *license, sqlite3pp::copy ); }
+    else { cmd.bind( 11 ); }
+    {
+      nlohmann::json jOutputs = outputs;
+      cmd.bind( 12, jOutputs.dump(), sqlite3pp::copy );
+    }
+    {
+      nlohmann::json jOutsInstall = outputsToInstall;
+      cmd.bind( 13, jOutsInstall.dump(), sqlite3pp::copy );
+    }
+    if ( broken.has_value() ) { cmd.bind( 14, static_cast<int>( *broken ) ); }
+    else { cmd.bind( 14 ); }
+    if ( unfree.has_value() ) { cmd.bind( 15, static_cast<int>( *unfree ) ); }
+    else { cmd.bind( 15 ); }
+    if ( description.has_value() )
+      {
+        cmd.bind( 16,
+                  static_cast<long long>(
+                    this->addOrGetDescriptionId( *description ) ) );
+      }
+    else { cmd.bind( 16 ); }
+
+    if ( sql_rc rcode = cmd.execute(); isSQLError( rcode ) )
+      {
+        throw PkgDbException(
+          nix::fmt( "failed to import Package '%s'", fullName ),
+          this->db.error_msg() );
+      }
+    return true;
+  };
+
+  /* Walk the cached attribute tree breadth-first, mirroring the recursion
+   * rules of `PkgDb::scrape'. */
+  struct Node
+  {
+    long long      cacheId;
+    row_id         dbId;
+    flox::AttrPath path;
+  };
+  std::deque<Node> todo;
+  todo.push_back(
+    Node { node, this->addOrGetAttrSetId( prefix ), prefix } );
+
+  bool complete = true;
+  while ( complete && ( ! todo.empty() ) )
+    {
+      Node current = std::move( todo.front() );
+      todo.pop_front();
+
+      sqlite3pp::query children( cache,
+                                 "SELECT name, rowid, type, value "
+                                 "FROM Attributes WHERE ( parent = ? )" );
+      children.bind( 1, current.cacheId );
+      for ( auto row : children )
+        {
+          std::string aname = row.get<std::string>( 0 );
+          if ( aname == "recurseForDerivations" ) { continue; }
+          auto childId = row.get<long long>( 1 );
+          auto type    = static_cast<CachedAttrType>( row.get<int>( 2 ) );
+
+          if ( type == CachedAttrType::Failed )
+            {
+              /* Mirrors the scrape behavior of ignoring eval errors
+               * everywhere except `packages'. */
+              if ( ! tryRecur )
+                {
+                  complete = false;
+                  break;
+                }
+              continue;
+            }
+          if ( type == CachedAttrType::Placeholder )
+            {
+              /* Never evaluated; the cache cannot answer for
+               * this attribute. */
+              complete = false;
+              break;
+            }
+          if ( type != CachedAttrType::FullAttrs ) { continue; }
+
+          auto atype = lookupCachedAttr( cache, childId, "type" );
+          if ( atype.has_value() && ( atype->type == CachedAttrType::String )
+               && atype->value.has_value()
+               && ( *atype->value == "derivation" ) )
+            {
+              if ( ! importPackage( childId, current.dbId, aname ) )
+                {
+                  complete = false;
+                  break;
+                }
+              continue;
+            }
+          if ( ! tryRecur ) { continue; }
+
+          auto recurse
+            = lookupCachedAttr( cache, childId, "recurseForDerivations" );
+          bool darwinException = ( current.path.front() == "legacyPackages" )
+                                 && ( aname == "darwin" );
+          if ( ( recurse.has_value()
+                 && ( recurse->type == CachedAttrType::Bool )
+                 && recurse->value.has_value()
+                 && ( *recurse->value == "1" ) )
+               || darwinException )
+            {
+              flox::AttrPath path = current.path;
+              path.emplace_back( aname );
+              row_id childDbId
+                = this->addOrGetAttrSetId( aname, current.dbId );
+              todo.push_back(
+                Node { childId, childDbId, std::move( path ) } );
+            }
+          else if ( ( ! recurse.has_value() ) && ( ! atype.has_value() ) )
+            {
+              /* Neither `type' nor `recurseForDerivations' was ever asked
+               * for, so a previous scrape never touched this attribute. */
+              complete = false;
+              break;
+            }
+        }
+    }
+
+  if ( ! complete )
+    {
+      this->execute( "ROLLBACK TRANSACTION" );
+      return false;
+    }
+
+  this->setPrefixDone( prefix, true );
+  this->execute( "COMMIT TRANSACTION" );
+  return true;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+}  // namespace flox::pkgdb
+
+
+/* -------------------------------------------------------------------------- *
+ *
+ *
+ *
+ * ========================================================================== */
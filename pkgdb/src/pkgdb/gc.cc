@@ -27,6 +27,7 @@
 #include <nix/logging.hh>
 #include <nix/types.hh>
 #include <nix/util.hh>
+#include <sqlite3pp.hh>
 
 #include "flox/core/command.hh"
 #include "flox/core/exceptions.hh"
@@ -42,51 +43,172 @@ namespace flox::pkgdb {
 
 /* -------------------------------------------------------------------------- */
 
-std::vector<std::filesystem::path>
-findStaleDatabases( const std::filesystem::path & cacheDir, int minAgeDays )
+/** Filename of the access index kept alongside the databases. */
+static const char * accessDbName = "access.sqlite";
+
+/** SQL schema of the access index. */
+static const char * sql_dbAccess = R"SQL(
+CREATE TABLE IF NOT EXISTS DbAccess (
+  dbPath    TEXT PRIMARY KEY
+, lastUsed  INTEGER NOT NULL
+)
+)SQL";
+
+
+/* -------------------------------------------------------------------------- */
+
+/** @brief Open ( creating if necessary ) a cache directory's access index. */
+static sqlite3pp::database
+openDbAccess( const std::filesystem::path & cacheDir )
 {
+  sqlite3pp::database adb( ( cacheDir / accessDbName ).c_str() );
+  adb.set_busy_timeout( DB_BUSY_TIMEOUT );
+  adb.execute( sql_dbAccess );
+  return adb;
+}
 
-  nix::logger->log( nix::Verbosity::lvlDebug,
-                    nix::fmt( "cacheDir: %s\n", cacheDir.c_str() ) );
 
-  std::vector<std::filesystem::path> toDelete;
+/* -------------------------------------------------------------------------- */
+
+void
+touchDbAccess( const std::filesystem::path & cacheDir,
+               const std::filesystem::path & dbPath )
+{
+  try
+    {
+      sqlite3pp::database adb = openDbAccess( cacheDir );
+      sqlite3pp::command  cmd(
+        adb,
+        "INSERT INTO DbAccess ( dbPath, lastUsed ) VALUES ( ?, ? ) "
+         "ON CONFLICT ( dbPath ) DO UPDATE SET lastUsed = excluded.lastUsed" );
+      cmd.bind( 1, dbPath.string(), sqlite3pp::copy );
+      cmd.bind( 2,
+                static_cast<long long>( std::chrono::system_clock::to_time_t(
+                  std::chrono::system_clock::now() ) ) );
+      cmd.execute();
+    }
+  catch ( ... )
+    { /* Best effort; never block an open on the index. */
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void
+forgetDbAccess( const std::filesystem::path & cacheDir,
+                const std::filesystem::path & dbPath )
+{
+  try
+    {
+      sqlite3pp::database adb = openDbAccess( cacheDir );
+      sqlite3pp::command  cmd( adb,
+                               "DELETE FROM DbAccess WHERE dbPath = ?" );
+      cmd.bind( 1, dbPath.string(), sqlite3pp::copy );
+      cmd.execute();
+    }
+  catch ( ... )
+    { /* Best effort. */
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Seed the access index from filesystem access times.
+ *
+ * Only runs when the index is created for the first time so that databases
+ * written before the index existed remain collectable; every later run
+ * reads the one table instead of walking the cache directory.
+ */
+static void
+seedDbAccess( sqlite3pp::database &         adb,
+              const std::filesystem::path & cacheDir )
+{
+  sqlite3pp::command cmd(
+    adb,
+    "INSERT OR IGNORE INTO DbAccess ( dbPath, lastUsed ) VALUES ( ?, ? )" );
   for ( const auto & entry : std::filesystem::directory_iterator( cacheDir ) )
     {
+      /* Never index ( and so never collect ) the index itself. */
+      if ( entry.path().filename() == accessDbName ) { continue; }
 
       struct stat result
       {};
 
-      if ( stat( entry.path().c_str(), &result ) == 0 )
+      if ( ( stat( entry.path().c_str(), &result ) != 0 )
+           || ( ! isSQLiteDb( entry.path() ) ) )
         {
-          auto accessTime
-            = std::chrono::system_clock::from_time_t( result.st_atime );
+          continue;
+        }
+      cmd.bind( 1, entry.path().string(), sqlite3pp::copy );
+      cmd.bind( 2, static_cast<long long>( result.st_atime ) );
+      cmd.execute();
+      cmd.reset();
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+std::vector<std::filesystem::path>
+findStaleDatabases( const std::filesystem::path & cacheDir, int minAgeDays )
+{
 
-          auto now = std::chrono::system_clock::now();
+  nix::logger->log( nix::Verbosity::lvlDebug,
+                    nix::fmt( "cacheDir: %s\n", cacheDir.c_str() ) );
 
-          auto ageInDays
-            = std::chrono::duration_cast<std::chrono::days>( now - accessTime )
-                .count();
+  bool seed = ! std::filesystem::exists( cacheDir / accessDbName );
 
-          nix::logger->log(
-            nix::Verbosity::lvlDebug,
-            nix::fmt( "%s: atime: %ld, now: %ld, age: %d\n",
-                      entry.path().c_str(),
-                      result.st_atime,
-                      std::chrono::system_clock::to_time_t( now ),
-                      ageInDays ) );
+  sqlite3pp::database adb = openDbAccess( cacheDir );
+  if ( seed ) { seedDbAccess( adb, cacheDir ); }
 
+  auto now = std::chrono::system_clock::now();
 
-          if ( ( minAgeDays <= ageInDays ) && isSQLiteDb( entry.path() ) )
-            {
-              toDelete.push_back( entry.path() );
-            }
+  std::vector<std::filesystem::path> toDelete;
+  std::vector<std::string>           vanished;
+  sqlite3pp::query                   qry(
+    adb,
+    "SELECT dbPath, lastUsed FROM DbAccess ORDER BY lastUsed ASC" );
+  for ( const auto & row : qry )
+    {
+      std::filesystem::path dbPath   = row.get<std::string>( 0 );
+      auto                  lastUsed = std::chrono::system_clock::from_time_t(
+        static_cast<time_t>( row.get<long long>( 1 ) ) );
 
-          struct utimbuf newTimes
-          {};
-          newTimes.actime = std::chrono::system_clock::to_time_t( accessTime );
-          utime( entry.path().c_str(), &newTimes );
+      /* Forget databases removed behind our back. */
+      if ( ! std::filesystem::exists( dbPath ) )
+        {
+          vanished.push_back( dbPath.string() );
+          continue;
         }
+
+      auto ageInDays
+        = std::chrono::duration_cast<std::chrono::days>( now - lastUsed )
+            .count();
+
+      nix::logger->log(
+        nix::Verbosity::lvlDebug,
+        nix::fmt( "%s: lastUsed: %ld, now: %ld, age: %d\n",
+                  dbPath.c_str(),
+                  std::chrono::system_clock::to_time_t( lastUsed ),
+                  std::chrono::system_clock::to_time_t( now ),
+                  ageInDays ) );
+
+      if ( ( minAgeDays <= ageInDays ) && isSQLiteDb( dbPath ) )
+        {
+          toDelete.push_back( dbPath );
+        }
+    }
+
+  for ( const auto & path : vanished )
+    {
+      sqlite3pp::command cmd( adb, "DELETE FROM DbAccess WHERE dbPath = ?" );
+      cmd.bind( 1, path, sqlite3pp::copy );
+      cmd.execute();
     }
+
   return toDelete;
 }
 
@@ -112,6 +234,14 @@ GCCommand::GCCommand() : parser( "gc" )
     .action( [&]( const std::string & minAgeStr )
              { this->gcStaleAgeDays = stoi( minAgeStr ); } );
 
+  this->parser.add_argument( "-m", "--max-delete" )
+    .help( "delete at most a given number of databases per run" )
+    .metavar( "COUNT" )
+    .nargs( 1 )
+    .default_value( 0 )
+    .action( [&]( const std::string & maxDeleteStr )
+             { this->gcMaxDelete = stoi( maxDeleteStr ); } );
+
   this->parser.add_argument( "--dry-run" )
     .help( "list which databases are deleted, but don't actually delete them" )
     .default_value( false )
@@ -145,6 +275,17 @@ GCCommand::run()
   auto toDelete = findStaleDatabases( cacheDir, this->gcStaleAgeDays );
 
   std::cout << "Found " << toDelete.size() << " stale databases." << '\n';
+
+  /* Stale databases are returned least-recently-used first, so a bounded
+   * batch always removes the oldest ones and later runs finish the job. */
+  if ( ( 0 < this->gcMaxDelete )
+       && ( static_cast<size_t>( this->gcMaxDelete ) < toDelete.size() ) )
+    {
+      std::cout << "Deleting at most " << this->gcMaxDelete << " this run."
+                << '\n';
+      toDelete.resize( static_cast<size_t>( this->gcMaxDelete ) );
+    }
+
   for ( const auto & path : toDelete )
     {
       std::cout << "deleting " << path;
@@ -153,6 +294,7 @@ GCCommand::run()
         {
           std::cout << '\n';
           std::filesystem::remove( path );
+          forgetDbAccess( cacheDir, path );
         }
     }
 
@@ -7,10 +7,14 @@
  *
  * -------------------------------------------------------------------------- */
 
+#include <cctype>
 #include <iostream>
+#include <string>
+#include <string_view>
 
 #include <nlohmann/json.hpp>
 
+#include "flox/core/util.hh"
 #include "flox/pkgdb/command.hh"
 
 
@@ -28,6 +32,7 @@ GetCommand::GetCommand()
   , pFlake( "flake" )
   , pDb( "db" )
   , pPkg( "pkg" )
+  , pPkgs( "pkgs" )
 {
   this->parser.add_description( "Get metadata from Package DB" );
 
@@ -70,6 +75,11 @@ GetCommand::GetCommand()
 
   this->pPkg.add_description( "Get info about a single package" );
   this->addTargetArg( this->pPkg );
+  this->pPkg.add_argument( "--batch" )
+    .help( "read newline-delimited targets from STDIN and stream one JSON "
+           "result per line" )
+    .nargs( 0 )
+    .action( [&]( const auto & ) { this->batch = true; } );
   /* In `runPkg' we check for a singleton and if it's an integer it
    * is interpreted as a row id. */
   this->pPkg.add_argument( "id-or-path" )
@@ -79,6 +89,17 @@ GetCommand::GetCommand()
     .action( [&]( const std::string & idOrPath )
              { this->attrPath.emplace_back( idOrPath ); } );
   this->parser.add_subparser( this->pPkg );
+
+  this->pPkgs.add_description(
+    "Stream info about every package as JSON lines" );
+  this->addTargetArg( this->pPkgs );
+  this->pPkgs.add_argument( "attr-path" )
+    .help( "restrict output to packages under an attribute path" )
+    .metavar( "ATTRS..." )
+    .remaining()
+    .action( [&]( const std::string & path )
+             { this->attrPath.emplace_back( path ); } );
+  this->parser.add_subparser( this->pPkgs );
 }
 
 
@@ -139,10 +160,10 @@ int
 GetCommand::runFlake()
 {
   nlohmann::json flakeInfo
-    = { { "string", this->db->lockedRef.string },
-        { "attrs", this->db->lockedRef.attrs },
+    = { { "string", this->db->getLockedRef().string },
+        { "attrs", this->db->getLockedRef().attrs },
         { "fingerprint",
-          this->db->fingerprint.to_string( nix::Base16, false ) } };
+          this->db->getFingerprint().to_string( nix::Base16, false ) } };
   std::cout << flakeInfo.dump() << std::endl;
   return EXIT_SUCCESS;
 }
@@ -167,11 +188,71 @@ GetCommand::runDb()
 }
 
 
+/* -------------------------------------------------------------------------- */
+
+int
+GetCommand::runPkgBatch()
+{
+  /* One lookup per line over the already-open connection; prepared
+   * statements inside `getPackage' are cached by the handle, so the
+   * per-target cost is a bind/step rather than a process spawn. */
+  std::string line;
+  while ( std::getline( std::cin, line ) )
+    {
+      /* Trim surrounding whitespace and skip blank lines. */
+      std::string_view target( line );
+      while ( ( ! target.empty() )
+              && ( std::isspace(
+                     static_cast<unsigned char>( target.front() ) )
+                   != 0 ) )
+        {
+          target.remove_prefix( 1 );
+        }
+      while ( ( ! target.empty() )
+              && ( std::isspace( static_cast<unsigned char>( target.back() ) )
+                   != 0 ) )
+        {
+          target.remove_suffix( 1 );
+        }
+      if ( target.empty() ) { continue; }
+
+      try
+        {
+          if ( isUInt( target ) )
+            {
+              row_id row = stoull( std::string( target ) );
+              std::cout << this->db->getPackage( row ) << "\n";
+            }
+          else if ( target.front() == '[' )
+            {
+              AttrPath path = nlohmann::json::parse( target );
+              std::cout << this->db->getPackage( path ) << "\n";
+            }
+          else
+            {
+              std::cout << this->db->getPackage( splitAttrPath( target ) )
+                        << "\n";
+            }
+        }
+      catch ( const std::exception & err )
+        {
+          /* Keep streaming; a bad target shouldn't kill the batch. */
+          std::cout << nlohmann::json( { { "error", err.what() } } ).dump()
+                    << "\n";
+        }
+    }
+  std::cout << std::flush;
+  return EXIT_SUCCESS;
+}
+
+
 /* -------------------------------------------------------------------------- */
 
 int
 GetCommand::runPkg()
 {
+  if ( this->batch ) { return this->runPkgBatch(); }
+
   if ( ( this->attrPath.size() == 1 ) && ( isUInt( this->attrPath.front() ) ) )
     {
       this->id = stoull( this->attrPath.front() );
@@ -183,6 +264,19 @@ GetCommand::runPkg()
 }
 
 
+/* -------------------------------------------------------------------------- */
+
+int
+GetCommand::runPkgs()
+{
+  /* Rows are written to stdout as they stream off the cursor; no
+   * intermediate document is built. */
+  if ( this->attrPath.empty() ) { this->db->streamPackages( std::cout ); }
+  else { this->db->streamPackages( std::cout, this->attrPath ); }
+  return EXIT_SUCCESS;
+}
+
+
 /* -------------------------------------------------------------------------- */
 
 int
@@ -197,6 +291,7 @@ GetCommand::run()
   if ( this->parser.is_subcommand_used( "flake" ) ) { return this->runFlake(); }
   if ( this->parser.is_subcommand_used( "done" ) ) { return this->runDone(); }
   if ( this->parser.is_subcommand_used( "pkg" ) ) { return this->runPkg(); }
+  if ( this->parser.is_subcommand_used( "pkgs" ) ) { return this->runPkgs(); }
   std::cerr << this->parser << std::endl;
   throw flox::FloxException( "You must provide a valid 'get' subcommand" );
   return EXIT_FAILURE;
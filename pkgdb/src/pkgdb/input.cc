@@ -8,22 +8,34 @@
  * -------------------------------------------------------------------------- */
 
 #include <assert.h>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
 #include <list>
 #include <map>
 #include <optional>
 #include <ostream>
+#include <sys/mman.h>
+#ifdef __linux__
+#  include <sys/vfs.h>
+#endif
 #include <sys/wait.h>
+#include <thread>
 #include <tuple>
+#include <unistd.h>
 
 #include <nix/error.hh>
 #include <nix/eval.hh>
 #include <nix/fmt.hh>
+#include <nix/hash.hh>
 #include <nix/logging.hh>
 #include <nix/nixexpr.hh>
+#include <nix/util.hh>
 #include <nlohmann/json.hpp>
 #include <sqlite3pp.hh>
 
 #include "flox/core/exceptions.hh"
+#include "flox/pkgdb/gc.hh"
 #include "flox/pkgdb/input.hh"
 #include "flox/pkgdb/write.hh"
 
@@ -40,19 +52,446 @@ class Store;
 
 namespace flox::pkgdb {
 
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Whether fresh databases should be seeded from a previous generation.
+ *
+ * Controlled by the environment variable `PKGDB_INCREMENTAL`.
+ */
+static bool
+isIncrementalScrape()
+{
+  const char * maybeIncremental = std::getenv( "PKGDB_INCREMENTAL" );
+  return ( maybeIncremental != nullptr )
+         && ( std::string_view( maybeIncremental ) != "0" );
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+/** @brief `PKGDB_LOCAL_SNAPSHOT` policy ( see @a maybeSnapshotDb ). */
+enum class SnapshotMode { DISABLED, AUTO, FORCED };
+
+static SnapshotMode
+localSnapshotMode()
+{
+  const char * maybeMode = std::getenv( "PKGDB_LOCAL_SNAPSHOT" );
+  if ( maybeMode == nullptr ) { return SnapshotMode::AUTO; }
+  std::string_view mode( maybeMode );
+  if ( mode == "0" ) { return SnapshotMode::DISABLED; }
+  if ( mode == "1" ) { return SnapshotMode::FORCED; }
+  return SnapshotMode::AUTO;
+}
+
+
+/** @brief Whether @a path sits on a network filesystem. */
+static bool
+isNetworkFilesystem( const std::filesystem::path & path )
+{
+#ifdef __linux__
+  struct statfs buf;
+  if ( statfs( path.c_str(), &buf ) != 0 ) { return false; }
+  /* NFS, CIFS, and SMB2 magic numbers ( see `statfs(2)' ). */
+  switch ( static_cast<unsigned>( buf.f_type ) )
+    {
+      case 0x6969U:      /* NFS_SUPER_MAGIC */
+      case 0xFF534D42U:  /* CIFS_MAGIC_NUMBER */
+      case 0xFE534D42U:  /* SMB2_MAGIC_NUMBER */
+        return true;
+      default: return false;
+    }
+#else
+  (void) path;
+  return false;
+#endif
+}
+
+
+/**
+ * @brief Optional host-wide database cache directory.
+ *
+ * Named by `PKGDB_SHARED_CACHEDIR`; fingerprint-keyed files there are
+ * preferred over per-user databases so one scrape serves every user on
+ * the host.
+ */
+static std::optional<std::filesystem::path>
+getSharedCacheDir()
+{
+  const char * maybeDir = std::getenv( "PKGDB_SHARED_CACHEDIR" );
+  if ( ( maybeDir == nullptr ) || ( *maybeDir == '\0' ) )
+    {
+      return std::nullopt;
+    }
+  return std::filesystem::path( maybeDir );
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+/** @brief Directory holding local database snapshots. */
+static std::filesystem::path
+getLocalSnapshotDir()
+{
+  if ( const char * runtimeDir = std::getenv( "XDG_RUNTIME_DIR" );
+       ( runtimeDir != nullptr ) && ( *runtimeDir != '\0' ) )
+    {
+      return std::filesystem::path( runtimeDir ) / "flox"
+             / "pkgdb-snapshots";
+    }
+  return std::filesystem::temp_directory_path()
+         / ( "flox-pkgdb-snapshots-" + std::to_string( getuid() ) );
+}
+
+
+/**
+ * @brief Mirror @a source into @a local with the SQLite backup API.
+ *
+ * A plain file copy of a live SQLite database is not crash consistent;
+ * the backup API produces a coherent page-level copy even while writers
+ * hold the source.  The snapshot lands under a temporary name and is
+ * renamed into place so concurrent readers only ever see complete copies,
+ * and carries the source's mtime so freshness is a single `stat`.
+ * @return Whether @a local is a current copy of @a source afterwards.
+ */
+static bool
+refreshLocalSnapshot( const std::filesystem::path & source,
+                      const std::filesystem::path & local,
+                      bool                          force )
+{
+  try
+    {
+      auto sourceMtime = std::filesystem::last_write_time( source );
+      if ( ( ! force ) && std::filesystem::exists( local )
+           && ( std::filesystem::last_write_time( local ) == sourceMtime ) )
+        {
+          return true;
+        }
+
+      std::filesystem::create_directories( local.parent_path() );
+      std::filesystem::path tmpPath
+        = local.string() + nix::fmt( ".%d", getpid() );
+
+      sqlite3pp::database srcDb;
+      srcDb.connect( source.c_str(), SQLITE_OPEN_READONLY );
+      sqlite3pp::database dstDb;
+      dstDb.connect( tmpPath.c_str(),
+                     SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE );
+      if ( srcDb.backup( dstDb ) != SQLITE_OK )
+        {
+          std::filesystem::remove( tmpPath );
+          return false;
+        }
+      dstDb.disconnect();
+      srcDb.disconnect();
+
+      std::filesystem::last_write_time( tmpPath, sourceMtime );
+      std::filesystem::rename( tmpPath, local );
+      return true;
+    }
+  catch ( const std::exception & )
+    { /* Reads fall back to the source on any failure. */
+      return false;
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Whether the fingerprint memo may stand in for locking @a ref.
+ *
+ * A fully locked ref pins its lock file and therefore its fingerprint, so
+ * the memo cannot go stale.  Mutable refs may point at new revisions and
+ * only use the memo when `PKGDB_OFFLINE` is set.
+ */
+static bool
+offlineFastPathAllowed( const nix::FlakeRef & ref )
+{
+  if ( const char * maybeOffline = std::getenv( "PKGDB_OFFLINE" );
+       ( maybeOffline != nullptr )
+       && ( std::string_view( maybeOffline ) != "0" ) )
+    {
+      return true;
+    }
+  return ref.input.isLocked();
+}
+
+
+/** @brief Path of the memo mapping @a url to its locked fingerprint. */
+static std::filesystem::path
+getFingerprintMemoPath( const std::filesystem::path & cacheDir,
+                        const std::string &           url )
+{
+  nix::Hash urlHash = nix::hashString( nix::htSHA256, url );
+  return cacheDir / "fingerprints-v0"
+         / urlHash.to_string( nix::Base32, false );
+}
+
+
+static std::optional<Fingerprint>
+lookupFingerprintMemo( const std::filesystem::path & cacheDir,
+                       const std::string &           url )
+{
+  try
+    {
+      std::filesystem::path memoPath = getFingerprintMemoPath( cacheDir, url );
+      if ( ! std::filesystem::exists( memoPath ) ) { return std::nullopt; }
+      nlohmann::json memo
+        = nlohmann::json::parse( nix::readFile( memoPath.string() ) );
+      /* Guard against a ( truncated ) hash collision in the file name. */
+      if ( memo.at( "url" ).get<std::string>() != url )
+        {
+          return std::nullopt;
+        }
+      return nix::Hash::parseNonSRIUnprefixed(
+        memo.at( "fingerprint" ).get<std::string>(),
+        nix::htSHA256 );
+    }
+  catch ( ... )
+    { /* An unreadable memo only costs the fast path. */
+      return std::nullopt;
+    }
+}
+
+
+static void
+recordFingerprintMemo( const std::filesystem::path & cacheDir,
+                       const std::string &           url,
+                       const Fingerprint &           fingerprint )
+{
+  try
+    {
+      std::filesystem::path memoPath = getFingerprintMemoPath( cacheDir, url );
+      std::filesystem::create_directories( memoPath.parent_path() );
+      /* Write-then-rename so concurrent readers never see partial memos. */
+      std::filesystem::path tmpPath
+        = memoPath.string() + nix::fmt( ".%d", getpid() );
+      nlohmann::json memo
+        = { { "url", url },
+            { "fingerprint", fingerprint.to_string( nix::Base16, false ) } };
+      nix::writeFile( tmpPath.string(), memo.dump() );
+      std::filesystem::rename( tmpPath, memoPath );
+    }
+  catch ( ... )
+    { /* Best effort; the memo is an optimization only. */
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+std::filesystem::path
+PkgDbInput::resolveDbPath( const std::filesystem::path & cacheDir )
+{
+  const std::string url = this->getFlakeRef()->to_string();
+  if ( offlineFastPathAllowed( *this->getFlakeRef() ) )
+    {
+      if ( auto fingerprint = lookupFingerprintMemo( cacheDir, url );
+           fingerprint.has_value() )
+        {
+          std::filesystem::path path = genPkgDbName( *fingerprint, cacheDir );
+          if ( std::filesystem::exists( path ) )
+            {
+              this->offlineDb = true;
+              return path;
+            }
+        }
+    }
+  Fingerprint fingerprint = this->getFlake()->lockedFlake.getFingerprint();
+  recordFingerprintMemo( cacheDir, url, fingerprint );
+  return genPkgDbName( fingerprint, cacheDir );
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+std::shared_ptr<PkgDbReadOnly>
+PkgDbInput::openDbReadOnly( const std::string & dbPath )
+{
+  /* On the offline fast path the flake was never locked; the fingerprint
+   * is loaded lazily from the database's own `LockedFlake' row instead of
+   * being asserted against a freshly locked flake. */
+  if ( this->offlineDb ) { return openPkgDbReadOnly( dbPath ); }
+  return openPkgDbReadOnly( this->getFlake()->lockedFlake.getFingerprint(),
+                            dbPath );
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Strip volatile locked fields from a flake-ref attr-set so that two
+ *        revisions of the same flake compare equal.
+ */
+static nlohmann::json
+stripVolatileAttrs( nlohmann::json attrs )
+{
+  for ( const auto * key : { "rev", "narHash", "lastModified", "revCount" } )
+    {
+      attrs.erase( key );
+    }
+  return attrs;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+std::optional<std::filesystem::path>
+PkgDbInput::findPreviousDb()
+{
+  nlohmann::json origin = stripVolatileAttrs( nix::fetchers::attrsToJSON(
+    this->getFlake()->lockedFlake.flake.lockedRef.toAttrs() ) );
+
+  const std::filesystem::path cacheDir = this->dbPath.parent_path();
+  if ( ! std::filesystem::exists( cacheDir ) ) { return std::nullopt; }
+
+  std::optional<std::filesystem::path> best;
+  std::filesystem::file_time_type      bestTime;
+  for ( const auto & entry : std::filesystem::directory_iterator( cacheDir ) )
+    {
+      if ( ( ! entry.is_regular_file() ) || ( entry.path() == this->dbPath ) )
+        {
+          continue;
+        }
+      try
+        {
+          PkgDbReadOnly candidate( entry.path().string() );
+          if ( stripVolatileAttrs( candidate.getLockedRef().attrs ) != origin )
+            {
+              continue;
+            }
+        }
+      catch ( ... )
+        { /* Not a compatible database. */
+          continue;
+        }
+      if ( ( ! best.has_value() )
+           || ( bestTime < entry.last_write_time() ) )
+        {
+          best     = entry.path();
+          bestTime = entry.last_write_time();
+        }
+    }
+  return best;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Find this fingerprint's database under an older schema generation's
+ *        cache directory, if one exists which can be migrated in place.
+ */
+static std::optional<std::filesystem::path>
+findPreviousSchemaDb( const Fingerprint &           fingerprint,
+                      const std::filesystem::path & dbPath )
+{
+  const std::filesystem::path cacheDir = dbPath.parent_path();
+  /* Only the default versioned cache layout has older siblings. */
+  if ( cacheDir.filename().string()
+       != ( "pkgdb-v" + std::to_string( sqlVersions.tables ) ) )
+    {
+      return std::nullopt;
+    }
+  for ( unsigned version = sqlVersions.tables - 1; 0 < version; --version )
+    {
+      std::filesystem::path dir
+        = cacheDir.parent_path() / ( "pkgdb-v" + std::to_string( version ) );
+      std::filesystem::path candidate = genPkgDbName( fingerprint, dir );
+      if ( ! std::filesystem::exists( candidate ) ) { continue; }
+      try
+        {
+          PkgDbReadOnly cand( candidate.string() );
+          if ( PkgDb::canMigrateFrom( cand.getDbVersion().tables ) )
+            {
+              return candidate;
+            }
+        }
+      catch ( ... )
+        { /* Not a usable database. */
+        }
+    }
+  return std::nullopt;
+}
+
+
 /* -------------------------------------------------------------------------- */
 
 void
 PkgDbInput::init()
 {
+  /* Prefer a host-wide copy over creating a per-user database; one scrape
+   * then serves every user on the host.  The shared file is root-owned
+   * and read-only, so writes copy it to the per-user path first
+   * ( see @a getDbReadWrite ). */
+  if ( ! std::filesystem::exists( this->dbPath ) )
+    {
+      if ( auto sharedDir = getSharedCacheDir(); sharedDir.has_value() )
+        {
+          std::filesystem::path shared
+            = ( *sharedDir ) / this->dbPath.filename();
+          if ( std::filesystem::exists( shared ) )
+            {
+              try
+                {
+                  auto pdb = this->openDbReadOnly( shared.string() );
+                  if ( pdb->getDbVersion() == sqlVersions )
+                    {
+                      nix::logger->log(
+                        nix::lvlTalkative,
+                        nix::fmt( "Using host-wide database '%s'",
+                                  shared.string() ) );
+                      this->dbRO         = pdb;
+                      this->sharedDbPath = shared;
+                      return;
+                    }
+                }
+              catch ( ... )
+                { /* An unreadable or stale shared copy is skipped. */
+                }
+            }
+        }
+    }
+
   /* Initialize DB if missing. */
   if ( ! std::filesystem::exists( this->dbPath ) )
     {
-      std::filesystem::create_directories( this->dbPath.parent_path() );
-      nix::logger->log(
-        nix::lvlTalkative,
-        nix::fmt( "Creating database '%s'", this->dbPath.string() ) );
-      PkgDb( this->getFlake()->lockedFlake, this->dbPath.string() );
+      /* A database from a previous schema generation can be migrated in
+       * place, which is far cheaper than re-scraping. */
+      if ( auto prev = findPreviousSchemaDb(
+             this->getFlake()->lockedFlake.getFingerprint(),
+             this->dbPath );
+           prev.has_value() )
+        {
+          std::filesystem::create_directories( this->dbPath.parent_path() );
+          nix::logger->log(
+            nix::lvlTalkative,
+            nix::fmt( "Adopting previous-generation database '%s'",
+                      prev->string() ) );
+          std::filesystem::copy_file( *prev, this->dbPath );
+        }
+      else
+        {
+          /* A fresh database may be seeded from a previous generation so
+           * that unchanged attributes are copied instead of re-evaluated. */
+          if ( isIncrementalScrape() )
+            {
+              this->seedDbPath = this->findPreviousDb();
+              if ( this->seedDbPath.has_value() )
+                {
+                  nix::logger->log(
+                    nix::lvlTalkative,
+                    nix::fmt( "Seeding incremental scrape from '%s'",
+                              this->seedDbPath->string() ) );
+                }
+            }
+          std::filesystem::create_directories( this->dbPath.parent_path() );
+          nix::logger->log(
+            nix::lvlTalkative,
+            nix::fmt( "Creating database '%s'", this->dbPath.string() ) );
+          PkgDb( this->getFlake()->lockedFlake, this->dbPath.string() );
+        }
     }
 
   /* If the database exists we don't want to needlessly try to initialize it, so
@@ -62,24 +501,38 @@ PkgDbInput::init()
    * initialized, so creating the read-only connection can fail. */
   try
     {
-      this->dbRO = std::make_shared<PkgDbReadOnly>(
-        this->getFlake()->lockedFlake.getFingerprint(),
-        this->dbPath.string() );
+      this->dbRO = this->openDbReadOnly( this->dbPath.string() );
     }
   catch ( ... )
     {
       throw PkgDbException( "couldn't initialize read-only package database" );
     }
 
-  /* If the schema version is bad, delete the DB so it will be recreated. */
+  /* If the schema version is outdated, first try migrating in place;
+   * opening a read/write connection applies any pending migrations. */
   SqlVersions dbVersions = this->dbRO->getDbVersion();
+  if ( dbVersions.tables != sqlVersions.tables )
+    {
+      nix::logger->log(
+        nix::lvlTalkative,
+        nix::fmt( "Migrating outdated database '%s'",
+                  this->dbPath.string() ) );
+      PkgDb( this->getFlake()->lockedFlake, this->dbPath.string() );
+      dbVersions = this->dbRO->getDbVersion();
+    }
+
+  /* Re-scrape only when no migration path exists. */
   if ( dbVersions.tables != sqlVersions.tables )
     {
       nix::logger->log(
         nix::lvlTalkative,
         nix::fmt( "Clearing outdated database '%s'", this->dbPath.string() ) );
+      /* Drop the pooled read connection first so it doesn't keep reading
+       * the deleted inode. */
+      this->dbRO.reset();
       std::filesystem::remove( this->dbPath );
       PkgDb( this->getFlake()->lockedFlake, this->dbPath.string() );
+      this->dbRO = this->openDbReadOnly( this->dbPath.string() );
     }
   else if ( dbVersions.views != sqlVersions.views )
     {
@@ -99,6 +552,43 @@ PkgDbInput::init()
                   dbVersions.tables,
                   dbVersions.views ) );
     }
+
+  /* Record the access so `pkgdb gc` can find stale databases without
+   * walking the filesystem. */
+  touchDbAccess( this->dbPath.parent_path(), this->dbPath );
+
+  /* On network-filesystem homes point reads at a local snapshot. */
+  this->maybeSnapshotDb();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void
+PkgDbInput::maybeSnapshotDb( bool force )
+{
+  SnapshotMode mode = localSnapshotMode();
+  if ( mode == SnapshotMode::DISABLED ) { return; }
+  if ( ( mode == SnapshotMode::AUTO )
+       && ( ! isNetworkFilesystem( this->dbPath.parent_path() ) ) )
+    {
+      return;
+    }
+
+  std::filesystem::path local
+    = getLocalSnapshotDir() / this->dbPath.filename();
+  if ( ! refreshLocalSnapshot( this->dbPath, local, force ) ) { return; }
+
+  try
+    {
+      this->dbRO        = this->openDbReadOnly( local.string() );
+      this->localDbPath = local;
+    }
+  catch ( ... )
+    { /* Keep reading the source; the snapshot is an optimization only. */
+      this->dbRO        = this->openDbReadOnly( this->dbPath.string() );
+      this->localDbPath = std::nullopt;
+    }
 }
 
 
@@ -109,6 +599,23 @@ PkgDbInput::getDbReadWrite()
 {
   if ( this->dbRW == nullptr )
     {
+      /* A host-wide database is read-only; copy it to the per-user path
+       * before taking writes, and move the read connection with it. */
+      if ( this->sharedDbPath.has_value() )
+        {
+          std::filesystem::create_directories( this->dbPath.parent_path() );
+          if ( ! std::filesystem::exists( this->dbPath ) )
+            {
+              std::filesystem::copy_file( *this->sharedDbPath,
+                                          this->dbPath );
+              std::filesystem::permissions(
+                this->dbPath,
+                std::filesystem::perms::owner_write,
+                std::filesystem::perm_options::add );
+            }
+          this->sharedDbPath = std::nullopt;
+          this->dbRO = this->openDbReadOnly( this->dbPath.string() );
+        }
       this->dbRW = std::make_shared<PkgDb>( this->getFlake()->lockedFlake,
                                             this->dbPath.string() );
     }
@@ -121,7 +628,278 @@ PkgDbInput::getDbReadWrite()
 void
 PkgDbInput::closeDbReadWrite()
 {
-  if ( this->dbRW != nullptr ) { this->dbRW = nullptr; }
+  if ( this->dbRW != nullptr )
+    {
+      this->dbRW = nullptr;
+      /* Writes went to the source database; re-sync the local snapshot so
+       * the read connection sees them.  Changes may live entirely in the
+       * WAL without touching the main file's mtime, so the copy is
+       * unconditional. */
+      if ( this->localDbPath.has_value() )
+        {
+          this->maybeSnapshotDb( /* force = */ true );
+        }
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Get the number of scrape worker processes to spawn.
+ *
+ * The environment variable `PKGDB_SCRAPE_JOBS` is respected if it is set,
+ * otherwise we use the number of available hardware threads.
+ */
+static unsigned
+getScrapeJobs()
+{
+  if ( const char * maybeJobs = std::getenv( "PKGDB_SCRAPE_JOBS" ) )
+    {
+      try
+        {
+          unsigned long jobs = std::stoul( maybeJobs );
+          if ( 0 < jobs ) { return static_cast<unsigned>( jobs ); }
+        }
+      catch ( const std::exception & )
+        { /* Fallthrough to the default below. */
+        }
+      nix::logger->log(
+        nix::lvlWarn,
+        nix::fmt( "ignoring invalid PKGDB_SCRAPE_JOBS value '%s'",
+                  maybeJobs ) );
+    }
+  unsigned jobs = std::thread::hardware_concurrency();
+  return ( jobs == 0 ) ? 1 : jobs;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Whether scrape workers should write to per-worker shard databases.
+ *
+ * Controlled by the environment variable `PKGDB_SCRAPE_SHARDED`.
+ * Sharding removes contention on the central database lock at the cost of a
+ * merge phase once all workers have finished.
+ */
+static bool
+isShardedScrape()
+{
+  const char * maybeSharded = std::getenv( "PKGDB_SCRAPE_SHARDED" );
+  return ( maybeSharded != nullptr )
+         && ( std::string_view( maybeSharded ) != "0" );
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+/* Deterministic cross-machine shard of the page space, set by
+ * `pkgdb scrape --shard K/N'.
+ * A count below `2' means sharding is disabled. */
+static unsigned scrapeShardIndex = 0;
+static unsigned scrapeShardCount = 0;
+
+
+void
+setScrapeShard( unsigned index, unsigned count )
+{
+  scrapeShardIndex = index;
+  scrapeShardCount = count;
+}
+
+
+/** @brief Whether @a pageIdx belongs to this machine's scrape shard. */
+static bool
+pageInScrapeShard( std::size_t pageIdx )
+{
+  return ( scrapeShardCount < 2 )
+         || ( ( pageIdx % scrapeShardCount ) == scrapeShardIndex );
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void
+PkgDbInput::scrapePrefixPool( const flox::AttrPath & prefix, unsigned jobs )
+{
+  /* Exit code indicating the worker failed inside of `nix` evaluation. */
+  const int EXIT_FAILURE_NIX_EVAL = 150;
+
+  /* Page claim counter shared between all workers.
+   * Placed in an anonymous shared mapping so `fetch_add' across processes
+   * hands each page to exactly one worker. */
+  auto * nextPage = static_cast<std::atomic<std::size_t> *>(
+    mmap( nullptr,
+          sizeof( std::atomic<std::size_t> ),
+          PROT_READ | PROT_WRITE,
+          MAP_SHARED | MAP_ANONYMOUS,
+          -1,
+          0 ) );
+  if ( nextPage == MAP_FAILED )
+    {
+      throw PkgDbException( "failed to map shared page counter" );
+    }
+  new ( nextPage ) std::atomic<std::size_t>( 0 );
+
+  /* Close handles so that each worker creates its own. */
+  this->closeDbReadWrite();
+  this->freeFlake();
+
+  std::vector<pid_t> workers;
+  for ( unsigned widx = 0; widx < jobs; ++widx )
+    {
+      pid_t pid = fork();
+      if ( pid == -1 )
+        {
+          /* Let any previously forked workers drain the queue. */
+          if ( ! workers.empty() ) { break; }
+          munmap( nextPage, sizeof( std::atomic<std::size_t> ) );
+          throw PkgDbException( "fork to scrape attributes failed" );
+        }
+      if ( pid == 0 )
+        {
+          /* Workers are long-lived: the eval state and read/write connection
+           * created on the first page are reused for every later page, so
+           * the per-page re-initialization cost is paid exactly once
+           * per worker. */
+          int ecode = EXIT_SUCCESS;
+          try
+            {
+              /* In sharded mode each worker writes to its own shard database
+               * so writers never contend on the central database lock.
+               * Shards are merged by the parent once every worker exits. */
+              nix::ref<PkgDb> chunkDbRW
+                = isShardedScrape()
+                    ? static_cast<nix::ref<PkgDb>>( std::make_shared<PkgDb>(
+                      this->getFlake()->lockedFlake,
+                      nix::fmt( "%s.shard-%d",
+                                this->dbPath.string(),
+                                widx ) ) )
+                    : this->getDbReadWrite();
+              if ( this->seedDbPath.has_value() )
+                {
+                  chunkDbRW->attachSeed( *this->seedDbPath );
+                }
+              MaybeCursor root = this->getFlake()->maybeOpenCursor( prefix );
+              if ( root == nullptr ) { exit( EXIT_SUCCESS ); }
+
+              row_id chunkRow = chunkDbRW->addOrGetAttrSetId( prefix );
+              Target rootTarget
+                = std::make_tuple( prefix,
+                                   static_cast<flox::Cursor>( root ),
+                                   chunkRow );
+
+              const std::size_t pageSize = 5000;
+              std::size_t       numAttrs
+                = std::get<1>( rootTarget )->getAttrs().size();
+              std::size_t numPages
+                = ( numAttrs + pageSize - 1 ) / pageSize;
+
+              std::size_t pageIdx = 0;
+              while ( ( pageIdx = nextPage->fetch_add( 1 ) ) < numPages )
+                {
+                  /* Pages outside of this machine's shard are handled by a
+                   * sibling machine running with a different `--shard'. */
+                  if ( ! pageInScrapeShard( pageIdx ) ) { continue; }
+                  debugLog( nix::fmt(
+                    "scrapePrefixPool(worker): scraping page %d of %d",
+                    pageIdx,
+                    numPages ) );
+                  chunkDbRW->execute( "BEGIN TRANSACTION" );
+                  chunkDbRW->scrape( this->getFlake()->state->symbols,
+                                     rootTarget,
+                                     pageSize,
+                                     pageIdx,
+                                     /* markPrefixDone */ false );
+                  chunkDbRW->execute( "COMMIT TRANSACTION" );
+                }
+            }
+          catch ( const nix::EvalError & err )
+            {
+              debugLog(
+                nix::fmt( "scrapePrefixPool(worker): caught nix::EvalError: %s",
+                          err.msg().c_str() ) );
+              ecode = EXIT_FAILURE_NIX_EVAL;
+            }
+          catch ( const std::exception & err )
+            {
+              debugLog(
+                nix::fmt( "scrapePrefixPool(worker): caught exception: %s",
+                          err.what() ) );
+              ecode = EXIT_FAILURE;
+            }
+          try
+            {
+              this->closeDbReadWrite();
+              this->freeFlake();
+            }
+          catch ( const std::exception & )
+            { /* Ignore teardown failures on exit. */
+            }
+          exit( ecode );
+        }
+      workers.emplace_back( pid );
+    }
+
+  /* Collect workers, preserving the first failure. */
+  std::optional<PkgDbException> failure;
+  for ( pid_t pid : workers )
+    {
+      int status = 0;
+      waitpid( pid, &status, 0 );
+      if ( failure.has_value() ) { continue; }
+      if ( ! WIFEXITED( status ) )
+        {
+          failure = PkgDbException(
+            nix::fmt( "scraping failed: abnormal worker exit, signal: %d",
+                      WTERMSIG( status ) ) );
+        }
+      else if ( WEXITSTATUS( status ) == EXIT_FAILURE_NIX_EVAL )
+        {
+          failure = PkgDbException( "scraping failed: NixEvalException "
+                                    "reported. See worker log for details." );
+        }
+      else if ( WEXITSTATUS( status ) != EXIT_SUCCESS )
+        {
+          failure = PkgDbException( nix::fmt( "scraping failed: exit code %d",
+                                              WEXITSTATUS( status ) ) );
+        }
+    }
+
+  munmap( nextPage, sizeof( std::atomic<std::size_t> ) );
+
+  if ( isShardedScrape() )
+    {
+      /* Merge worker shards into the central database, or discard them if
+       * any worker failed. */
+      for ( unsigned widx = 0; widx < jobs; ++widx )
+        {
+          std::filesystem::path shardPath
+            = nix::fmt( "%s.shard-%d", this->dbPath.string(), widx );
+          if ( ! std::filesystem::exists( shardPath ) ) { continue; }
+          if ( ! failure.has_value() )
+            {
+              debugLog( nix::fmt( "scrapePrefixPool: merging shard '%s'",
+                                  shardPath.string() ) );
+              this->getDbReadWrite()->absorbShard( shardPath );
+            }
+          std::filesystem::remove( shardPath );
+        }
+    }
+
+  if ( failure.has_value() ) { throw *failure; }
+
+  /* Every page has been committed, so the prefix can be marked done.
+   * Workers never set the flag themselves since pages complete out
+   * of order.
+   * A cross-machine shard only holds its slice of the pages, so completion
+   * is recorded by `pkgdb merge-shards' once every shard is combined. */
+  if ( scrapeShardCount < 2 )
+    {
+      this->getDbReadWrite()->setPrefixDone( prefix, true );
+    }
+  this->closeDbReadWrite();
 }
 
 
@@ -132,6 +910,67 @@ PkgDbInput::scrapePrefix( const flox::AttrPath & prefix )
 {
   if ( this->getDbReadOnly()->completedAttrSet( prefix ) ) { return; }
 
+  emitProgressEvent( "prefix-begin",
+                     { { "prefix", concatStringsSep( ".", prefix ) },
+                       { "input", this->getNameOrURL() } } );
+
+  /* Stamp the wall-clock duration into `Stats' once the prefix completes;
+   * the remaining statistics columns are refreshed by `setPrefixDone'. */
+  const auto scrapeStart    = std::chrono::steady_clock::now();
+  auto       recordDuration = [&]()
+  {
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                     std::chrono::steady_clock::now() - scrapeStart )
+                     .count();
+    this->getDbReadWrite()->recordScrapeDuration( prefix, elapsed );
+    this->closeDbReadWrite();
+  };
+
+  /* Fast path: when the flake was evaluated before, import straight from
+   * `nix`'s eval-cache database without instantiating any eval values.
+   * Any cache miss falls through to a normal scrape. */
+  if ( auto cachePath = genEvalCachePath(
+         this->getFlake()->lockedFlake.getFingerprint() );
+       cachePath.has_value() )
+    {
+      try
+        {
+          bool imported
+            = this->getDbReadWrite()->importEvalCache( *cachePath, prefix );
+          this->closeDbReadWrite();
+          if ( imported )
+            {
+              debugLog( nix::fmt( "scrapePrefix: imported '%s' from eval-cache",
+                                  concatStringsSep( ".", prefix ) ) );
+              recordDuration();
+              return;
+            }
+        }
+      catch ( const std::exception & err )
+        {
+          /* The eval-cache schema is not a public interface; treat any
+           * surprise as a cache miss. */
+          debugLog( nix::fmt( "scrapePrefix: eval-cache import failed: %s",
+                              err.what() ) );
+          this->closeDbReadWrite();
+        }
+    }
+
+  /* With more than one job available use the worker-pool scrape, where each
+   * long-lived worker keeps its eval state warm across pages instead of
+   * re-creating it once per page.
+   * Cross-machine sharding always goes through the pool since only its page
+   * loop knows how to skip pages owned by sibling machines. */
+  if ( unsigned jobs = getScrapeJobs(); ( 1 < jobs )
+                                        || ( 1 < scrapeShardCount ) )
+    {
+      this->scrapePrefixPool( prefix, jobs );
+      recordDuration();
+      emitProgressEvent( "prefix-done",
+                         { { "prefix", concatStringsSep( ".", prefix ) } } );
+      return;
+    }
+
   Todos todo;
 
   // close the db if we have anything open in preparation for the child to take
@@ -146,6 +985,9 @@ PkgDbInput::scrapePrefix( const flox::AttrPath & prefix )
 
   do {
       const int EXIT_CHILD_INCOMPLETE = EXIT_SUCCESS + 1;
+      /* The child hit the RSS watermark mid-page; re-fork and resume the
+       * SAME page from its checkpoint. */
+      const int EXIT_CHILD_MEMORY = EXIT_SUCCESS + 2;
       const int EXIT_FAILURE_NIX_EVAL
         = 150;  // seems to not overlap with common posix codes
 
@@ -180,6 +1022,14 @@ PkgDbInput::scrapePrefix( const flox::AttrPath & prefix )
                   pageIdx++;
                   scrapingComplete = false;
                 }
+              else if ( WEXITSTATUS( status ) == EXIT_CHILD_MEMORY )
+                {
+                  debugLog( "scrapePrefix: Child hit memory watermark, "
+                            "resuming same page in a fresh process" );
+                  /* Do NOT increment pageIdx; the checkpoint lets the next
+                   * child skip past completed attributes. */
+                  scrapingComplete = false;
+                }
               else  // ( WEXITSTATUS( status ) != EXIT_SUCCESS )
                 {
                   scrapingComplete = true;
@@ -210,6 +1060,10 @@ PkgDbInput::scrapePrefix( const flox::AttrPath & prefix )
         {
           /* Open a read/write connection. */
           auto chunkDbRW = this->getDbReadWrite();
+          if ( this->seedDbPath.has_value() )
+            {
+              chunkDbRW->attachSeed( *this->seedDbPath );
+            }
 
           /* Start a transaction */
           chunkDbRW->execute( "BEGIN TRANSACTION" );
@@ -221,6 +1075,7 @@ PkgDbInput::scrapePrefix( const flox::AttrPath & prefix )
                                static_cast<flox::Cursor>( root ),
                                chunkRow );
           bool targetComplete = false;
+          bool hitWatermark   = false;
 
           try
             {
@@ -232,7 +1087,9 @@ PkgDbInput::scrapePrefix( const flox::AttrPath & prefix )
                 = chunkDbRW->scrape( this->getFlake()->state->symbols,
                                      rootTarget,
                                      pageSize,
-                                     pageIdx );
+                                     pageIdx,
+                                     /* markPrefixDone */ true,
+                                     &hitWatermark );
             }
           catch ( const nix::EvalError & err )
             {
@@ -251,22 +1108,29 @@ PkgDbInput::scrapePrefix( const flox::AttrPath & prefix )
             "scrapePrefix(child): scraping page %d complete, lastPage: %d",
             pageIdx,
             targetComplete ) );
+          int ecode = targetComplete ? EXIT_SUCCESS
+                      : hitWatermark ? EXIT_CHILD_MEMORY
+                                     : EXIT_CHILD_INCOMPLETE;
           try
             {
               this->closeDbReadWrite();
               this->freeFlake();
-              exit( targetComplete ? EXIT_SUCCESS : EXIT_CHILD_INCOMPLETE );
+              exit( ecode );
             }
           catch ( const std::exception & err )
             {
               debugLog(
                 nix::fmt( "scrapePrefix(child): caught exception on exit: %s",
                           err.what() ) );
-              exit( targetComplete ? EXIT_SUCCESS : EXIT_CHILD_INCOMPLETE );
+              exit( ecode );
             }
         }
     }
   while ( ! scrapingComplete );
+
+  recordDuration();
+  emitProgressEvent( "prefix-done",
+                     { { "prefix", concatStringsSep( ".", prefix ) } } );
 }
 
 
@@ -325,10 +1189,102 @@ PkgDbRegistryMixin::scrapeIfNeeded()
 {
   this->initRegistry();
   assert( this->registry != nullptr );
+
+  std::vector<std::pair<std::string, std::shared_ptr<PkgDbInput>>> inputs;
   for ( auto & [name, input] : *this->registry )
     {
-      input->scrapeSystems( this->getSystems() );
+      inputs.emplace_back( name, input );
+    }
+
+  /* A single input is scraped in-process; with several inputs each gets its
+   * own child process since every input writes to its own database keyed
+   * by fingerprint.  Cold multi-input startup is then bounded by the
+   * slowest input rather than the sum. */
+  if ( inputs.size() < 2 )
+    {
+      for ( auto & [name, input] : inputs )
+        {
+          input->scrapeSystems( this->getSystems() );
+        }
+      return;
     }
+
+  const unsigned limit
+    = std::min( getScrapeJobs(), static_cast<unsigned>( inputs.size() ) );
+
+  std::map<pid_t, std::string> running;
+  std::size_t                  nextInput = 0;
+  std::optional<std::string>   failedInput;
+
+  auto spawnNext = [&]()
+  {
+    auto & [name, input] = inputs[nextInput];
+    pid_t pid            = fork();
+    if ( pid == -1 )
+      {
+        throw PkgDbException( "fork to scrape registry input failed" );
+      }
+    if ( pid == 0 )
+      {
+        /* Worker pools inside an input child would multiply with the
+         * per-input concurrency, so force the serial scrape path. */
+        setenv( "PKGDB_SCRAPE_JOBS", "1", 1 );
+        int ecode = EXIT_SUCCESS;
+        try
+          {
+            input->scrapeSystems( this->getSystems() );
+          }
+        catch ( const std::exception & err )
+          {
+            debugLog( nix::fmt( "scrapeIfNeeded(child): input '%s' failed: %s",
+                                name,
+                                err.what() ) );
+            ecode = EXIT_FAILURE;
+          }
+        exit( ecode );
+      }
+    nix::logger->log( nix::lvlTalkative,
+                      nix::fmt( "scraping input '%s' ( pid %d )", name, pid ) );
+    running.emplace( pid, name );
+    ++nextInput;
+  };
+
+  while ( ( nextInput < inputs.size() ) && ( running.size() < limit ) )
+    {
+      spawnNext();
+    }
+
+  while ( ! running.empty() )
+    {
+      int   status = 0;
+      pid_t pid    = waitpid( -1, &status, 0 );
+      if ( pid == -1 ) { continue; }
+      auto itr = running.find( pid );
+      if ( itr == running.end() ) { continue; }
+      std::string name = itr->second;
+      running.erase( itr );
+
+      if ( ( ! WIFEXITED( status ) )
+           || ( WEXITSTATUS( status ) != EXIT_SUCCESS ) )
+        {
+          if ( ! failedInput.has_value() ) { failedInput = name; }
+        }
+      else if ( ( ! failedInput.has_value() )
+                && ( nextInput < inputs.size() ) )
+        {
+          spawnNext();
+        }
+    }
+
+  if ( failedInput.has_value() )
+    {
+      throw PkgDbException(
+        nix::fmt( "failed to scrape input '%s'", *failedInput ) );
+    }
+
+  /* The children wrote through their own connections, so re-open handles to
+   * see their results. */
+  for ( auto & [name, input] : inputs ) { input->closeDbReadWrite(); }
 }
 
 
@@ -343,6 +1299,42 @@ PkgDbRegistryMixin::getPkgDbRegistry()
 }
 
 
+/* -------------------------------------------------------------------------- */
+
+void
+publishSharedDb( const std::filesystem::path & dbPath )
+{
+  auto sharedDir = getSharedCacheDir();
+  if ( ! sharedDir.has_value() ) { return; }
+
+  std::filesystem::path target = ( *sharedDir ) / dbPath.filename();
+  /* Fingerprint-keyed content is identical; the first publisher wins. */
+  if ( std::filesystem::exists( target ) ) { return; }
+
+  try
+    {
+      std::filesystem::create_directories( *sharedDir );
+      std::filesystem::path tmpPath
+        = target.string() + nix::fmt( ".%d", getpid() );
+      std::filesystem::copy_file( dbPath, tmpPath );
+      std::filesystem::permissions( tmpPath,
+                                    std::filesystem::perms::owner_read
+                                      | std::filesystem::perms::group_read
+                                      | std::filesystem::perms::others_read,
+                                    std::filesystem::perm_options::replace );
+      std::filesystem::rename( tmpPath, target );
+      nix::logger->log( nix::lvlTalkative,
+                        nix::fmt( "Published database to host-wide cache "
+                                  "'%s'",
+                                  target.string() ) );
+    }
+  catch ( const std::exception & )
+    { /* Publishing requires write access to the shared directory; callers
+       * without it simply keep their per-user copy. */
+    }
+}
+
+
 /* -------------------------------------------------------------------------- */
 
 }  // namespace flox::pkgdb
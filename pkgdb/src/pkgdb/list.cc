@@ -63,8 +63,6 @@ ListCommand::run()
       return EXIT_SUCCESS;
     }
 
-  nlohmann::json dbs = nlohmann::json::object();
-
   /* Show the cachedir path over stderr if we're only printing basenames and
    * they didn't specify it explicitly. */
   if ( this->basenames && ( ! this->cacheDir.has_value() ) )
@@ -72,6 +70,10 @@ ListCommand::run()
       std::cerr << "pkgdb cachedir: " << cacheDir.string() << std::endl;
     }
 
+  /* JSON output is serialized incrementally: each entry is written as soon
+   * as its database has been summarized, rather than accumulating a document
+   * and dumping it at the end. */
+  bool first = true;
   for ( const auto & entry : std::filesystem::directory_iterator( cacheDir ) )
     {
       if ( ! isSQLiteDb( entry.path() ) ) { continue; }
@@ -83,12 +85,25 @@ ListCommand::run()
 
       if ( this->json )
         {
-          dbs[dbPath] = { { "string", db.lockedRef.string },
-                          { "attrs", db.lockedRef.attrs },
-                          { "fingerprint",
-                            db.fingerprint.to_string( nix::Base16, false ) } };
+          nlohmann::json info
+            = { { "string", db.getLockedRef().string },
+                { "attrs", db.getLockedRef().attrs },
+                { "fingerprint",
+                  db.getFingerprint().to_string( nix::Base16, false ) } };
+          std::cout << ( first ? "{" : "," )
+                    << nlohmann::json( dbPath ).dump() << ':' << info.dump();
+          first = false;
+        }
+      else
+        {
+          std::cout << db.getLockedRef().string << ' ' << dbPath << std::endl;
         }
-      else { std::cout << db.lockedRef.string << ' ' << dbPath << std::endl; }
+    }
+
+  if ( this->json )
+    {
+      if ( first ) { std::cout << '{'; }
+      std::cout << '}' << std::endl;
     }
 
   return EXIT_SUCCESS;
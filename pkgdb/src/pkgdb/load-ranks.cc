@@ -0,0 +1,58 @@
+/* ========================================================================== *
+ *
+ * @file pkgdb/load-ranks.cc
+ *
+ * @brief Implementation of the `pkgdb load-ranks` subcommand.
+ *
+ *
+ * -------------------------------------------------------------------------- */
+
+#include <iostream>
+
+#include <nlohmann/json.hpp>
+
+#include "flox/pkgdb/command.hh"
+#include "flox/pkgdb/write.hh"
+
+
+/* -------------------------------------------------------------------------- */
+
+namespace flox::pkgdb {
+
+/* -------------------------------------------------------------------------- */
+
+LoadRanksCommand::LoadRanksCommand() : parser( "load-ranks" )
+{
+  this->parser.add_description(
+    "Load popularity ranks into a Package DB for search ordering" );
+  this->addTargetArg( this->parser );
+  this->parser.add_argument( "ranks" )
+    .help( "path to a JSON object mapping 'pname' to an integer rank "
+           "( lower is more popular )" )
+    .nargs( 1 )
+    .action( [&]( const std::string & path ) { this->ranksPath = path; } );
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+int
+LoadRanksCommand::run()
+{
+  this->openPkgDb();
+  std::size_t ranked = this->db->loadPopularityRanks( this->ranksPath );
+  std::cout << nlohmann::json( { { "ranked", ranked } } ).dump() << std::endl;
+  return EXIT_SUCCESS;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+}  // namespace flox::pkgdb
+
+
+/* -------------------------------------------------------------------------- *
+ *
+ *
+ *
+ * ========================================================================== */
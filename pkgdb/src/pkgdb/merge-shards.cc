@@ -0,0 +1,137 @@
+/* ========================================================================== *
+ *
+ * @file merge-shards.cc
+ *
+ * @brief Implementation of the `pkgdb merge-shards` subcommand.
+ *
+ *
+ * -------------------------------------------------------------------------- */
+
+#include <filesystem>
+#include <iostream>
+
+#include "flox/core/util.hh"
+#include "flox/pkgdb/command.hh"
+#include "flox/pkgdb/write.hh"
+
+
+/* -------------------------------------------------------------------------- */
+
+namespace flox::pkgdb {
+
+/* -------------------------------------------------------------------------- */
+
+MergeShardsCommand::MergeShardsCommand() : parser( "merge-shards" )
+{
+  this->parser.add_description(
+    "Merge partial scrape shard databases into one database" );
+  this->parser.add_argument( "--mark-done" )
+    .help( "mark an attribute path as completely scraped after merging" )
+    .metavar( "ATTRS" )
+    .nargs( 1 )
+    .append()
+    .action( [&]( const std::string & attrs )
+             { this->donePrefixes.emplace_back( splitAttrPath( attrs ) ); } );
+  this->parser.add_argument( "target" )
+    .help( "path to the merged database ( created from the first shard if "
+           "it does not exist )" )
+    .metavar( "DB-PATH" )
+    .action( [&]( const std::string & target )
+             { this->targetPath = target; } );
+  this->parser.add_argument( "shards" )
+    .help( "paths to shard databases" )
+    .metavar( "SHARD..." )
+    .remaining()
+    .action( [&]( const std::string & shard )
+             { this->shardPaths.emplace_back( shard ); } );
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+int
+MergeShardsCommand::run()
+{
+  if ( this->shardPaths.empty() )
+    {
+      throw command::InvalidArgException(
+        "at least one shard database is required" );
+    }
+
+  /* All shards must describe the same locked flake.
+   * Opening each one read-only both verifies it is a usable database and
+   * yields its fingerprint. */
+  std::optional<Fingerprint> fingerprint;
+  for ( const auto & shardPath : this->shardPaths )
+    {
+      PkgDbReadOnly shard( shardPath.string() );
+      if ( ! fingerprint.has_value() )
+        {
+          fingerprint = shard.getFingerprint();
+        }
+      else if ( shard.getFingerprint() != *fingerprint )
+        {
+          throw PkgDbException(
+            nix::fmt( "shard '%s' fingerprint does not match '%s'",
+                      shardPath.string(),
+                      fingerprint->to_string( nix::Base16, false ) ) );
+        }
+    }
+
+  /* A missing target is created by adopting the first shard wholesale,
+   * which skips one remap/copy pass; the remaining shards are absorbed. */
+  auto shard = this->shardPaths.begin();
+  if ( ! std::filesystem::exists( this->targetPath ) )
+    {
+      if ( this->targetPath.has_parent_path() )
+        {
+          std::filesystem::create_directories(
+            this->targetPath.parent_path() );
+        }
+      std::filesystem::copy_file( *shard, this->targetPath );
+      ++shard;
+    }
+  else if ( PkgDbReadOnly( this->targetPath.string() ).getFingerprint()
+            != *fingerprint )
+    {
+      throw PkgDbException(
+        nix::fmt( "target '%s' fingerprint does not match '%s'",
+                  this->targetPath.string(),
+                  fingerprint->to_string( nix::Base16, false ) ) );
+    }
+
+  PkgDb pdb( static_cast<std::string_view>( this->targetPath.string() ) );
+  for ( ; shard != this->shardPaths.end(); ++shard )
+    {
+      pdb.absorbShard( *shard );
+    }
+
+  /* Individual shards never mark prefixes done since each one only holds
+   * its slice of the pages; the caller asserts completeness here. */
+  for ( const auto & prefix : this->donePrefixes )
+    {
+      pdb.setPrefixDone( prefix, true );
+    }
+
+  /* Refresh planner statistics so readers plan against real table shapes. */
+  pdb.analyze();
+
+  /* Print path to database. */
+  std::cout << nlohmann::json(
+                 { { "database-path", this->targetPath.string() } } )
+                 .dump()
+            << std::endl;
+  return EXIT_SUCCESS;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+}  // namespace flox::pkgdb
+
+
+/* -------------------------------------------------------------------------- *
+ *
+ *
+ *
+ * ========================================================================== */
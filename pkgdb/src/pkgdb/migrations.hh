@@ -0,0 +1,146 @@
+/* ========================================================================== *
+ *
+ * @file pkgdb/migrations.hh
+ *
+ * @brief SQL steps used to migrate older package databases in place.
+ *
+ * Each string upgrades the tables schema by exactly one version and is
+ * applied inside a transaction by `PkgDb::migrate`.
+ * Versions with no step here force a re-scrape; that should be reserved for
+ * changes which genuinely require new evaluation data.
+ *
+ *
+ * -------------------------------------------------------------------------- */
+
+#pragma once
+
+/* -------------------------------------------------------------------------- */
+
+namespace flox::pkgdb {
+
+/* -------------------------------------------------------------------------- */
+
+/* v4 -> v5: pre-parsed semver component columns.
+ * The numeric values are backfilled natively afterwards. */
+static const char * sql_migrateSemverParts = R"SQL(
+ALTER TABLE Packages ADD COLUMN major  INTEGER;
+ALTER TABLE Packages ADD COLUMN minor  INTEGER;
+ALTER TABLE Packages ADD COLUMN patch  INTEGER;
+ALTER TABLE Packages ADD COLUMN preTag VARCHAR( 127 );
+
+CREATE INDEX IF NOT EXISTS idx_PackagesSemver
+  ON Packages ( major, minor, patch )
+)SQL";
+
+
+/* Seeds `fts_Packages` from existing rows once the index exists. */
+static const char * sql_migrateFtsBackfill = R"SQL(
+INSERT INTO fts_Packages ( rowid, pname, attrName, description )
+SELECT Packages.id, Packages.pname, Packages.attrName
+     , uncompress_description( Descriptions.description )
+FROM Packages
+LEFT OUTER JOIN Descriptions ON ( Packages.descriptionId = Descriptions.id )
+WHERE Packages.id NOT IN ( SELECT rowid FROM fts_Packages )
+)SQL";
+
+
+/* -------------------------------------------------------------------------- */
+
+/* v5 -> v6: `AttrSets` closure table.
+ * The one-time backfill below is the last recursive traversal these
+ * databases will run; the insert trigger ( created by `initTables` )
+ * maintains the closure from here on. */
+static const char * sql_migrateAttrSetClosure = R"SQL(
+CREATE TABLE IF NOT EXISTS AttrSetClosure (
+  ancestor    INTEGER NOT NULL
+, descendant  INTEGER NOT NULL
+, depth       INTEGER NOT NULL
+, PRIMARY KEY ( ancestor, descendant )
+);
+
+CREATE INDEX IF NOT EXISTS idx_AttrSetClosureDescendant
+  ON AttrSetClosure ( descendant, depth );
+
+INSERT INTO AttrSetClosure ( ancestor, descendant, depth )
+WITH RECURSIVE Chain ( ancestor, descendant, depth ) AS (
+  SELECT id, id, 0 FROM AttrSets
+  UNION ALL
+  SELECT A.parent, Chain.descendant, ( Chain.depth + 1 )
+  FROM Chain INNER JOIN AttrSets A ON ( A.id = Chain.ancestor )
+  WHERE ( A.parent != 0 )
+)
+SELECT ancestor, descendant, depth FROM Chain
+)SQL";
+
+
+/* -------------------------------------------------------------------------- */
+
+/* v6 -> v7: pre-lowered name columns for indexed case-insensitive exact
+ * matching.
+ * `VIRTUAL' generated columns are the only generated kind `ALTER TABLE'
+ * permits; the indexes below store the computed values either way. */
+static const char * sql_migrateLowerNames = R"SQL(
+ALTER TABLE Packages ADD COLUMN attrNameLower VARCHAR( 255 )
+  GENERATED ALWAYS AS ( LOWER( attrName ) ) VIRTUAL;
+ALTER TABLE Packages ADD COLUMN pnameLower VARCHAR( 255 )
+  GENERATED ALWAYS AS ( LOWER( pname ) ) VIRTUAL;
+
+CREATE INDEX IF NOT EXISTS idx_PackagesPnameLower
+  ON Packages ( pnameLower );
+
+CREATE INDEX IF NOT EXISTS idx_PackagesAttrNameLower
+  ON Packages ( attrNameLower )
+)SQL";
+
+
+/* -------------------------------------------------------------------------- */
+
+/* v7 -> v8: materialized `fullPath` column ( and its generated `relPath`
+ * projection ).
+ * Existing rows are backfilled from `AttrSetClosure` with the same
+ * `json_insert` expression the `trg_packagesFullPath` insert trigger uses,
+ * correlated on the stored row instead of `new`. */
+static const char * sql_migrateFullPath = R"SQL(
+-- The pre-v8 full-text update trigger fires on *every* `UPDATE`; drop it so
+-- the backfill below does not churn the index row-by-row.  `initTables`
+-- recreates the column-scoped replacement right after migration.
+DROP TRIGGER IF EXISTS trg_ftsPackagesUpdate;
+
+ALTER TABLE Packages ADD COLUMN fullPath JSON;
+ALTER TABLE Packages ADD COLUMN relPath JSON
+  GENERATED ALWAYS AS ( json_remove( fullPath, '$[1]', '$[0]' ) ) VIRTUAL;
+
+CREATE INDEX IF NOT EXISTS idx_PackagesRelPath
+  ON Packages ( relPath );
+
+UPDATE Packages
+SET fullPath
+  = json_insert(
+      ( SELECT json_group_array( attrName )
+        FROM ( SELECT A.attrName
+               FROM AttrSetClosure C
+                    JOIN AttrSets A ON ( A.id = C.ancestor )
+               WHERE ( C.descendant = Packages.parentId )
+               ORDER BY C.depth DESC ) )
+    , '$[#]', Packages.attrName )
+)SQL";
+
+
+/* -------------------------------------------------------------------------- */
+
+/* v9 -> v10: optional popularity-rank column.
+ * Starts `NULL` ( unranked ) everywhere; populated by `pkgdb load-ranks`. */
+static const char * sql_migratePopularityRank = R"SQL(
+ALTER TABLE Packages ADD COLUMN popularityRank INTEGER
+)SQL";
+
+
+/* -------------------------------------------------------------------------- */
+
+}  // namespace flox::pkgdb
+
+/* -------------------------------------------------------------------------- *
+ *
+ *
+ *
+ * ========================================================================== */
@@ -16,6 +16,7 @@
 #include <sstream>
 #include <string>
 #include <string_view>
+#include <tuple>
 #include <unordered_map>
 #include <unordered_set>
 #include <utility>
@@ -26,6 +27,7 @@
 #include <nlohmann/json.hpp>
 #include <sqlite3pp.hh>
 
+#include "flox/core/trace.hh"
 #include "flox/core/types.hh"
 #include "flox/core/util.hh"
 #include "flox/pkgdb/pkg-query.hh"
@@ -113,6 +115,7 @@ to_json( nlohmann::json & jto, const PkgQueryArgs & args )
     { "systems", args.systems },
     { "relPath", args.relPath },
     { "limit", args.limit },
+    { "pageAfter", args.pageAfter },
     { "deduplicate", args.deduplicate },
   };
 }
@@ -136,6 +139,7 @@ PkgQueryArgs::clear()
   this->subtrees          = std::nullopt;
   this->systems           = { nix::settings.thisSystem.get() };
   this->relPath           = std::nullopt;
+  this->pageAfter         = std::nullopt;
 }
 
 
@@ -178,6 +182,7 @@ PkgQuery::clearBuilt()
   this->firstOrder  = true;
   this->firstWhere  = true;
   this->binds       = {};
+  this->builtSql.reset();
 }
 
 
@@ -210,6 +215,19 @@ PkgQuery::mkPatternString( const std::string & matchString )
   return pattern;
 }
 
+std::string
+PkgQuery::mkFtsMatchString( const std::string & matchString )
+{
+  /* Quote the string so FTS query syntax characters are treated literally;
+   * embedded quotes are doubled per SQL conventions. */
+  std::string phrase
+    = std::regex_replace( matchString, std::regex( "\"" ), "\"\"" );
+  return "\"" + phrase + "\"";
+}
+
+
+/* -------------------------------------------------------------------------- */
+
 void
 PkgQuery::initMatch()
 {
@@ -259,15 +277,23 @@ PkgQuery::initMatch()
        * match relPath, but we check attrName no matter what for ordering. */
       /* We have to add '%' around `:match' because they were added for
        * use with `LIKE'. */
+      /* The pre-lowered columns are indexed; `LOWER()' on the left side
+       * would force a per-row expression instead. */
       this->addSelection(
-        "LOWER( pname ) = LOWER( :partialMatch ) AS matchExactPname" );
+        "pnameLower = LOWER( :partialMatch ) AS matchExactPname" );
       this->addSelection(
-        "LOWER( attrName ) = LOWER( :partialMatch ) AS matchExactAttrName" );
+        "attrNameLower = LOWER( :partialMatch ) AS matchExactAttrName" );
       this->addSelection( "( pname LIKE :partialMatchPattern ESCAPE '\\' ) AS "
                           "matchPartialPname" );
       this->addSelection( "( attrName LIKE :partialMatchPattern ESCAPE '\\' ) "
                           "AS matchPartialAttrName" );
 
+      /* Narrow candidate rows with the trigram index before the `LIKE'
+       * ranking columns above run.  Trigram matching is a superset of the
+       * `LIKE' conditions it guards, so this never drops a result; queries
+       * shorter than a trigram fall back to plain scans. */
+      constexpr std::size_t ftsMinLength = 3;
+
       if ( hasPartialNameMatch )
         {
           /* Add `%` before binding so `LIKE` works. */
@@ -277,6 +303,15 @@ PkgQuery::initMatch()
           this->addWhere( "( matchExactPname OR matchExactAttrName OR"
                           "  matchPartialPname OR matchPartialAttrName"
                           ")" );
+          if ( ftsMinLength <= this->partialNameMatch->size() )
+            {
+              this->addWhere(
+                "id IN ( SELECT rowid FROM fts_Packages "
+                "WHERE fts_Packages MATCH :ftsMatch )" );
+              binds.emplace( ":ftsMatch",
+                             "{pname attrName} : "
+                               + mkFtsMatchString( *this->partialNameMatch ) );
+            }
         }
 
       if ( hasPartialMatch )
@@ -292,11 +327,20 @@ PkgQuery::initMatch()
                           "  matchPartialPname OR matchPartialAttrName OR"
                           "  matchPartialDescription "
                           ")" );
+          if ( ftsMinLength <= this->partialMatch->size() )
+            {
+              this->addWhere( "id IN ( SELECT rowid FROM fts_Packages "
+                              "WHERE fts_Packages MATCH :ftsMatch )" );
+              binds.emplace( ":ftsMatch",
+                             mkFtsMatchString( *this->partialMatch ) );
+            }
         }
       else { this->addSelection( "NULL AS matchPartialDescription" ); }
 
       if ( hasPartialNameOrRelPathMatch )
         {
+          /* No FTS narrowing here: `relPath' matches may span attribute path
+           * components, which the index does not cover. */
           /* Join relPath with '.' so searches can include dots. */
           this->addSelection( "(SELECT LOWER( group_concat(value, '.') ) "
                               "= LOWER( :partialMatch )"
@@ -413,24 +457,34 @@ PkgQuery::initOrderBy()
 
   , subtreesRank ASC
   , systemsRank ASC
+  -- Among equally matched packages prefer popular ones ( see
+  -- `pkgdb load-ranks' ); unranked rows sort after ranked ones.
+  , popularityRank ASC NULLS LAST
   , pname ASC
   , versionType ASC
   )SQL" );
 
-  /* Handle `preferPreReleases' and semver parts. */
+  /* Handle `preferPreReleases' and semver parts.
+   * Pre-release tags rank via `version_sort_key' so their identifiers
+   * compare by semver precedence ( e.g. `beta.9' before `beta.10' )
+   * rather than as raw strings, keeping the sort inside SQLite. */
   if ( this->preferPreReleases )
     {
       this->addOrderBy( R"SQL(
         major  DESC NULLS LAST
       , minor  DESC NULLS LAST
       , patch  DESC NULLS LAST
-      , preTag DESC NULLS FIRST
+      , CASE WHEN preTag IS NULL THEN NULL
+             ELSE version_sort_key( preTag )
+        END DESC NULLS FIRST
       )SQL" );
     }
   else
     {
       this->addOrderBy( R"SQL(
-        preTag DESC NULLS FIRST
+        CASE WHEN preTag IS NULL THEN NULL
+             ELSE version_sort_key( preTag )
+        END DESC NULLS FIRST
       , major  DESC NULLS LAST
       , minor  DESC NULLS LAST
       , patch  DESC NULLS LAST
@@ -439,8 +493,10 @@ PkgQuery::initOrderBy()
 
   this->addOrderBy( R"SQL(
     versionDate DESC NULLS LAST
-  -- Lexicographic as fallback for misc. versions
-  , v_PackagesSearch.version ASC NULLS LAST
+  -- Precedence-aware fallback for misc. versions
+  , CASE WHEN v_PackagesSearch.version IS NULL THEN NULL
+         ELSE version_sort_key( v_PackagesSearch.version )
+    END ASC NULLS LAST
   , brokenRank ASC
   , unfreeRank ASC
   , attrName ASC
@@ -529,6 +585,19 @@ PkgQuery::init()
 
 std::string
 PkgQuery::str() const
+{
+  /* The clause structure only changes when `init()' reruns, so the text is
+   * generated once and rebound per input database; federated searches bind
+   * the same statement against every registry input. */
+  if ( ! this->builtSql.has_value() ) { this->builtSql = this->buildStr(); }
+  return *this->builtSql;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+std::string
+PkgQuery::buildStr() const
 {
   std::stringstream qry;
   qry << "SELECT ";
@@ -539,19 +608,38 @@ PkgQuery::str() const
       else { qry << ", "; }
       qry << column;
     }
-  qry << " FROM ( SELECT ";
-  if ( this->firstSelect ) { qry << "*"; }
-  else { qry << this->selects.str(); }
-  qry << " FROM v_PackagesSearch";
-  if ( ! this->firstWhere ) { qry << " WHERE " << this->wheres.str(); }
-  /* This will cause an arbitrary row to be chosen for all values other than
-   * relPath. See "a single arbitrarily chosen row from within the group" from
-   * https://www.sqlite.org/lang_select.html. This is a bit hacky, but we know
-   * that `flox search` only uses `relPath` and `description`, and we assume
-   * that `description` is the same for all packages that share `relPath`. */
-  if ( this->deduplicate ) { qry << "\n GROUP BY relPath\n"; }
-  if ( ! this->firstOrder ) { qry << " ORDER BY " << this->orders.str(); }
-  qry << " )";
+  if ( this->deduplicate )
+    {
+      /* Keep only the best-ranked row per `relPath', eliminated inside
+       * SQLite so duplicates across subtrees never leave the database.
+       * The window ranks with the full `ORDER BY' rather than the old
+       * `GROUP BY relPath' hack's arbitrary row choice.
+       * Ordering expressions live above the view here, so drop the view
+       * qualifier. */
+      std::string orders
+        = std::regex_replace( this->orders.str(),
+                              std::regex( "v_PackagesSearch\\." ),
+                              "" );
+      qry << " FROM ( SELECT *, ROW_NUMBER() OVER ( PARTITION BY relPath";
+      if ( ! this->firstOrder ) { qry << " ORDER BY " << orders; }
+      qry << " ) AS dedupeRank FROM ( SELECT ";
+      if ( this->firstSelect ) { qry << "*"; }
+      else { qry << this->selects.str(); }
+      qry << " FROM v_PackagesSearch";
+      if ( ! this->firstWhere ) { qry << " WHERE " << this->wheres.str(); }
+      qry << " ) ) WHERE ( dedupeRank = 1 )";
+      if ( ! this->firstOrder ) { qry << " ORDER BY " << orders; }
+    }
+  else
+    {
+      qry << " FROM ( SELECT ";
+      if ( this->firstSelect ) { qry << "*"; }
+      else { qry << this->selects.str(); }
+      qry << " FROM v_PackagesSearch";
+      if ( ! this->firstWhere ) { qry << " WHERE " << this->wheres.str(); }
+      if ( ! this->firstOrder ) { qry << " ORDER BY " << this->orders.str(); }
+      qry << " )";
+    }
   // Dump the bindings as well
   if ( ! this->binds.empty() )
     {
@@ -568,15 +656,119 @@ PkgQuery::str() const
 
 /* -------------------------------------------------------------------------- */
 
+std::string
+PkgQuery::mkInnerSelect( const std::string & schema, size_t idx ) const
+{
+  std::stringstream inner;
+  inner << "SELECT ";
+  if ( this->firstSelect ) { inner << "*"; }
+  else { inner << this->selects.str(); }
+  inner << " FROM " << schema << ".v_PackagesSearch";
+  if ( ! this->firstWhere )
+    {
+      /* Subqueries against the FTS index must name the same schema;
+       * unqualified names would resolve against the first attachment. */
+      std::string wheres
+        = std::regex_replace( this->wheres.str(),
+                              std::regex( "FROM fts_Packages" ),
+                              "FROM " + schema + ".fts_Packages" );
+      inner << " WHERE " << wheres;
+    }
+
+  std::stringstream qry;
+  if ( this->deduplicate )
+    {
+      /* Keep only the best-ranked row per `relPath' within this input with
+       * the same window `buildStr' uses, so federated and single-input
+       * searches pick the same representative; identical `relPath's from
+       * distinct inputs remain distinct results.
+       * Ordering expressions live above the view here, so drop the view
+       * qualifier. */
+      std::string orders
+        = std::regex_replace( this->orders.str(),
+                              std::regex( "v_PackagesSearch\\." ),
+                              "" );
+      qry << "SELECT *, " << idx << " AS inputRank"
+          << " FROM ( SELECT *, ROW_NUMBER() OVER ( PARTITION BY relPath";
+      if ( ! this->firstOrder ) { qry << " ORDER BY " << orders; }
+      qry << " ) AS dedupeRank FROM ( " << inner.str()
+          << " ) ) WHERE ( dedupeRank = 1 )";
+    }
+  else
+    {
+      qry << "SELECT *, " << idx << " AS inputRank FROM ( " << inner.str()
+          << " )";
+    }
+  return qry.str();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+std::string
+PkgQuery::strFederated( const std::vector<std::string> & schemas ) const
+{
+  std::stringstream qry;
+  qry << "SELECT ";
+  for ( const auto & column : this->exportedColumns ) { qry << column << ", "; }
+  qry << "inputRank, totalCount, pageRank FROM ( SELECT *"
+         ", COUNT( * ) OVER () AS totalCount"
+         /* Every row's position in the stable ranking; `( inputRank, id )'
+          * breaks any ties so positions ( and thus page cursors ) are
+          * deterministic. */
+         ", ROW_NUMBER() OVER ( ORDER BY ";
+  if ( ! this->firstOrder )
+    {
+      /* The union's result columns are unqualified, so drop the view name
+       * from any ordering expressions. */
+      qry << std::regex_replace( this->orders.str(),
+                                 std::regex( "v_PackagesSearch\\." ),
+                                 "" )
+          << ", ";
+    }
+  qry << "inputRank, id ) AS pageRank FROM ( ";
+  bool first = true;
+  for ( size_t idx = 0; idx < schemas.size(); ++idx )
+    {
+      if ( first ) { first = false; }
+      else { qry << " UNION ALL "; }
+      qry << this->mkInnerSelect( schemas[idx], idx );
+    }
+  qry << " ) )";
+  /* Keyset pagination: seek past the previous page's final position. */
+  if ( this->pageAfter.has_value() )
+    {
+      qry << " WHERE " << *this->pageAfter << " < pageRank";
+    }
+  qry << " ORDER BY pageRank";
+  /* `semver' filtering happens after SQL, so applying `LIMIT' here would
+   * under-deliver; leave trimming to the caller in that case. */
+  if ( this->limit.has_value() && ( ! this->semver.has_value() ) )
+    {
+      qry << " LIMIT " << static_cast<int>( *this->limit );
+    }
+  return qry.str();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+/** @return `true` iff @a range matches every version, making filtering moot. */
+static bool
+isIgnoredSemverRange( const std::string & range )
+{
+  static const std::vector<std::string> ignores
+    = { "", "*", "any", "^*", "~*", "x", "X" };
+  return std::find( ignores.begin(), ignores.end(), range ) != ignores.end();
+}
+
+
 std::unordered_set<std::string>
 PkgQuery::filterSemvers(
   const std::unordered_set<std::string> & versions ) const
 {
-  static const std::vector<std::string> ignores
-    = { "", "*", "any", "^*", "~*", "x", "X" };
   if ( ( ! this->semver.has_value() )
-       || ( std::find( ignores.begin(), ignores.end(), *this->semver )
-            != ignores.end() ) )
+       || isIgnoredSemverRange( *this->semver ) )
     {
       return versions;
     }
@@ -611,40 +803,261 @@ PkgQuery::bind( sqlite3pp::database & pdb ) const
 std::vector<row_id>
 PkgQuery::execute( sqlite3pp::database & pdb ) const
 {
-  std::shared_ptr<sqlite3pp::query> qry = this->bind( pdb );
-  std::vector<row_id>               rsl;
+  TraceSpan span( "PkgQuery::execute" );
+
+  /* We can handle quite a bit of filtering and ordering in SQL, but `semver`
+   * has to be handled with post-processing; the cursor applies it lazily. */
+  std::vector<row_id> rsl;
+  PkgQueryCursor      cursor = this->start( pdb );
+  while ( auto id = cursor.next() ) { rsl.push_back( *id ); }
+  span.addArg( "rows", rsl.size() );
+  return rsl;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+std::vector<std::string>
+PkgQuery::explain( sqlite3pp::database & pdb ) const
+{
+  std::string      stmt = "EXPLAIN QUERY PLAN " + this->str();
+  sqlite3pp::query qry( pdb, stmt.c_str() );
+  for ( const auto & [var, val] : this->binds )
+    {
+      qry.bind( var.c_str(), val, sqlite3pp::copy );
+    }
+  std::vector<std::string> plan;
+  for ( const auto & row : qry )
+    {
+      /* `EXPLAIN QUERY PLAN' rows are ( id, parent, notused, detail ). */
+      plan.emplace_back( row.get<std::string>( 3 ) );
+    }
+  return plan;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+std::vector<std::optional<row_id>>
+PkgQuery::executeMany( sqlite3pp::database &             pdb,
+                       const std::vector<PkgQueryArgs> & argsList )
+{
+  std::vector<std::optional<row_id>> results( argsList.size(), std::nullopt );
+  if ( argsList.empty() ) { return results; }
+
+  std::vector<PkgQuery> queries;
+  queries.reserve( argsList.size() );
+  for ( const auto & args : argsList ) { queries.emplace_back( args ); }
+
+  /* Each branch is a complete single-descriptor select wrapped in a
+   * subquery, so per-branch `ORDER BY' and `LIMIT' remain legal inside the
+   * compound statement.
+   * Host parameter names are suffixed with the branch index to keep binds
+   * from distinct descriptors apart. */
+  std::stringstream                                sql;
+  std::vector<std::pair<std::string, std::string>> allBinds;
+  for ( size_t idx = 0; idx < queries.size(); ++idx )
+    {
+      const PkgQuery & query = queries[idx];
+      if ( idx != 0 ) { sql << " UNION ALL "; }
+      sql << "SELECT " << idx << " AS descriptorIdx, id, semver FROM ( ";
+
+      std::stringstream inner;
+      inner << "SELECT ";
+      if ( query.firstSelect ) { inner << "*"; }
+      else { inner << query.selects.str(); }
+      inner << " FROM v_PackagesSearch";
+      if ( ! query.firstWhere )
+        {
+          std::string wheres = query.wheres.str();
+          for ( const auto & [var, val] : query.binds )
+            {
+              std::string renamed = var + "_" + std::to_string( idx );
+              wheres = std::regex_replace( wheres,
+                                           std::regex( var + "\\b" ),
+                                           renamed );
+              allBinds.emplace_back( renamed, val );
+            }
+          inner << " WHERE " << wheres;
+        }
+
+      if ( query.deduplicate )
+        {
+          /* Keep only the best-ranked row per `relPath' with the same
+           * window `buildStr' uses, so batched resolution picks the same
+           * representative as the unbatched path.
+           * Ordering expressions live above the view here, so drop the
+           * view qualifier. */
+          std::string orders
+            = std::regex_replace( query.orders.str(),
+                                  std::regex( "v_PackagesSearch\\." ),
+                                  "" );
+          sql << "SELECT * FROM ( SELECT *, ROW_NUMBER() OVER"
+                 " ( PARTITION BY relPath";
+          if ( ! query.firstOrder ) { sql << " ORDER BY " << orders; }
+          sql << " ) AS dedupeRank FROM ( " << inner.str()
+              << " ) ) WHERE ( dedupeRank = 1 )";
+          if ( ! query.firstOrder ) { sql << " ORDER BY " << orders; }
+        }
+      else
+        {
+          sql << inner.str();
+          if ( ! query.firstOrder )
+            {
+              sql << " ORDER BY " << query.orders.str();
+            }
+        }
+      /* `semver' filtering happens after SQL; those branches must yield
+       * every candidate so post-filtering can pick the first survivor. */
+      if ( ( ! query.semver.has_value() )
+           || isIgnoredSemverRange( *query.semver ) )
+        {
+          sql << " LIMIT 1";
+        }
+      sql << " )";
+    }
+
+  std::string      stmt = sql.str();
+  sqlite3pp::query qry( pdb, stmt.c_str() );
+  for ( const auto & [var, val] : allBinds )
+    {
+      qry.bind( var.c_str(), val, sqlite3pp::copy );
+    }
+
+  for ( const auto & row : qry )
+    {
+      auto idx = static_cast<size_t>( row.get<long long>( 0 ) );
+      if ( results[idx].has_value() ) { continue; }
+
+      const PkgQuery & query = queries[idx];
+      if ( query.semver.has_value()
+           && ( ! isIgnoredSemverRange( *query.semver ) ) )
+        {
+          const char * semver = row.get<const char *>( 2 );
+          if ( ( semver == nullptr )
+               || versions::semverSat( *query.semver, { semver } ).empty() )
+            {
+              continue;
+            }
+        }
+      results[idx] = static_cast<row_id>( row.get<long long>( 1 ) );
+    }
+
+  return results;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+/** @brief Private stepping state owned by a @a PkgQueryCursor. */
+struct PkgQueryCursor::State
+{
+  std::shared_ptr<sqlite3pp::query> qry;
+  sqlite3pp::query::iterator        itr;
+  sqlite3pp::query::iterator        end;
+  /** Unset when no `semver' post-filtering is required. */
+  std::optional<std::string> semver;
+  /** Memoized per-version satisfaction results. */
+  std::unordered_map<std::string, bool> satCache;
+}; /* End struct `PkgQueryCursor::State' */
+
+
+PkgQueryCursor
+PkgQuery::start( sqlite3pp::database & pdb ) const
+{
+  auto state = std::make_shared<PkgQueryCursor::State>();
+  state->qry = this->bind( pdb );
+  state->itr = state->qry->begin();
+  state->end = state->qry->end();
+  if ( this->semver.has_value() && ( ! isIgnoredSemverRange( *this->semver ) ) )
+    {
+      state->semver = this->semver;
+    }
+  return PkgQueryCursor( std::move( state ) );
+}
+
+
+std::optional<row_id>
+PkgQueryCursor::next()
+{
+  if ( this->state == nullptr ) { return std::nullopt; }
+  State & state = *this->state;
+  while ( state.itr != state.end )
+    {
+      auto row = *state.itr;
+      ++state.itr;
+      if ( state.semver.has_value() )
+        {
+          auto version = row.get<std::string>( 1 );
+          auto cached  = state.satCache.find( version );
+          if ( cached == state.satCache.end() )
+            {
+              bool sat
+                = ! versions::semverSat( *state.semver, { version } ).empty();
+              cached = state.satCache.emplace( std::move( version ), sat )
+                         .first;
+            }
+          if ( ! cached->second ) { continue; }
+        }
+      return static_cast<row_id>( row.get<long long>( 0 ) );
+    }
+  return std::nullopt;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+FederatedResults
+PkgQuery::executeFederated( sqlite3pp::database &            pdb,
+                            const std::vector<std::string> & schemas ) const
+{
+  std::string      stmt = this->strFederated( schemas );
+  sqlite3pp::query qry( pdb, stmt.c_str() );
+  for ( const auto & [var, val] : this->binds )
+    {
+      qry.bind( var.c_str(), val, sqlite3pp::copy );
+    }
+
+  FederatedResults rsl;
 
   /* If we don't need to handle `semver' this is easy. */
   if ( ! this->semver.has_value() )
     {
-      for ( const auto & row : *qry )
+      for ( const auto & row : qry )
         {
-          rsl.push_back( row.get<long long>( 0 ) );
+          rsl.totalCount = static_cast<size_t>( row.get<long long>( 3 ) );
+          rsl.rows.emplace_back( static_cast<uint32_t>( row.get<int>( 2 ) ),
+                                 row.get<long long>( 0 ) );
+          rsl.pageRanks.emplace_back(
+            static_cast<uint64_t>( row.get<long long>( 4 ) ) );
         }
       return rsl;
     }
 
-  /* We can handle quite a bit of filtering and ordering in SQL, but `semver`
-   * has to be handled with post-processing here. */
-
+  /* As with `execute()', `semver' filtering is a post-processing step. */
   std::unordered_set<std::string> versions;
-  /* Use a vector to preserve ordering original ordering. */
-  std::vector<std::pair<row_id, std::string>> idVersions;
-  for ( const auto & row : *qry )
+  /* Use a vector to preserve the original ordering. */
+  std::vector<std::tuple<uint32_t, row_id, std::string, uint64_t>> idVersions;
+  for ( const auto & row : qry )
     {
-      const auto & [_, version] = idVersions.emplace_back(
-        std::make_pair( row.get<long long>( 0 ), row.get<std::string>( 1 ) ) );
+      const auto & [rank, _, version, pageRank] = idVersions.emplace_back(
+        static_cast<uint32_t>( row.get<int>( 2 ) ),
+        row.get<long long>( 0 ),
+        row.get<std::string>( 1 ),
+        static_cast<uint64_t>( row.get<long long>( 4 ) ) );
       versions.emplace( version );
     }
   versions = this->filterSemvers( versions );
   /* Filter SQL results to be those in the satisfactory list. */
-  for ( const auto & elem : idVersions )
+  for ( const auto & [rank, id, version, pageRank] : idVersions )
     {
-      if ( versions.find( elem.second ) != versions.end() )
+      if ( versions.find( version ) != versions.end() )
         {
-          rsl.push_back( elem.first );
+          rsl.rows.emplace_back( rank, id );
+          rsl.pageRanks.emplace_back( pageRank );
         }
     }
+  rsl.totalCount = rsl.rows.size();
   return rsl;
 }
 
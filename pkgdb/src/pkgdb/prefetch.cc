@@ -0,0 +1,151 @@
+/* ========================================================================== *
+ *
+ * @file prefetch.cc
+ *
+ * @brief Implementation of the `pkgdb prefetch` subcommand.
+ *
+ *
+ * -------------------------------------------------------------------------- */
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <unistd.h>
+
+#include <nix/globals.hh>
+
+#include "flox/pkgdb/command.hh"
+#include "flox/registry.hh"
+
+
+/* -------------------------------------------------------------------------- */
+
+namespace flox::pkgdb {
+
+/* -------------------------------------------------------------------------- */
+
+/* Prefetch Subcommand */
+
+PrefetchCommand::PrefetchCommand() : parser( "prefetch" )
+{
+  this->parser.add_description(
+    "Fetch flakes and scrape their package databases ahead of need" );
+
+  this->parser.add_argument( "--registry" )
+    .help( "registry to prefetch, as inline JSON or a path to a JSON file. "
+           "May be used multiple times." )
+    .metavar( "REGISTRY" )
+    .action(
+      [&]( const std::string & registry )
+      {
+        this->registryRaw.merge(
+          parseOrReadJSONObject( registry ).get<RegistryRaw>() );
+      } );
+
+  this->parser.add_argument( "--manifest" )
+    .help( "path to a manifest whose registry and systems should "
+           "be prefetched" )
+    .metavar( "PATH" )
+    .action(
+      [&]( const std::string & path )
+      {
+        nlohmann::json manifest = readAndCoerceJSON( path );
+        if ( manifest.contains( "registry" )
+             && ( ! manifest.at( "registry" ).is_null() ) )
+          {
+            this->registryRaw.merge(
+              manifest.at( "registry" ).get<RegistryRaw>() );
+          }
+        if ( manifest.contains( "options" )
+             && manifest.at( "options" ).contains( "systems" )
+             && ( ! manifest.at( "options" ).at( "systems" ).is_null() ) )
+          {
+            for ( const auto & system :
+                  manifest.at( "options" ).at( "systems" ) )
+              {
+                const auto & systemStr = system.get<System>();
+                if ( std::find( this->systems.begin(),
+                                this->systems.end(),
+                                systemStr )
+                     == this->systems.end() )
+                  {
+                    this->systems.emplace_back( systemStr );
+                  }
+              }
+          }
+      } );
+
+  this->parser.add_argument( "--ga-registry" )
+    .help( "use a hard coded manifest ( with `nixpkgs` input )" )
+    .nargs( 0 )
+    .action( [&]( const auto & )
+             { this->registryRaw.merge( getGARegistry() ); } );
+
+  this->parser.add_argument( "--system" )
+    .help( "a system to scrape for each input. May be used multiple times. "
+           "Defaults to the current system." )
+    .metavar( "SYSTEM" )
+    .append()
+    .action(
+      [&]( const std::string & system )
+      {
+        if ( std::find( this->systems.begin(), this->systems.end(), system )
+             == this->systems.end() )
+          {
+            this->systems.emplace_back( system );
+          }
+      } );
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+int
+PrefetchCommand::run()
+{
+  if ( this->registryRaw.inputs.empty() )
+    {
+      throw command::InvalidArgException(
+        "one of '--registry', '--manifest', or '--ga-registry' is required" );
+    }
+
+  if ( this->systems.empty() )
+    {
+      this->systems = { nix::settings.thisSystem.get() };
+    }
+
+  /* Prefetching is background maintenance intended to run from `cron' or
+   * login hooks; yield the CPU to interactive work.
+   * Forked fetch and scrape children inherit the lowered priority. */
+  if ( nice( 19 ) == -1 )
+    {
+      debugLog( "prefetch: failed to lower scheduling priority" );
+    }
+
+  /* Fetches flakes and scrapes any missing prefixes, closing the read/write
+   * handles before returning so readers see finished databases. */
+  auto registry = this->getPkgDbRegistry();
+
+  /* Print the warmed databases so callers can confirm what was produced. */
+  nlohmann::json dbPaths = nlohmann::json::object();
+  for ( auto & [name, input] : *registry )
+    {
+      dbPaths.emplace( name, input->getDbPath() );
+    }
+  std::cout << nlohmann::json( { { "database-paths", dbPaths } } ).dump()
+            << std::endl;
+
+  return EXIT_SUCCESS;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+}  // namespace flox::pkgdb
+
+
+/* -------------------------------------------------------------------------- *
+ *
+ *
+ *
+ * ========================================================================== */
@@ -7,6 +7,9 @@
  *
  * -------------------------------------------------------------------------- */
 
+#include <string>
+#include <unordered_map>
+
 #include <nix/json-to-value.hh>
 #include <nix/primops.hh>
 #include <nix/value-to-json.hh>
@@ -23,6 +26,26 @@
 
 namespace flox::pkgdb {
 
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Per-`EvalState` memoization of flake-ref -> fingerprint.
+ *
+ * Computing a fingerprint locks the flake ( potentially fetching it ) and
+ * expressions call `builtins.getFingerprint` in loops with the same ref;
+ * within one evaluation the result is stable, so repeated calls should be
+ * hash-map hits.
+ */
+static std::unordered_map<std::string, std::string> &
+getFingerprintCache( const nix::EvalState & state )
+{
+  static std::unordered_map<const nix::EvalState *,
+                            std::unordered_map<std::string, std::string>>
+    caches;
+  return caches[&state];
+}
+
+
 /* -------------------------------------------------------------------------- */
 
 void
@@ -31,6 +54,11 @@ prim_getFingerprint( nix::EvalState &  state,
                      nix::Value **     args,
                      nix::Value &      value )
 {
+  /* Fingerprinting locks a flake ref, so the result is not determined by
+   * the calling expression's text; result caches must not record this
+   * eval. */
+  noteFlakeRefPrimopCall();
+
   nix::NixStringContext context;
 
   if ( args[0]->isThunk() && args[0]->isTrivial() )
@@ -43,10 +71,20 @@ prim_getFingerprint( nix::EvalState &  state,
     pos,
     "while processing 'flakeRef' argument to 'builtins.getFingerprint'" ) );
 
+  auto & cache = getFingerprintCache( state );
+  auto   key   = input.from->to_string();
+  if ( auto hit = cache.find( key ); hit != cache.end() )
+    {
+      value.mkString( hit->second );
+      return;
+    }
+
   FloxFlakeInput flake( state.store, input );
-  value.mkString(
-    flake.getFlake()->lockedFlake.getFingerprint().to_string( nix::Base16,
-                                                              false ) );
+  std::string    fingerprint
+    = flake.getFlake()->lockedFlake.getFingerprint().to_string( nix::Base16,
+                                                                false );
+  cache.emplace( std::move( key ), fingerprint );
+  value.mkString( fingerprint );
 }
 
 
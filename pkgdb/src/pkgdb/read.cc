@@ -11,13 +11,20 @@
 #include <limits>
 #include <list>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
+#include <nix/compression.hh>
+#include <sqlite3ppext.hh>
+
 #include "flox/core/util.hh"
 #include "flox/flake-package.hh"
 #include "flox/pkgdb/read.hh"
+#include "versions.hh"
 
 
 /* -------------------------------------------------------------------------- */
@@ -67,6 +74,85 @@ genPkgDbName( const Fingerprint &           fingerprint,
 }
 
 
+/* -------------------------------------------------------------------------- */
+
+/** Zstandard frame magic marking a compressed stored description.
+ * These bytes cannot begin a valid UTF-8 string, so plain text rows are
+ * always distinguishable from compressed ones. */
+static constexpr std::string_view ZSTD_MAGIC = "\x28\xb5\x2f\xfd";
+
+/** Descriptions shorter than this are stored as plain text since the `zstd`
+ * frame overhead would outweigh any savings. */
+static constexpr std::size_t COMPRESS_DESCRIPTION_MIN_SIZE = 96;
+
+
+std::string
+compressDescription( const std::string & description )
+{
+  if ( ( description.size() < COMPRESS_DESCRIPTION_MIN_SIZE )
+       || ( description.compare( 0, ZSTD_MAGIC.size(), ZSTD_MAGIC ) == 0 ) )
+    {
+      return description;
+    }
+  std::string compressed = nix::compress( "zstd", description );
+  /* Incompressible text ( rare at this size ) is stored as-is. */
+  if ( description.size() <= compressed.size() ) { return description; }
+  return compressed;
+}
+
+
+std::string
+decompressDescription( const std::string & stored )
+{
+  if ( ( stored.size() < ZSTD_MAGIC.size() )
+       || ( stored.compare( 0, ZSTD_MAGIC.size(), ZSTD_MAGIC ) != 0 ) )
+    {
+      return stored;
+    }
+  return nix::decompress( "zstd", stored );
+}
+
+
+std::string
+getStoredDescription( const sqlite3pp::query::rows & row, int col )
+{
+  const auto * data = static_cast<const char *>( row.get<const void *>( col ) );
+  if ( data == nullptr ) { return {}; }
+  return { data, static_cast<std::size_t>( row.column_bytes( col ) ) };
+}
+
+
+std::shared_ptr<void>
+registerSqlFunctions( SQLiteDb & pdb )
+{
+  /* The handler table lives inside the `ext::function' object, so it must
+   * outlive any statement that may call a registered function. */
+  auto funcs = std::make_shared<sqlite3pp::ext::function>( pdb );
+  /* Read the argument with its explicit length: stored frames contain NUL
+   * bytes, which the typed `create' wrapper's C-string conversion would
+   * truncate mid-frame. */
+  funcs->create(
+    "uncompress_description",
+    []( sqlite3pp::ext::context & ctx )
+    {
+      const auto * data
+        = static_cast<const char *>( ctx.get<const void *>( 0 ) );
+      if ( data == nullptr )
+        { /* `NULL' in, `NULL' out. */
+          ctx.result( static_cast<const char *>( nullptr ) );
+          return;
+        }
+      ctx.result( decompressDescription(
+        std::string( data,
+                     static_cast<std::size_t>( ctx.args_bytes( 0 ) ) ) ) );
+    },
+    1 );
+  funcs->create<std::string( std::string )>( "version_sort_key",
+                                             &versions::versionSortKey );
+  return funcs;
+}
+
+
 /* -------------------------------------------------------------------------- */
 
 void
@@ -77,7 +163,9 @@ PkgDbReadOnly::init()
       throw NoSuchDatabase( *this );
     }
   this->connect();
-  this->loadLockedFlake();
+  /* `LockedFlake' metadata is loaded lazily on first access; queries which
+   * only touch `Packages' never read it, and skipping the JSON parse here
+   * trims per-open work across the many opens a federated search performs. */
 }
 
 
@@ -88,6 +176,70 @@ PkgDbReadOnly::connect()
 {
   this->db.connect( this->dbPath.string().c_str(), SQLITE_OPEN_READONLY );
   this->db.set_busy_timeout( DB_BUSY_TIMEOUT );
+  /* Memory-map the database so page reads hit the page cache instead of
+   * copying through SQLite's heap, and give repeated queries within one
+   * invocation a larger page cache.
+   * Both pragmas are per-connection and harmless on databases smaller than
+   * the limits. */
+  this->db.execute(
+    nix::fmt( "PRAGMA mmap_size = %lld", DB_MMAP_SIZE ).c_str() );
+  this->db.execute(
+    nix::fmt( "PRAGMA cache_size = -%d", DB_CACHE_SIZE_KIB ).c_str() );
+  this->sqlFunctions = registerSqlFunctions( this->db );
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+/* Connections are pooled per-path for the life of the process so that
+ * search and resolution reuse a single connection ( and its page cache )
+ * instead of re-opening the same fingerprint database repeatedly.
+ * Weak references let an unused connection close once every handle to it
+ * is dropped; long-lived serving modes opt into retention so handles stay
+ * warm between commands. */
+static std::mutex dbPoolLock;
+static std::unordered_map<std::string, std::weak_ptr<PkgDbReadOnly>> dbPool;
+static bool dbPoolRetain = false;
+static std::unordered_map<std::string, std::shared_ptr<PkgDbReadOnly>>
+  dbPoolRetained;
+
+
+void
+setDbHandleRetention( bool retain )
+{
+  const std::lock_guard<std::mutex> guard( dbPoolLock );
+  dbPoolRetain = retain;
+  if ( ! retain ) { dbPoolRetained.clear(); }
+}
+
+
+std::shared_ptr<PkgDbReadOnly>
+openPkgDbReadOnly( const std::string & dbPath )
+{
+  const std::lock_guard<std::mutex> guard( dbPoolLock );
+  if ( auto entry = dbPool.find( dbPath ); entry != dbPool.end() )
+    {
+      if ( auto pdb = entry->second.lock() ) { return pdb; }
+    }
+  auto pdb       = std::make_shared<PkgDbReadOnly>( dbPath );
+  dbPool[dbPath] = pdb;
+  if ( dbPoolRetain ) { dbPoolRetained[dbPath] = pdb; }
+  return pdb;
+}
+
+
+std::shared_ptr<PkgDbReadOnly>
+openPkgDbReadOnly( const Fingerprint & fingerprint, const std::string & dbPath )
+{
+  auto pdb = openPkgDbReadOnly( dbPath );
+  if ( pdb->getFingerprint() != fingerprint )
+    {
+      throw PkgDbException(
+        nix::fmt( "database '%s' fingerprint does not match expected '%s'",
+                  dbPath,
+                  fingerprint.to_string( nix::Base16, false ) ) );
+    }
+  return pdb;
 }
 
 
@@ -119,6 +271,7 @@ PkgDbReadOnly::loadLockedFlake()
                   fingerprintStr,
                   this->fingerprint.to_string( nix::Base16, false ) ) );
     }
+  this->lockedFlakeLoaded = true;
 }
 
 
@@ -126,6 +279,32 @@ PkgDbReadOnly::loadLockedFlake()
 
 SqlVersions
 PkgDbReadOnly::getDbVersion()
+{
+  /* `PkgDb::init' mirrors the schema versions into SQLite's native header
+   * fields, so most opens answer from the file header without a table
+   * lookup or string parsing.  The `application_id' check keeps us off the
+   * pragma for databases created before the mirror existed. */
+  sqlite3pp::query appIdQry( this->db, "PRAGMA application_id" );
+  if ( ( *appIdQry.begin() ).get<int>( 0 ) == pkgDbApplicationId )
+    {
+      sqlite3pp::query versionQry( this->db, "PRAGMA user_version" );
+      auto encoded = ( *versionQry.begin() ).get<long long>( 0 );
+      if ( encoded != 0 )
+        {
+          return SqlVersions {
+            .tables = static_cast<unsigned>( ( encoded >> 16 ) & 0xFFFF ),
+            .views  = static_cast<unsigned>( encoded & 0xFFFF )
+          };
+        }
+    }
+  return this->getDbVersionFromTable();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+SqlVersions
+PkgDbReadOnly::getDbVersionFromTable()
 {
   sqlite3pp::query qry(
     this->db,
@@ -223,7 +402,7 @@ PkgDbReadOnly::getDescription( row_id descriptionId )
       throw PkgDbException(
         nix::fmt( "No such Descriptions.id %llu.", descriptionId ) );
     }
-  return ( *itr ).get<std::string>( 0 );
+  return decompressDescription( getStoredDescription( *itr, 0 ) );
 }
 
 
@@ -232,11 +411,8 @@ PkgDbReadOnly::getDescription( row_id descriptionId )
 bool
 PkgDbReadOnly::hasPackage( const flox::AttrPath & path )
 {
-  flox::AttrPath parent;
-  for ( size_t idx = 0; idx < ( path.size() - 1 ); ++idx )
-    {
-      parent.emplace_back( path[idx] );
-    }
+  /* The parent prefix is only queried, so borrow it rather than copy it. */
+  flox::AttrPathView parent( path.begin(), path.end() - 1 );
 
   /* Make sure there are actually packages in the set. */
   row_id           row = this->getAttrSetId( parent );
@@ -280,28 +456,57 @@ PkgDbReadOnly::getAttrSetId( const flox::AttrPath & path )
 
 /* -------------------------------------------------------------------------- */
 
-flox::AttrPath
-PkgDbReadOnly::getAttrSetPath( row_id row )
+row_id
+PkgDbReadOnly::getAttrSetId( const flox::AttrPathView & path )
 {
-  if ( row == 0 ) { return {}; }
-  std::list<std::string> path;
-  while ( row != 0 )
+  /* Lookup the `AttrName.id' ( if one exists ) */
+  row_id row = 0;
+  for ( const auto & part : path )
     {
-      sqlite3pp::query qry(
+      sqlite3pp::query qryId(
         this->db,
-        "SELECT parent, attrName FROM AttrSets WHERE ( id = ? )" );
-      qry.bind( 1, static_cast<long long>( row ) );
-      auto itr = qry.begin();
+        "SELECT id FROM AttrSets "
+        "WHERE ( attrName = ? ) AND ( parent = ? ) LIMIT 1" );
+      /* Short components land in the small-string buffer. */
+      qryId.bind( 1, std::string( part ), sqlite3pp::copy );
+      qryId.bind( 2, static_cast<long long>( row ) );
+      auto itr = qryId.begin();
       /* Handle no such path. */
-      if ( itr == qry.end() )
+      if ( itr == qryId.end() )
         {
-          throw PkgDbException( nix::fmt( "No such 'AttrSet.id' %llu.", row ) );
+          flox::AttrPath owned( path.begin(), path.end() );
+          throw PkgDbException(
+            nix::fmt( "No such AttrSet '%s'.",
+                      concatStringsSep( ".", owned ) ) );
         }
       row = ( *itr ).get<long long>( 0 );
-      path.push_front( ( *itr ).get<std::string>( 1 ) );
     }
-  return flox::AttrPath { std::make_move_iterator( std::begin( path ) ),
-                          std::make_move_iterator( std::end( path ) ) };
+
+  return row;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+flox::AttrPath
+PkgDbReadOnly::getAttrSetPath( row_id row )
+{
+  if ( row == 0 ) { return {}; }
+  /* A single indexed join over the closure table reconstructs the full path
+   * without stepping the parent chain one row at a time. */
+  sqlite3pp::query qry( this->db,
+                        "SELECT attrName FROM AttrSetClosure "
+                        "INNER JOIN AttrSets ON ( AttrSets.id = ancestor ) "
+                        "WHERE ( descendant = ? ) ORDER BY depth DESC" );
+  qry.bind( 1, static_cast<long long>( row ) );
+  flox::AttrPath path;
+  for ( auto itr : qry ) { path.emplace_back( itr.get<std::string>( 0 ) ); }
+  /* Handle no such path. */
+  if ( path.empty() )
+    {
+      throw PkgDbException( nix::fmt( "No such 'AttrSet.id' %llu.", row ) );
+    }
+  return path;
 }
 
 
@@ -338,9 +543,9 @@ flox::AttrPath
 PkgDbReadOnly::getPackagePath( row_id row )
 {
   if ( row == 0 ) { return {}; }
-  sqlite3pp::query qry(
-    this->db,
-    "SELECT parentId, attrName FROM Packages WHERE ( id = ? )" );
+  /* The full path is materialized on the row itself. */
+  sqlite3pp::query qry( this->db,
+                        "SELECT fullPath FROM Packages WHERE ( id = ? )" );
   qry.bind( 1, static_cast<long long>( row ) );
   auto itr = qry.begin();
   /* Handle no such path. */
@@ -348,9 +553,8 @@ PkgDbReadOnly::getPackagePath( row_id row )
     {
       throw PkgDbException( nix::fmt( "No such 'Packages.id' %llu.", row ) );
     }
-  flox::AttrPath path = this->getAttrSetPath( ( *itr ).get<long long>( 0 ) );
-  path.emplace_back( ( *itr ).get<std::string>( 1 ) );
-  return path;
+  return nlohmann::json::parse( ( *itr ).get<std::string>( 0 ) )
+    .get<flox::AttrPath>();
 }
 
 
@@ -363,6 +567,15 @@ PkgDbReadOnly::getPackages( const PkgQueryArgs & params )
 }
 
 
+/* -------------------------------------------------------------------------- */
+
+std::vector<std::optional<row_id>>
+PkgDbReadOnly::queryMany( const std::vector<PkgQueryArgs> & argsList )
+{
+  return PkgQuery::executeMany( this->db, argsList );
+}
+
+
 /* -------------------------------------------------------------------------- */
 
 nlohmann::json
@@ -373,7 +586,7 @@ PkgDbReadOnly::getPackage( row_id row )
         'id',          Packages.id
       , 'pname',       pname
       , 'version',     version
-      , 'description', Descriptions.description
+      , 'description', uncompress_description( Descriptions.description )
       , 'license',     license
       , 'broken',      CASE WHEN broken IS NULL THEN json( 'null' )
                             WHEN broken         THEN json( 'true' )
@@ -412,6 +625,56 @@ PkgDbReadOnly::getPackage( const flox::AttrPath & path )
 }
 
 
+/* -------------------------------------------------------------------------- */
+
+void
+PkgDbReadOnly::streamPackages( std::ostream &                        out,
+                               const std::optional<flox::AttrPath> & prefix )
+{
+  /* Each row is serialized to JSON inside SQLite and written as soon as it
+   * comes off the cursor, so memory usage is constant regardless of result
+   * size.  Attribute paths come off the materialized `fullPath' column. */
+  std::string sql = R"SQL(
+      SELECT json_object(
+        'id',          Packages.id
+      , 'pname',       pname
+      , 'version',     version
+      , 'description', uncompress_description( Descriptions.description )
+      , 'license',     license
+      , 'broken',      CASE WHEN broken IS NULL THEN json( 'null' )
+                            WHEN broken         THEN json( 'true' )
+                                                ELSE json( 'false' )
+                       END
+      , 'unfree',      CASE WHEN unfree IS NULL THEN json( 'null' )
+                            WHEN unfree         THEN json( 'true' )
+                                                ELSE json( 'false' )
+                       END
+      , 'absPath',     json( fullPath )
+      , 'subtree',     json_extract( fullPath, '$[0]' )
+      , 'system',      json_extract( fullPath, '$[1]' )
+      , 'relPath',     json( relPath )
+      ) AS json
+      FROM Packages
+           LEFT JOIN Descriptions ON ( descriptionId = Descriptions.id )
+    )SQL";
+  if ( prefix.has_value() )
+    {
+      sql += "      WHERE Packages.parentId IN "
+             "( SELECT descendant FROM AttrSetClosure WHERE ancestor = ? )\n";
+    }
+  sql += "      ORDER BY Packages.id";
+
+  sqlite3pp::query qry( this->db, sql.c_str() );
+  if ( prefix.has_value() )
+    {
+      qry.bind( 1, static_cast<long long>( this->getAttrSetId( *prefix ) ) );
+    }
+
+  for ( const auto & row : qry ) { out << row.get<std::string>( 0 ) << '\n'; }
+  out.flush();
+}
+
+
 /* -------------------------------------------------------------------------- */
 
 }  // namespace flox::pkgdb
@@ -64,16 +64,90 @@ CREATE TRIGGER IF NOT EXISTS IT_AttrSets AFTER INSERT ON AttrSets
     )
   BEGIN
     SELECT RAISE( ABORT, 'No such AttrSets.id for parent.' );
-  END
+  END;
+
+-- Transitive closure over the `AttrSets` parent chain.
+-- Every set is its own ancestor at depth 0, so subtree selection and
+-- full-path reconstruction become single indexed joins instead of
+-- recursive CTEs.  Rows are maintained by the insert trigger below;
+-- `AttrSets` rows are never reparented or deleted.
+CREATE TABLE IF NOT EXISTS AttrSetClosure (
+  ancestor    INTEGER NOT NULL
+, descendant  INTEGER NOT NULL
+, depth       INTEGER NOT NULL
+, PRIMARY KEY ( ancestor, descendant )
+);
+
+CREATE INDEX IF NOT EXISTS idx_AttrSetClosureDescendant
+  ON AttrSetClosure ( descendant, depth );
+
+CREATE TRIGGER IF NOT EXISTS trg_attrSetClosureInsert
+AFTER INSERT ON AttrSets BEGIN
+  INSERT INTO AttrSetClosure ( ancestor, descendant, depth )
+  VALUES ( new.id, new.id, 0 );
+  INSERT INTO AttrSetClosure ( ancestor, descendant, depth )
+  SELECT ancestor, new.id, ( depth + 1 ) FROM AttrSetClosure
+  WHERE ( descendant = new.parent );
+END
+)SQL";
+
+
+/* -------------------------------------------------------------------------- */
+
+/* Tracks per-page scrape progress so an interrupted scrape resumes past
+ * finished work instead of re-evaluating it. */
+static const char * sql_scrapeProgress = R"SQL(
+CREATE TABLE IF NOT EXISTS ScrapeProgress (
+  attrSetId  INTEGER NOT NULL
+, pageIdx    INTEGER NOT NULL
+, doneCount  INTEGER NOT NULL DEFAULT 0
+, PRIMARY KEY ( attrSetId, pageIdx )
+)
+)SQL";
+
+
+/* -------------------------------------------------------------------------- */
+
+/* Memoizes attributes that threw a `nix::EvalError' so later scrapes skip
+ * them instead of repeating the eval; failures run all the way to the throw
+ * point, making them the most expensive attributes to revisit.
+ * The database is keyed by the flake fingerprint, so rows never outlive the
+ * revision ( and eval cache ) that produced them.
+ * Cleared for a subtree by `pkgdb scrape --force'. */
+static const char * sql_evalFailures = R"SQL(
+CREATE TABLE IF NOT EXISTS EvalFailures (
+  parentId  INTEGER        NOT NULL
+, attrName  VARCHAR( 255 ) NOT NULL
+, errorMsg  TEXT
+, PRIMARY KEY ( parentId, attrName )
+)
+)SQL";
+
+
+/* -------------------------------------------------------------------------- */
+
+/* Pre-aggregated per-prefix statistics, refreshed when a prefix is marked
+ * done so dashboards and planner hints read one small row instead of
+ * re-counting `Packages` through `AttrSetClosure`. */
+static const char * sql_stats = R"SQL(
+CREATE TABLE IF NOT EXISTS Stats (
+  prefix     INTEGER PRIMARY KEY REFERENCES AttrSets ( id )
+, pkgCount   INTEGER NOT NULL DEFAULT 0
+, rowBytes   INTEGER NOT NULL DEFAULT 0
+, scrapeMs   INTEGER
+, scrapedAt  INTEGER
+)
 )SQL";
 
 
 /* -------------------------------------------------------------------------- */
 
 static const char * sql_packages = R"SQL(
+-- `description' is declared ( and bound ) as a BLOB: long descriptions are
+-- stored as `zstd' frames, whose bytes may include NUL.
 CREATE TABLE IF NOT EXISTS Descriptions (
   id           INTEGER PRIMARY KEY
-, description  TEXT    NOT NULL UNIQUE
+, description  BLOB    NOT NULL UNIQUE
 );
 
 CREATE UNIQUE INDEX IF NOT EXISTS idx_Descriptions
@@ -83,23 +157,112 @@ CREATE TABLE IF NOT EXISTS Packages (
   id                INTEGER PRIMARY KEY
 , parentId          INTEGER        NOT NULL
 , attrName          VARCHAR( 255 ) NOT NULL
+-- Generated so every write path ( and raw test inserts ) stays in sync;
+-- the indexes below are what case-insensitive exact matching hits.
+, attrNameLower     VARCHAR( 255 )
+    GENERATED ALWAYS AS ( LOWER( attrName ) ) VIRTUAL
 , name              VARCHAR( 255 ) NOT NULL
 , pname             VARCHAR( 255 )
+, pnameLower        VARCHAR( 255 )
+    GENERATED ALWAYS AS ( LOWER( pname ) ) VIRTUAL
 , version           VARCHAR( 127 )
 , semver            VARCHAR( 127 )
+, major             INTEGER
+, minor             INTEGER
+, patch             INTEGER
+, preTag            VARCHAR( 127 )
 , license           VARCHAR( 255 )
 , outputs           JSON           NOT NULL
 , outputsToInstall  JSON
 , broken            BOOL
 , unfree            BOOL
 , descriptionId     INTEGER
+-- Optional precomputed popularity rank ( lower is more popular ), loaded
+-- from an external dataset by `pkgdb load-ranks`; `NULL` means unranked.
+, popularityRank    INTEGER
+-- Full attribute path as a JSON list, materialized by the insert trigger
+-- below so emitting a result row never walks the `AttrSets` parent chain.
+, fullPath          JSON
+, relPath           JSON
+    GENERATED ALWAYS AS ( json_remove( fullPath, '$[1]', '$[0]' ) ) VIRTUAL
 , FOREIGN KEY ( parentId      ) REFERENCES AttrSets  ( id )
 , FOREIGN KEY ( descriptionId ) REFERENCES Descriptions ( id     )
 , CONSTRAINT UC_Packages UNIQUE ( parentId, attrName )
 );
 
 CREATE UNIQUE INDEX IF NOT EXISTS idx_Packages
-  ON Packages ( parentId, attrName )
+  ON Packages ( parentId, attrName );
+
+CREATE INDEX IF NOT EXISTS idx_PackagesRelPath
+  ON Packages ( relPath );
+
+-- Every write path ( scrape inserts, seed copies, shard absorption ) funnels
+-- through a plain `INSERT`, so a single trigger keeps `fullPath` correct;
+-- parent paths come from one indexed `AttrSetClosure` join rather than a
+-- recursive view.
+CREATE TRIGGER IF NOT EXISTS trg_packagesFullPath
+AFTER INSERT ON Packages BEGIN
+  UPDATE Packages
+  SET fullPath
+    = json_insert(
+        ( SELECT json_group_array( attrName )
+          FROM ( SELECT A.attrName
+                 FROM AttrSetClosure C
+                      JOIN AttrSets A ON ( A.id = C.ancestor )
+                 WHERE ( C.descendant = new.parentId )
+                 ORDER BY C.depth DESC ) )
+      , '$[#]', new.attrName )
+  WHERE id = new.id;
+END;
+
+CREATE INDEX IF NOT EXISTS idx_PackagesSemver
+  ON Packages ( major, minor, patch );
+
+CREATE INDEX IF NOT EXISTS idx_PackagesPnameLower
+  ON Packages ( pnameLower );
+
+CREATE INDEX IF NOT EXISTS idx_PackagesAttrNameLower
+  ON Packages ( attrNameLower )
+)SQL";
+
+
+/* -------------------------------------------------------------------------- */
+
+/* A trigram full-text index over the fields targeted by partial matching.
+ * `PkgQuery' uses it to narrow candidate rows before its `LIKE' ranking
+ * columns run, turning full scans of `v_PackagesSearch' into index lookups.
+ * Rows use `Packages.id' as their `rowid' and are maintained by triggers;
+ * the insert trigger deletes first so `INSERT OR REPLACE' on `Packages'
+ * stays in sync without recursive triggers. */
+static const char * sql_fts = R"SQL(
+CREATE VIRTUAL TABLE IF NOT EXISTS fts_Packages USING fts5(
+  pname, attrName, description, tokenize = 'trigram'
+);
+
+CREATE TRIGGER IF NOT EXISTS trg_ftsPackagesInsert
+AFTER INSERT ON Packages BEGIN
+  DELETE FROM fts_Packages WHERE rowid = new.id;
+  INSERT INTO fts_Packages ( rowid, pname, attrName, description )
+  VALUES ( new.id, new.pname, new.attrName
+         , ( SELECT uncompress_description( description )
+             FROM Descriptions WHERE id = new.descriptionId ) );
+END;
+
+-- Scoped to the indexed columns so the `fullPath` materialization trigger's
+-- `UPDATE` does not churn the full-text index.
+CREATE TRIGGER IF NOT EXISTS trg_ftsPackagesUpdate
+AFTER UPDATE OF pname, attrName, descriptionId ON Packages BEGIN
+  DELETE FROM fts_Packages WHERE rowid = old.id;
+  INSERT INTO fts_Packages ( rowid, pname, attrName, description )
+  VALUES ( new.id, new.pname, new.attrName
+         , ( SELECT uncompress_description( description )
+             FROM Descriptions WHERE id = new.descriptionId ) );
+END;
+
+CREATE TRIGGER IF NOT EXISTS trg_ftsPackagesDelete
+AFTER DELETE ON Packages BEGIN
+  DELETE FROM fts_Packages WHERE rowid = old.id;
+END
 )SQL";
 
 
@@ -125,34 +288,6 @@ CREATE VIEW IF NOT EXISTS v_AttrPaths AS
   ) SELECT * FROM Tree;
 
 
--- Splits semvers into their major, minor, patch, and pre-release tags.
-CREATE VIEW IF NOT EXISTS v_Semvers AS SELECT
-  semver
-, major
-, minor
-, CASE WHEN ( length( mPatch ) < 1 ) THEN rest ELSE mPatch END AS patch
-, CASE WHEN ( length( mPatch ) < 1 ) THEN NULL ELSE rest END   AS preTag
-FROM (
-  SELECT semver
-       , major
-       , minor
-       , ( substr( rest, 0, instr( rest, '-' ) ) )  AS mPatch
-       , ( substr( rest, instr( rest, '-' ) + 1 ) ) AS rest
-  FROM (
-    SELECT semver
-         , major
-         , ( substr( rest, 0, instr( rest, '.' ) ) )  AS minor
-         , ( substr( rest, instr( rest, '.' ) + 1 ) ) AS rest
-    FROM (
-      SELECT semver
-           , ( substr( semver, 0, instr( semver, '.' ) ) )  AS major
-           , ( substr( semver, instr( semver, '.' ) + 1 ) ) AS rest
-      FROM ( SELECT DISTINCT semver FROM Packages )
-    )
-  )
-) ORDER BY major, minor, patch, preTag DESC NULLS FIRST;
-
-
 -- Supplies additional version information identifying _date_ versions,
 -- and categorizes versions into _types_.
 CREATE VIEW IF NOT EXISTS v_PackagesVersions AS SELECT
@@ -168,42 +303,45 @@ CREATE VIEW IF NOT EXISTS v_PackagesVersions AS SELECT
        WHEN ( SELECT Packages.version = date( Packages.version ) ) THEN 1
                                                                    ELSE 2
   END AS versionType
-FROM Packages
-LEFT OUTER JOIN v_Semvers ON ( Packages.semver = v_Semvers.semver );
+FROM Packages;
 
 
 -- Additional information about the _attribute path_ for a `Packages` row.
+-- Reads the materialized `Packages.fullPath` column; the recursive
+-- `v_AttrPaths` view is kept only for ad-hoc queries against `AttrSets`.
 CREATE VIEW IF NOT EXISTS v_PackagesPaths AS SELECT
   Packages.id
-, json_insert( v_AttrPaths.path, '$[#]', Packages.attrName ) AS path
-, json_insert( json_remove( v_AttrPaths.path, '$[1]', '$[0]' )
-             , '$[#]'
-             , Packages.attrName
-             ) AS relPath
-, ( json_array_length( v_AttrPaths.path ) + 1 ) AS depth
+, Packages.fullPath                        AS path
+, Packages.relPath                         AS relPath
+, json_array_length( Packages.fullPath )   AS depth
 , Packages.attrName AS attrName
-FROM Packages INNER JOIN v_AttrPaths ON ( Packages.parentId = v_AttrPaths.id );
+FROM Packages;
 
 
 -- Aggregates columns used for searching packages.
+-- Path fields come straight off `Packages.fullPath`, so no recursive view
+-- or `AttrSets` join sits on the search path.
 CREATE VIEW IF NOT EXISTS v_PackagesSearch AS SELECT
   Packages.id
-, v_AttrPaths.subtree
-, v_AttrPaths.system
-, v_PackagesPaths.path
-, v_PackagesPaths.relPath
-, v_PackagesPaths.depth
+, json_extract( Packages.fullPath, '$[0]' ) AS subtree
+, json_extract( Packages.fullPath, '$[1]' ) AS system
+, Packages.fullPath                         AS path
+, Packages.relPath
+, json_array_length( Packages.fullPath )    AS depth
 , Packages.name
 , Packages.attrName
+, Packages.attrNameLower
 , Packages.pname
-, v_PackagesPaths.attrName
+, Packages.pnameLower
 , Packages.version
 , v_PackagesVersions.versionDate
 , Packages.semver
-, v_Semvers.major
-, v_Semvers.minor
-, v_Semvers.patch
-, v_Semvers.preTag
+-- Pre-parsed at scrape time so range constraints and version ordering
+-- compare integers rather than re-splitting strings per query.
+, Packages.major
+, Packages.minor
+, Packages.patch
+, Packages.preTag
 , v_PackagesVersions.versionType
 , Packages.license
 , Packages.broken
@@ -216,12 +354,10 @@ CREATE VIEW IF NOT EXISTS v_PackagesSearch AS SELECT
        WHEN unfree         THEN 2
                            ELSE 0
   END AS unfreeRank
-, Descriptions.description
+, Packages.popularityRank
+, uncompress_description( Descriptions.description ) AS description
 FROM Packages
 LEFT OUTER JOIN Descriptions ON ( Packages.descriptionId = Descriptions.id )
-LEFT OUTER JOIN v_Semvers    ON ( Packages.semver = v_Semvers.semver )
-     INNER JOIN v_AttrPaths        ON ( Packages.parentId = v_AttrPaths.id )
-     INNER JOIN v_PackagesPaths    ON ( Packages.id = v_PackagesPaths.id )
      INNER JOIN v_PackagesVersions ON ( Packages.id = v_PackagesVersions.id )
 )SQL";
 
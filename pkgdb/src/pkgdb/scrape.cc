@@ -9,7 +9,10 @@
 
 #include <iostream>
 
+#include <nix/util.hh>
+
 #include "flox/pkgdb/command.hh"
+#include "flox/pkgdb/snapshot.hh"
 
 
 /* -------------------------------------------------------------------------- */
@@ -27,6 +30,50 @@ ScrapeCommand::ScrapeCommand() : parser( "scrape" )
     .help( "force re-evaluation of flake" )
     .nargs( 0 )
     .action( [&]( const auto & ) { this->force = true; } );
+  this->parser.add_argument( "--progress-json" )
+    .help( "emit newline-delimited JSON progress events to STDERR" )
+    .nargs( 0 )
+    .action(
+      [&]( const auto & )
+      {
+        setProgressJsonEnabled( true );
+        /* Forked scrape workers read the environment on startup. */
+        setenv( "PKGDB_PROGRESS_JSON", "1", 1 );
+      } );
+  this->parser.add_argument( "--shard" )
+    .help( "only scrape shard K of N ( `K/N', 1-based ) of attribute pages" )
+    .metavar( "K/N" )
+    .nargs( 1 )
+    .action(
+      [&]( const std::string & shard )
+      {
+        unsigned    index = 0;
+        unsigned    count = 0;
+        std::size_t slash = shard.find( '/' );
+        try
+          {
+            if ( slash == std::string::npos )
+              {
+                throw std::invalid_argument( shard );
+              }
+            index = std::stoul( shard.substr( 0, slash ) );
+            count = std::stoul( shard.substr( slash + 1 ) );
+          }
+        catch ( const std::exception & )
+          {
+            throw command::InvalidArgException(
+              nix::fmt( "invalid '--shard' value '%s', expected 'K/N'",
+                        shard ) );
+          }
+        if ( ( index < 1 ) || ( count < index ) )
+          {
+            throw command::InvalidArgException(
+              nix::fmt( "invalid '--shard' value '%s', "
+                        "expected '1 <= K <= N'",
+                        shard ) );
+          }
+        setScrapeShard( index - 1, count );
+      } );
   this->addDatabasePathOption( this->parser );
   this->addFlakeRefArg( this->parser );
   this->addAttrPathArgs( this->parser );
@@ -65,16 +112,41 @@ ScrapeCommand::run()
   assert( this->input.has_value() );
 
   /* If `--force' was given, clear the `done' fields for the prefix and its
-   * descendants to force them to re-evaluate. */
+   * descendants to force them to re-evaluate, and drop the eval-failure
+   * memo so known-broken attributes get a fresh chance. */
   if ( this->force )
     {
       this->input->getDbReadWrite()->setPrefixDone( this->attrPath, false );
+      this->input->getDbReadWrite()->clearEvalFailures( this->attrPath );
       this->input->closeDbReadWrite();
     }
 
   /* scrape it up! */
   this->input->scrapePrefix( this->attrPath );
 
+  /* Optionally load popularity ranks for search ordering; re-scrapes reset
+   * `Packages` rows so the dataset is applied while the database is fresh. */
+  std::optional<std::string> ranksEnv = nix::getEnv( "PKGDB_RANKS" );
+  if ( ranksEnv.has_value() && ( ! ranksEnv->empty() ) )
+    {
+      this->input->getDbReadWrite()->loadPopularityRanks( *ranksEnv );
+    }
+
+  /* Refresh planner statistics so readers plan against real table shapes. */
+  this->input->getDbReadWrite()->analyze();
+  this->input->closeDbReadWrite();
+
+  /* Offer the result to the host-wide cache ( no-op unless
+   * `PKGDB_SHARED_CACHEDIR' is configured and writable ). */
+  publishSharedDb( this->input->getDbPath() );
+
+  /* Optionally freeze a snapshot for instant exact-name searches. */
+  std::optional<std::string> snapshotEnv = nix::getEnv( "PKGDB_SNAPSHOT" );
+  if ( snapshotEnv.has_value() && ( *snapshotEnv != "0" ) )
+    {
+      writeDbSnapshot( this->input->getDbPath() );
+    }
+
   /* Print path to database. */
   std::cout << nlohmann::json(
                  { { "database-path",
@@ -0,0 +1,438 @@
+/* ========================================================================== *
+ *
+ * @file pkgdb/snapshot.cc
+ *
+ * @brief Frozen read-only snapshots of package databases.
+ *
+ *
+ * -------------------------------------------------------------------------- */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <map>
+#include <string_view>
+#include <sys/mman.h>
+#include <tuple>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <nix/fmt.hh>
+#include <sqlite3pp.hh>
+
+#include "flox/core/exceptions.hh"
+#include "flox/pkgdb/read.hh"
+#include "flox/pkgdb/snapshot.hh"
+
+
+/* -------------------------------------------------------------------------- */
+
+namespace flox::pkgdb {
+
+/* -------------------------------------------------------------------------- */
+
+/* File layout: header, aux string table ( subtree/system names ), key index
+ * sorted by hash, record table, then raw bytes ( keys and JSON ).
+ * All integers are native-endian; snapshots are per-machine cache artifacts
+ * and are never copied between hosts. */
+
+static constexpr char     snapshotMagic[8] = { 'F', 'L', 'O', 'X',
+                                               'S', 'N', 'A', 'P' };
+static constexpr uint32_t snapshotVersion  = 1;
+
+enum snapshot_key_kind : uint32_t {
+  SK_PNAME    = 0,
+  SK_ATTRNAME = 1,
+  SK_NAME     = 2
+};
+
+struct SnapshotHeader
+{
+  char     magic[8];
+  uint32_t version;
+  uint32_t nAux;
+  uint64_t nKeys;
+  uint64_t nRecords;
+  uint64_t auxOff;
+  uint64_t keysOff;
+  uint64_t recordsOff;
+  uint64_t blobOff;
+}; /* End struct `SnapshotHeader' */
+
+struct SnapshotAux
+{
+  uint64_t off;
+  uint32_t len;
+  uint32_t pad;
+}; /* End struct `SnapshotAux' */
+
+struct SnapshotKey
+{
+  uint64_t hash;
+  uint64_t keyOff;
+  uint32_t keyLen;
+  uint32_t record;
+  uint32_t kind;
+  uint32_t pad;
+}; /* End struct `SnapshotKey' */
+
+struct SnapshotRecord
+{
+  uint64_t jsonOff;
+  uint32_t jsonLen;
+  uint8_t  subtreeAux;
+  uint8_t  systemAux;
+  /* 0 = false, 1 = NULL, 2 = true; mirrors `brokenRank'/`unfreeRank'. */
+  uint8_t brokenRank;
+  uint8_t unfreeRank;
+}; /* End struct `SnapshotRecord' */
+
+
+/* -------------------------------------------------------------------------- */
+
+/** @brief FNV-1a; stable, fast, and good enough for a verified index. */
+static uint64_t
+hashKey( std::string_view key )
+{
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for ( unsigned char chr : key )
+    {
+      hash ^= chr;
+      hash *= 0x100000001b3ULL;
+    }
+  return hash;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+std::filesystem::path
+genDbSnapshotName( const std::filesystem::path & dbPath )
+{
+  return std::filesystem::path( dbPath.string() + ".snapshot" );
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void
+writeDbSnapshot( const std::filesystem::path & dbPath )
+{
+  auto pdb = openPkgDbReadOnly( dbPath.string() );
+
+  std::vector<SnapshotRecord> records;
+  std::vector<SnapshotKey>    keys;
+  std::vector<std::string>    auxStrings;
+  std::string                 blob;
+
+  auto internAux = [&]( const std::string & str ) -> uint8_t
+  {
+    for ( size_t idx = 0; idx < auxStrings.size(); ++idx )
+      {
+        if ( auxStrings[idx] == str )
+          {
+            return static_cast<uint8_t>( idx );
+          }
+      }
+    auxStrings.push_back( str );
+    return static_cast<uint8_t>( auxStrings.size() - 1 );
+  };
+
+  auto internKey = [&]( const std::string & key, uint32_t kind )
+  {
+    keys.push_back( SnapshotKey { hashKey( key ),
+                                  blob.size(),
+                                  static_cast<uint32_t>( key.size() ),
+                                  static_cast<uint32_t>( records.size() ),
+                                  kind,
+                                  0 } );
+    blob.append( key );
+  };
+
+  /* Records are emitted in the order exact-name searches want them back:
+   * grouped by `pname', working rows first, newest versions first. */
+  sqlite3pp::query qry( pdb->db, R"SQL(
+    SELECT id, name, attrName, pname, subtree, system
+         , brokenRank, unfreeRank
+    FROM v_PackagesSearch
+    ORDER BY pname, brokenRank
+           , CASE WHEN version IS NULL THEN NULL
+                  ELSE version_sort_key( version )
+             END DESC
+  )SQL" );
+  for ( const auto & row : qry )
+    {
+      internKey( row.get<std::string>( 3 ), SK_PNAME );
+      internKey( row.get<std::string>( 2 ), SK_ATTRNAME );
+      internKey( row.get<std::string>( 1 ), SK_NAME );
+
+      std::string json
+        = pdb->getPackage( static_cast<row_id>( row.get<long long>( 0 ) ) )
+            .dump();
+      records.push_back(
+        SnapshotRecord { blob.size(),
+                         static_cast<uint32_t>( json.size() ),
+                         internAux( row.get<std::string>( 4 ) ),
+                         internAux( row.get<std::string>( 5 ) ),
+                         static_cast<uint8_t>( row.get<int>( 6 ) ),
+                         static_cast<uint8_t>( row.get<int>( 7 ) ) } );
+      blob.append( json );
+    }
+
+  std::sort( keys.begin(),
+             keys.end(),
+             []( const SnapshotKey & lhs, const SnapshotKey & rhs )
+             {
+               return std::tie( lhs.hash, lhs.kind, lhs.record )
+                      < std::tie( rhs.hash, rhs.kind, rhs.record );
+             } );
+
+  std::vector<SnapshotAux> aux;
+  for ( const auto & str : auxStrings )
+    {
+      aux.push_back( SnapshotAux { blob.size(),
+                                   static_cast<uint32_t>( str.size() ),
+                                   0 } );
+      blob.append( str );
+    }
+
+  SnapshotHeader header {};
+  std::memcpy( header.magic, snapshotMagic, sizeof( header.magic ) );
+  header.version    = snapshotVersion;
+  header.nAux       = static_cast<uint32_t>( aux.size() );
+  header.nKeys      = keys.size();
+  header.nRecords   = records.size();
+  header.auxOff     = sizeof( SnapshotHeader );
+  header.keysOff    = header.auxOff + ( aux.size() * sizeof( SnapshotAux ) );
+  header.recordsOff = header.keysOff + ( keys.size() * sizeof( SnapshotKey ) );
+  header.blobOff
+    = header.recordsOff + ( records.size() * sizeof( SnapshotRecord ) );
+
+  /* Write to a sibling and rename so readers never see a partial file. */
+  std::filesystem::path target = genDbSnapshotName( dbPath );
+  std::filesystem::path tmp    = target.string() + ".tmp";
+  {
+    std::ofstream out( tmp, std::ios::binary | std::ios::trunc );
+    auto          put = [&]( const void * ptr, size_t size )
+    { out.write( static_cast<const char *>( ptr ), std::streamsize( size ) ); };
+    put( &header, sizeof( header ) );
+    put( aux.data(), aux.size() * sizeof( SnapshotAux ) );
+    put( keys.data(), keys.size() * sizeof( SnapshotKey ) );
+    put( records.data(), records.size() * sizeof( SnapshotRecord ) );
+    put( blob.data(), blob.size() );
+    if ( ! out.good() )
+      {
+        throw PkgDbException(
+          nix::fmt( "failed to write snapshot '%s'", tmp.string() ) );
+      }
+  }
+  std::filesystem::rename( tmp, target );
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+struct PkgDbSnapshot::State
+{
+  int          fd   = -1;
+  size_t       size = 0;
+  const char * data = nullptr;
+
+  ~State()
+  {
+    if ( this->data != nullptr )
+      {
+        munmap( const_cast<char *>( this->data ), this->size );
+      }
+    if ( 0 <= this->fd ) { close( this->fd ); }
+  }
+
+  [[nodiscard]] const SnapshotHeader &
+  header() const
+  {
+    return *reinterpret_cast<const SnapshotHeader *>( this->data );
+  }
+
+  /** @brief Resolve a blob-relative ( offset, length ) pair. */
+  [[nodiscard]] std::string_view
+  bytes( uint64_t off, uint32_t len ) const
+  {
+    return { this->data + this->header().blobOff + off, len };
+  }
+
+  [[nodiscard]] std::string_view
+  auxString( uint8_t idx ) const
+  {
+    const auto * entry = reinterpret_cast<const SnapshotAux *>(
+                           this->data + this->header().auxOff )
+                         + idx;
+    return this->bytes( entry->off, entry->len );
+  }
+
+}; /* End struct `PkgDbSnapshot::State' */
+
+
+/* -------------------------------------------------------------------------- */
+
+std::shared_ptr<PkgDbSnapshot>
+PkgDbSnapshot::tryOpen( const std::filesystem::path & dbPath )
+{
+  std::filesystem::path path = genDbSnapshotName( dbPath );
+
+  std::error_code ec;
+  auto            snapTime = std::filesystem::last_write_time( path, ec );
+  if ( ec ) { return nullptr; }
+  auto dbTime = std::filesystem::last_write_time( dbPath, ec );
+  /* A snapshot older than its database is stale. */
+  if ( ec || ( snapTime < dbTime ) ) { return nullptr; }
+
+  auto state = std::make_shared<State>();
+  state->fd  = open( path.c_str(), O_RDONLY );  // NOLINT(cppcoreguidelines-pro-type-vararg)
+  if ( state->fd < 0 ) { return nullptr; }
+
+  struct stat st
+  {};
+  if ( ( fstat( state->fd, &st ) != 0 )
+       || ( static_cast<size_t>( st.st_size ) < sizeof( SnapshotHeader ) ) )
+    {
+      return nullptr;
+    }
+  state->size = static_cast<size_t>( st.st_size );
+
+  void * mapped
+    = mmap( nullptr, state->size, PROT_READ, MAP_PRIVATE, state->fd, 0 );
+  if ( mapped == MAP_FAILED ) { return nullptr; }
+  state->data = static_cast<const char *>( mapped );
+
+  const auto & header = state->header();
+  if ( ( std::memcmp( header.magic, snapshotMagic, sizeof( header.magic ) )
+         != 0 )
+       || ( header.version != snapshotVersion )
+       || ( state->size < header.blobOff ) )
+    {
+      return nullptr;
+    }
+
+  return std::shared_ptr<PkgDbSnapshot>(
+    new PkgDbSnapshot( std::move( state ) ) );
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+bool
+PkgDbSnapshot::supports( const PkgQueryArgs & params )
+{
+  /* Exactly one exact-name column, nothing needing SQL. */
+  int nNames = static_cast<int>( params.name.has_value() )
+               + static_cast<int>( params.pname.has_value() )
+               + static_cast<int>( params.pnameOrAttrName.has_value() );
+  return ( nNames == 1 ) && ( ! params.version.has_value() )
+         && ( ! params.semver.has_value() )
+         && ( ! params.partialMatch.has_value() )
+         && ( ! params.partialNameMatch.has_value() )
+         && ( ! params.partialNameOrRelPathMatch.has_value() )
+         && ( ! params.licenses.has_value() )
+         && ( ! params.relPath.has_value() ) && ( ! params.deduplicate );
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+std::vector<std::string>
+PkgDbSnapshot::lookup( const PkgQueryArgs & params ) const
+{
+  std::string_view      key;
+  std::vector<uint32_t> kinds;
+  if ( params.pname.has_value() )
+    {
+      key   = *params.pname;
+      kinds = { SK_PNAME };
+    }
+  else if ( params.name.has_value() )
+    {
+      key   = *params.name;
+      kinds = { SK_NAME };
+    }
+  else
+    {
+      key   = *params.pnameOrAttrName;
+      kinds = { SK_PNAME, SK_ATTRNAME };
+    }
+
+  const auto & header = this->state->header();
+  const auto * keys   = reinterpret_cast<const SnapshotKey *>(
+    this->state->data + header.keysOff );
+  const auto * recs = reinterpret_cast<const SnapshotRecord *>(
+    this->state->data + header.recordsOff );
+
+  /* Collect matching record indexes, restoring scrape-time order. */
+  uint64_t              hash = hashKey( key );
+  std::vector<uint32_t> matched;
+  auto [begin, end]
+    = std::equal_range( keys,
+                        keys + header.nKeys,
+                        SnapshotKey { hash, 0, 0, 0, 0, 0 },
+                        []( const SnapshotKey & lhs, const SnapshotKey & rhs )
+                        { return lhs.hash < rhs.hash; } );
+  for ( const auto * entry = begin; entry != end; ++entry )
+    {
+      if ( ( std::find( kinds.begin(), kinds.end(), entry->kind )
+             != kinds.end() )
+           && ( this->state->bytes( entry->keyOff, entry->keyLen ) == key ) )
+        {
+          matched.push_back( entry->record );
+        }
+    }
+  std::sort( matched.begin(), matched.end() );
+  matched.erase( std::unique( matched.begin(), matched.end() ),
+                 matched.end() );
+
+  std::vector<std::string> results;
+  for ( uint32_t idx : matched )
+    {
+      const SnapshotRecord & rec = recs[idx];
+
+      if ( ( ! params.allowBroken ) && ( rec.brokenRank == 2 ) ) { continue; }
+      if ( ( ! params.allowUnfree ) && ( rec.unfreeRank == 2 ) ) { continue; }
+
+      std::string_view system = this->state->auxString( rec.systemAux );
+      if ( std::find( params.systems.begin(), params.systems.end(), system )
+           == params.systems.end() )
+        {
+          continue;
+        }
+
+      if ( params.subtrees.has_value() )
+        {
+          std::string_view subtree = this->state->auxString( rec.subtreeAux );
+          bool             hit     = false;
+          for ( const auto & want : *params.subtrees )
+            {
+              if ( subtree == to_string( want ) )
+                {
+                  hit = true;
+                  break;
+                }
+            }
+          if ( ! hit ) { continue; }
+        }
+
+      results.emplace_back( this->state->bytes( rec.jsonOff, rec.jsonLen ) );
+    }
+  return results;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+}  // namespace flox::pkgdb
+
+
+/* -------------------------------------------------------------------------- *
+ *
+ *
+ *
+ * ========================================================================== */
@@ -0,0 +1,155 @@
+/* ========================================================================== *
+ *
+ * @file pkgdb/stats.cc
+ *
+ * @brief Implementation of the `pkgdb stats` subcommand.
+ *
+ *
+ * -------------------------------------------------------------------------- */
+
+#include <iostream>
+
+#include <nlohmann/json.hpp>
+#include <sqlite3pp.hh>
+
+#include "flox/pkgdb/command.hh"
+
+
+/* -------------------------------------------------------------------------- */
+
+namespace flox::pkgdb {
+
+/* -------------------------------------------------------------------------- */
+
+StatsCommand::StatsCommand() : parser( "stats" )
+{
+  this->parser.add_description(
+    "Report per-prefix package statistics from a Package DB" );
+  this->addTargetArg( this->parser );
+  this->addAttrPathArgs( this->parser );
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+/** @brief Whether the database carries a `Stats` table. */
+static bool
+hasStatsTable( PkgDbReadOnly & pdb )
+{
+  sqlite3pp::query qry( pdb.db,
+                        "SELECT name FROM sqlite_master "
+                        "WHERE ( type = 'table' ) AND ( name = 'Stats' )" );
+  return qry.begin() != qry.end();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Produce the statistics record for one prefix.
+ *
+ * Prefixes without a pre-aggregated `Stats` row are counted live; those
+ * records carry `null` duration/timestamp fields since nothing recorded them.
+ */
+static nlohmann::json
+statsRecord( PkgDbReadOnly & pdb, row_id prefixId, bool hasStats )
+{
+  nlohmann::json record
+    = { { "path", pdb.getAttrSetPath( prefixId ) },
+        { "pkgCount", nullptr },
+        { "rowBytes", nullptr },
+        { "scrapeMs", nullptr },
+        { "scrapedAt", nullptr } };
+
+  if ( hasStats )
+    {
+      sqlite3pp::query qry( pdb.db,
+                            "SELECT pkgCount, rowBytes, scrapeMs, scrapedAt "
+                            "FROM Stats WHERE ( prefix = ? )" );
+      qry.bind( 1, static_cast<long long>( prefixId ) );
+      if ( auto itr = qry.begin(); itr != qry.end() )
+        {
+          record["pkgCount"] = ( *itr ).get<long long>( 0 );
+          record["rowBytes"] = ( *itr ).get<long long>( 1 );
+          if ( ( *itr ).column_type( 2 ) != SQLITE_NULL )
+            {
+              record["scrapeMs"] = ( *itr ).get<long long>( 2 );
+            }
+          if ( ( *itr ).column_type( 3 ) != SQLITE_NULL )
+            {
+              record["scrapedAt"] = ( *itr ).get<long long>( 3 );
+            }
+          return record;
+        }
+    }
+
+  /* Live fallback for old databases and prefixes not yet re-scraped. */
+  sqlite3pp::query qry( pdb.db, R"SQL(
+    SELECT count( p.id )
+         , ifnull( sum( length( p.attrName ) + length( p.name )
+                      + ifnull( length( p.pname ), 0 )
+                      + ifnull( length( p.version ), 0 )
+                      + ifnull( length( p.license ), 0 )
+                      + ifnull( length( p.outputs ), 0 )
+                      + ifnull( length( p.outputsToInstall ), 0 )
+                      + ifnull( length( p.fullPath ), 0 ) ), 0 )
+    FROM Packages p
+    JOIN AttrSetClosure c ON ( p.parentId = c.descendant )
+    WHERE ( c.ancestor = ? )
+  )SQL" );
+  qry.bind( 1, static_cast<long long>( prefixId ) );
+  auto rsl           = *qry.begin();
+  record["pkgCount"] = rsl.get<long long>( 0 );
+  record["rowBytes"] = rsl.get<long long>( 1 );
+  return record;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+int
+StatsCommand::run()
+{
+  this->fixupAttrPath();
+  this->openPkgDb();
+
+  bool hasStats = hasStatsTable( *this->db );
+
+  if ( ! this->attrPath.empty() )
+    {
+      std::cout << statsRecord( *this->db,
+                                this->db->getAttrSetId( this->attrPath ),
+                                hasStats )
+                     .dump()
+                << std::endl;
+      return EXIT_SUCCESS;
+    }
+
+  /* With no prefix argument report every recorded prefix, or fall back to
+   * the `<subtree>.<system>' scrape roots on old databases. */
+  const char * listSql
+    = hasStats ? "SELECT prefix FROM Stats ORDER BY prefix"
+               : "SELECT id FROM AttrSets WHERE parent IN "
+                 "( SELECT id FROM AttrSets WHERE parent = 0 ) ORDER BY id";
+  sqlite3pp::query qry( this->db->db, listSql );
+  for ( const auto & row : qry )
+    {
+      auto prefixId = static_cast<row_id>( row.get<long long>( 0 ) );
+      std::cout << statsRecord( *this->db, prefixId, hasStats ).dump()
+                << '\n';
+    }
+  std::cout.flush();
+  return EXIT_SUCCESS;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+}  // namespace flox::pkgdb
+
+
+/* -------------------------------------------------------------------------- *
+ *
+ *
+ *
+ * ========================================================================== */
@@ -7,13 +7,25 @@
  *
  * -------------------------------------------------------------------------- */
 
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
 #include <limits>
 #include <memory>
 #include <ranges>
+#include <sys/resource.h>
+#include <unistd.h>
 
+#include <nix/util.hh>
+#include <unordered_map>
+
+#include "flox/core/trace.hh"
 #include "flox/flake-package.hh"
 #include "flox/pkgdb/write.hh"
+#include "versions.hh"
 
+#include "./migrations.hh"
 #include "./schemas.hh"
 
 
@@ -21,6 +33,137 @@
 
 namespace flox::pkgdb {
 
+/* -------------------------------------------------------------------------- */
+
+void
+ScrapeRules::addRule( const flox::AttrPath & pattern, bool allow )
+{
+  Node * node = &this->root;
+  for ( const auto & part : pattern ) { node = &node->children[part]; }
+  node->allow = allow;
+}
+
+
+bool
+ScrapeRules::allowed( const flox::AttrPath & path ) const
+{
+  /* Walk the trie along @a path, following both literal and `*' edges, and
+   * keep the verdict of the deepest matching rule. */
+  std::vector<const Node *> frontier = { &this->root };
+  std::optional<bool>       verdict;
+  for ( const auto & part : path )
+    {
+      std::vector<const Node *> next;
+      for ( const Node * node : frontier )
+        {
+          if ( auto itr = node->children.find( part );
+               itr != node->children.end() )
+            {
+              next.push_back( &itr->second );
+            }
+          if ( auto itr = node->children.find( "*" );
+               itr != node->children.end() )
+            {
+              next.push_back( &itr->second );
+            }
+        }
+      if ( next.empty() ) { break; }
+      frontier = std::move( next );
+      for ( const Node * node : frontier )
+        {
+          if ( node->allow.has_value() ) { verdict = node->allow; }
+        }
+    }
+  return verdict.value_or( true );
+}
+
+
+const ScrapeRules &
+ScrapeRules::get()
+{
+  static const ScrapeRules rules = []()
+  {
+    ScrapeRules  rsl;
+    const char * maybePath = std::getenv( "PKGDB_SCRAPE_RULES" );
+    if ( maybePath == nullptr ) { return rsl; }
+    try
+      {
+        nlohmann::json raw = readAndCoerceJSON( maybePath );
+        if ( auto itr = raw.find( "allow" ); itr != raw.end() )
+          {
+            for ( const auto & pattern : *itr )
+              {
+                rsl.addRule( splitAttrPath( pattern.get<std::string>() ),
+                             true );
+              }
+          }
+        if ( auto itr = raw.find( "deny" ); itr != raw.end() )
+          {
+            for ( const auto & pattern : *itr )
+              {
+                rsl.addRule( splitAttrPath( pattern.get<std::string>() ),
+                             false );
+              }
+          }
+      }
+    catch ( const std::exception & err )
+      {
+        throw PkgDbException(
+          nix::fmt( "failed to load scrape rules from '%s'", maybePath ),
+          err.what() );
+      }
+    return rsl;
+  }();
+  return rules;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+static bool progressJson = []()
+{
+  const char * maybeProgress = std::getenv( "PKGDB_PROGRESS_JSON" );
+  return ( maybeProgress != nullptr )
+         && ( std::string_view( maybeProgress ) != "0" );
+}();
+
+
+bool
+progressJsonEnabled()
+{
+  return progressJson;
+}
+
+
+void
+setProgressJsonEnabled( bool enabled )
+{
+  progressJson = enabled;
+}
+
+
+void
+emitProgressEvent( const std::string & event, nlohmann::json fields )
+{
+  if ( ! progressJsonEnabled() ) { return; }
+  fields.emplace( "event", event );
+  fields.emplace( "ts",
+                  std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::system_clock::now().time_since_epoch() )
+                    .count() );
+  struct rusage usage;
+  if ( getrusage( RUSAGE_SELF, &usage ) == 0 )
+    {
+      fields.emplace( "rssKb", usage.ru_maxrss );
+    }
+  std::string line = fields.dump();
+  line += '\n';
+  /* A single `write' keeps events from concurrent workers whole. */
+  ssize_t _ignored = write( STDERR_FILENO, line.c_str(), line.size() );
+  (void) _ignored;
+}
+
+
 /* -------------------------------------------------------------------------- */
 
 /** @brief Create views in database if they do not exist. */
@@ -121,6 +264,40 @@ initTables( PkgDb & pdb )
                   rcode,
                   pdb.db.error_msg() ) );
     }
+
+  if ( sql_rc rcode = pdb.execute_all( sql_scrapeProgress );
+       isSQLError( rcode ) )
+    {
+      throw PkgDbException(
+        nix::fmt( "failed to initialize ScrapeProgress table:(%d) %s",
+                  rcode,
+                  pdb.db.error_msg() ) );
+    }
+
+  if ( sql_rc rcode = pdb.execute_all( sql_evalFailures );
+       isSQLError( rcode ) )
+    {
+      throw PkgDbException(
+        nix::fmt( "failed to initialize EvalFailures table:(%d) %s",
+                  rcode,
+                  pdb.db.error_msg() ) );
+    }
+
+  if ( sql_rc rcode = pdb.execute_all( sql_stats ); isSQLError( rcode ) )
+    {
+      throw PkgDbException(
+        nix::fmt( "failed to initialize Stats table:(%d) %s",
+                  rcode,
+                  pdb.db.error_msg() ) );
+    }
+
+  if ( sql_rc rcode = pdb.execute_all( sql_fts ); isSQLError( rcode ) )
+    {
+      throw PkgDbException(
+        nix::fmt( "failed to initialize full-text index:(%d) %s",
+                  rcode,
+                  pdb.db.error_msg() ) );
+    }
 }
 
 
@@ -146,11 +323,236 @@ initVersions( PkgDb & pdb )
 }
 
 
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Mirror @a versions into SQLite's native header fields.
+ *
+ * Stamped from whatever `DbVersions` actually holds so the header never
+ * claims a newer schema than the tables carry, even when no migration
+ * path exists.
+ */
+static void
+stampVersionPragmas( PkgDb & pdb, const SqlVersions & versions )
+{
+  pdb.execute(
+    nix::fmt( "PRAGMA application_id = %d", pkgDbApplicationId ).c_str() );
+  pdb.execute( nix::fmt( "PRAGMA user_version = %d",
+                         ( versions.tables << 16 ) | versions.views )
+                 .c_str() );
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Native half of the v3 -> v4 migration.
+ *
+ * Creates the full-text index and seeds it from existing rows.
+ */
+static void
+migrateToV4( PkgDb & pdb )
+{
+  if ( sql_rc rcode = pdb.execute_all( sql_fts ); isSQLError( rcode ) )
+    {
+      throw PkgDbException(
+        nix::fmt( "failed to create full-text index:(%d) %s",
+                  rcode,
+                  pdb.db.error_msg() ) );
+    }
+  if ( sql_rc rcode = pdb.execute_all( sql_migrateFtsBackfill );
+       isSQLError( rcode ) )
+    {
+      throw PkgDbException(
+        nix::fmt( "failed to backfill full-text index:(%d) %s",
+                  rcode,
+                  pdb.db.error_msg() ) );
+    }
+}
+
+
+/**
+ * @brief Native half of the v4 -> v5 migration.
+ *
+ * Backfills the pre-parsed semver component columns from existing
+ * `semver` strings.
+ */
+static void
+migrateToV5( PkgDb & pdb )
+{
+  sqlite3pp::query   qry( pdb.db,
+                        "SELECT id, semver FROM Packages "
+                          "WHERE semver IS NOT NULL" );
+  sqlite3pp::command upd( pdb.db,
+                          "UPDATE Packages SET major = ?, minor = ?"
+                          ", patch = ?, preTag = ? WHERE id = ?" );
+  for ( auto row : qry )
+    {
+      auto parts = versions::parseSemverParts( row.get<std::string>( 1 ) );
+      if ( ! parts.has_value() ) { continue; }
+      upd.reset();
+      upd.bind( 1, static_cast<long long>( parts->major ) );
+      upd.bind( 2, static_cast<long long>( parts->minor ) );
+      upd.bind( 3, static_cast<long long>( parts->patch ) );
+      if ( parts->preTag.has_value() )
+        {
+          upd.bind( 4, *parts->preTag, sqlite3pp::copy );
+        }
+      else { upd.bind( 4 ); /* binds NULL */ }
+      upd.bind( 5, row.get<long long>( 0 ) );
+      if ( sql_rc rcode = upd.execute(); isSQLError( rcode ) )
+        {
+          throw PkgDbException(
+            nix::fmt( "failed to backfill semver parts:(%d) %s",
+                      rcode,
+                      pdb.db.error_msg() ) );
+        }
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+/** @brief A single step upgrading the tables schema by one version. */
+struct SchemaMigration
+{
+  /** Tables version this step upgrades ( to `fromVersion + 1` ). */
+  unsigned fromVersion;
+  /** DDL/DML applied first, or `nullptr` for purely native steps. */
+  const char * sql;
+  /** Optional native fix-up run after @a sql in the same transaction. */
+  void ( *fixup )( PkgDb & pdb );
+}; /* End struct `SchemaMigration' */
+
+/* Versions with no step here force a re-scrape when encountered. */
+static const SchemaMigration schemaMigrations[] = {
+  /* v2 -> v3: per-page scrape progress tracking ( starts empty ).
+   * v2 also marks the switch to compressed stored descriptions; old plain
+   * rows need no conversion since `uncompress_description` passes
+   * unframed text through untouched. */
+  { 2, sql_scrapeProgress, nullptr },
+  /* v3 -> v4: trigram full-text index, seeded from existing rows. */
+  { 3, nullptr, &migrateToV4 },
+  /* v4 -> v5: pre-parsed semver component columns. */
+  { 4, sql_migrateSemverParts, &migrateToV5 },
+  /* v5 -> v6: `AttrSets' closure table. */
+  { 5, sql_migrateAttrSetClosure, nullptr },
+  /* v6 -> v7: pre-lowered name columns and their indexes. */
+  { 6, sql_migrateLowerNames, nullptr },
+  /* v7 -> v8: materialized full attribute path column, backfilled from the
+   * closure table. */
+  { 7, sql_migrateFullPath, nullptr },
+  /* v8 -> v9: per-prefix `Stats' table ( starts empty; rows appear as
+   * prefixes are re-scraped ). */
+  { 8, sql_stats, nullptr },
+  /* v9 -> v10: optional popularity-rank column ( starts unranked ). */
+  { 9, sql_migratePopularityRank, nullptr },
+  /* v10 -> v11: eval-failure memo table ( starts empty; rows appear as
+   * attributes fail to evaluate ). */
+  { 10, sql_evalFailures, nullptr },
+};
+
+
+bool
+PkgDb::canMigrateFrom( unsigned tablesVersion )
+{
+  if ( sqlVersions.tables < tablesVersion ) { return false; }
+  for ( unsigned from = tablesVersion; from < sqlVersions.tables; ++from )
+    {
+      bool found = false;
+      for ( const auto & step : schemaMigrations )
+        {
+          if ( step.fromVersion == from ) { found = true; }
+        }
+      if ( ! found ) { return false; }
+    }
+  return true;
+}
+
+
+bool
+PkgDb::migrate()
+{
+  /* A fresh database has no versions table and nothing to migrate. */
+  {
+    sqlite3pp::query qry( this->db,
+                          "SELECT name FROM sqlite_master "
+                          "WHERE ( type = 'table' ) "
+                          "AND ( name = 'DbVersions' )" );
+    if ( qry.begin() == qry.end() ) { return true; }
+  }
+
+  SqlVersions versions = this->getDbVersion();
+  if ( versions.tables == sqlVersions.tables ) { return true; }
+  /* Never attempt to "migrate" a database newer than this binary. */
+  if ( sqlVersions.tables < versions.tables ) { return false; }
+
+  /* Make sure an unbroken chain of steps exists before touching anything;
+   * otherwise leave the version rows as-is so callers fall back to
+   * a re-scrape. */
+  if ( ! canMigrateFrom( versions.tables ) ) { return false; }
+
+  this->execute( "BEGIN EXCLUSIVE TRANSACTION" );
+  try
+    {
+      for ( unsigned from = versions.tables; from < sqlVersions.tables;
+            ++from )
+        {
+          for ( const auto & step : schemaMigrations )
+            {
+              if ( step.fromVersion != from ) { continue; }
+              nix::logger->log(
+                nix::lvlTalkative,
+                nix::fmt( "Migrating database '%s' schema v%u -> v%u",
+                          this->dbPath.string(),
+                          from,
+                          from + 1 ) );
+              if ( ( step.sql != nullptr )
+                   && isSQLError( this->execute_all( step.sql ) ) )
+                {
+                  throw PkgDbException(
+                    nix::fmt( "failed to migrate schema v%u -> v%u: %s",
+                              from,
+                              from + 1,
+                              this->db.error_msg() ) );
+                }
+              if ( step.fixup != nullptr ) { step.fixup( *this ); }
+            }
+          sqlite3pp::command bump(
+            this->db,
+            "UPDATE DbVersions SET version = ? "
+            "WHERE name = 'pkgdb_tables_schema'" );
+          bump.bind( 1, static_cast<int>( from + 1 ) );
+          if ( sql_rc rcode = bump.execute(); isSQLError( rcode ) )
+            {
+              throw PkgDbException(
+                nix::fmt( "failed to record schema version v%u: %s",
+                          from + 1,
+                          this->db.error_msg() ) );
+            }
+        }
+    }
+  catch ( ... )
+    {
+      this->execute( "ROLLBACK TRANSACTION" );
+      throw;
+    }
+  this->execute( "COMMIT TRANSACTION" );
+  return true;
+}
+
+
 /* -------------------------------------------------------------------------- */
 
 void
 PkgDb::init()
 {
+  /* Bring an existing database forward before `initTables' asserts the
+   * current shape.  When no migration path exists the old version rows are
+   * preserved ( `initVersions' never overwrites ) so callers can detect the
+   * mismatch and re-scrape. */
+  this->migrate();
+
   initTables( *this );
   initVersions( *this );
 
@@ -160,6 +562,10 @@ PkgDb::init()
       updateViews( *this );
     }
   else { initViews( *this ); }
+
+  /* Mirror the now-final versions into the file header so later opens
+   * validate without touching `DbVersions' ( see @a getDbVersion ). */
+  stampVersionPragmas( *this, this->getDbVersionFromTable() );
 }
 
 
@@ -199,6 +605,7 @@ PkgDb::PkgDb( const nix::flake::LockedFlake & flake, std::string_view dbPath )
   this->lockedRef
     = { flake.flake.lockedRef.to_string(),
         nix::fetchers::attrsToJSON( flake.flake.lockedRef.toAttrs() ) };
+  this->lockedFlakeLoaded = true;
   writeInput( *this );
 }
 
@@ -211,6 +618,17 @@ PkgDb::connect()
   this->db.connect( this->dbPath.string().c_str(),
                     SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE );
   this->db.set_busy_timeout( DB_BUSY_TIMEOUT );
+  /* WAL mode is persistent, so setting it here covers both fresh databases
+   * and ones created before the switch.
+   * Readers are never blocked by an appending scrape under WAL. */
+  if ( sql_rc rcode = this->db.execute( "PRAGMA journal_mode = WAL" );
+       isSQLError( rcode ) )
+    {
+      throw PkgDbException( nix::fmt( "failed to enable WAL mode:(%d) %s",
+                                      rcode,
+                                      this->db.error_msg() ) );
+    }
+  this->sqlFunctions = registerSqlFunctions( this->db );
 }
 
 
@@ -219,16 +637,27 @@ PkgDb::connect()
 row_id
 PkgDb::addOrGetAttrSetId( const std::string & attrName, row_id parent )
 {
-  sqlite3pp::command cmd(
-    this->db,
-    "INSERT INTO AttrSets ( attrName, parent ) VALUES ( ?, ? )" );
+  if ( this->stmtInsertAttrSet == nullptr )
+    {
+      this->stmtInsertAttrSet = std::make_unique<sqlite3pp::command>(
+        this->db,
+        "INSERT INTO AttrSets ( attrName, parent ) VALUES ( ?, ? )" );
+    }
+  else { this->stmtInsertAttrSet->reset(); }
+  sqlite3pp::command & cmd = *this->stmtInsertAttrSet;
   cmd.bind( 1, attrName, sqlite3pp::copy );
   cmd.bind( 2, static_cast<long long>( parent ) );
   if ( sql_rc rcode = cmd.execute(); isSQLError( rcode ) )
     {
-      sqlite3pp::query qryId(
-        this->db,
-        "SELECT id FROM AttrSets WHERE ( attrName = ? ) AND ( parent = ? )" );
+      if ( this->qryAttrSetId == nullptr )
+        {
+          this->qryAttrSetId = std::make_unique<sqlite3pp::query>(
+            this->db,
+            "SELECT id FROM AttrSets WHERE ( attrName = ? ) "
+            "AND ( parent = ? )" );
+        }
+      else { this->qryAttrSetId->reset(); }
+      sqlite3pp::query & qryId = *this->qryAttrSetId;
       qryId.bind( 1, attrName, sqlite3pp::copy );
       qryId.bind( 2, static_cast<long long>( parent ) );
       auto row = qryId.begin();
@@ -263,10 +692,32 @@ PkgDb::addOrGetAttrSetId( const flox::AttrPath & path )
 row_id
 PkgDb::addOrGetDescriptionId( const std::string & description )
 {
-  sqlite3pp::query qry(
-    this->db,
-    "SELECT id FROM Descriptions WHERE description = ? LIMIT 1" );
-  qry.bind( 1, description, sqlite3pp::copy );
+  /* Repeats resolve from the session cache without compressing or touching
+   * SQLite; only the first occurrence of a description pays the
+   * SELECT-then-INSERT below. */
+  if ( auto cached = this->descriptionIds.find( description );
+       cached != this->descriptionIds.end() )
+    {
+      return cached->second;
+    }
+
+  /* Dedup against the stored form; `zstd' output is deterministic so equal
+   * descriptions always produce equal stored bytes.
+   * Bound as a blob: frames contain NUL bytes, and blob values survive
+   * every read path with their exact length. */
+  const std::string stored = compressDescription( description );
+  if ( this->qryDescriptionId == nullptr )
+    {
+      this->qryDescriptionId = std::make_unique<sqlite3pp::query>(
+        this->db,
+        "SELECT id FROM Descriptions WHERE description = ? LIMIT 1" );
+    }
+  else { this->qryDescriptionId->reset(); }
+  sqlite3pp::query & qry = *this->qryDescriptionId;
+  qry.bind( 1,
+            static_cast<const void *>( stored.data() ),
+            static_cast<int>( stored.size() ),
+            sqlite3pp::copy );
   auto itr = qry.begin();
   if ( itr != qry.end() )
     {
@@ -276,13 +727,23 @@ PkgDb::addOrGetDescriptionId( const std::string & description )
         nix::actUnknown,
         nix::fmt( "found existing description in database: %s.",
                   description ) );
-      return ( *itr ).get<long long>( 0 );
+      row_id descriptionId = ( *itr ).get<long long>( 0 );
+      this->descriptionIds.emplace( description, descriptionId );
+      return descriptionId;
     }
 
-  sqlite3pp::command cmd(
-    this->db,
-    "INSERT INTO Descriptions ( description ) VALUES ( ? )" );
-  cmd.bind( 1, description, sqlite3pp::copy );
+  if ( this->stmtInsertDescription == nullptr )
+    {
+      this->stmtInsertDescription = std::make_unique<sqlite3pp::command>(
+        this->db,
+        "INSERT INTO Descriptions ( description ) VALUES ( ? )" );
+    }
+  else { this->stmtInsertDescription->reset(); }
+  sqlite3pp::command & cmd = *this->stmtInsertDescription;
+  cmd.bind( 1,
+            static_cast<const void *>( stored.data() ),
+            static_cast<int>( stored.size() ),
+            sqlite3pp::copy );
   nix::Activity act(
     *nix::logger,
     nix::lvlDebug,
@@ -295,7 +756,9 @@ PkgDb::addOrGetDescriptionId( const std::string & description )
                                       rcode,
                                       this->db.error_msg() ) );
     }
-  return this->db.last_insert_rowid();
+  row_id descriptionId = this->db.last_insert_rowid();
+  this->descriptionIds.emplace( description, descriptionId );
+  return descriptionId;
 }
 
 
@@ -306,15 +769,46 @@ PkgDb::addPackage( row_id               parentId,
                    std::string_view     attrName,
                    const flox::Cursor & cursor )
 {
-  sqlite3pp::command cmd( this->db, R"SQL(
-    INSERT OR REPLACE INTO Packages (
-      parentId, attrName, name, pname, version, semver, license
-    , outputs, outputsToInstall, broken, unfree, descriptionId
-    ) VALUES (
-      :parentId, :attrName, :name, :pname, :version, :semver, :license
-    , :outputs, :outputsToInstall, :broken, :unfree, :descriptionId
-    )
-  )SQL" );
+  /* During an incremental scrape try to copy the previous generation's row
+   * before forcing the full package.
+   * The `name' attribute is forced as a cheap identity check; a copy is only
+   * taken when it matches the seed exactly. */
+  if ( this->seeded )
+    {
+      try
+        {
+          if ( auto aname = cursor->maybeGetAttr( "name" ); aname != nullptr )
+            {
+              if ( this->copySeedPackage( parentId,
+                                          attrName,
+                                          aname->getString() ) )
+                {
+                  return this->db.last_insert_rowid();
+                }
+            }
+        }
+      catch ( const nix::EvalError & )
+        { /* Fall through to a full evaluation. */
+        }
+    }
+
+  if ( this->stmtInsertPackage == nullptr )
+    {
+      this->stmtInsertPackage
+        = std::make_unique<sqlite3pp::command>( this->db, R"SQL(
+        INSERT OR REPLACE INTO Packages (
+          parentId, attrName, name, pname, version, semver
+        , major, minor, patch, preTag, license
+        , outputs, outputsToInstall, broken, unfree, descriptionId
+        ) VALUES (
+          :parentId, :attrName, :name, :pname, :version, :semver
+        , :major, :minor, :patch, :preTag, :license
+        , :outputs, :outputsToInstall, :broken, :unfree, :descriptionId
+        )
+      )SQL" );
+    }
+  else { this->stmtInsertPackage->reset(); }
+  sqlite3pp::command & cmd = *this->stmtInsertPackage;
 
   /* We don't need to reference any `attrPath' related info here, so
    * we can avoid looking up the parent path by passing a phony one to the
@@ -330,12 +824,35 @@ PkgDb::addPackage( row_id               parentId,
   if ( pkg._version.empty() ) { cmd.bind( ":version" ); /* bind NULL */ }
   else { cmd.bind( ":version", pkg._version, sqlite3pp::nocopy ); }
 
+  /* Pre-parse the semver so range queries compare indexed integers. */
+  std::optional<versions::SemverParts> semverParts;
   if ( pkg._semver.has_value() )
     {
       cmd.bind( ":semver", *pkg._semver, sqlite3pp::nocopy );
+      semverParts = versions::parseSemverParts( *pkg._semver );
     }
   else { cmd.bind( ":semver" ); /* binds NULL */ }
 
+  if ( semverParts.has_value() )
+    {
+      cmd.bind( ":major", static_cast<long long>( semverParts->major ) );
+      cmd.bind( ":minor", static_cast<long long>( semverParts->minor ) );
+      cmd.bind( ":patch", static_cast<long long>( semverParts->patch ) );
+      if ( semverParts->preTag.has_value() )
+        {
+          cmd.bind( ":preTag", *semverParts->preTag, sqlite3pp::copy );
+        }
+      else { cmd.bind( ":preTag" ); }
+    }
+  else
+    {
+      /* binds NULL */
+      cmd.bind( ":major" );
+      cmd.bind( ":minor" );
+      cmd.bind( ":patch" );
+      cmd.bind( ":preTag" );
+    }
+
   {
     nlohmann::json jOutputs = pkg.getOutputs();
     cmd.bind( ":outputs", jOutputs.dump(), sqlite3pp::copy );
@@ -395,92 +912,755 @@ PkgDb::addPackage( row_id               parentId,
 /* -------------------------------------------------------------------------- */
 
 void
-PkgDb::setPrefixDone( row_id prefixId, bool done )
+PkgDb::attachSeed( const std::filesystem::path & seedPath )
 {
-  sqlite3pp::command cmd( this->db, R"SQL(
-    UPDATE AttrSets SET done = ? WHERE id in (
-      WITH RECURSIVE Tree AS (
-        SELECT id, parent, 0 as depth FROM AttrSets
-        WHERE ( id = ? )
-        UNION ALL SELECT O.id, O.parent, ( Parent.depth + 1 ) AS depth
-        FROM AttrSets O
-        JOIN Tree AS Parent ON ( Parent.id = O.parent )
-      ) SELECT C.id FROM Tree AS C
-      JOIN AttrSets AS Parent ON ( C.parent = Parent.id )
-    )
-  )SQL" );
-  cmd.bind( 1, static_cast<int>( done ) );
-  cmd.bind( 2, static_cast<long long>( prefixId ) );
-  if ( sql_rc rcode = cmd.execute(); isSQLError( rcode ) )
+  sqlite3pp::command attach( this->db, "ATTACH DATABASE ? AS seed" );
+  attach.bind( 1, seedPath.string(), sqlite3pp::copy );
+  if ( sql_rc rcode = attach.execute(); isSQLError( rcode ) )
     {
-      throw PkgDbException(
-        nix::fmt( "failed to set AttrSets.done for subtree '%s':(%d) %s",
-                  concatStringsSep( ".", this->getAttrSetPath( prefixId ) ),
-                  rcode,
-                  this->db.error_msg() ) );
+      throw PkgDbException( nix::fmt( "failed to attach seed '%s':(%d) %s",
+                                      seedPath.string(),
+                                      rcode,
+                                      this->db.error_msg() ) );
     }
-}
-
-void
-PkgDb::setPrefixDone( const flox::AttrPath & prefix, bool done )
-{
-  this->setPrefixDone( this->addOrGetAttrSetId( prefix ), done );
+  this->seeded = true;
 }
 
 
 /* -------------------------------------------------------------------------- */
 
-/* NOTE:
- * Benchmarks on large catalogs have indicated that using a _todo_ queue instead
- * of recursion is faster and consumes less memory.
- * Repeated runs against `nixpkgs-flox` come in at ~2m03s using recursion and
- * ~1m40s using a queue. */
 bool
-PkgDb::scrape( nix::SymbolTable & syms,
-               const Target &     target,
-               std::size_t        pageSize,
-               std::size_t        pageIdx )
+PkgDb::copySeedPackage( row_id              parentId,
+                        std::string_view    attrName,
+                        const std::string & name )
 {
-  const auto & [prefix, cursor, parentId] = target;
+  /* Absolute attribute path of the candidate package, in the JSON list form
+   * materialized on `Packages.fullPath'. */
+  flox::AttrPath path = this->getAttrSetPath( parentId );
+  path.emplace_back( attrName );
+  nlohmann::json jpath = path;
+
+  sqlite3pp::query qry( this->db, R"SQL(
+    SELECT p.pname, p.version, p.semver, p.major, p.minor, p.patch, p.preTag
+         , p.license, p.outputs, p.outputsToInstall, p.broken, p.unfree
+         , d.description
+    FROM seed.Packages AS p
+    LEFT OUTER JOIN seed.Descriptions AS d ON ( p.descriptionId = d.id )
+    WHERE ( p.fullPath = ? ) AND ( p.name = ? ) LIMIT 1
+  )SQL" );
+  qry.bind( 1, jpath.dump(), sqlite3pp::copy );
+  qry.bind( 2, name, sqlite3pp::nocopy );
 
-  /* If it has previously been scraped then bail out. */
-  if ( this->completedAttrSet( parentId ) ) { return true; }
+  auto itr = qry.begin();
+  if ( itr == qry.end() ) { return false; }
+  auto row = *itr;
 
-  bool tryRecur = prefix.front() != "packages";
+  sqlite3pp::command cmd( this->db, R"SQL(
+    INSERT OR REPLACE INTO Packages (
+      parentId, attrName, name, pname, version, semver
+    , major, minor, patch, preTag, license
+    , outputs, outputsToInstall, broken, unfree, descriptionId
+    ) VALUES ( ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ? )
+  )SQL" );
 
-  debugLog( nix::fmt( "evaluating package set '%s'",
-                      concatStringsSep( ".", prefix ) ) );
+  std::string attrNameS( attrName );
+  cmd.bind( 1, static_cast<long long>( parentId ) );
+  cmd.bind( 2, attrNameS, sqlite3pp::copy );
+  cmd.bind( 3, name, sqlite3pp::nocopy );
 
-  auto processAttrib
-    = [this, &syms, tryRecur]( const flox::Cursor &      childCursor,
-                               const flox::AttrPath &    prefix,
-                               const flox::pkgdb::row_id parentId,
-                               const nix::Symbol &       aname,
-                               Todos &                   todo ) -> bool
-  {
-    try
-      {
+  /* Copy `pname' .. `unfree' as-is, preserving NULLs. */
+  for ( int col = 0; col < 12; ++col )
+    {
+      if ( row.column_type( col ) == SQLITE_NULL ) { cmd.bind( col + 4 ); }
+      else if ( row.column_type( col ) == SQLITE_INTEGER )
+        {
+          cmd.bind( col + 4, row.get<long long>( col ) );
+        }
+      else
+        {
+          cmd.bind( col + 4, row.get<std::string>( col ), sqlite3pp::copy );
+        }
+    }
+
+  if ( row.column_type( 12 ) == SQLITE_NULL ) { cmd.bind( 16 ); }
+  else
+    {
+      /* Read with explicit length; compressed frames contain NUL bytes. */
+      row_id descriptionId
+        = this->addOrGetDescriptionId( getStoredDescription( row, 12 ) );
+      cmd.bind( 16, static_cast<long long>( descriptionId ) );
+    }
+
+  if ( sql_rc rcode = cmd.execute(); isSQLError( rcode ) )
+    {
+      throw PkgDbException(
+        nix::fmt( "failed to copy seed Package '%s'", name ),
+        this->db.error_msg() );
+    }
+  return true;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void
+PkgDb::absorbShard( const std::filesystem::path & shardPath )
+{
+  {
+    sqlite3pp::command attach( this->db, "ATTACH DATABASE ? AS shard" );
+    attach.bind( 1, shardPath.string(), sqlite3pp::copy );
+    if ( sql_rc rcode = attach.execute(); isSQLError( rcode ) )
+      {
+        throw PkgDbException( nix::fmt( "failed to attach shard '%s':(%d) %s",
+                                        shardPath.string(),
+                                        rcode,
+                                        this->db.error_msg() ) );
+      }
+  }
+
+  this->execute( "BEGIN TRANSACTION" );
+
+  /* Remap `AttrSets.id's.
+   * Rows are visited in `id' order so a parent row is always remapped before
+   * any of its children.
+   * The root sentinel `0' maps to itself. */
+  std::unordered_map<row_id, row_id> attrIds { { 0, 0 } };
+  {
+    sqlite3pp::query qry(
+      this->db,
+      "SELECT id, parent, attrName, done FROM shard.AttrSets ORDER BY id" );
+    for ( auto row : qry )
+      {
+        auto oldId    = static_cast<row_id>( row.get<long long>( 0 ) );
+        auto parent   = static_cast<row_id>( row.get<long long>( 1 ) );
+        auto attrName = row.get<std::string>( 2 );
+
+        row_id newId = this->addOrGetAttrSetId( attrName, attrIds.at( parent ) );
+        attrIds.emplace( oldId, newId );
+
+        if ( row.get<int>( 3 ) != 0 )
+          {
+            sqlite3pp::command markDone(
+              this->db,
+              "UPDATE AttrSets SET done = TRUE WHERE id = ?" );
+            markDone.bind( 1, static_cast<long long>( newId ) );
+            markDone.execute();
+          }
+      }
+  }
+
+  /* Remap `Descriptions.id's. */
+  std::unordered_map<row_id, row_id> descIds;
+  {
+    sqlite3pp::query qry( this->db,
+                          "SELECT id, description FROM shard.Descriptions" );
+    for ( auto row : qry )
+      {
+        auto oldId = static_cast<row_id>( row.get<long long>( 0 ) );
+        /* Read with explicit length; compressed frames contain NUL bytes. */
+        descIds.emplace( oldId,
+                         this->addOrGetDescriptionId(
+                           getStoredDescription( row, 1 ) ) );
+      }
+  }
+
+  /* Bulk-copy `Packages' rows with their foreign keys remapped. */
+  {
+    sqlite3pp::query qry( this->db, R"SQL(
+      SELECT parentId, attrName, name, pname, version, semver
+           , major, minor, patch, preTag, license
+           , outputs, outputsToInstall, broken, unfree, descriptionId
+      FROM shard.Packages
+    )SQL" );
+    for ( auto row : qry )
+      {
+        sqlite3pp::command cmd( this->db, R"SQL(
+          INSERT OR REPLACE INTO Packages (
+            parentId, attrName, name, pname, version, semver
+          , major, minor, patch, preTag, license
+          , outputs, outputsToInstall, broken, unfree, descriptionId
+          ) VALUES ( ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ? )
+        )SQL" );
+
+        cmd.bind( 1,
+                  static_cast<long long>( attrIds.at( static_cast<row_id>(
+                    row.get<long long>( 0 ) ) ) ) );
+        /* Copy remaining columns as-is, preserving NULLs. */
+        for ( int col = 1; col < 15; ++col )
+          {
+            if ( row.column_type( col ) == SQLITE_NULL )
+              {
+                cmd.bind( col + 1 );
+              }
+            else if ( row.column_type( col ) == SQLITE_INTEGER )
+              {
+                cmd.bind( col + 1, row.get<long long>( col ) );
+              }
+            else
+              {
+                cmd.bind( col + 1, row.get<std::string>( col ),
+                          sqlite3pp::copy );
+              }
+          }
+        if ( row.column_type( 15 ) == SQLITE_NULL ) { cmd.bind( 16 ); }
+        else
+          {
+            cmd.bind( 16,
+                      static_cast<long long>( descIds.at( static_cast<row_id>(
+                        row.get<long long>( 15 ) ) ) ) );
+          }
+
+        if ( sql_rc rcode = cmd.execute(); isSQLError( rcode ) )
+          {
+            this->execute( "ROLLBACK TRANSACTION" );
+            this->execute( "DETACH DATABASE shard" );
+            throw PkgDbException(
+              nix::fmt( "failed to copy Packages row from shard '%s':(%d) %s",
+                        shardPath.string(),
+                        rcode,
+                        this->db.error_msg() ) );
+          }
+      }
+  }
+
+  this->execute( "COMMIT TRANSACTION" );
+  this->execute( "DETACH DATABASE shard" );
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+std::size_t
+PkgDb::getScrapeProgress( row_id prefixId, std::size_t pageIdx )
+{
+  sqlite3pp::query qry( this->db,
+                        "SELECT doneCount FROM ScrapeProgress "
+                        "WHERE ( attrSetId = ? ) AND ( pageIdx = ? )" );
+  qry.bind( 1, static_cast<long long>( prefixId ) );
+  qry.bind( 2, static_cast<long long>( pageIdx ) );
+  auto itr = qry.begin();
+  if ( itr == qry.end() ) { return 0; }
+  return static_cast<std::size_t>( ( *itr ).get<long long>( 0 ) );
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void
+PkgDb::setScrapeProgress( row_id      prefixId,
+                          std::size_t pageIdx,
+                          std::size_t doneCount )
+{
+  sqlite3pp::command cmd(
+    this->db,
+    "INSERT OR REPLACE INTO ScrapeProgress ( attrSetId, pageIdx, doneCount )"
+    " VALUES ( ?, ?, ? )" );
+  cmd.bind( 1, static_cast<long long>( prefixId ) );
+  cmd.bind( 2, static_cast<long long>( pageIdx ) );
+  cmd.bind( 3, static_cast<long long>( doneCount ) );
+  if ( sql_rc rcode = cmd.execute(); isSQLError( rcode ) )
+    {
+      throw PkgDbException( nix::fmt( "failed to record scrape progress:(%d) %s",
+                                      rcode,
+                                      this->db.error_msg() ) );
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void
+PkgDb::addEvalFailure( row_id           parentId,
+                       std::string_view attrName,
+                       std::string_view errorMsg )
+{
+  sqlite3pp::command cmd(
+    this->db,
+    "INSERT OR REPLACE INTO EvalFailures ( parentId, attrName, errorMsg )"
+    " VALUES ( ?, ?, ? )" );
+  std::string attrNameS( attrName );
+  std::string errorMsgS( errorMsg );
+  cmd.bind( 1, static_cast<long long>( parentId ) );
+  cmd.bind( 2, attrNameS, sqlite3pp::copy );
+  cmd.bind( 3, errorMsgS, sqlite3pp::copy );
+  if ( sql_rc rcode = cmd.execute(); isSQLError( rcode ) )
+    {
+      throw PkgDbException( nix::fmt( "failed to record eval failure:(%d) %s",
+                                      rcode,
+                                      this->db.error_msg() ) );
+    }
+}
+
+
+std::unordered_set<std::string>
+PkgDb::getEvalFailures( row_id parentId )
+{
+  std::unordered_set<std::string> failures;
+  sqlite3pp::query qry( this->db,
+                        "SELECT attrName FROM EvalFailures "
+                        "WHERE ( parentId = ? )" );
+  qry.bind( 1, static_cast<long long>( parentId ) );
+  for ( auto row : qry ) { failures.emplace( row.get<std::string>( 0 ) ); }
+  return failures;
+}
+
+
+void
+PkgDb::clearEvalFailures( const flox::AttrPath & prefix )
+{
+  /* Subtree selection through the closure table, as in @a setPrefixDone. */
+  sqlite3pp::command cmd( this->db, R"SQL(
+    DELETE FROM EvalFailures WHERE parentId IN (
+      SELECT descendant FROM AttrSetClosure WHERE ( ancestor = ? )
+    )
+  )SQL" );
+  cmd.bind( 1,
+            static_cast<long long>( this->addOrGetAttrSetId( prefix ) ) );
+  if ( sql_rc rcode = cmd.execute(); isSQLError( rcode ) )
+    {
+      throw PkgDbException(
+        nix::fmt( "failed to clear eval failures for '%s':(%d) %s",
+                  concatStringsSep( ".", prefix ),
+                  rcode,
+                  this->db.error_msg() ) );
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void
+PkgDb::setPrefixDone( row_id prefixId, bool done )
+{
+  /* The closure table turns subtree selection into one indexed lookup.
+   * As with the recursive walk it replaces, root-level sets
+   * ( `parent = 0` ) are left untouched. */
+  sqlite3pp::command cmd( this->db, R"SQL(
+    UPDATE AttrSets SET done = ? WHERE ( parent != 0 ) AND id IN (
+      SELECT descendant FROM AttrSetClosure WHERE ( ancestor = ? )
+    )
+  )SQL" );
+  cmd.bind( 1, static_cast<int>( done ) );
+  cmd.bind( 2, static_cast<long long>( prefixId ) );
+  if ( sql_rc rcode = cmd.execute(); isSQLError( rcode ) )
+    {
+      throw PkgDbException(
+        nix::fmt( "failed to set AttrSets.done for subtree '%s':(%d) %s",
+                  concatStringsSep( ".", this->getAttrSetPath( prefixId ) ),
+                  rcode,
+                  this->db.error_msg() ) );
+    }
+
+  /* Refresh the prefix's `Stats' row when it completes.
+   * One aggregate pass per scrape keeps the numbers exact under
+   * `INSERT OR REPLACE' re-scrapes, where per-insert counters would drift.
+   * The wall-clock duration is recorded separately by the scrape driver. */
+  if ( ! done ) { return; }
+  sqlite3pp::command stats( this->db, R"SQL(
+    INSERT INTO Stats ( prefix, pkgCount, rowBytes, scrapedAt )
+    SELECT :prefix
+         , count( p.id )
+         , ifnull( sum( length( p.attrName ) + length( p.name )
+                      + ifnull( length( p.pname ), 0 )
+                      + ifnull( length( p.version ), 0 )
+                      + ifnull( length( p.license ), 0 )
+                      + ifnull( length( p.outputs ), 0 )
+                      + ifnull( length( p.outputsToInstall ), 0 )
+                      + ifnull( length( p.fullPath ), 0 ) ), 0 )
+         , CAST( strftime( '%s', 'now' ) AS INTEGER )
+    FROM Packages p
+    JOIN AttrSetClosure c ON ( p.parentId = c.descendant )
+    WHERE ( c.ancestor = :prefix )
+    ON CONFLICT ( prefix ) DO UPDATE
+    SET pkgCount  = excluded.pkgCount
+      , rowBytes  = excluded.rowBytes
+      , scrapedAt = excluded.scrapedAt
+  )SQL" );
+  stats.bind( ":prefix", static_cast<long long>( prefixId ) );
+  if ( sql_rc rcode = stats.execute(); isSQLError( rcode ) )
+    {
+      throw PkgDbException(
+        nix::fmt( "failed to refresh Stats for subtree '%s':(%d) %s",
+                  concatStringsSep( ".", this->getAttrSetPath( prefixId ) ),
+                  rcode,
+                  this->db.error_msg() ) );
+    }
+}
+
+void
+PkgDb::setPrefixDone( const flox::AttrPath & prefix, bool done )
+{
+  this->setPrefixDone( this->addOrGetAttrSetId( prefix ), done );
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+bool
+PkgDb::completedAttrSetCached( row_id row )
+{
+  if ( this->doneAttrSets.contains( row ) ) { return true; }
+  if ( ! this->completedAttrSet( row ) ) { return false; }
+  this->doneAttrSets.emplace( row );
+  return true;
+}
+
+
+void
+PkgDb::queuePrefixDone( row_id prefixId )
+{
+  this->doneAttrSets.emplace( prefixId );
+  this->pendingDonePrefixes.emplace_back( prefixId );
+}
+
+
+void
+PkgDb::flushDonePrefixes()
+{
+  for ( row_id prefixId : this->pendingDonePrefixes )
+    {
+      this->setPrefixDone( prefixId, true );
+    }
+  this->pendingDonePrefixes.clear();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void
+PkgDb::recordScrapeDuration( const flox::AttrPath & prefix, long long millis )
+{
+  sqlite3pp::command cmd( this->db,
+                          "INSERT INTO Stats ( prefix, scrapeMs ) "
+                          "VALUES ( ?, ? ) "
+                          "ON CONFLICT ( prefix ) DO UPDATE "
+                          "SET scrapeMs = excluded.scrapeMs" );
+  cmd.bind( 1,
+            static_cast<long long>( this->addOrGetAttrSetId( prefix ) ) );
+  cmd.bind( 2, millis );
+  if ( sql_rc rcode = cmd.execute(); isSQLError( rcode ) )
+    {
+      throw PkgDbException(
+        nix::fmt( "failed to record scrape duration for '%s':(%d) %s",
+                  concatStringsSep( ".", prefix ),
+                  rcode,
+                  this->db.error_msg() ) );
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void
+PkgDb::analyze()
+{
+  if ( sql_rc rcode = this->execute_all( "ANALYZE; PRAGMA optimize;" );
+       isSQLError( rcode ) )
+    {
+      throw PkgDbException( nix::fmt( "failed to analyze database:(%d) %s",
+                                      rcode,
+                                      this->db.error_msg() ) );
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+std::size_t
+PkgDb::loadPopularityRanks( const std::filesystem::path & ranksPath )
+{
+  nlohmann::json ranks
+    = nlohmann::json::parse( nix::readFile( ranksPath.string() ) );
+  if ( ! ranks.is_object() )
+    {
+      throw PkgDbException(
+        nix::fmt( "popularity ranks dataset '%s' must be a JSON object "
+                  "mapping `pname' to an integer rank",
+                  ranksPath.string() ) );
+    }
+
+  this->execute( "BEGIN TRANSACTION" );
+  sqlite3pp::command cmd( this->db,
+                          "UPDATE Packages SET popularityRank = ? "
+                          "WHERE pname = ?" );
+  for ( const auto & [pname, rank] : ranks.items() )
+    {
+      if ( ! rank.is_number_integer() )
+        {
+          throw PkgDbException(
+            nix::fmt( "invalid rank for '%s': expected an integer, got: %s",
+                      pname,
+                      rank.dump() ) );
+        }
+      cmd.bind( 1, rank.get<long long>() );
+      cmd.bind( 2, pname, sqlite3pp::copy );
+      if ( sql_rc rcode = cmd.execute(); isSQLError( rcode ) )
+        {
+          throw PkgDbException(
+            nix::fmt( "failed to set popularity rank for '%s':(%d) %s",
+                      pname,
+                      rcode,
+                      this->db.error_msg() ) );
+        }
+      cmd.reset();
+    }
+  this->execute( "COMMIT TRANSACTION" );
+
+  sqlite3pp::query qry(
+    this->db,
+    "SELECT COUNT( * ) FROM Packages WHERE popularityRank IS NOT NULL" );
+  return static_cast<std::size_t>( ( *qry.begin() ).get<long long>( 0 ) );
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Get the scrape RSS watermark in KiB.
+ *
+ * Eval memory per attribute varies by orders of magnitude between subtrees,
+ * so pages are ended early once the resident set crosses this mark rather
+ * than letting heavy subtrees OOM.
+ * Controlled by `PKGDB_SCRAPE_RSS_WATERMARK_MB`; `0` disables the check.
+ */
+static long
+getScrapeRssWatermarkKb()
+{
+  static const long watermarkKb = []() -> long
+  {
+    if ( const char * maybeMb = std::getenv( "PKGDB_SCRAPE_RSS_WATERMARK_MB" ) )
+      {
+        try
+          {
+            return std::stol( maybeMb ) * 1024;
+          }
+        catch ( const std::exception & )
+          { /* Fallthrough to the default below. */
+          }
+      }
+    return 4096L * 1024; /* 4 GiB */
+  }();
+  return watermarkKb;
+}
+
+
+/** @brief Get the process' current resident set size in KiB. */
+static long
+getCurrentRssKb()
+{
+  FILE * statm = fopen( "/proc/self/statm", "r" );
+  if ( statm == nullptr ) { return 0; }
+  long sizePages     = 0;
+  long residentPages = 0;
+  int  matched       = fscanf( statm, "%ld %ld", &sizePages, &residentPages );
+  fclose( statm );
+  if ( matched != 2 ) { return 0; }
+  return residentPages * ( sysconf( _SC_PAGESIZE ) / 1024 );
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Parent-pointer arena interning attribute paths for the scrape
+ *        _todo_ queue.
+ *
+ * Recursed attribute sets previously copied their full `AttrPath`
+ * ( a `std::vector<std::string>` ) onto the queue, duplicating every prefix
+ * component per node.
+ * The arena stores each component exactly once and queue entries carry a
+ * single integer handle; full paths are only materialized when a subtree is
+ * marked _done_.
+ */
+class PathArena
+{
+
+public:
+
+  using id_type = std::uint32_t;
+
+  /** Handle indicating _no parent_, i.e. the attribute path root. */
+  static constexpr id_type NONE = std::numeric_limits<id_type>::max();
+
+
+private:
+
+  struct Node
+  {
+    id_type     parent;
+    std::string name;
+  };
+
+  std::vector<Node> nodes;
+
+
+public:
+
+  /** @brief Intern a single path component under @a parent. */
+  id_type
+  intern( id_type parent, std::string name )
+  {
+    this->nodes.push_back( Node { parent, std::move( name ) } );
+    return static_cast<id_type>( this->nodes.size() - 1 );
+  }
+
+  /** @brief Intern a full attribute path, returning its handle. */
+  id_type
+  internPath( const flox::AttrPath & path )
+  {
+    id_type cur = NONE;
+    for ( const auto & part : path ) { cur = this->intern( cur, part ); }
+    return cur;
+  }
+
+  /** @brief Materialize the attribute path for a handle. */
+  [[nodiscard]] flox::AttrPath
+  resolve( id_type node ) const
+  {
+    flox::AttrPath path;
+    while ( node != NONE )
+      {
+        path.push_back( this->nodes[node].name );
+        node = this->nodes[node].parent;
+      }
+    std::reverse( path.begin(), path.end() );
+    return path;
+  }
+
+}; /* End class `PathArena' */
+
+
+/* -------------------------------------------------------------------------- */
+
+/* NOTE:
+ * Benchmarks on large catalogs have indicated that using a _todo_ queue instead
+ * of recursion is faster and consumes less memory.
+ * Repeated runs against `nixpkgs-flox` come in at ~2m03s using recursion and
+ * ~1m40s using a queue. */
+bool
+PkgDb::scrape( nix::SymbolTable & syms,
+               const Target &     target,
+               std::size_t        pageSize,
+               std::size_t        pageIdx,
+               bool               markPrefixDone,
+               bool *             hitWatermark )
+{
+  const auto & [prefix, cursor, parentId] = target;
+
+  TraceSpan span( "PkgDb::scrape" );
+  span.addArg( "prefix", concatStringsSep( ".", prefix ) );
+  span.addArg( "page", pageIdx );
+
+  /* If it has previously been scraped then bail out.
+   * Concurrent scrapers manage the `done' flag themselves, so the flag can
+   * never be set while their pages are still in flight. */
+  if ( markPrefixDone && this->completedAttrSetCached( parentId ) )
+    {
+      return true;
+    }
+
+  bool tryRecur = prefix.front() != "packages";
+  /* XXX: We explicitly recurse into `legacyPackages.*.darwin' due to a bug
+   *      in `nixpkgs' which doesn't set the `recurseForDerivations'
+   *      attribute correctly. */
+  bool isLegacy = prefix.front() == "legacyPackages";
+
+  debugLog( nix::fmt( "evaluating package set '%s'",
+                      concatStringsSep( ".", prefix ) ) );
+
+  const auto  pageStart  = std::chrono::steady_clock::now();
+  std::size_t pkgCount   = 0;
+  std::size_t evalErrors = 0;
+  emitProgressEvent( "page-begin",
+                     { { "prefix", concatStringsSep( ".", prefix ) },
+                       { "page", pageIdx } } );
+
+  /* Queue entries carry interned path handles rather than full `AttrPath'
+   * copies; the vector-backed stack also avoids the per-node allocation of
+   * the old `std::list' storage. */
+  PathArena arena;
+  using ArenaTarget = std::tuple<PathArena::id_type, flox::Cursor, row_id>;
+  using ArenaTodos  = std::stack<ArenaTarget, std::vector<ArenaTarget>>;
+
+  const ScrapeRules & rules = ScrapeRules::get();
+
+  /* Per-set cache of memoized eval failures, loaded lazily from
+   * `EvalFailures' the first time a set is visited. */
+  std::unordered_map<row_id, std::unordered_set<std::string>> knownFailures;
+
+  auto processAttrib
+    = [this,
+       &syms,
+       &arena,
+       &rules,
+       &pkgCount,
+       &evalErrors,
+       &knownFailures,
+       tryRecur,
+       isLegacy](
+        const flox::Cursor &      childCursor,
+        const PathArena::id_type  parentPath,
+        const flox::pkgdb::row_id parentId,
+        const nix::Symbol &       aname,
+        ArenaTodos &              todo ) -> bool
+  {
+    /* Consult exclusion rules before forcing the cursor; skipping eval is
+     * the cheapest optimization available. */
+    if ( ! rules.empty() )
+      {
+        flox::AttrPath childPath = arena.resolve( parentPath );
+        childPath.emplace_back( syms[aname] );
+        if ( ! rules.allowed( childPath ) )
+          {
+            traceLog( nix::fmt( "skipping excluded attribute path: '%s'.",
+                                concatStringsSep( ".", childPath ) ) );
+            return false;
+          }
+      }
+    /* Skip attributes that failed evaluation on a previous scrape of this
+     * flake revision; failed evals run all the way to their throw point, so
+     * they are the most expensive attributes to revisit.
+     * The memo lives in this database, which is keyed by the flake
+     * fingerprint, so entries never outlive the revision ( and eval cache )
+     * that produced them. */
+    if ( tryRecur )
+      {
+        auto failed = knownFailures.find( parentId );
+        if ( failed == knownFailures.end() )
+          {
+            failed = knownFailures
+                       .emplace( parentId, this->getEvalFailures( parentId ) )
+                       .first;
+          }
+        if ( failed->second.contains( syms[aname] ) )
+          {
+            traceLog(
+              nix::fmt( "skipping memoized eval failure: '%s.%s'.",
+                        concatStringsSep( ".", arena.resolve( parentPath ) ),
+                        std::string( syms[aname] ) ) );
+            ++evalErrors;
+            return false;
+          }
+      }
+    try
+      {
         if ( childCursor->isDerivation() )
           {
             this->addPackage( parentId, syms[aname], childCursor );
+            ++pkgCount;
             return false;
           }
         else if ( ! tryRecur ) { return false; }
         else if ( auto maybe
                   = childCursor->maybeGetAttr( "recurseForDerivations" );
                   ( ( maybe != nullptr ) && maybe->getBool() )
-                  /* XXX: We explicitly recurse into `legacyPackages.*.darwin'
-                   *      due to a bug in `nixpkgs' which doesn't set
-                   *      `recurseForDerivations' attribute correctly. */
-                  || ( ( prefix.front() == "legacyPackages" )
-                       && ( syms[aname] == "darwin" ) ) )
+                  || ( isLegacy && ( syms[aname] == "darwin" ) ) )
           {
-            flox::AttrPath path = prefix;
-            path.emplace_back( syms[aname] );
             row_id childId = this->addOrGetAttrSetId( syms[aname], parentId );
-            todo.emplace( std::make_tuple( std::move( path ),
-                                           std::move( childCursor ),
-                                           childId ) );
+            todo.emplace(
+              std::make_tuple( arena.intern( parentPath, syms[aname] ),
+                               std::move( childCursor ),
+                               childId ) );
             return true;
           }
         else { return false; }
@@ -490,6 +1670,13 @@ PkgDb::scrape( nix::SymbolTable & syms,
         /* Ignore errors in `legacyPackages' */
         if ( tryRecur )
           {
+            ++evalErrors;
+            /* Memoize the failure so later scrapes of this revision skip
+             * the attribute instead of repeating the eval. */
+            this->addEvalFailure(
+              parentId,
+              syms[aname],
+              nix::filterANSIEscapes( err.what(), true ) );
             /* Only print eval errors in "debug" mode. */
             nix::ignoreException( nix::lvlDebug );
             return false;
@@ -498,6 +1685,8 @@ PkgDb::scrape( nix::SymbolTable & syms,
       }
   };
 
+  PathArena::id_type rootPath = arena.internPath( prefix );
+
   auto   allAttribs   = cursor->getAttrs();
   size_t startIdx     = pageIdx * pageSize;
   size_t thisPageSize = startIdx + pageSize < allAttribs.size()
@@ -507,8 +1696,19 @@ PkgDb::scrape( nix::SymbolTable & syms,
   auto   page
     = std::views::counted( allAttribs.begin() + startIdx, thisPageSize );
 
+  /* Resume past attributes committed by a previous interrupted scrape of
+   * this page. */
+  std::size_t doneCount = this->getScrapeProgress( parentId, pageIdx );
+  std::size_t processed = 0;
+
   for ( nix::Symbol & aname : page )
     {
+      if ( processed < doneCount )
+        {
+          ++processed;
+          continue;
+        }
+
       if ( auto lvl = nix::lvlTalkative; lvl <= nix::verbosity )
         {
           const std::string pathS
@@ -516,37 +1716,91 @@ PkgDb::scrape( nix::SymbolTable & syms,
           traceLog( nix::fmt( "Processing attribute path: '%s'.", pathS ) );
         }
 
-      if ( syms[aname] == "recurseForDerivations" ) { continue; }
+      if ( syms[aname] == "recurseForDerivations" )
+        {
+          ++processed;
+          continue;
+        }
 
-      Todos        todo;
+      ArenaTodos   todo;
       flox::Cursor childCursor = cursor->getAttr( aname );
 
       /* Try processing this attribute.
        * If we are to recurse, todo will be loaded with the first target for
        * us... we process this subtree completely using the todo stack. */
-      if ( processAttrib( childCursor, prefix, parentId, aname, todo ) )
+      if ( processAttrib( childCursor, rootPath, parentId, aname, todo ) )
         {
-          const auto [parentPrefix, _a, _b] = todo.top();
+          const auto subtreeRootId = std::get<2>( todo.top() );
           do {
-              const auto [prefix, cursor, parentId] = todo.top();
+              const auto [pathId, cursor, parentId] = todo.top();
               todo.pop();
 
               for ( nix::Symbol & aname : cursor->getAttrs() )
                 {
                   if ( syms[aname] == "recurseForDerivations" ) { continue; }
                   flox::Cursor childCursor = cursor->getAttr( aname );
-                  processAttrib( childCursor, prefix, parentId, aname, todo );
+                  processAttrib( childCursor, pathId, parentId, aname, todo );
                 }
             }
           while ( ! todo.empty() );
 
-          this->setPrefixDone( parentPrefix, true );
+          this->queuePrefixDone( subtreeRootId );
+        }
+
+      /* Checkpoint the attribute inside the caller's open transaction, and
+       * periodically cycle the transaction so completed evaluation survives
+       * a crashed or killed scrape. */
+      ++processed;
+      this->setScrapeProgress( parentId, pageIdx, processed );
+      if ( ( processed % SCRAPE_CHECKPOINT_INTERVAL ) == 0 )
+        {
+          this->flushDonePrefixes();
+          this->execute( "COMMIT TRANSACTION" );
+          this->execute( "BEGIN TRANSACTION" );
+        }
+
+      /* End the page early if eval memory crosses the watermark; the
+       * checkpoint above lets a fresh process resume exactly here, so page
+       * size effectively adapts to per-attribute eval cost. */
+      if ( ( hitWatermark != nullptr ) && ( ( processed % 64 ) == 0 ) )
+        {
+          if ( long watermarkKb = getScrapeRssWatermarkKb();
+               ( 0 < watermarkKb ) && ( watermarkKb < getCurrentRssKb() ) )
+            {
+              emitProgressEvent(
+                "page-watermark",
+                { { "prefix", concatStringsSep( ".", prefix ) },
+                  { "page", pageIdx },
+                  { "attrs", processed } } );
+              *hitWatermark = true;
+              this->flushDonePrefixes();
+              return false;
+            }
         }
     }
 
-  if ( lastPage ) { this->setPrefixDone( prefix, true ); }
+  span.addArg( "attrs", processed );
+  span.addArg( "packages", pkgCount );
+  span.addArg( "evalErrors", evalErrors );
+
+  {
+    auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                       std::chrono::steady_clock::now() - pageStart )
+                       .count();
+    emitProgressEvent( "page-done",
+                       { { "prefix", concatStringsSep( ".", prefix ) },
+                         { "page", pageIdx },
+                         { "attrs", processed },
+                         { "packages", pkgCount },
+                         { "evalErrors", evalErrors },
+                         { "elapsedMs", elapsedMs } } );
+  }
+
+  /* Flush before returning so completions land in the caller's commit. */
+  this->flushDonePrefixes();
+
+  if ( lastPage && markPrefixDone ) { this->setPrefixDone( prefix, true ); }
   return lastPage;
-  ;
 }
 
 
@@ -339,6 +339,17 @@ FloxFlakeInput::getLockedInput()
 std::map<std::string, RegistryInput>
 FlakeRegistry::getLockedInputs()
 {
+  /* Fetch and lock every input's flake concurrently first; for fresh clones
+   * each fetch is an independent network operation, and the children leave
+   * the results in the shared local caches. */
+  std::vector<std::function<void()>> fetches;
+  for ( auto & [name, input] : *this )
+    {
+      fetches.emplace_back( [input]() { auto unusedFlake = input->getFlake(); } );
+    }
+  ensureFlakesAreDownloaded( fetches );
+
+  /* Assemble the locked inputs in priority order from the warm caches. */
   std::map<std::string, RegistryInput> locked;
   for ( auto & [name, input] : *this )
     {
@@ -7,6 +7,10 @@
  *
  * -------------------------------------------------------------------------- */
 
+#include <memory>
+#include <unordered_map>
+
+#include <nix/util.hh>
 #include <nlohmann/json.hpp>
 
 #include "flox/resolver/command.hh"
@@ -27,7 +31,20 @@ LockCommand::LockCommand() : parser( "lock" )
   this->addLockfileOption( this->parser );
   this->addGARegistryOption( this->parser );
   /* TODO: make manifest file optional and support locking global manifest. */
-  this->addManifestFileArg( this->parser, true );
+  this->addManifestFileArg( this->parser, false );
+
+  this->parser.add_argument( "--batch" )
+    .help( "lock every manifest passed as a positional argument, sharing "
+           "one store connection and one set of scraped databases" )
+    .nargs( 0 )
+    .action( [&]( const auto & ) { this->batch = true; } );
+
+  this->parser.add_argument( "manifests" )
+    .help( "manifest paths to lock ( requires '--batch' )" )
+    .metavar( "MANIFESTS..." )
+    .remaining()
+    .action( [&]( const std::string & path )
+             { this->batchPaths.emplace_back( path ); } );
 }
 
 
@@ -36,6 +53,15 @@ LockCommand::LockCommand() : parser( "lock" )
 int
 LockCommand::run()
 {
+  if ( this->batch ) { return this->runBatch(); }
+  if ( ! this->batchPaths.empty() )
+    {
+      throw FloxException( "manifest path arguments require '--batch'" );
+    }
+  if ( ! this->getManifestRaw().has_value() )
+    {
+      throw FloxException( "you must provide '--manifest' or '--batch'" );
+    }
   // TODO: `RegistryRaw' should drop empty fields.
   nlohmann::json lockfile
     = this->getEnvironment().createLockfile().getLockfileRaw();
@@ -45,6 +71,58 @@ LockCommand::run()
 }
 
 
+/* -------------------------------------------------------------------------- */
+
+int
+LockCommand::runBatch()
+{
+  if ( this->batchPaths.empty() )
+    {
+      throw FloxException( "'--batch' requires at least one manifest path" );
+    }
+
+  /* Every environment shares one store connection and, where their combined
+   * registries agree, one set of scraped databases; this amortizes setup
+   * that a per-manifest invocation pays in full. */
+  NixStoreMixin        storeMixin;
+  nix::ref<nix::Store> store  = storeMixin.getStore();
+  auto                 global = this->getGlobalManifest();
+
+  std::unordered_map<std::string,
+                     std::shared_ptr<Registry<pkgdb::PkgDbInputFactory>>>
+    registries;
+
+  for ( const auto & path : this->batchPaths )
+    {
+      EnvironmentManifest manifest = this->initManifest(
+        readManifestFromPath<ManifestRaw>( nix::absPath( path ) ) );
+      Environment environment( store, global, std::move( manifest ) );
+
+      /* Environments whose combined registries lock to the same inputs
+       * share a single scraped registry. */
+      std::string registryKey
+        = nlohmann::json( environment.getCombinedRegistryRaw() ).dump();
+      if ( auto shared = registries.find( registryKey );
+           shared != registries.end() )
+        {
+          environment.sharePkgDbRegistry( shared->second );
+        }
+
+      nlohmann::json lockfile = environment.createLockfile().getLockfileRaw();
+      registries.try_emplace(
+        registryKey,
+        static_cast<std::shared_ptr<Registry<pkgdb::PkgDbInputFactory>>>(
+          environment.getPkgDbRegistry() ) );
+
+      nlohmann::json entry
+        = { { "manifest", path }, { "lockfile", std::move( lockfile ) } };
+      std::cout << entry.dump() << std::endl;
+    }
+
+  return EXIT_SUCCESS;
+}
+
+
 /* -------------------------------------------------------------------------- */
 
 DiffCommand::DiffCommand() : parser( "diff" )
@@ -228,6 +306,12 @@ UpgradeCommand::UpgradeCommand() : parser( "upgrade" )
 
   this->addManifestFileArg( this->parser, false );
 
+  this->parser.add_argument( "--dry-run" )
+    .help( "report which packages would resolve to newer versions "
+           "without re-locking" )
+    .nargs( 0 )
+    .action( [&]( const auto & ) { this->dryRun = true; } );
+
   this->parser.add_argument( "groups" )
     .help( "names of groups or standalone packages to upgrade" )
     .metavar( "GROUPS..." )
@@ -254,9 +338,9 @@ UpgradeCommand::run()
   if ( ! this->groupsOrIIDS.has_value() ) { this->setUpgrades( true ); }
   else
     {
-      auto manifest           = this->getManifest();
-      auto descriptors        = manifest.getDescriptors();
-      auto groupedDescriptors = manifest.getGroupedDescriptors();
+      const auto & manifest           = this->getManifest();
+      const auto & descriptors        = manifest.getDescriptors();
+      const auto & groupedDescriptors = manifest.getGroupedDescriptors();
       std::vector<std::string> groupsToUpgrade;
       for ( const auto & groupOrIID : *this->groupsOrIIDS )
         {
@@ -301,6 +385,14 @@ UpgradeCommand::run()
       this->setUpgrades( groupsToUpgrade );
     }
 
+  /* Dry run: probe locked packages for newer versions without re-locking. */
+  if ( this->dryRun )
+    {
+      std::cout << this->getEnvironment().previewUpgrades().dump()
+                << std::endl;
+      return EXIT_SUCCESS;
+    }
+
   /* Generate lockfile. */
   Environment environment = this->getEnvironment();
   LockfileRaw newLockfile = environment.createLockfile().getLockfileRaw();
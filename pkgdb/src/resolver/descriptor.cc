@@ -27,6 +27,7 @@
 #include "flox/core/util.hh"
 #include "flox/pkgdb/pkg-query.hh"
 #include "flox/resolver/descriptor.hh"
+#include "flox/resolver/resolution-cache.hh"
 #include "versions.hh"
 
 
@@ -620,10 +621,10 @@ isAbsolutePath( const AttrPathGlob & attrs )
 
 /* -------------------------------------------------------------------------- */
 
-ManifestDescriptor::ManifestDescriptor( const ManifestDescriptorRaw & raw )
-  : name( raw.name )
+ManifestDescriptor::ManifestDescriptor( ManifestDescriptorRaw && raw )
+  : name( std::move( raw.name ) )
   , optional( raw.optional.value_or( false ) )
-  , group( raw.pkgGroup )
+  , group( std::move( raw.pkgGroup ) )
 {
   /* Determine if `version' was a range or not.
    * NOTE: The string "4.2.0" is not a range, but "4.2" is!
@@ -643,7 +644,7 @@ ManifestDescriptor::ManifestDescriptor( const ManifestDescriptorRaw & raw )
   /* Only set if it wasn't handled by `absPath`. */
   if ( ( ! this->systems.has_value() ) && raw.systems.has_value() )
     {
-      this->systems = *raw.systems;
+      this->systems = std::move( *raw.systems );
     }
 
   if ( raw.pkgPath.has_value() )
@@ -654,7 +655,7 @@ ManifestDescriptor::ManifestDescriptor( const ManifestDescriptorRaw & raw )
         {
           pkgPath = splitAttrPath( std::get<std::string>( *raw.pkgPath ) );
         }
-      else { pkgPath = std::get<AttrPath>( *raw.pkgPath ); }
+      else { pkgPath = std::move( std::get<AttrPath>( *raw.pkgPath ) ); }
 
       if ( this->pkgPath.has_value() )
         {
@@ -664,7 +665,7 @@ ManifestDescriptor::ManifestDescriptor( const ManifestDescriptorRaw & raw )
                 "'pkg-path' conflicts with with 'abspath'" );
             }
         }
-      else { this->pkgPath = pkgPath; }
+      else { this->pkgPath = std::move( pkgPath ); }
     }
 
   if ( raw.packageRepository.has_value() )
@@ -716,12 +717,14 @@ ManifestDescriptor::fillPkgQueryArgs( pkgdb::PkgQueryArgs & pqa ) const
   else if ( this->semver.has_value() )
     {
       pqa.semver = *this->semver;
-      /* Use `preferPreRelease' on `~<VERSION>-<TAG>' ranges. */
+      /* Use `preferPreRelease' on `~<VERSION>-<TAG>' ranges.
+       * Compiled once; this runs for every descriptor of every lock. */
+      static const std::regex preReleaseRange( "~[^ ]+-.*",
+                                               std::regex::ECMAScript );
       if ( this->semver->at( 0 ) == '~' )
         {
-          pqa.preferPreReleases = std::regex_match(
-            *this->semver,
-            std::regex( "~[^ ]+-.*", std::regex::ECMAScript ) );
+          pqa.preferPreReleases
+            = std::regex_match( *this->semver, preReleaseRange );
         }
     }
 
@@ -752,6 +755,70 @@ to_json( nlohmann::json & jto, const ManifestDescriptor & descriptor )
   };
 }
 
+
+/* -------------------------------------------------------------------------- */
+
+void
+from_json( const nlohmann::json & jfrom, ManifestDescriptor & descriptor )
+{
+  descriptor.clear();
+  if ( const auto & name = jfrom.at( "name" ); ! name.is_null() )
+    {
+      descriptor.name = name.get<std::string>();
+    }
+  descriptor.optional = jfrom.at( "optional" ).get<bool>();
+  if ( const auto & group = jfrom.at( "group" ); ! group.is_null() )
+    {
+      descriptor.group = group.get<GroupName>();
+    }
+  if ( const auto & version = jfrom.at( "version" ); ! version.is_null() )
+    {
+      descriptor.version = version.get<std::string>();
+    }
+  if ( const auto & semver = jfrom.at( "semver" ); ! semver.is_null() )
+    {
+      descriptor.semver = semver.get<std::string>();
+    }
+  if ( const auto & subtree = jfrom.at( "subtree" ); ! subtree.is_null() )
+    {
+      descriptor.subtree = subtree.get<Subtree>();
+    }
+  if ( const auto & systems = jfrom.at( "systems" ); ! systems.is_null() )
+    {
+      descriptor.systems = systems.get<std::vector<System>>();
+    }
+  if ( const auto & pkgPath = jfrom.at( "pkg-path" ); ! pkgPath.is_null() )
+    {
+      descriptor.pkgPath = pkgPath.get<flox::AttrPath>();
+    }
+  if ( const auto & input = jfrom.at( "input" ); ! input.is_null() )
+    {
+      descriptor.input = input.get<nix::FlakeRef>();
+    }
+  descriptor.priority = jfrom.at( "priority" ).get<unsigned>();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+ManifestDescriptor
+getManifestDescriptor( std::string_view              installID,
+                       const ManifestDescriptorRaw & raw )
+{
+  if ( ! useResolutionCache() )
+    {
+      return ManifestDescriptor( installID, raw );
+    }
+  std::string key = descriptorCacheKey( installID, raw );
+  if ( auto cached = lookupCachedDescriptor( key ); cached.has_value() )
+    {
+      return *cached;
+    }
+  ManifestDescriptor descriptor( installID, raw );
+  recordCachedDescriptor( key, descriptor );
+  return descriptor;
+}
+
 }  // namespace flox::resolver
 
 
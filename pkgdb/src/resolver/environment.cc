@@ -9,6 +9,10 @@
 
 #include <algorithm>
 #include <assert.h>
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <string_view>
 #include <memory>
 #include <optional>
 #include <ostream>
@@ -22,7 +26,9 @@
 #include <nix/logging.hh>
 #include <nix/ref.hh>
 #include <nlohmann/json.hpp>
+#include <sqlite3pp.hh>
 
+#include "flox/core/trace.hh"
 #include "flox/core/types.hh"
 #include "flox/pkgdb/input.hh"
 #include "flox/pkgdb/pkg-query.hh"
@@ -33,6 +39,7 @@
 #include "flox/resolver/lockfile.hh"
 #include "flox/resolver/manifest-raw.hh"
 #include "flox/resolver/manifest.hh"
+#include "flox/resolver/resolution-cache.hh"
 
 
 /* -------------------------------------------------------------------------- */
@@ -116,6 +123,23 @@ Environment::getCombinedRegistryRaw()
 }
 
 
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Whether scraping and resolution are pipelined.
+ *
+ * Opt-in; set `PKGDB_SCRAPE_PIPELINE=1` to let resolution query a
+ * partially-populated database, blocking only on the prefixes it needs.
+ */
+static bool
+pipelinedScrape()
+{
+  const char * maybeEnabled = std::getenv( "PKGDB_SCRAPE_PIPELINE" );
+  return ( maybeEnabled != nullptr )
+         && ( std::string_view( maybeEnabled ) != "0" );
+}
+
+
 /* -------------------------------------------------------------------------- */
 
 nix::ref<Registry<pkgdb::PkgDbInputFactory>>
@@ -129,15 +153,98 @@ Environment::getPkgDbRegistry()
         this->getCombinedRegistryRaw(),
         factory );
       /* Scrape if needed. */
-      for ( auto & [name, input] : *this->dbs )
+      if ( pipelinedScrape() )
+        {
+          /* Resolve each input's subtrees up front ( cached ), then scrape
+           * in the background; resolution blocks per-prefix via
+           * `awaitScrapedPrefixes' instead of waiting for whole scrapes. */
+          for ( auto & [name, input] : *this->dbs )
+            {
+              std::vector<Subtree> subtrees = input->getSubtrees();
+              std::shared_future<void> future
+                = std::async( std::launch::async,
+                              [input, systems = this->getSystems()]()
+                              { input->scrapeSystems( systems ); } )
+                    .share();
+              this->pipelinedScrapes.emplace(
+                input->getDbReadOnly()->getFingerprint().to_string(
+                  nix::Base16,
+                  false ),
+                PipelinedScrape { std::move( future ),
+                                  std::move( subtrees ) } );
+            }
+        }
+      else
         {
-          input->scrapeSystems( this->getSystems() );
+          for ( auto & [name, input] : *this->dbs )
+            {
+              input->scrapeSystems( this->getSystems() );
+            }
         }
     }
   return static_cast<nix::ref<Registry<pkgdb::PkgDbInputFactory>>>( this->dbs );
 }
 
 
+/* -------------------------------------------------------------------------- */
+
+void
+Environment::awaitScrapedPrefixes( const pkgdb::PkgDbInput &   input,
+                                   const pkgdb::PkgQueryArgs & args )
+{
+  if ( this->pipelinedScrapes.empty() ) { return; }
+  auto dbRO  = input.getDbReadOnly();
+  auto entry = this->pipelinedScrapes.find(
+    dbRO->getFingerprint().to_string( nix::Base16, false ) );
+  if ( entry == this->pipelinedScrapes.end() ) { return; }
+
+  const auto & [future, subtrees] = entry->second;
+  const std::vector<Subtree> & wanted
+    = args.subtrees.has_value() ? *args.subtrees : subtrees;
+  for ( const auto & subtree : wanted )
+    {
+      flox::AttrPath prefix
+        = { static_cast<std::string>( to_string( subtree ) ) };
+      for ( const auto & system : args.systems )
+        {
+          prefix.emplace_back( system );
+          while ( ! dbRO->completedAttrSet( prefix ) )
+            {
+              if ( future.wait_for( std::chrono::milliseconds( 100 ) )
+                   == std::future_status::ready )
+                {
+                  /* The whole scrape finished ( or failed );
+                   * propagate any failure and stop waiting. */
+                  future.get();
+                  break;
+                }
+            }
+          prefix.pop_back();
+        }
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+const std::unordered_map<std::string, std::shared_ptr<pkgdb::PkgDbInput>> &
+Environment::getFingerprintedInputs()
+{
+  if ( ! this->fingerprintedInputs.has_value() )
+    {
+      this->fingerprintedInputs.emplace();
+      for ( const auto & [name, input] : *this->getPkgDbRegistry() )
+        {
+          this->fingerprintedInputs->emplace(
+            input->getDbReadOnly()->getFingerprint().to_string( nix::Base16,
+                                                                false ),
+            input );
+        }
+    }
+  return *this->fingerprintedInputs;
+}
+
+
 /* -------------------------------------------------------------------------- */
 
 std::optional<ManifestRaw>
@@ -201,15 +308,17 @@ Environment::groupIsLocked( const GroupName &          name,
    * locked again. */
   if ( upgradingGroup( name ) ) { return false; }
 
-  auto packages = oldLockfile.getLockfileRaw().packages;
+  /* These maps are read-only here; take references so checking a group is
+   * index lookups rather than copying every locked package and descriptor. */
+  const auto & packages = oldLockfile.getLockfileRaw().packages;
   if ( ! packages.contains( system ) ) { return false; }
 
-  SystemPackages oldSystemPackages = packages.at( system );
+  const SystemPackages & oldSystemPackages = packages.at( system );
 
-  InstallDescriptors oldDescriptors = oldLockfile.getDescriptors();
+  const InstallDescriptors & oldDescriptors = oldLockfile.getDescriptors();
 
   /* Check for upgrades. */
-  for ( auto & [iid, descriptor] : group )
+  for ( const auto & [iid, descriptor] : group )
     {
       /* If the descriptor has changed compared to the one in the lockfile
        * manifest, it needs to be locked again. */
@@ -395,14 +504,41 @@ Environment::tryResolveDescriptorIn( const ManifestDescriptor & descriptor,
   descriptor.fillPkgQueryArgs( args );
   /* Limit results to the target system. */
   args.systems = std::vector<System> { system };
+
+  /* Resolution against a fingerprinted database is deterministic, so a
+   * previously recorded answer ( including _no match_ ) can skip SQL. */
+  std::optional<std::string> cacheKey;
+  if ( useResolutionCache() )
+    {
+      cacheKey
+        = resolutionCacheKey( input.getDbReadOnly()->getFingerprint(), args );
+      if ( auto cached
+           = lookupCachedResolution( *input.getDbReadOnly(), *cacheKey );
+           cached.has_value() )
+        {
+          debugLog( "resolved descriptor from resolution cache" );
+          return *cached;
+        }
+    }
+
+  /* In pipelined mode, block until the prefixes this query touches have
+   * been scraped rather than on the whole input. */
+  this->awaitScrapedPrefixes( input, args );
+
   pkgdb::PkgQuery query( args );
   auto            rows = query.execute( input.getDbReadOnly()->db );
-  if ( rows.empty() )
+  std::optional<pkgdb::row_id> row;
+  if ( ! rows.empty() ) { row = rows.front(); }
+  if ( cacheKey.has_value() )
+    {
+      recordCachedResolution( *input.getDbReadOnly(), *cacheKey, row );
+    }
+  if ( ! row.has_value() )
     {
       debugLog( "package not found in input" );
       return std::nullopt;
     }
-  return rows.front();
+  return row;
 }
 
 
@@ -414,18 +550,27 @@ Environment::lockPackage( const LockedInputRaw & input,
                           pkgdb::row_id          row,
                           unsigned               priority )
 {
-  nlohmann::json   info = dbRO.getPackage( row );
-  LockedPackageRaw pkg;
-  pkg.input = input;
-  info.at( "absPath" ).get_to( pkg.attrPath );
+  nlohmann::json info = dbRO.getPackage( row );
+
+  /* Move the attribute path's strings out of the owned JSON rather than
+   * copying them; `info' is dropped below anyhow. */
+  AttrPath attrPath;
+  auto &   absPath = info.at( "absPath" );
+  attrPath.reserve( absPath.size() );
+  for ( auto & part : absPath )
+    {
+      attrPath.emplace_back( std::move( part.get_ref<std::string &>() ) );
+    }
   info.erase( "absPath" );
   info.erase( "relPath" );
   info.erase( "subtree" );
   info.erase( "id" );
   info.erase( "system" );
-  pkg.priority = priority;
-  pkg.info     = std::move( info );
-  return pkg;
+
+  return LockedPackageRaw { .input    = input,
+                            .attrPath = std::move( attrPath ),
+                            .priority = priority,
+                            .info     = std::move( info ) };
 }
 
 
@@ -436,11 +581,11 @@ Environment::getGroupInput( const InstallDescriptors & group,
                             const Lockfile &           oldLockfile,
                             const System &             system ) const
 {
-  auto packages = oldLockfile.getLockfileRaw().packages;
+  const auto & packages = oldLockfile.getLockfileRaw().packages;
   if ( ! packages.contains( system ) ) { return std::nullopt; }
-  SystemPackages oldSystemPackages = packages.at( system );
+  const SystemPackages & oldSystemPackages = packages.at( system );
 
-  InstallDescriptors oldDescriptors = oldLockfile.getDescriptors();
+  const InstallDescriptors & oldDescriptors = oldLockfile.getDescriptors();
 
   std::optional<LockedInputRaw> wrongGroupInput;
   /* We could look for packages where just the _iid_ has changed, but for now
@@ -507,18 +652,24 @@ Environment::getGroupInput( const InstallDescriptors & group,
 
 /* -------------------------------------------------------------------------- */
 
-std::variant<InstallID, SystemPackages>
+std::variant<std::vector<InstallID>, SystemPackages>
 Environment::tryResolveGroupIn( const InstallDescriptors & group,
                                 const pkgdb::PkgDbInput &  input,
                                 const System &             system )
 {
   std::unordered_map<InstallID, std::optional<pkgdb::row_id>> pkgRows;
+  std::vector<InstallID>                                      failed;
+  pkgRows.reserve( group.size() );
 
   std::string inputName;
   if ( auto name = input.getName(); name.has_value() ) { inputName = *name; }
   else { inputName = "<none>"; }
   debugLog( "resolving group in input: " + inputName );
-  /* Loop over each descriptor. */
+  /* Compile the whole group into one batched query; a single pass over the
+   * database replaces one round-trip per descriptor. */
+  std::vector<pkgdb::PkgQueryArgs> argsList;
+  std::vector<InstallID>           argIds;
+  std::vector<std::string>         argKeys;
   for ( const auto & [iid, descriptor] : group )
     {
       debugLog( "resolving install ID '" + iid + "'" );
@@ -533,21 +684,109 @@ Environment::tryResolveGroupIn( const InstallDescriptors & group,
           continue;
         }
 
-      /* Try resolving.
-       * If resolution fails, return the _iid_ of the **first**
-       * failed descriptor. */
-      std::optional<pkgdb::row_id> maybeRow
-        = this->tryResolveDescriptorIn( descriptor, input, system );
-      if ( maybeRow.has_value() || descriptor.optional )
+      pkgdb::PkgQueryArgs args = this->getCombinedBaseQueryArgs();
+      input.fillPkgQueryArgs( args );
+      descriptor.fillPkgQueryArgs( args );
+      /* Limit results to the target system. */
+      args.systems = std::vector<System> { system };
+
+      std::string cacheKey;
+      if ( useResolutionCache() )
+        {
+          cacheKey
+            = resolutionCacheKey( input.getDbReadOnly()->getFingerprint(),
+                                  args );
+        }
+      argsList.emplace_back( std::move( args ) );
+      argIds.emplace_back( iid );
+      argKeys.emplace_back( std::move( cacheKey ) );
+    }
+
+  /* A recorded group failure skips this input with a single lookup; the
+   * member keys incorporate the fingerprint, so a rescraped input or any
+   * changed descriptor misses and resolves fresh. */
+  std::string groupKey;
+  if ( useResolutionCache() && ( ! argKeys.empty() ) )
+    {
+      groupKey = groupResolutionCacheKey( argKeys );
+      if ( auto failedId = lookupCachedGroupMiss( groupKey );
+           failedId.has_value() && ( group.find( *failedId ) != group.end() ) )
+        {
+          debugLog( "skipping input from group resolution cache" );
+          return std::vector<InstallID> { *failedId };
+        }
+    }
+
+  /* Resolution against a fingerprinted database is deterministic, so
+   * previously recorded answers ( including _no match_ ) skip SQL. */
+  std::vector<pkgdb::PkgQueryArgs> queryArgs;
+  std::vector<InstallID>           queryIds;
+  std::vector<std::string>         queryKeys;
+  for ( size_t idx = 0; idx < argIds.size(); ++idx )
+    {
+      const InstallID & iid = argIds[idx];
+      if ( ! argKeys[idx].empty() )
+        {
+          if ( auto cached = lookupCachedResolution( *input.getDbReadOnly(),
+                                                     argKeys[idx] );
+               cached.has_value() )
+            {
+              debugLog( "resolved install ID '" + iid
+                        + "' from resolution cache" );
+              if ( cached->has_value() || group.at( iid ).optional )
+                {
+                  pkgRows.emplace( iid, *cached );
+                }
+              /* A cached failure fails the group just like a fresh one. */
+              else { failed.emplace_back( iid ); }
+              continue;
+            }
+        }
+      queryArgs.emplace_back( std::move( argsList[idx] ) );
+      queryIds.emplace_back( iid );
+      queryKeys.emplace_back( argKeys[idx] );
+    }
+
+  /* In pipelined mode, block until the prefixes these queries touch have
+   * been scraped rather than on the whole input. */
+  for ( const auto & args : queryArgs )
+    {
+      this->awaitScrapedPrefixes( input, args );
+    }
+
+  auto rows = input.getDbReadOnly()->queryMany( queryArgs );
+  for ( size_t idx = 0; idx < queryIds.size(); ++idx )
+    {
+      const InstallID & iid      = queryIds[idx];
+      const auto &      maybeRow = rows[idx];
+      if ( ! queryKeys[idx].empty() )
+        {
+          recordCachedResolution( *input.getDbReadOnly(),
+                                  queryKeys[idx],
+                                  maybeRow );
+        }
+      /* Collect every unsatisfiable descriptor rather than bailing on the
+       * first, so one pass reports the complete failure set. */
+      if ( maybeRow.has_value() || group.at( iid ).optional )
         {
           debugLog( "found match for install ID '" + iid + "'" );
           pkgRows.emplace( iid, maybeRow );
         }
-      else { return iid; }
+      else { failed.emplace_back( iid ); }
+    }
+
+  if ( ! failed.empty() )
+    {
+      if ( ! groupKey.empty() )
+        {
+          recordCachedGroupMiss( groupKey, failed.front() );
+        }
+      return failed;
     }
 
   /* Convert to `LockedPackageRaw's */
   SystemPackages pkgs;
+  pkgs.reserve( pkgRows.size() );
   LockedInputRaw lockedInput( input );
   auto           dbRO = input.getDbReadOnly();
   for ( const auto & [iid, maybeRow] : pkgRows )
@@ -586,6 +825,30 @@ getGroupName( const InstallDescriptors & group )
 }
 
 
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Whether @a descriptor still describes the same package it did when
+ *        @a oldDescriptor was locked.
+ *
+ * Mirrors the field comparisons in @a Environment::getGroupInput:
+ * `optional' and `priority' don't change what the package _is_, and `group'
+ * membership is handled by the caller.
+ */
+[[nodiscard]] static inline bool
+descriptorUnchanged( const ManifestDescriptor & descriptor,
+                     const ManifestDescriptor & oldDescriptor )
+{
+  return ( descriptor.name == oldDescriptor.name )
+         && ( descriptor.pkgPath == oldDescriptor.pkgPath )
+         && ( descriptor.version == oldDescriptor.version )
+         && ( descriptor.semver == oldDescriptor.semver )
+         && ( descriptor.subtree == oldDescriptor.subtree )
+         && ( descriptor.input == oldDescriptor.input )
+         && ( descriptor.systems == oldDescriptor.systems );
+}
+
+
 /* -------------------------------------------------------------------------- */
 
 ResolutionResult
@@ -607,7 +870,7 @@ Environment::tryResolveGroup( const GroupName &          name,
    * If we fail collect a list of failed descriptors; presumably these are
    * new group members.
    * Skip this step if a group is being upgraded. */
-  std::optional<pkgdb::PkgDbInput> oldGroupInput;
+  std::shared_ptr<pkgdb::PkgDbInput> oldGroupInput;
   if ( ! upgradingGroup( name ) )
     {
       if ( auto oldLockfile = this->getOldLockfile(); oldLockfile.has_value() )
@@ -620,11 +883,74 @@ Environment::tryResolveGroup( const GroupName &          name,
               RegistryInput registryInput( *lockedInput );
               debugLog( "group previously had input: "
                         + registryInput.from->to_string() );
-              nix::ref<nix::Store> store = this->getStore();
-              oldGroupInput = pkgdb::PkgDbInput( store, registryInput );
+              /* The pinned input is usually still in the registry; its
+               * fingerprint finds it in one hash lookup, reusing the already
+               * fetched flake and open database connection rather than
+               * re-fetching and re-locking the flake. */
+              const auto & byFingerprint = this->getFingerprintedInputs();
+              if ( auto match = byFingerprint.find(
+                     lockedInput->fingerprint.to_string( nix::Base16, false ) );
+                   match != byFingerprint.end() )
+                {
+                  debugLog( "group input matches registry input "
+                            "by fingerprint" );
+                  oldGroupInput = match->second;
+                }
+              else
+                {
+                  nix::ref<nix::Store> store = this->getStore();
+                  oldGroupInput
+                    = std::make_shared<pkgdb::PkgDbInput>( store,
+                                                           registryInput );
+                }
+
+              /* Descriptor-level diffing: members unchanged since the old
+               * lock reuse their locked entries, so adding one package to a
+               * large group costs one resolution rather than re-resolving
+               * every member. */
+              InstallDescriptors toResolve = group;
+              SystemPackages     reused;
+              const auto & oldDescriptors = oldLockfile->getDescriptors();
+              const auto & oldPackages
+                = oldLockfile->getLockfileRaw().packages;
+              if ( auto oldSystem = oldPackages.find( system );
+                   oldSystem != oldPackages.end() )
+                {
+                  for ( auto iter = toResolve.begin();
+                        iter != toResolve.end(); )
+                    {
+                      const auto & [iid, descriptor] = *iter;
+                      auto oldDescriptor = oldDescriptors.find( iid );
+                      auto oldLocked     = oldSystem->second.find( iid );
+                      /* Reuse only entries locked to the group's pinned
+                       * input, so the group stays input-consistent. */
+                      if ( ( oldDescriptor != oldDescriptors.end() )
+                           && ( oldLocked != oldSystem->second.end() )
+                           && descriptorUnchanged( descriptor,
+                                                   oldDescriptor->second )
+                           && ( ( ! oldLocked->second.has_value() )
+                                || ( oldLocked->second->input
+                                     == *lockedInput ) ) )
+                        {
+                          reused.emplace( iid, oldLocked->second );
+                          if ( reused.at( iid ).has_value() )
+                            {
+                              reused.at( iid )->priority = descriptor.priority;
+                            }
+                          iter = toResolve.erase( iter );
+                        }
+                      else { ++iter; }
+                    }
+                }
+              if ( ! reused.empty() )
+                {
+                  debugLog( "reusing " + std::to_string( reused.size() )
+                            + " unchanged locked package(s) for group" );
+                }
+              if ( toResolve.empty() ) { return reused; }
 
               auto maybeResolved
-                = this->tryResolveGroupIn( group, *oldGroupInput, system );
+                = this->tryResolveGroupIn( toResolve, *oldGroupInput, system );
 
               /* If we're able to resolve the group with the same input+rev as
                * the old lockfile's pin, then we're done. */
@@ -633,18 +959,24 @@ Environment::tryResolveGroup( const GroupName &          name,
               //      template deduction failed with `gcc'.
               //      Rather than adding deduction guides and stuff
               //      `std::get_if' is fine here.
-              if ( const SystemPackages * resolved
+              if ( SystemPackages * resolved
                    = std::get_if<SystemPackages>( &maybeResolved ) )
                 {
+                  resolved->merge( reused );
                   return *resolved;
                 }
 
-              if ( const InstallID * iid
-                   = std::get_if<InstallID>( &maybeResolved ) )
+              if ( const std::vector<InstallID> * iids
+                   = std::get_if<std::vector<InstallID>>( &maybeResolved ) )
                 {
-                  failure.push_back( std::pair<InstallID, std::string> {
-                    *iid,
-                    oldGroupInput->getDbReadOnly()->lockedRef.string } );
+                  for ( const InstallID & iid : *iids )
+                    {
+                      failure.push_back( std::pair<InstallID, std::string> {
+                        iid,
+                        oldGroupInput->getDbReadOnly()
+                          ->getLockedRef()
+                          .string } );
+                    }
                 }
               else
                 {
@@ -657,13 +989,58 @@ Environment::tryResolveGroup( const GroupName &          name,
 
   /* If we've made it to this point, we know there are some unlocked descriptors
    * in this group that need to be resolved. */
-  for ( const auto & [_, input] : *this->getPkgDbRegistry() )
+
+  /* Adaptive ordering: most groups always resolve in the same input, so try
+   * the historically successful one first; manifest priority order is kept
+   * for every other input and whenever the record is stale.
+   * The key covers every registry input's name and fingerprint in priority
+   * order, so any change to the inputs, their revisions, or their order
+   * misses and the scan below runs in pure priority order; within one fixed
+   * registry that scan is deterministic, making the reorder a pure
+   * optimization which cannot change which input wins. */
+  std::vector<std::pair<std::string, std::shared_ptr<pkgdb::PkgDbInput>>>
+    orderedInputs;
+  for ( const auto & [inputName, input] : *this->getPkgDbRegistry() )
+    {
+      orderedInputs.emplace_back( inputName, input );
+    }
+  std::string preferenceKey;
+  if ( useResolutionCache() )
+    {
+      std::vector<std::string> inputKeys;
+      inputKeys.reserve( orderedInputs.size() );
+      for ( const auto & [inputName, input] : orderedInputs )
+        {
+          inputKeys.emplace_back(
+            inputName + "="
+            + input->getDbReadOnly()->getFingerprint().to_string(
+              nix::Base16,
+              false ) );
+        }
+      preferenceKey = preferredInputKey( group, system, inputKeys );
+      if ( auto preferred = lookupPreferredInput( preferenceKey );
+           preferred.has_value() )
+        {
+          auto match = std::find_if( orderedInputs.begin(),
+                                     orderedInputs.end(),
+                                     [&]( const auto & entry )
+                                     { return entry.first == *preferred; } );
+          if ( match != orderedInputs.end() )
+            {
+              std::rotate( orderedInputs.begin(), match, match + 1 );
+            }
+        }
+    }
+
+  for ( const auto & [inputName, input] : orderedInputs )
     {
       /* If there is an existing lock we'll try to use the same input+rev as the
        * old lockfile's pin.
        * If we fail collect a list of failed descriptors we will return a list
        * of failed descriptors. */
-      if ( ! ( oldGroupInput.has_value() && *input == *oldGroupInput ) )
+      if ( ! ( ( oldGroupInput != nullptr )
+               && ( input->getDbReadOnly()->getFingerprint()
+                    == oldGroupInput->getDbReadOnly()->getFingerprint() ) ) )
         {
           auto maybeResolved = this->tryResolveGroupIn( group, *input, system );
           if ( const SystemPackages * resolved
@@ -674,14 +1051,21 @@ Environment::tryResolveGroup( const GroupName &          name,
                                           "resolution failure",
                                           getGroupName( group ) ) );
 
+              if ( ! preferenceKey.empty() )
+                {
+                  recordPreferredInput( preferenceKey, inputName );
+                }
               return *resolved;
             }
-          else if ( const InstallID * iid
-                    = std::get_if<InstallID>( &maybeResolved ) )
+          else if ( const std::vector<InstallID> * iids
+                    = std::get_if<std::vector<InstallID>>( &maybeResolved ) )
             {
-              failure.push_back( std::pair<InstallID, std::string> {
-                *iid,
-                input->getDbReadOnly()->lockedRef.string } );
+              for ( const InstallID & iid : *iids )
+                {
+                  failure.push_back( std::pair<InstallID, std::string> {
+                    iid,
+                    input->getDbReadOnly()->getLockedRef().string } );
+                }
             }
           else
             {
@@ -713,12 +1097,12 @@ describeResolutionFailure( std::stringstream &       msg,
 
 /* -------------------------------------------------------------------------- */
 
-void
+SystemPackages
 Environment::lockSystem( const System & system )
 {
-  /* This should only be called from `Environment::createLock()' after
-   * initializing `lockfileRaw'. */
-  assert( this->lockfileRaw.has_value() );
+  /* This should only be called from `Environment::createLockfile()' after
+   * forcing lazily initialized shared state, so that the reads below are
+   * safe from multiple threads. */
   SystemPackages pkgs;
 
   auto groups = this->getUnlockedGroups( system );
@@ -772,9 +1156,9 @@ Environment::lockSystem( const System & system )
        oldLockfile.has_value()
        && oldLockfile->getLockfileRaw().packages.contains( system ) )
     {
-      SystemPackages systemPackages
+      const SystemPackages & systemPackages
         = oldLockfile->getLockfileRaw().packages.at( system );
-      auto oldDescriptors = oldLockfile->getDescriptors();
+      const auto & oldDescriptors = oldLockfile->getDescriptors();
       for ( const auto & [_, group] : this->getLockedGroups( system ) )
         {
           for ( const auto & [iid, descriptor] : group )
@@ -789,7 +1173,7 @@ Environment::lockSystem( const System & system )
         }
     }
 
-  this->lockfileRaw->packages.emplace( system, std::move( pkgs ) );
+  return pkgs;
 }
 
 
@@ -798,23 +1182,176 @@ Environment::lockSystem( const System & system )
 Lockfile
 Environment::createLockfile()
 {
+  TraceSpan span( "Environment::createLockfile" );
   if ( ! this->lockfileRaw.has_value() )
     {
       this->lockfileRaw           = LockfileRaw {};
       this->lockfileRaw->manifest = this->getManifestRaw();
       this->lockfileRaw->registry = this->getCombinedRegistryRaw();
-      /* Lock each system. */
-      for ( const auto & system : this->getSystems() )
+
+      /* Version 1 deduplicates locked inputs in the emitted lockfile.
+       * Opt-in until every lockfile consumer understands references. */
+      if ( const char * compact = std::getenv( "PKGDB_LOCKFILE_COMPACT" );
+           ( compact != nullptr ) && ( std::string_view( compact ) != "0" ) )
+        {
+          this->lockfileRaw->lockfileVersion = 1;
+        }
+
+      /* Force lazily initialized shared state ( scraping inputs and opening
+       * read-only connections as needed ) on this thread, so that locking a
+       * system only performs reads. */
+      for ( const auto & [name, input] : *this->getPkgDbRegistry() )
+        {
+          (void) input->getDbReadOnly();
+        }
+      (void) this->getCombinedBaseQueryArgs();
+      (void) this->getOldLockfile();
+      (void) this->getFingerprintedInputs();
+
+      /* Lock each system.
+       * Cross-system resolutions share no mutable state at this point, so
+       * they run in parallel; SQLite serializes use of the shared read-only
+       * connections internally. */
+      const std::vector<System> systems = this->getSystems();
+      if ( systems.size() <= 1 )
         {
-          this->lockSystem( system );
+          for ( const auto & system : systems )
+            {
+              this->lockfileRaw->packages.emplace( system,
+                                                   this->lockSystem( system ) );
+            }
+        }
+      else
+        {
+          std::vector<std::future<SystemPackages>> futures;
+          futures.reserve( systems.size() );
+          for ( const auto & system : systems )
+            {
+              futures.emplace_back(
+                std::async( std::launch::async,
+                            [this, &system]()
+                            { return this->lockSystem( system ); } ) );
+            }
+          /* Collect in declaration order so resolution failures are
+           * reported deterministically. */
+          for ( size_t idx = 0; idx < systems.size(); ++idx )
+            {
+              this->lockfileRaw->packages.emplace( systems[idx],
+                                                   futures[idx].get() );
+            }
         }
     }
+  for ( const auto & [system, sysPkgs] : this->lockfileRaw->packages )
+    {
+      span.addArg( "packages." + system, sysPkgs.size() );
+    }
   Lockfile lockfile( *this->lockfileRaw );
   lockfile.removeUnusedInputs();
   return lockfile;
 }
 
 
+/* -------------------------------------------------------------------------- */
+
+nlohmann::json
+Environment::previewUpgrades()
+{
+  nlohmann::json preview = nlohmann::json::object();
+  auto           oldLockfile = this->getOldLockfile();
+  if ( ! oldLockfile.has_value() ) { return preview; }
+
+  const auto & oldPackages = oldLockfile->getLockfileRaw().packages;
+  const auto & grouped     = this->getManifest().getGroupedDescriptors();
+
+  for ( const System & system : this->getSystems() )
+    {
+      auto oldSystem = oldPackages.find( system );
+      if ( oldSystem == oldPackages.end() ) { continue; }
+      nlohmann::json systemPreview = nlohmann::json::object();
+      for ( const auto & [groupName, group] : grouped )
+        {
+          if ( ! this->upgradingGroup( groupName ) ) { continue; }
+          for ( const auto & [iid, descriptor] : group )
+            {
+              auto oldLocked = oldSystem->second.find( iid );
+              if ( ( oldLocked == oldSystem->second.end() )
+                   || ( ! oldLocked->second.has_value() ) )
+                {
+                  continue;
+                }
+              const LockedPackageRaw & locked = *oldLocked->second;
+              if ( locked.attrPath.size() < 2 ) { continue; }
+              std::string current;
+              if ( auto vers = locked.info.find( "version" );
+                   ( vers != locked.info.end() ) && vers->is_string() )
+                {
+                  current = vers->get<std::string>();
+                }
+
+              /* Probe registry inputs in priority order for the version the
+               * locked attr-path would re-resolve to.
+               * Pinning the query to an exact attr-path skips match ranking
+               * entirely; only version ordering and the descriptor's version
+               * constraints remain. */
+              for ( const auto & [inputName, input] :
+                    *this->getPkgDbRegistry() )
+                {
+                  pkgdb::PkgQueryArgs args
+                    = this->getCombinedBaseQueryArgs();
+                  input->fillPkgQueryArgs( args );
+                  descriptor.fillPkgQueryArgs( args );
+                  args.name                      = std::nullopt;
+                  args.pname                     = std::nullopt;
+                  args.pnameOrAttrName           = std::nullopt;
+                  args.partialMatch              = std::nullopt;
+                  args.partialNameMatch          = std::nullopt;
+                  args.partialNameOrRelPathMatch = std::nullopt;
+                  args.relPath
+                    = AttrPath( locked.attrPath.begin() + 2,
+                                locked.attrPath.end() );
+                  args.subtrees = std::vector<Subtree> { Subtree(
+                    std::string_view( locked.attrPath.front() ) ) };
+                  args.systems  = std::vector<System> { system };
+                  args.limit    = 1;
+
+                  pkgdb::PkgQuery query( args );
+                  auto            dbRO = input->getDbReadOnly();
+                  auto            rows = query.execute( dbRO->db );
+                  if ( rows.empty() ) { continue; }
+
+                  sqlite3pp::query vqry(
+                    dbRO->db,
+                    "SELECT version FROM Packages WHERE id = ?" );
+                  vqry.bind( 1, static_cast<long long>( rows.front() ) );
+                  std::string latest;
+                  if ( auto itr = vqry.begin(); itr != vqry.end() )
+                    {
+                      if ( ( *itr ).get<const char *>( 0 ) != nullptr )
+                        {
+                          latest = ( *itr ).get<std::string>( 0 );
+                        }
+                    }
+                  if ( ( ! latest.empty() ) && ( latest != current ) )
+                    {
+                      systemPreview[iid] = { { "current", current },
+                                             { "latest", latest },
+                                             { "input", inputName } };
+                    }
+                  /* The first input offering the attr-path decides, matching
+                   * resolution's input priority order. */
+                  break;
+                }
+            }
+        }
+      if ( ! systemPreview.empty() )
+        {
+          preview[system] = std::move( systemPreview );
+        }
+    }
+  return preview;
+}
+
+
 /* -------------------------------------------------------------------------- */
 
 }  // namespace flox::resolver
@@ -10,10 +10,17 @@
  * -------------------------------------------------------------------------- */
 
 #include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include <nix/hash.hh>
 
 #include "flox/core/util.hh"
+#include "flox/pkgdb/write.hh"
 #include "flox/resolver/lockfile.hh"
 
 
@@ -26,7 +33,9 @@ namespace flox::resolver {
 void
 LockfileRaw::check() const
 {
-  if ( this->lockfileVersion != 0 )
+  /* Version 1 deduplicates locked inputs into a toplevel `inputs' table;
+   * packages reference entries by fingerprint instead of inlining them. */
+  if ( 1 < this->lockfileVersion )
     {
       throw InvalidLockfileException(
         "unsupported lockfile version "
@@ -40,30 +49,43 @@ LockfileRaw::check() const
 void
 Lockfile::checkGroups() const
 {
+  /* Copy the system list once; `getSystems' materializes a fresh vector on
+   * every call. */
+  const std::vector<System> systems = this->manifest.getSystems();
   for ( const auto & [_, group] : this->getManifest().getGroupedDescriptors() )
     {
-      for ( const auto & system : this->manifest.getSystems() )
+      /* Index each descriptor's `systems' skip list so the per-system pass
+       * below does hash lookups instead of rescanning vectors; large
+       * environments hit this for every ( group, system, package ) triple. */
+      std::unordered_map<InstallID, std::unordered_set<System>> skipLists;
+      for ( const auto & [iid, descriptor] : group )
         {
+          if ( descriptor.systems.has_value() )
+            {
+              skipLists.emplace(
+                iid,
+                std::unordered_set<System>( descriptor.systems->begin(),
+                                            descriptor.systems->end() ) );
+            }
+        }
+
+      for ( const auto & system : systems )
+        {
+          auto maybeSystem = this->lockfileRaw.packages.find( system );
+          if ( maybeSystem == this->lockfileRaw.packages.end() ) { continue; }
+
           std::optional<LockedInputRaw> groupInput;
           for ( const auto & [iid, descriptor] : group )
             {
               /* Handle system skips.  */
-              if ( descriptor.systems.has_value()
-                   && ( std::find( this->manifest.getSystems().begin(),
-                                   this->manifest.getSystems().end(),
-                                   system )
-                        == descriptor.systems->end() ) )
-                {
-                  continue;
-                }
-
-              auto maybeSystem = this->lockfileRaw.packages.find( system );
-              if ( maybeSystem == this->lockfileRaw.packages.end() )
+              if ( auto skip = skipLists.find( iid );
+                   ( skip != skipLists.end() )
+                   && ( ! skip->second.contains( system ) ) )
                 {
                   continue;
                 }
 
-              auto maybeLocked = maybeSystem->second.at( iid );
+              const auto & maybeLocked = maybeSystem->second.at( iid );
 
               /* Package was unresolved, we don't enforce `optional' here. */
               if ( ! maybeLocked.has_value() ) { continue; }
@@ -147,7 +169,22 @@ Lockfile::init()
 
 /* -------------------------------------------------------------------------- */
 
-/** @brief Read a flox::resolver::Lockfile from a file. */
+/** @brief Generate the name of a lockfile's binary sidecar cache. */
+static std::filesystem::path
+genLockfileCacheName( const std::filesystem::path & lockfilePath )
+{
+  return lockfilePath.string() + ".cbor";
+}
+
+
+/**
+ * @brief Read a flox::resolver::Lockfile from a file.
+ *
+ * A CBOR sidecar is kept beside the lockfile and refreshed whenever the
+ * JSON is ( re- )parsed, so repeat reads skip JSON parsing entirely.
+ * The sidecar is ignored when older than the lockfile and unreadable
+ * sidecars fall back to JSON, so it is always safe to delete.
+ */
 static LockfileRaw
 readLockfileFromPath( const std::filesystem::path & lockfilePath )
 {
@@ -156,15 +193,58 @@ readLockfileFromPath( const std::filesystem::path & lockfilePath )
       throw InvalidLockfileException( "no such path: "
                                       + lockfilePath.string() );
     }
-  return readAndCoerceJSON( lockfilePath );
+
+  std::filesystem::path cachePath = genLockfileCacheName( lockfilePath );
+  std::error_code       ec;
+  if ( std::filesystem::exists( cachePath, ec )
+       && ( std::filesystem::last_write_time( lockfilePath, ec )
+            <= std::filesystem::last_write_time( cachePath, ec ) ) )
+    {
+      try
+        {
+          std::ifstream cfile( cachePath, std::ios::binary );
+          return nlohmann::json::from_cbor( cfile );
+        }
+      catch ( ... )
+        { /* Stale or corrupt cache; fall back to JSON below. */
+        }
+    }
+
+  nlohmann::json parsed = readAndCoerceJSON( lockfilePath );
+
+  /* Refresh the sidecar best-effort; write-then-rename so concurrent
+   * readers never see a partial cache. */
+  try
+    {
+      std::filesystem::path tmpPath = cachePath.string() + ".tmp";
+      std::vector<uint8_t>  bytes   = nlohmann::json::to_cbor( parsed );
+      std::ofstream out( tmpPath, std::ios::binary | std::ios::trunc );
+      out.write( reinterpret_cast<const char *>( bytes.data() ),
+                 static_cast<std::streamsize>( bytes.size() ) );
+      out.close();
+      std::filesystem::rename( tmpPath, cachePath );
+    }
+  catch ( ... )
+    { /* Best effort; never block a read on the cache. */
+    }
+
+  return parsed;
 }
 
 /* -------------------------------------------------------------------------- */
 
 Lockfile::Lockfile( std::filesystem::path lockfilePath )
-  : lockfileRaw( readLockfileFromPath( lockfilePath ) )
 {
+  auto started      = std::chrono::steady_clock::now();
+  this->lockfileRaw = readLockfileFromPath( lockfilePath );
   this->init();
+  pkgdb::emitProgressEvent(
+    "phase-done",
+    { { "phase", "lockfile-parse" },
+      { "ms",
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now() - started )
+          .count() } } );
 }
 
 
@@ -346,6 +426,10 @@ void
 from_json( const nlohmann::json & jfrom, LockfileRaw & raw )
 {
   assertIsJSONObject<InvalidLockfileException>( jfrom, "lockfile" );
+  /* The `inputs' table ( lockfile version 1 ) and `packages' may appear in
+   * any order, so packages are parsed after the loop. */
+  nlohmann::json         inputsTable  = nlohmann::json::object();
+  const nlohmann::json * packagesJson = nullptr;
   for ( const auto & [key, value] : jfrom.items() )
     {
       if ( key == "manifest" )
@@ -382,34 +466,14 @@ from_json( const nlohmann::json & jfrom, LockfileRaw & raw )
                 jfrom,
                 "lockfile 'packages' field" );
             }
-          for ( const auto & [system, descriptors] : value.items() )
-            {
-              SystemPackages sysPkgs;
-              for ( const auto & [pid, descriptor] : descriptors.items() )
-                {
-                  if ( descriptor.is_null() )
-                    {
-                      sysPkgs.emplace( pid, std::nullopt );
-                      continue;
-                    }
-                  else
-                    {
-                      try
-                        {
-                          sysPkgs.emplace( pid,
-                                           descriptor.get<LockedPackageRaw>() );
-                        }
-                      catch ( nlohmann::json::exception & err )
-                        {
-                          throw InvalidLockfileException(
-                            "couldn't parse lockfile field 'packages." + system
-                              + "." + pid + "'",
-                            extract_json_errmsg( err ) );
-                        }
-                    }
-                }
-              raw.packages.emplace( system, std::move( sysPkgs ) );
-            }
+          packagesJson = &value;
+        }
+      else if ( key == "inputs" )
+        {
+          assertIsJSONObject<InvalidLockfileException>(
+            value,
+            "lockfile 'inputs' field" );
+          inputsTable = value;
         }
       else if ( key == "lockfile-version" )
         {
@@ -430,15 +494,96 @@ from_json( const nlohmann::json & jfrom, LockfileRaw & raw )
                                           + "' while parsing locked package" );
         }
     }
+
+  if ( packagesJson == nullptr ) { return; }
+  for ( const auto & [system, descriptors] : packagesJson->items() )
+    {
+      SystemPackages sysPkgs;
+      for ( const auto & [pid, descriptor] : descriptors.items() )
+        {
+          if ( descriptor.is_null() )
+            {
+              sysPkgs.emplace( pid, std::nullopt );
+              continue;
+            }
+          try
+            {
+              /* Version 1 references the `inputs' table by fingerprint;
+               * splice the shared entry back in before parsing. */
+              if ( descriptor.contains( "input" )
+                   && descriptor.at( "input" ).is_string() )
+                {
+                  auto ref = descriptor.at( "input" ).get<std::string>();
+                  if ( ! inputsTable.contains( ref ) )
+                    {
+                      throw InvalidLockfileException(
+                        "locked package 'packages." + system + "." + pid
+                        + "' references missing input '" + ref + "'" );
+                    }
+                  nlohmann::json inlined = descriptor;
+                  inlined["input"]       = inputsTable.at( ref );
+                  sysPkgs.emplace( pid, inlined.get<LockedPackageRaw>() );
+                }
+              else
+                {
+                  sysPkgs.emplace( pid, descriptor.get<LockedPackageRaw>() );
+                }
+            }
+          catch ( nlohmann::json::exception & err )
+            {
+              throw InvalidLockfileException(
+                "couldn't parse lockfile field 'packages." + system + "." + pid
+                  + "'",
+                extract_json_errmsg( err ) );
+            }
+        }
+      raw.packages.emplace( system, std::move( sysPkgs ) );
+    }
 }
 
 
 void
 to_json( nlohmann::json & jto, const LockfileRaw & raw )
 {
+  if ( raw.lockfileVersion < 1 )
+    {
+      jto = { { "manifest", raw.manifest },
+              { "registry", raw.registry },
+              { "packages", raw.packages },
+              { "lockfile-version", raw.lockfileVersion } };
+      return;
+    }
+
+  /* Version 1: write each distinct locked input once, keyed by fingerprint,
+   * and have packages reference it.  Multi-system lockfiles otherwise
+   * repeat the same input hundreds of times. */
+  nlohmann::json inputs   = nlohmann::json::object();
+  nlohmann::json packages = nlohmann::json::object();
+  for ( const auto & [system, sysPkgs] : raw.packages )
+    {
+      nlohmann::json jsysPkgs = nlohmann::json::object();
+      for ( const auto & [pid, pkg] : sysPkgs )
+        {
+          if ( ! pkg.has_value() )
+            {
+              jsysPkgs.emplace( pid, nullptr );
+              continue;
+            }
+          std::string ref
+            = pkg->input.fingerprint.to_string( nix::Base16, false );
+          if ( ! inputs.contains( ref ) ) { inputs.emplace( ref, pkg->input ); }
+          jsysPkgs.emplace( pid,
+                            nlohmann::json { { "input", ref },
+                                             { "attr-path", pkg->attrPath },
+                                             { "priority", pkg->priority },
+                                             { "info", pkg->info } } );
+        }
+      packages.emplace( system, std::move( jsysPkgs ) );
+    }
   jto = { { "manifest", raw.manifest },
           { "registry", raw.registry },
-          { "packages", raw.packages },
+          { "inputs", std::move( inputs ) },
+          { "packages", std::move( packages ) },
           { "lockfile-version", raw.lockfileVersion } };
 }
 
@@ -7,14 +7,18 @@
  *
  * -------------------------------------------------------------------------- */
 
+#include <cstdlib>
 #include <filesystem>
 #include <optional>
 #include <string>
 #include <string_view>
+#include <unistd.h>
 #include <utility>
 #include <variant>
 
 #include <argparse/argparse.hpp>
+#include <nix/globals.hh>
+#include <nix/hash.hh>
 #include <nix/util.hh>
 
 #include "flox/resolver/environment.hh"
@@ -47,6 +51,124 @@ namespace flox::resolver {
     }
 
 
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Whether parsed global manifests may be cached on disk.
+ *
+ * Controlled by the environment variable `PKGDB_MANIFEST_CACHE`; enabled
+ * unless set to `0`.
+ */
+static bool
+manifestCacheEnabled()
+{
+  const char * maybeCache = std::getenv( "PKGDB_MANIFEST_CACHE" );
+  return ( maybeCache == nullptr )
+         || ( std::string_view( maybeCache ) != "0" );
+}
+
+
+/** @brief Directory holding parsed global manifest sidecars. */
+static std::filesystem::path
+getManifestCacheDir()
+{
+  return std::filesystem::path( nix::getCacheDir() ) / "flox"
+         / "manifests-v1";
+}
+
+
+/**
+ * @brief Read the global manifest, keeping a parsed sidecar.
+ *
+ * The global manifest changes rarely but is read by nearly every command,
+ * so the coerced JSON is kept in a CBOR sidecar keyed by the manifest's
+ * absolute path.  The sidecar is validated by source mtime first and
+ * content hash second, so `touch`ed-but-unchanged manifests re-validate
+ * with one file hash instead of a TOML parse.
+ * Sidecar reads and writes are best-effort; any failure falls back to
+ * parsing the source.
+ */
+static GlobalManifestRaw
+readGlobalManifestCached( const std::filesystem::path & manifestPath )
+{
+  if ( ( ! manifestCacheEnabled() )
+       || ( ! std::filesystem::exists( manifestPath ) ) )
+    {
+      return readManifestFromPath<GlobalManifestRaw>( manifestPath );
+    }
+
+  auto mtime = static_cast<long long>(
+    std::filesystem::last_write_time( manifestPath )
+      .time_since_epoch()
+      .count() );
+
+  std::string key = nix::fmt( "%s\n%s",
+                              FLOX_PKGDB_VERSION,
+                              std::filesystem::absolute( manifestPath )
+                                .string() );
+  std::filesystem::path cachePath
+    = getManifestCacheDir()
+      / nix::hashString( nix::htSHA256, key ).to_string( nix::Base32,
+                                                         false );
+
+  std::optional<std::string> contentHash;
+  try
+    {
+      if ( std::filesystem::exists( cachePath ) )
+        {
+          std::string blob  = nix::readFile( cachePath.string() );
+          auto        entry = nlohmann::json::from_cbor( blob );
+          if ( entry.at( "mtime" ).get<long long>() == mtime )
+            {
+              return entry.at( "manifest" );
+            }
+          contentHash = nix::hashFile( nix::htSHA256, manifestPath.string() )
+                          .to_string( nix::Base32, false );
+          if ( entry.at( "hash" ).get<std::string>() == *contentHash )
+            {
+              /* Touched but unchanged: adopt the new mtime so the next
+               * read skips the hash again. */
+              entry["mtime"] = mtime;
+              auto        bytes = nlohmann::json::to_cbor( entry );
+              std::string refreshed( bytes.begin(), bytes.end() );
+              nix::writeFile( cachePath.string(), refreshed );
+              return entry.at( "manifest" );
+            }
+        }
+    }
+  catch ( const std::exception & )
+    { /* Corrupt or unreadable sidecar; re-parse below. */
+    }
+
+  nlohmann::json    raw      = readAndCoerceJSON( manifestPath );
+  GlobalManifestRaw manifest = raw;
+
+  try
+    {
+      if ( ! contentHash.has_value() )
+        {
+          contentHash = nix::hashFile( nix::htSHA256, manifestPath.string() )
+                          .to_string( nix::Base32, false );
+        }
+      nlohmann::json entry = { { "mtime", mtime },
+                               { "hash", *contentHash },
+                               { "manifest", std::move( raw ) } };
+      std::filesystem::create_directories( cachePath.parent_path() );
+      std::filesystem::path tmpPath
+        = cachePath.string() + nix::fmt( ".%d", getpid() );
+      auto        bytes = nlohmann::json::to_cbor( entry );
+      std::string blob( bytes.begin(), bytes.end() );
+      nix::writeFile( tmpPath.string(), blob );
+      std::filesystem::rename( tmpPath, cachePath );
+    }
+  catch ( const std::exception & )
+    { /* Ignore cache write failures. */
+    }
+
+  return manifest;
+}
+
+
 /* -------------------------- non virtual set/get --------------------------- */
 
 void
@@ -67,8 +189,7 @@ EnvironmentMixin::setGlobalManifestRaw(
         "initialized" );
     }
 
-  this->globalManifestRaw
-    = readManifestFromPath<GlobalManifestRaw>( *maybePath );
+  this->globalManifestRaw = readGlobalManifestCached( *maybePath );
 }
 
 void
@@ -7,6 +7,9 @@
  *
  * -------------------------------------------------------------------------- */
 
+#include <string>
+#include <unordered_map>
+
 #include <nix/json-to-value.hh>
 #include <nix/primops.hh>
 #include <nix/value-to-json.hh>
@@ -25,6 +28,27 @@
 
 namespace flox::resolver {
 
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Per-`EvalState` memoization of `builtins.resolve` argument sets to
+ *        serialized resolutions.
+ *
+ * Each resolution constructs an environment, opens package databases, and
+ * scrapes missing prefixes; expressions call this primop in loops and often
+ * repeat descriptors, so identical argument sets within one evaluation
+ * should be hash-map hits.
+ */
+static std::unordered_map<std::string, std::string> &
+getResolveCache( const nix::EvalState & state )
+{
+  static std::unordered_map<const nix::EvalState *,
+                            std::unordered_map<std::string, std::string>>
+    caches;
+  return caches[&state];
+}
+
+
 /* -------------------------------------------------------------------------- */
 
 void
@@ -33,28 +57,31 @@ prim_resolve( nix::EvalState &  state,
               nix::Value **     args,
               nix::Value &      value )
 {
+  /* Resolution locks a flake ref, so the result is not determined by the
+   * calling expression's text; result caches must not record this eval. */
+  noteFlakeRefPrimopCall();
+
   state.forceAttrs( *args[0],
                     pos,
                     "while processing options argument to 'builtins.resolve'" );
 
   nix::NixStringContext context;
-  Options               options
+  nlohmann::json        optionsJSON
     = nix::printValueAsJSON( state, true, *args[0], pos, context, false );
+  Options options = optionsJSON;
 
   RegistryInput input( valueToFlakeRef(
     state,
     *args[1],
     pos,
     "while processing 'input' argument to 'builtins.resolve'" ) );
-  RegistryRaw   registry;
-  registry.inputs.emplace( std::make_pair( "input", std::move( input ) ) );
-
 
   if ( args[2]->isThunk() && args[2]->isTrivial() )
     {
       state.forceValue( *args[2], pos );
     }
   ManifestDescriptorRaw descriptor;
+  nlohmann::json        descriptorJSON;
   auto                  type = args[2]->type();
   if ( type == nix::nAttrs )
     {
@@ -62,8 +89,9 @@ prim_resolve( nix::EvalState &  state,
         *args[2],
         pos,
         "while processing 'descriptor' argument to 'builtins.resolve'" );
-      descriptor
+      descriptorJSON
         = nix::printValueAsJSON( state, true, *args[2], pos, context, false );
+      descriptor = descriptorJSON;
       if ( descriptor.systems.has_value() && ( ! options.systems.has_value() ) )
         {
           options.systems    = std::move( descriptor.systems );
@@ -77,6 +105,7 @@ prim_resolve( nix::EvalState &  state,
         pos,
         "while processing 'descriptor' argument to 'builtins.resolve'" );
       descriptor.name = args[2]->str();
+      descriptorJSON  = std::string( args[2]->str() );
     }
   else
     {
@@ -87,6 +116,20 @@ prim_resolve( nix::EvalState &  state,
         .debugThrow<nix::EvalError>();
     }
 
+  /* Repeated calls with identical arguments are common within one eval;
+   * serve them from the memoization table without re-resolving. */
+  auto &      cache = getResolveCache( state );
+  std::string key   = optionsJSON.dump() + '\0' + input.from->to_string() + '\0'
+                    + descriptorJSON.dump();
+  if ( auto hit = cache.find( key ); hit != cache.end() )
+    {
+      nix::parseJSON( state, hit->second, value );
+      return;
+    }
+
+  RegistryRaw registry;
+  registry.inputs.emplace( std::make_pair( "input", std::move( input ) ) );
+
   std::unordered_map<std::string, std::optional<ManifestDescriptorRaw>> install;
   install.emplace( "__package", std::move( descriptor ) );
 
@@ -105,7 +148,9 @@ prim_resolve( nix::EvalState &  state,
       bySystem.emplace( system, pkgs.at( "__package" ) );
     }
 
-  nix::parseJSON( state, bySystem.dump(), value );
+  std::string serialized = bySystem.dump();
+  cache.emplace( std::move( key ), serialized );
+  nix::parseJSON( state, serialized, value );
 }
 
 
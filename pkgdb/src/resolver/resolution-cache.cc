@@ -0,0 +1,404 @@
+/* ========================================================================== *
+ *
+ * @file resolver/resolution-cache.cc
+ *
+ * @brief An on-disk cache of descriptor resolutions.
+ *
+ *
+ * -------------------------------------------------------------------------- */
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <nix/hash.hh>
+#include <nlohmann/json.hpp>
+#include <sqlite3pp.hh>
+
+#include "flox/pkgdb/pkg-query.hh"
+#include "flox/pkgdb/read.hh"
+#include "flox/resolver/resolution-cache.hh"
+
+
+/* -------------------------------------------------------------------------- */
+
+namespace flox::resolver {
+
+/* -------------------------------------------------------------------------- */
+
+/* The cache lives in the versioned cache directory, so schema or view
+ * changes which could alter resolution results invalidate it naturally. */
+
+/** Filename of the resolution cache kept alongside the databases. */
+static const char * resolutionDbName = "resolution.sqlite";
+
+/** SQL schema of the resolution cache.
+ * Stores the resolved attribute path rather than a raw `Packages.id`:
+ * row ids are assigned in insertion order, which the parallel scrape worker
+ * pool makes nondeterministic, and a garbage-collected database re-scraped
+ * under the same fingerprint renumbers its rows entirely.
+ * A `NULL' @a pkgPath records that resolution found no match. */
+static const char * sql_resolutionCache = R"SQL(
+CREATE TABLE IF NOT EXISTS ResolutionCache (
+  key      TEXT PRIMARY KEY
+, pkgPath  JSON
+)
+)SQL";
+
+/** SQL schema of the adaptive input-ordering record.
+ * Maps a group of descriptors to the registry input that last satisfied
+ * it, so later locks try that input first. */
+static const char * sql_resolutionHit = R"SQL(
+CREATE TABLE IF NOT EXISTS ResolutionHit (
+  key        TEXT PRIMARY KEY
+, inputName  TEXT NOT NULL
+)
+)SQL";
+
+/** SQL schema of the descriptor parse memo.
+ * @a descriptor holds the parsed form serialized as JSON. */
+static const char * sql_descriptorCache = R"SQL(
+CREATE TABLE IF NOT EXISTS DescriptorCache (
+  key         TEXT PRIMARY KEY
+, descriptor  TEXT NOT NULL
+)
+)SQL";
+
+/** SQL schema of the group-level negative cache.
+ * @a failedId is the install ID whose resolution failed, so a cached skip
+ * reports the same failure a fresh resolution would. */
+static const char * sql_resolutionGroupMiss = R"SQL(
+CREATE TABLE IF NOT EXISTS ResolutionGroupMiss (
+  key       TEXT PRIMARY KEY
+, failedId  TEXT NOT NULL
+)
+)SQL";
+
+
+/* -------------------------------------------------------------------------- */
+
+bool
+useResolutionCache()
+{
+  const char * maybeEnabled = std::getenv( "PKGDB_RESOLUTION_CACHE" );
+  return ( maybeEnabled == nullptr )
+         || ( std::string_view( maybeEnabled ) != "0" );
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+/** @brief Open ( creating if necessary ) the resolution cache. */
+static sqlite3pp::database
+openResolutionCache()
+{
+  std::filesystem::path cacheDir = pkgdb::getPkgDbCachedir();
+  std::filesystem::create_directories( cacheDir );
+  sqlite3pp::database rdb( ( cacheDir / resolutionDbName ).c_str() );
+  rdb.set_busy_timeout( pkgdb::DB_BUSY_TIMEOUT );
+  /* Early caches stored raw row ids, which are not stable across
+   * re-scrapes; drop such a table so the path-keyed schema replaces it. */
+  {
+    sqlite3pp::query qry( rdb,
+                          "SELECT 1 FROM pragma_table_info( "
+                          "'ResolutionCache' ) WHERE ( name = 'pkgRow' )" );
+    if ( qry.begin() != qry.end() )
+      {
+        rdb.execute( "DROP TABLE ResolutionCache" );
+      }
+  }
+  rdb.execute( sql_resolutionCache );
+  rdb.execute( sql_descriptorCache );
+  rdb.execute( sql_resolutionGroupMiss );
+  rdb.execute( sql_resolutionHit );
+  return rdb;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+std::string
+resolutionCacheKey( const pkgdb::Fingerprint &  fingerprint,
+                    const pkgdb::PkgQueryArgs & args )
+{
+  nlohmann::json argsJson;
+  pkgdb::to_json( argsJson, args );
+  std::string raw
+    = fingerprint.to_string( nix::Base16, false ) + ":" + argsJson.dump();
+  return nix::hashString( nix::htSHA256, raw ).to_string( nix::Base16, false );
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+std::optional<std::optional<pkgdb::row_id>>
+lookupCachedResolution( pkgdb::PkgDbReadOnly & dbRO, const std::string & key )
+{
+  try
+    {
+      sqlite3pp::database rdb = openResolutionCache();
+      sqlite3pp::query    qry(
+        rdb,
+        "SELECT pkgPath FROM ResolutionCache WHERE key = ?" );
+      qry.bind( 1, key, sqlite3pp::copy );
+      auto itr = qry.begin();
+      if ( itr == qry.end() ) { return std::nullopt; }
+      std::optional<pkgdb::row_id> row;
+      if ( ( *itr ).get<const char *>( 0 ) != nullptr )
+        {
+          /* Map the recorded path back onto the current database; the id is
+           * re-read every time since a re-scrape renumbers rows. */
+          auto path = nlohmann::json::parse( ( *itr ).get<std::string>( 0 ) )
+                        .get<flox::AttrPath>();
+          row = dbRO.getPackageId( path );
+        }
+      return row;
+    }
+  catch ( ... )
+    { /* Best effort; an unreadable cache or a path absent from the current
+       * database is a miss. */
+      return std::nullopt;
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void
+recordCachedResolution( pkgdb::PkgDbReadOnly &               dbRO,
+                        const std::string &                  key,
+                        const std::optional<pkgdb::row_id> & row )
+{
+  try
+    {
+      sqlite3pp::database rdb = openResolutionCache();
+      sqlite3pp::command  cmd(
+        rdb,
+        "INSERT INTO ResolutionCache ( key, pkgPath ) VALUES ( ?, ? ) "
+         "ON CONFLICT ( key ) DO UPDATE SET pkgPath = excluded.pkgPath" );
+      cmd.bind( 1, key, sqlite3pp::copy );
+      if ( row.has_value() )
+        {
+          cmd.bind( 2,
+                    nlohmann::json( dbRO.getPackagePath( *row ) ).dump(),
+                    sqlite3pp::copy );
+        }
+      else { cmd.bind( 2 ); }
+      cmd.execute();
+    }
+  catch ( ... )
+    { /* Best effort; never block resolution on the cache. */
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+std::string
+descriptorCacheKey( std::string_view              installID,
+                    const ManifestDescriptorRaw & raw )
+{
+  std::string rawStr = std::string( installID ) + ":"
+                       + nlohmann::json( raw ).dump();
+  return nix::hashString( nix::htSHA256, rawStr )
+    .to_string( nix::Base16, false );
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+std::optional<ManifestDescriptor>
+lookupCachedDescriptor( const std::string & key )
+{
+  try
+    {
+      sqlite3pp::database rdb = openResolutionCache();
+      sqlite3pp::query    qry(
+        rdb,
+        "SELECT descriptor FROM DescriptorCache WHERE key = ?" );
+      qry.bind( 1, key, sqlite3pp::copy );
+      auto itr = qry.begin();
+      if ( itr == qry.end() ) { return std::nullopt; }
+      return nlohmann::json::parse( ( *itr ).get<std::string>( 0 ) )
+        .get<ManifestDescriptor>();
+    }
+  catch ( ... )
+    { /* Best effort; an unreadable cache is a miss. */
+      return std::nullopt;
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void
+recordCachedDescriptor( const std::string &        key,
+                        const ManifestDescriptor & descriptor )
+{
+  try
+    {
+      sqlite3pp::database rdb = openResolutionCache();
+      sqlite3pp::command  cmd(
+        rdb,
+        "INSERT INTO DescriptorCache ( key, descriptor ) VALUES ( ?, ? ) "
+         "ON CONFLICT ( key ) DO UPDATE SET descriptor = excluded.descriptor" );
+      cmd.bind( 1, key, sqlite3pp::copy );
+      cmd.bind( 2, nlohmann::json( descriptor ).dump(), sqlite3pp::copy );
+      cmd.execute();
+    }
+  catch ( ... )
+    { /* Best effort; never block parsing on the cache. */
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+std::string
+groupResolutionCacheKey( const std::vector<std::string> & memberKeys )
+{
+  std::string raw;
+  for ( const auto & key : memberKeys )
+    {
+      raw += key;
+      raw += ';';
+    }
+  return nix::hashString( nix::htSHA256, raw ).to_string( nix::Base16, false );
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+std::optional<std::string>
+lookupCachedGroupMiss( const std::string & key )
+{
+  try
+    {
+      sqlite3pp::database rdb = openResolutionCache();
+      sqlite3pp::query    qry(
+        rdb,
+        "SELECT failedId FROM ResolutionGroupMiss WHERE key = ?" );
+      qry.bind( 1, key, sqlite3pp::copy );
+      auto itr = qry.begin();
+      if ( itr == qry.end() ) { return std::nullopt; }
+      return ( *itr ).get<std::string>( 0 );
+    }
+  catch ( ... )
+    { /* Best effort; an unreadable cache is a miss. */
+      return std::nullopt;
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void
+recordCachedGroupMiss( const std::string & key, const std::string & failedId )
+{
+  try
+    {
+      sqlite3pp::database rdb = openResolutionCache();
+      sqlite3pp::command  cmd(
+        rdb,
+        "INSERT INTO ResolutionGroupMiss ( key, failedId ) VALUES ( ?, ? ) "
+         "ON CONFLICT ( key ) DO UPDATE SET failedId = excluded.failedId" );
+      cmd.bind( 1, key, sqlite3pp::copy );
+      cmd.bind( 2, failedId, sqlite3pp::copy );
+      cmd.execute();
+    }
+  catch ( ... )
+    { /* Best effort; never block resolution on the cache. */
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+std::string
+preferredInputKey( const InstallDescriptors &       group,
+                   const System &                   system,
+                   const std::vector<std::string> & inputKeys )
+{
+  /* `InstallDescriptors' iterates in hash order; sort for a stable key. */
+  std::vector<std::string> iids;
+  for ( const auto & [iid, descriptor] : group ) { iids.emplace_back( iid ); }
+  std::sort( iids.begin(), iids.end() );
+
+  std::string raw = system;
+  for ( const auto & iid : iids )
+    {
+      raw += ';';
+      raw += iid;
+      raw += '=';
+      raw += nlohmann::json( group.at( iid ) ).dump();
+    }
+  /* The inputs stay in priority order so reordering the registry also
+   * invalidates the record. */
+  for ( const auto & inputKey : inputKeys )
+    {
+      raw += '|';
+      raw += inputKey;
+    }
+  return nix::hashString( nix::htSHA256, raw ).to_string( nix::Base16, false );
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+std::optional<std::string>
+lookupPreferredInput( const std::string & key )
+{
+  try
+    {
+      sqlite3pp::database rdb = openResolutionCache();
+      sqlite3pp::query    qry(
+        rdb,
+        "SELECT inputName FROM ResolutionHit WHERE key = ?" );
+      qry.bind( 1, key, sqlite3pp::copy );
+      auto itr = qry.begin();
+      if ( itr == qry.end() ) { return std::nullopt; }
+      return ( *itr ).get<std::string>( 0 );
+    }
+  catch ( ... )
+    { /* Best effort; an unreadable cache is a miss. */
+      return std::nullopt;
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void
+recordPreferredInput( const std::string & key, const std::string & inputName )
+{
+  try
+    {
+      sqlite3pp::database rdb = openResolutionCache();
+      sqlite3pp::command  cmd(
+        rdb,
+        "INSERT INTO ResolutionHit ( key, inputName ) VALUES ( ?, ? ) "
+         "ON CONFLICT ( key ) DO UPDATE SET inputName = excluded.inputName" );
+      cmd.bind( 1, key, sqlite3pp::copy );
+      cmd.bind( 2, inputName, sqlite3pp::copy );
+      cmd.execute();
+    }
+  catch ( ... )
+    { /* Best effort; never block resolution on the cache. */
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+}  // namespace flox::resolver
+
+
+/* -------------------------------------------------------------------------- *
+ *
+ *
+ *
+ * ========================================================================== */
@@ -7,24 +7,33 @@
  *
  * -------------------------------------------------------------------------- */
 
+#include <chrono>
+#include <cstdint>
 #include <cstdlib>
 #include <filesystem>
 #include <iostream>
 #include <memory>
 #include <optional>
+#include <regex>
 #include <string>
+#include <string_view>
 #include <variant>
 #include <vector>
 
+#include <array>
+
 #include <argparse/argparse.hpp>
+#include <nix/fmt.hh>
 #include <nix/ref.hh>
 #include <nlohmann/json.hpp>
+#include <sqlite3pp.hh>
 
 #include "flox/core/command.hh"
 #include "flox/core/util.hh"
 #include "flox/pkgdb/input.hh"
 #include "flox/pkgdb/pkg-query.hh"
 #include "flox/pkgdb/read.hh"
+#include "flox/pkgdb/snapshot.hh"
 #include "flox/registry.hh"
 #include "flox/resolver/environment.hh"
 #include "flox/resolver/lockfile.hh"
@@ -111,12 +120,45 @@ SearchCommand::addSearchQueryOptions( argparse::ArgumentParser & parser )
     .action( [&]( const std::string & arg )
              { this->params.query.partialNameOrRelPathMatch = arg; } );
 
+  parser.add_argument( "--format" )
+    .help( "output format for result records, one of 'json' ( the default, "
+           "one object per line ) or 'cbor' ( length-prefixed binary "
+           "records )." )
+    .metavar( "FORMAT" )
+    .nargs( 1 )
+    .action(
+      [&]( const std::string & arg )
+      {
+        if ( arg == "cbor" ) { this->cborOutput = true; }
+        else if ( arg == "json" ) { this->cborOutput = false; }
+        else
+          {
+            throw command::InvalidArgException(
+              "unrecognized output format '" + arg + "'" );
+          }
+      } );
+
   parser.add_argument( "--dump-query" )
     .help( "print the generated SQL query and exit." )
     .nargs( 0 )
     .implicit_value( true )
     .action( [&]( const auto & ) { this->dumpQuery = true; } );
 
+  parser.add_argument( "--explain" )
+    .help( "emit EXPLAIN QUERY PLAN and per-input wall/row counts as JSON "
+           "instead of results." )
+    .nargs( 0 )
+    .implicit_value( true )
+    .action( [&]( const auto & ) { this->explain = true; } );
+
+  parser.add_argument( "--page-token" )
+    .help( "resume a federated search after the position given by a previous "
+           "'next-page-token' record." )
+    .metavar( "TOKEN" )
+    .nargs( 1 )
+    .action( [&]( const std::string & arg )
+             { this->pageAfter = std::stoull( arg ); } );
+
   parser.add_argument( "--query-limit" )
     .help( "set the query-limit for results" )
     .nargs( 1 )
@@ -179,6 +221,62 @@ SearchCommand::initEnvironment()
 }
 
 
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Whether search should federate all inputs into one SQL query.
+ *
+ * Enabled by default; set `PKGDB_SEARCH_FEDERATED=0` to query each input
+ * separately instead.
+ */
+static bool
+useFederatedSearch()
+{
+  const char * maybeFederated = std::getenv( "PKGDB_SEARCH_FEDERATED" );
+  return ( maybeFederated == nullptr )
+         || ( std::string_view( maybeFederated ) != "0" );
+}
+
+
+/** SQLite3's default limit on simultaneously `ATTACH`ed databases. */
+static constexpr size_t MAX_ATTACHED_DBS = 10;
+
+
+/** @brief Quote a filesystem path as a SQL string literal. */
+static std::string
+mkSqlPathLiteral( const std::string & path )
+{
+  return "'" + std::regex_replace( path, std::regex( "'" ), "''" ) + "'";
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void
+SearchCommand::emitRecord( const nlohmann::json & record ) const
+{
+  if ( ! this->cborOutput )
+    {
+      std::cout << record.dump() << std::endl;
+      return;
+    }
+  /* Length-prefixed CBOR: a 4-byte network-order length then the record.
+   * Integers ( ranks, counts, page tokens ) encode as native CBOR integers,
+   * so binary consumers deserialize without text re-parsing. */
+  std::vector<std::uint8_t> bytes = nlohmann::json::to_cbor( record );
+  auto                      size  = static_cast<std::uint32_t>( bytes.size() );
+  std::array<char, 4>       prefix
+    = { static_cast<char>( ( size >> 24 ) & 0xFF ),
+        static_cast<char>( ( size >> 16 ) & 0xFF ),
+        static_cast<char>( ( size >> 8 ) & 0xFF ),
+        static_cast<char>( size & 0xFF ) };
+  std::cout.write( prefix.data(), prefix.size() );
+  std::cout.write( reinterpret_cast<const char *>( bytes.data() ),
+                   static_cast<std::streamsize>( bytes.size() ) );
+  std::cout.flush();
+}
+
+
 /* -------------------------------------------------------------------------- */
 
 int
@@ -189,37 +287,195 @@ SearchCommand::run()
 
   pkgdb::PkgQueryArgs args = this->getEnvironment().getCombinedBaseQueryArgs();
   this->params.query.fillPkgQueryArgs( args );
+  if ( this->pageAfter.has_value() ) { args.pageAfter = this->pageAfter; }
   nlohmann::json queryJson;
   to_json( queryJson, args );
   debugLog( "performing search with query: " + queryJson.dump() );
   auto query = pkgdb::PkgQuery( args );
   if ( this->dumpQuery ) { std::cout << query.str() << std::endl; }
 
-  /* Collect results from each input */
-  auto                                            globalResultCount = 0;
-  std::vector<std::vector<pkgdb::row_id>>         globallyFoundIds;
-  std::vector<std::shared_ptr<pkgdb::PkgDbInput>> inputs;
+  /* Collect inputs in priority order. */
+  std::vector<std::shared_ptr<pkgdb::PkgDbInput>> registryInputs;
+  std::vector<std::string>                        registryNames;
   for ( const auto & [name, input] :
         *this->getEnvironment().getPkgDbRegistry() )
     {
-      auto                       dbRO = input->getDbReadOnly();
-      std::vector<pkgdb::row_id> thisInputIds;
+      registryInputs.emplace_back( input );
+      registryNames.emplace_back( name );
+    }
+
+  /* Diagnostic mode: emit each input's query plan and measured cost
+   * instead of results, so plan regressions can be pinned down. */
+  if ( this->explain )
+    {
+      for ( size_t idx = 0; idx < registryInputs.size(); ++idx )
+        {
+          auto dbRO  = registryInputs[idx]->getDbReadOnly();
+          auto begin = std::chrono::steady_clock::now();
+          auto rows  = query.execute( dbRO->db );
+          auto durationUs
+            = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - begin )
+                .count();
+          nlohmann::json record = { { "input", registryNames[idx] },
+                                    { "plan", query.explain( dbRO->db ) },
+                                    { "rows", rows.size() },
+                                    { "durationUs", durationUs } };
+          this->emitRecord( record );
+        }
+      return EXIT_SUCCESS;
+    }
+
+  /* Exact-name lookups can be answered from frozen snapshots without
+   * touching SQLite; require a usable snapshot for every input so result
+   * counts stay exact, otherwise fall through to SQL. */
+  if ( ( ! args.pageAfter.has_value() )
+       && pkgdb::PkgDbSnapshot::supports( args ) )
+    {
+      std::vector<std::shared_ptr<pkgdb::PkgDbSnapshot>> snapshots;
+      for ( const auto & input : registryInputs )
+        {
+          auto snap = pkgdb::PkgDbSnapshot::tryOpen( input->getDbPath() );
+          if ( snap == nullptr ) { break; }
+          snapshots.emplace_back( std::move( snap ) );
+        }
+      if ( snapshots.size() == registryInputs.size() )
+        {
+          debugLog( "answering search from database snapshots" );
+          std::vector<std::pair<size_t, std::string>> rows;
+          for ( size_t idx = 0; idx < snapshots.size(); ++idx )
+            {
+              for ( auto & json : snapshots[idx]->lookup( args ) )
+                {
+                  rows.emplace_back( idx, std::move( json ) );
+                }
+            }
+          if ( query.limit.has_value() )
+            {
+              // Emit the number of results as the first line
+              nlohmann::json resultCountRecord
+                = { { "result-count", rows.size() } };
+              this->emitRecord( resultCountRecord );
+              if ( *query.limit < rows.size() ) { rows.resize( *query.limit ); }
+            }
+          for ( auto & [idx, json] : rows )
+            {
+              auto rsl = nlohmann::json::parse( json );
+              rsl.emplace( "input", registryInputs[idx]->getNameOrURL() );
+              this->emitRecord( rsl );
+            }
+          return EXIT_SUCCESS;
+        }
+    }
+
+  /* Federated mode `ATTACH'es every input into one connection so a single
+   * statement ranks results globally and pushes `LIMIT' into SQL, rather
+   * than paying N full query costs and ranking per-input. */
+  if ( useFederatedSearch() && ( registryInputs.size() <= MAX_ATTACHED_DBS ) )
+    {
+      sqlite3pp::database lens;
+      lens.connect( ":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE );
+      lens.set_busy_timeout( pkgdb::DB_BUSY_TIMEOUT );
+      auto sqlFunctions = pkgdb::registerSqlFunctions( lens );
 
-      debugLog( "querying input=" + name );
-      for ( const auto & id : query.execute( dbRO->db ) )
+      std::vector<std::string> schemas;
+      for ( size_t idx = 0; idx < registryInputs.size(); ++idx )
         {
-          thisInputIds.emplace_back( id );
+          std::string schema = "db" + std::to_string( idx );
+          std::string cmd
+            = "ATTACH DATABASE "
+              + mkSqlPathLiteral( registryInputs[idx]->getDbPath().string() )
+              + " AS " + schema;
+          if ( lens.execute( cmd.c_str() ) != SQLITE_OK )
+            {
+              throw pkgdb::PkgDbException(
+                nix::fmt( "failed to attach database '%s': %s",
+                          registryInputs[idx]->getDbPath().string(),
+                          lens.error_msg() ) );
+            }
+          schemas.emplace_back( std::move( schema ) );
         }
-      inputs.emplace_back( input );
 
-      globalResultCount += thisInputIds.size();
-      debugLog( "found " + std::to_string( thisInputIds.size() )
-                + " results, input=" + name );
-      globallyFoundIds.emplace_back( std::move( thisInputIds ) );
+      debugLog( "querying " + std::to_string( registryInputs.size() )
+                + " inputs with a federated query" );
+      auto results = query.executeFederated( lens, schemas );
+      debugLog( "found " + std::to_string( results.totalCount )
+                + " total results across all inputs" );
+
+      if ( query.limit.has_value() )
+        {
+          debugLog( "returning the first " + std::to_string( *query.limit )
+                    + " results" );
+          // Emit the number of results as the first line
+          nlohmann::json resultCountRecord
+            = { { "result-count", results.totalCount } };
+          this->emitRecord( resultCountRecord );
+        }
+      size_t   printed  = 0;
+      uint64_t lastRank = 0;
+      for ( size_t row = 0; row < results.rows.size(); ++row )
+        {
+          if ( query.limit.has_value() && ( *query.limit <= printed ) )
+            {
+              break;
+            }
+          const auto & [rank, id] = results.rows[row];
+          this->emitRecord( registryInputs.at( rank )->getRowJSON( id ) );
+          lastRank = results.pageRanks.at( row );
+          ++printed;
+        }
+      /* `pageRank' positions are global across pages, so more results
+       * remain whenever the last delivered position precedes the total. */
+      if ( query.limit.has_value()
+           && ( ( printed < results.rows.size() )
+                || ( ( 0 < printed ) && ( lastRank < results.totalCount ) ) ) )
+        {
+          nlohmann::json nextPageRecord = { { "next-page-token", lastRank } };
+          this->emitRecord( nextPageRecord );
+        }
+      return EXIT_SUCCESS;
+    }
+
+  /* Page tokens index the federated ranking; per-input streaming has no
+   * comparable stable global position to resume from. */
+  if ( args.pageAfter.has_value() )
+    {
+      throw FloxException( "'--page-token' requires federated search; unset "
+                           "'PKGDB_SEARCH_FEDERATED=0' or reduce the number "
+                           "of inputs" );
+    }
+
+  /* Query each input separately, streaming rows so broad matches are never
+   * materialized.
+   * With a `limit' the total count must be emitted before any result, so at
+   * most `limit' rows are buffered; without one rows print as they stream. */
+  size_t                                        globalResultCount = 0;
+  std::vector<std::pair<size_t, pkgdb::row_id>> buffered;
+  for ( size_t idx = 0; idx < registryInputs.size(); ++idx )
+    {
+      auto & input = registryInputs[idx];
+      auto   dbRO  = input->getDbReadOnly();
+
+      debugLog( "querying input=" + registryNames[idx] );
+      size_t found  = 0;
+      auto   cursor = query.start( dbRO->db );
+      while ( auto id = cursor.next() )
+        {
+          ++found;
+          if ( query.limit.has_value() )
+            {
+              if ( buffered.size() < *query.limit )
+                {
+                  buffered.emplace_back( idx, *id );
+                }
+            }
+          else { this->emitRecord( input->getRowJSON( *id ) ); }
+        }
+      globalResultCount += found;
+      debugLog( "found " + std::to_string( found )
+                + " results, input=" + registryNames[idx] );
     }
 
-  /* Return results as a single flat list by iterating over each input with
-   * results */
   debugLog( "found " + std::to_string( globalResultCount )
             + " total results across all inputs" );
   if ( query.limit.has_value() )
@@ -229,35 +485,13 @@ SearchCommand::run()
       // Emit the number of results as the first line
       nlohmann::json resultCountRecord
         = { { "result-count", globalResultCount } };
-      std::cout << resultCountRecord << std::endl;
-      // Only print the first `limit` results
-      for ( size_t i = 0; i < inputs.size(); i++ )
-        {
-          if ( *query.limit == 0 ) { break; }
-          auto input    = inputs[i];
-          auto inputIds = globallyFoundIds[i];
-          for ( auto & id : inputIds )
-            {
-              if ( *query.limit == 0 ) { break; }
-              std::cout << input->getRowJSON( id ).dump() << std::endl;
-              *query.limit -= 1;
-            }
-        }
-    }
-  else
-    {
-      debugLog( "returning all results" );
-      // Print all of the results
-      for ( size_t i = 0; i < inputs.size(); i++ )
+      this->emitRecord( resultCountRecord );
+      for ( const auto & [idx, id] : buffered )
         {
-          auto input    = inputs[i];
-          auto inputIds = globallyFoundIds[i];
-          for ( auto & id : inputIds )
-            {
-              std::cout << input->getRowJSON( id ).dump() << std::endl;
-            }
+          this->emitRecord( registryInputs[idx]->getRowJSON( id ) );
         }
     }
+  else { debugLog( "returned all results" ); }
   return EXIT_SUCCESS;
 }
 
@@ -8,6 +8,7 @@
  * -------------------------------------------------------------------------- */
 
 #include <string>
+#include <utility>
 
 #include <nlohmann/json.hpp>
 #include <toml.hpp>
@@ -41,27 +42,31 @@ tomlToJSON( std::string_view toml )
   std::string        tomlStr( toml );
   std::istringstream tomlStream( tomlStr );
 
-  std::function<void( nlohmann::json &, const toml::value & )> visit;
+  /* The parsed tree is ours alone, so the visitor consumes it: strings and
+   * keys are moved into the JSON value rather than copied, and tables and
+   * arrays are walked in place instead of being duplicated. */
+  std::function<void( nlohmann::json &, toml::value & )> visit;
 
-  visit = [&]( nlohmann::json & jto, const toml::value & tfrom )
+  visit = [&]( nlohmann::json & jto, toml::value & tfrom )
   {
     switch ( tfrom.type() )
       {
           case toml::value_t::table: {
-            jto = nlohmann::json::object();
-            for ( const auto & elem : toml::get<toml::table>( tfrom ) )
+            jto           = nlohmann::json::object();
+            auto & ttable = toml::get<toml::table>( tfrom );
+            while ( ! ttable.empty() )
               {
+                auto           node = ttable.extract( ttable.begin() );
                 nlohmann::json jval;
-                visit( jval, elem.second );
-                jto.emplace( elem.first, std::move( jval ) );
+                visit( jval, node.mapped() );
+                jto.emplace( std::move( node.key() ), std::move( jval ) );
               }
           }
           break;
 
           case toml::value_t::array: {
-            auto tlist = toml::get<std::vector<toml::value>>( tfrom );
-            jto        = nlohmann::json::array();
-            for ( const auto & elem : tlist )
+            jto = nlohmann::json::array();
+            for ( auto & elem : toml::get<toml::array>( tfrom ) )
               {
                 nlohmann::json jval;
                 visit( jval, elem );
@@ -77,7 +82,7 @@ tomlToJSON( std::string_view toml )
         case toml::value_t::floating: jto = toml::get<double>( tfrom ); break;
 
         case toml::value_t::string:
-          jto = toml::get<std::string>( tfrom );
+          jto = std::move( toml::get<std::string>( tfrom ) );
           break;
 
         case toml::value_t::empty: jto = nullptr; break;
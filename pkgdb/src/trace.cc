@@ -0,0 +1,109 @@
+/* ========================================================================== *
+ *
+ * @file trace.cc
+ *
+ * @brief Chrome trace-event span instrumentation.
+ *
+ *
+ * -------------------------------------------------------------------------- */
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+#include <nlohmann/json.hpp>
+
+#include "flox/core/trace.hh"
+
+
+/* -------------------------------------------------------------------------- */
+
+namespace flox {
+
+/* -------------------------------------------------------------------------- */
+
+/** Output path from `FLOX_TRACE`, or empty when tracing is off. */
+static const std::string &
+tracePath()
+{
+  static const std::string path = []() -> std::string
+  {
+    const char * maybePath = std::getenv( "FLOX_TRACE" );
+    return ( maybePath == nullptr ) ? "" : maybePath;
+  }();
+  return path;
+}
+
+
+bool
+traceEnabled()
+{
+  return ! tracePath().empty();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void
+recordTraceSpan( const std::string &                           name,
+                 const std::chrono::steady_clock::time_point & start,
+                 const std::chrono::steady_clock::time_point & end,
+                 const nlohmann::json &                        args )
+{
+  if ( ! traceEnabled() ) { return; }
+
+  /* Spans are recorded off the hot path ( at scope exit ), so a plain
+   * mutex around the stream is fine. */
+  static std::mutex    lock;
+  std::lock_guard<std::mutex> guard( lock );
+
+  /* Chrome's trace viewer accepts an array with a missing closing bracket,
+   * so the file opens with `[' once and every event appends `,\n'; no
+   * finalization step is needed and partial traces from crashed runs
+   * still load. */
+  static std::ofstream stream = []()
+  {
+    std::ofstream out( tracePath(), std::ios::trunc );
+    out << "[\n";
+    return out;
+  }();
+  if ( ! stream.is_open() ) { return; }
+
+  auto toMicros = []( const std::chrono::steady_clock::time_point & time )
+  {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+             time.time_since_epoch() )
+      .count();
+  };
+
+  nlohmann::json event
+    = { { "name", name },
+        { "ph", "X" },
+        { "ts", toMicros( start ) },
+        { "dur", toMicros( end ) - toMicros( start ) },
+        { "pid", getpid() },
+        { "tid",
+          std::hash<std::thread::id> {}( std::this_thread::get_id() )
+            % 0xFFFF } };
+  if ( ! args.empty() ) { event["args"] = args; }
+
+  stream << event.dump() << ",\n";
+  stream.flush();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+}  // namespace flox
+
+
+/* -------------------------------------------------------------------------- *
+ *
+ *
+ *
+ * ========================================================================== */
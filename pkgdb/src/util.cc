@@ -14,6 +14,7 @@
 #include <filesystem>
 #include <fstream>
 #include <initializer_list>
+#include <optional>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -98,6 +99,34 @@ parseFlakeRef( const std::string & flakeRef )
 }
 
 
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Read an entire file into one contiguous buffer.
+ *
+ * Parsers run markedly faster over a contiguous buffer than through the
+ * `istream` input adapter, which pays a per-character indirection; these
+ * entry points sit on the lockfile, manifest, and search-params hot paths
+ * where that difference is visible per activation.
+ */
+static std::string
+readFileToString( const std::filesystem::path & path )
+{
+  std::ifstream ifs( path, std::ios::binary );
+  if ( ! ifs.is_open() )
+    {
+      throw flox::FloxException( "Failed to open file '" + path.string()
+                                 + "'" );
+    }
+  std::string buffer;
+  ifs.seekg( 0, std::ios::end );
+  buffer.resize( static_cast<std::size_t>( ifs.tellg() ) );
+  ifs.seekg( 0, std::ios::beg );
+  ifs.read( buffer.data(), static_cast<std::streamsize>( buffer.size() ) );
+  return buffer;
+}
+
+
 /* -------------------------------------------------------------------------- */
 
 nlohmann::json
@@ -107,8 +136,7 @@ parseOrReadJSONObject( const std::string & jsonOrPath )
     {
       return nlohmann::json::parse( jsonOrPath );
     }
-  std::ifstream jfile( jsonOrPath );
-  return nlohmann::json::parse( jfile );
+  return nlohmann::json::parse( readFileToString( jsonOrPath ) );
 }
 
 
@@ -123,30 +151,77 @@ readAndCoerceJSON( const std::filesystem::path & path )
                                  + "' does not exist" );
     }
 
-  std::ifstream ifs( path );
-  auto          ext = path.extension();
+  std::string content = readFileToString( path );
+
+  auto ext = path.extension();
   if ( ( ext == ".json" ) || ( ext == ".lock" ) )
     {
-      return nlohmann::json::parse( ifs );
+      return nlohmann::json::parse( content );
     }
-
-  /* Read file to buffer */
-  std::ostringstream oss;
   if ( ( ext == ".yaml" ) || ( ext == ".yml" ) )
     {
-      oss << ifs.rdbuf();
-      return yamlToJSON( oss.str() );
+      return yamlToJSON( content );
     }
-  else if ( ext == ".toml" )
+  if ( ext == ".toml" ) { return tomlToJSON( content ); }
+  throw flox::FloxException( "Cannot convert file extension '" + ext.string()
+                             + "' to JSON" );
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+std::optional<std::vector<std::string_view>>
+splitAttrPathView( std::string_view path )
+{
+  std::vector<std::string_view> parts;
+
+  bool   inSingleQuote = false;
+  bool   inDoubleQuote = false;
+  bool   wasEscaped    = false;
+  size_t start         = 0;
+
+  /* Trim outer quotes; escapes cannot be represented as a view. */
+  auto pushPart = [&]( size_t end ) -> bool
+  {
+    std::string_view part = path.substr( start, end - start );
+    if ( ( 2 <= part.size() )
+         && ( ( ( part.front() == '\'' ) && ( part.back() == '\'' ) )
+              || ( ( part.front() == '"' ) && ( part.back() == '"' ) ) ) )
+      {
+        part = part.substr( 1, part.size() - 2 );
+      }
+    if ( part.find( '\\' ) != std::string_view::npos ) { return false; }
+    parts.emplace_back( part );
+    return true;
+  }; /* End lambda `pushPart' */
+
+  /* Split by dots, handling quotes. */
+  for ( size_t idx = 0; idx < path.size(); ++idx )
     {
-      oss << ifs.rdbuf();
-      return tomlToJSON( oss.str() );
+      const char chr = path[idx];
+      if ( wasEscaped ) { wasEscaped = false; }
+      else if ( chr == '\\' ) { wasEscaped = true; }
+      else if ( ( chr == '\'' ) && ( ! inDoubleQuote ) )
+        {
+          inSingleQuote = ! inSingleQuote;
+        }
+      else if ( ( chr == '"' ) && ( ! inSingleQuote ) )
+        {
+          inDoubleQuote = ! inDoubleQuote;
+        }
+      else if ( ( chr == '.' ) && ( ! inSingleQuote ) && ( ! inDoubleQuote ) )
+        {
+          if ( ! pushPart( idx ) ) { return std::nullopt; }
+          start = idx + 1;
+        }
     }
-  else
+
+  if ( start != path.size() )
     {
-      throw flox::FloxException( "Cannot convert file extension '"
-                                 + ext.string() + "' to JSON" );
+      if ( ! pushPart( path.size() ) ) { return std::nullopt; }
     }
+
+  return parts;
 }
 
 
@@ -155,6 +230,13 @@ readAndCoerceJSON( const std::filesystem::path & path )
 std::vector<std::string>
 splitAttrPath( std::string_view path )
 {
+  /* The common case has no escapes: split as views and materialize each
+   * component exactly once. */
+  if ( auto views = splitAttrPathView( path ); views.has_value() )
+    {
+      return std::vector<std::string>( views->begin(), views->end() );
+    }
+
   std::vector<std::string> parts;
 
   bool inSingleQuote = false;
@@ -165,6 +247,9 @@ splitAttrPath( std::string_view path )
   /* Remove outer quotes and unescape. */
   auto dequote = [&]( const std::string & part ) -> std::string
   {
+    /* Too short to carry outer quotes or escapes. */
+    if ( part.size() < 2 ) { return part; }
+
     auto itr = part.begin();
     auto end = part.end();
 
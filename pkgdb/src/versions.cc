@@ -8,20 +8,19 @@
  *
  * -------------------------------------------------------------------------- */
 
-#include <istream>
+#include <algorithm>
+#include <cctype>
 #include <list>
-#include <map>
 #include <optional>
 #include <regex>
+#include <sstream>
 #include <string>
 #include <string_view>
 #include <sys/types.h>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
-#include <nix/types.hh>
-#include <nix/util.hh>
-
 #include "versions.hh"
 
 
@@ -32,25 +31,322 @@ namespace versions {
 
 /* -------------------------------------------------------------------------- */
 
-/** Matches Semantic Version strings, e.g. `4.2.0-pre'. */
-static const char * const semverREStr
-  = "(0|[1-9][0-9]*)\\.(0|[1-9][0-9]*)\\.(0|[1-9][0-9]*)(-[-[:alnum:]_+.]+)?";
-
 /** Matches _loose_ versions which may omit trailing 0s. */
 static const char * const semverLooseREStr
   = "(0|[1-9][0-9]*)(\\.(0|[1-9][0-9]*)(\\.(0|[1-9][0-9]*))?)?"
     "(-[-[:alnum:]_+.]+)?";
 
-/** Coercively matches Semantic Version Strings, e.g. `v1.0-pre'. */
-static const char * const semverCoerceREStr
-  = "(.*@)?[vV]?(0*([0-9]+)(\\.0*([0-9]+)(\\.0*([0-9]+))?)?(-[-[:alnum:]_+.]+)?"
-    ")";
 
-/** Match '-' separated date strings, e.g. `2023-05-31' or `5-1-23'. */
-static const char * const dateREStr
-  = "([12][0-9][0-9][0-9]-[0-1]?[0-9]-[0-3]?[0-9]|" /* Y-M-D */
-    "[0-1]?[0-9]-[0-3]?[0-9]-[12][0-9][0-9][0-9])"  /* M-D-Y */
-    "(-[-[:alnum:]_+.]+)?";
+/* -------------------------------------------------------------------------- */
+
+/* The classifiers below ( `isSemver', `isDate', `coerceSemver', and friends )
+ * are hand-written matchers for grammars previously expressed as `std::regex'
+ * patterns.
+ * They run once per candidate version while post-processing search results,
+ * where `std::regex' matching dominated profiles; each matcher accepts
+ * exactly the same language as the pattern quoted in its doc comment. */
+
+
+/** @brief Matches the pre-release tag alphabet `[-[:alnum:]_+.]`. */
+static inline bool
+isTagChar( char chr )
+{
+  return ( std::isalnum( static_cast<unsigned char>( chr ) ) != 0 )
+         || ( chr == '-' ) || ( chr == '_' ) || ( chr == '+' )
+         || ( chr == '.' );
+}
+
+
+/**
+ * @brief Matches `(-[-[:alnum:]_+.]+)?` anchored from @a pos to the end
+ *        of @a sv.
+ * @return The tag including its leading `-` ( empty when absent ), or
+ *         `std::nullopt` if the tail is not a valid tag.
+ */
+static std::optional<std::string_view>
+matchTagTail( std::string_view sv, size_t pos )
+{
+  if ( pos == sv.size() ) { return std::string_view {}; }
+  if ( ( sv[pos] != '-' ) || ( ( pos + 1 ) == sv.size() ) )
+    {
+      return std::nullopt;
+    }
+  for ( size_t idx = pos + 1; idx < sv.size(); ++idx )
+    {
+      if ( ! isTagChar( sv[idx] ) ) { return std::nullopt; }
+    }
+  return sv.substr( pos );
+}
+
+
+/** @brief Matches `0|[1-9][0-9]*` at @a pos, returning the end offset. */
+static std::optional<size_t>
+matchStrictNumber( std::string_view sv, size_t pos )
+{
+  if ( ( sv.size() <= pos )
+       || ( std::isdigit( static_cast<unsigned char>( sv[pos] ) ) == 0 ) )
+    {
+      return std::nullopt;
+    }
+  /* A leading `0' is only valid on its own. */
+  if ( sv[pos] == '0' ) { return pos + 1; }
+  size_t end = pos + 1;
+  while ( ( end < sv.size() )
+          && ( std::isdigit( static_cast<unsigned char>( sv[end] ) ) != 0 ) )
+    {
+      ++end;
+    }
+  return end;
+}
+
+
+/** @brief Captured components of a strict _semantic version_ string. */
+struct StrictSemver
+{
+  std::string_view major;
+  std::string_view minor;
+  std::string_view patch;
+  /** Pre-release tag including its leading `-`, or empty. */
+  std::string_view tag;
+}; /* End struct `StrictSemver' */
+
+
+/**
+ * @brief Parse a strict _semantic version_ string, e.g. `4.2.0-pre`:
+ *        `(0|[1-9][0-9]*)\.(0|[1-9][0-9]*)\.(0|[1-9][0-9]*)(-[tag]+)?`.
+ */
+static std::optional<StrictSemver>
+parseStrictSemver( std::string_view sv )
+{
+  std::optional<size_t> majorEnd = matchStrictNumber( sv, 0 );
+  if ( ( ! majorEnd.has_value() ) || ( sv.size() <= *majorEnd )
+       || ( sv[*majorEnd] != '.' ) )
+    {
+      return std::nullopt;
+    }
+  std::optional<size_t> minorEnd = matchStrictNumber( sv, *majorEnd + 1 );
+  if ( ( ! minorEnd.has_value() ) || ( sv.size() <= *minorEnd )
+       || ( sv[*minorEnd] != '.' ) )
+    {
+      return std::nullopt;
+    }
+  std::optional<size_t> patchEnd = matchStrictNumber( sv, *minorEnd + 1 );
+  if ( ! patchEnd.has_value() ) { return std::nullopt; }
+  std::optional<std::string_view> tag = matchTagTail( sv, *patchEnd );
+  if ( ! tag.has_value() ) { return std::nullopt; }
+
+  StrictSemver rsl;
+  rsl.major = sv.substr( 0, *majorEnd );
+  rsl.minor = sv.substr( *majorEnd + 1, *minorEnd - ( *majorEnd + 1 ) );
+  rsl.patch = sv.substr( *minorEnd + 1, *patchEnd - ( *minorEnd + 1 ) );
+  rsl.tag   = *tag;
+  return rsl;
+}
+
+
+/** @brief Matches a 4 digit year `[12][0-9][0-9][0-9]` at @a pos. */
+static bool
+matchYear( std::string_view sv, size_t pos )
+{
+  if ( sv.size() < ( pos + 4 ) ) { return false; }
+  if ( ( sv[pos] != '1' ) && ( sv[pos] != '2' ) ) { return false; }
+  for ( size_t idx = pos + 1; idx < ( pos + 4 ); ++idx )
+    {
+      if ( std::isdigit( static_cast<unsigned char>( sv[idx] ) ) == 0 )
+        {
+          return false;
+        }
+    }
+  return true;
+}
+
+
+/**
+ * @brief Matches a 1-2 digit month/day field such as `[0-1]?[0-9]` at
+ *        @a pos, where a two digit form's first digit may be at
+ *        most @a maxFirst.
+ * @param ends Filled with candidate end offsets ( the grammar is ambiguous
+ *             so both lengths must be tried by the caller ).
+ * @return The number of candidates.
+ */
+static size_t
+matchShortField( std::string_view sv, size_t pos, char maxFirst, size_t * ends )
+{
+  size_t count = 0;
+  if ( ( pos < sv.size() )
+       && ( std::isdigit( static_cast<unsigned char>( sv[pos] ) ) != 0 ) )
+    {
+      if ( ( ( pos + 1 ) < sv.size() ) && ( sv[pos] <= maxFirst )
+           && ( std::isdigit( static_cast<unsigned char>( sv[pos + 1] ) )
+                != 0 ) )
+        {
+          ends[count++] = pos + 2;
+        }
+      ends[count++] = pos + 1;
+    }
+  return count;
+}
+
+
+/**
+ * @brief Matches '-' separated date strings, e.g. `2023-05-31` or `5-1-23`:
+ *        `([12][0-9]{3}-[0-1]?[0-9]-[0-3]?[0-9]` ( Y-M-D ) or
+ *        `[0-1]?[0-9]-[0-3]?[0-9]-[12][0-9]{3})` ( M-D-Y ), optionally
+ *        followed by `-[tag]+`.
+ */
+static bool
+matchDate( std::string_view sv )
+{
+  size_t monthEnds[2];
+  size_t dayEnds[2];
+
+  /* Y-M-D */
+  if ( matchYear( sv, 0 ) && ( 4 < sv.size() ) && ( sv[4] == '-' ) )
+    {
+      size_t months = matchShortField( sv, 5, '1', monthEnds );
+      for ( size_t mdx = 0; mdx < months; ++mdx )
+        {
+          size_t monthEnd = monthEnds[mdx];
+          if ( ( sv.size() <= monthEnd ) || ( sv[monthEnd] != '-' ) )
+            {
+              continue;
+            }
+          size_t days = matchShortField( sv, monthEnd + 1, '3', dayEnds );
+          for ( size_t ddx = 0; ddx < days; ++ddx )
+            {
+              if ( matchTagTail( sv, dayEnds[ddx] ).has_value() )
+                {
+                  return true;
+                }
+            }
+        }
+    }
+
+  /* M-D-Y */
+  size_t months = matchShortField( sv, 0, '1', monthEnds );
+  for ( size_t mdx = 0; mdx < months; ++mdx )
+    {
+      size_t monthEnd = monthEnds[mdx];
+      if ( ( sv.size() <= monthEnd ) || ( sv[monthEnd] != '-' ) )
+        {
+          continue;
+        }
+      size_t days = matchShortField( sv, monthEnd + 1, '3', dayEnds );
+      for ( size_t ddx = 0; ddx < days; ++ddx )
+        {
+          size_t dayEnd = dayEnds[ddx];
+          if ( ( sv.size() <= dayEnd ) || ( sv[dayEnd] != '-' )
+               || ( ! matchYear( sv, dayEnd + 1 ) ) )
+            {
+              continue;
+            }
+          if ( matchTagTail( sv, dayEnd + 5 ).has_value() ) { return true; }
+        }
+    }
+  return false;
+}
+
+
+/**
+ * @brief Matches `0*([0-9]+)` at @a pos.
+ * @return The captured value with leading zeros stripped ( keeping at least
+ *         one digit ) and the end offset.
+ */
+static std::optional<std::pair<std::string_view, size_t>>
+matchLooseNumber( std::string_view sv, size_t pos )
+{
+  size_t end = pos;
+  while ( ( end < sv.size() )
+          && ( std::isdigit( static_cast<unsigned char>( sv[end] ) ) != 0 ) )
+    {
+      ++end;
+    }
+  if ( end == pos ) { return std::nullopt; }
+  size_t begin = pos;
+  while ( ( ( begin + 1 ) < end ) && ( sv[begin] == '0' ) ) { ++begin; }
+  return std::make_pair( sv.substr( begin, end - begin ), end );
+}
+
+
+/** @brief Captured components of a _coercible_ version string. */
+struct CoercedVersion
+{
+  std::string_view major;
+  std::string_view minor;
+  std::string_view patch;
+  /** Pre-release tag including its leading `-`, or empty. */
+  std::string_view tag;
+  bool             hasMinor = false;
+  bool             hasPatch = false;
+}; /* End struct `CoercedVersion' */
+
+
+/**
+ * @brief Parse a coercible version without any `@` prefix, e.g. `v1.02-pre`:
+ *        `[vV]?0*([0-9]+)(\.0*([0-9]+)(\.0*([0-9]+))?)?(-[tag]+)?`.
+ */
+static std::optional<CoercedVersion>
+parseCoercibleTail( std::string_view sv )
+{
+  size_t pos = 0;
+  if ( ( ! sv.empty() ) && ( ( sv[0] == 'v' ) || ( sv[0] == 'V' ) ) )
+    {
+      pos = 1;
+    }
+
+  CoercedVersion rsl;
+  auto           major = matchLooseNumber( sv, pos );
+  if ( ! major.has_value() ) { return std::nullopt; }
+  rsl.major = major->first;
+  pos       = major->second;
+
+  if ( ( pos < sv.size() ) && ( sv[pos] == '.' ) )
+    {
+      auto minor = matchLooseNumber( sv, pos + 1 );
+      if ( ! minor.has_value() ) { return std::nullopt; }
+      rsl.minor    = minor->first;
+      rsl.hasMinor = true;
+      pos          = minor->second;
+      if ( ( pos < sv.size() ) && ( sv[pos] == '.' ) )
+        {
+          auto patch = matchLooseNumber( sv, pos + 1 );
+          if ( ! patch.has_value() ) { return std::nullopt; }
+          rsl.patch    = patch->first;
+          rsl.hasPatch = true;
+          pos          = patch->second;
+        }
+    }
+
+  std::optional<std::string_view> tag = matchTagTail( sv, pos );
+  if ( ! tag.has_value() ) { return std::nullopt; }
+  rsl.tag = *tag;
+  return rsl;
+}
+
+
+/**
+ * @brief Parse a coercible version with an optional `(.*@)?` prefix,
+ *        e.g. `foo@v1.02.0-pre`, preferring the longest prefix as the
+ *        greedy pattern did.
+ */
+static std::optional<CoercedVersion>
+parseCoercedVersion( std::string_view sv )
+{
+  size_t at = sv.rfind( '@' );
+  /* The version grammar cannot itself contain `@', so a string with one must
+   * split at some `@'. */
+  if ( at == std::string_view::npos ) { return parseCoercibleTail( sv ); }
+  for ( ;; )
+    {
+      std::optional<CoercedVersion> parsed
+        = parseCoercibleTail( sv.substr( at + 1 ) );
+      if ( parsed.has_value() ) { return parsed; }
+      if ( at == 0 ) { break; }
+      at = sv.rfind( '@', at - 1 );
+      if ( at == std::string_view::npos ) { break; }
+    }
+  return std::nullopt;
+}
 
 
 /* -------------------------------------------------------------------------- */
@@ -58,8 +354,7 @@ static const char * const dateREStr
 bool
 isSemver( const std::string & version )
 {
-  static const std::regex semverRE( semverREStr, std::regex::ECMAScript );
-  return std::regex_match( version, semverRE );
+  return parseStrictSemver( version ).has_value();
 }
 
 
@@ -68,8 +363,7 @@ isSemver( const std::string & version )
 bool
 isDate( const std::string & version )
 {
-  static const std::regex dateRE( dateREStr, std::regex::ECMAScript );
-  return std::regex_match( version, dateRE );
+  return matchDate( version );
 }
 
 
@@ -78,11 +372,8 @@ isDate( const std::string & version )
 bool
 isCoercibleToSemver( const std::string & version )
 {
-  static const std::regex dateRE( dateREStr, std::regex::ECMAScript );
-  static const std::regex semverCoerceRE( semverCoerceREStr,
-                                          std::regex::ECMAScript );
-  return ( ! std::regex_match( version, dateRE ) )
-         && std::regex_match( version, semverCoerceRE );
+  return ( ! matchDate( version ) )
+         && parseCoercedVersion( version ).has_value();
 }
 
 
@@ -91,62 +382,57 @@ isCoercibleToSemver( const std::string & version )
 std::optional<std::string>
 coerceSemver( std::string_view version )
 {
-  static const std::regex semverRE( semverREStr, std::regex::ECMAScript );
-  static const std::regex semverCoerceRE( semverCoerceREStr,
-                                          std::regex::ECMAScript );
-  std::string             vsn( version );
   /* If it's already a match for a proper semver we're done. */
-  if ( std::regex_match( vsn, semverRE ) ) { return { vsn }; }
-
-  /* Try try matching the coercive pattern. */
-  std::smatch match;
-  if ( isDate( vsn ) || ( ! std::regex_match( vsn, match, semverCoerceRE ) ) )
+  if ( parseStrictSemver( version ).has_value() )
     {
-      return std::nullopt;
+      return { std::string( version ) };
     }
 
-  /**
-   * Capture Groups Example:
-   *   [0]: foo@v1.02.0-pre
-   *   [1]: foo@
-   *   [2]: 1.02.0-pre
-   *   [3]: 1
-   *   [4]: .02.0
-   *   [5]: 2
-   *   [6]: .0
-   *   [7]: 0
-   *   [8]: -pre
-   */
-  static const size_t majorIdx  = 3;
-  static const size_t minorIdx  = 5;
-  static const size_t patchIdx  = 7;
-  static const size_t preTagIdx = 8;
-
-
-  /* The `str()' function is destructive and works by adding null terminators to
-   * the original string.
-   * If we attempt to convert each submatch from left to right we will clobber
-   * some characters with null terminators.
-   * To avoid this we convert each submatch to a string from right to left.
-   */
-  std::string tag( match[preTagIdx].str() );
-  std::string patch( match[patchIdx].str() );
-  std::string minor( match[minorIdx].str() );
-
-  std::string rsl( match[majorIdx].str() + "." );
-
-  if ( minor.empty() ) { rsl += "0."; }
-  else { rsl += minor + "."; }
-
-  if ( patch.empty() ) { rsl += "0"; }
-  else { rsl += patch; }
-
-  if ( ! tag.empty() ) { rsl += tag; }
+  /* Try matching the coercive grammar, filling omitted components with 0s. */
+  if ( matchDate( version ) ) { return std::nullopt; }
+  std::optional<CoercedVersion> parsed = parseCoercedVersion( version );
+  if ( ! parsed.has_value() ) { return std::nullopt; }
+
+  std::string rsl( parsed->major );
+  rsl += '.';
+
+  if ( parsed->hasMinor ) { rsl += parsed->minor; }
+  else { rsl += '0'; }
+  rsl += '.';
+
+  if ( parsed->hasPatch ) { rsl += parsed->patch; }
+  else { rsl += '0'; }
+
+  rsl += parsed->tag;
 
   return { rsl };
 }
 
 
+/* -------------------------------------------------------------------------- */
+
+std::optional<SemverParts>
+parseSemverParts( const std::string & semver )
+{
+  std::optional<StrictSemver> parsed = parseStrictSemver( semver );
+  if ( ! parsed.has_value() ) { return std::nullopt; }
+
+  auto toNum = []( std::string_view num )
+  { return static_cast<unsigned>( std::stoul( std::string( num ) ) ); };
+
+  SemverParts parts;
+  parts.major = toNum( parsed->major );
+  parts.minor = toNum( parsed->minor );
+  parts.patch = toNum( parsed->patch );
+  /* Drop the leading '-' from the pre-release tag. */
+  if ( ! parsed->tag.empty() )
+    {
+      parts.preTag = std::string( parsed->tag.substr( 1 ) );
+    }
+  return parts;
+}
+
+
 /* -------------------------------------------------------------------------- */
 
 bool
@@ -167,32 +453,6 @@ isSemverRange( const std::string & range )
 }
 
 
-/* -------------------------------------------------------------------------- */
-
-#ifndef SEMVER_PATH
-#  define SEMVER_PATH "semver"
-#endif
-
-std::pair<int, std::string>
-runSemver( const std::list<std::string> & args )
-{
-  static const std::string semverProg
-    = nix::getEnv( "SEMVER" ).value_or( SEMVER_PATH );
-  static const std::map<std::string, std::string> env = nix::getEnv();
-  return nix::runProgram( nix::RunOptions { .program             = semverProg,
-                                            .searchPath          = true,
-                                            .args                = args,
-                                            .uid                 = std::nullopt,
-                                            .gid                 = std::nullopt,
-                                            .chdir               = std::nullopt,
-                                            .environment         = env,
-                                            .input               = std::nullopt,
-                                            .standardIn          = nullptr,
-                                            .standardOut         = nullptr,
-                                            .mergeStderrToStdout = false } );
-}
-
-
 /* -------------------------------------------------------------------------- */
 
 /** @brief Strip any '*', 'x', or 'X' characters from the range. */
@@ -229,26 +489,499 @@ cleanRange( const std::string & range )
 
 /* -------------------------------------------------------------------------- */
 
-std::list<std::string>
-semverSat( const std::string & range, const std::list<std::string> & versions )
+/* Native implementation of the `node-semver' range grammar.
+ * Matching follows `--include-prerelease --loose' semantics: versions are
+ * compared purely by semver precedence rules and pre-releases are never
+ * excluded merely for carrying a tag. */
+
+/** @brief A fully parsed version, compared by semver precedence rules. */
+struct ParsedVersion
+{
+  unsigned major = 0;
+  unsigned minor = 0;
+  unsigned patch = 0;
+  /** `.' separated pre-release identifiers, without the leading `-'. */
+  std::vector<std::string> prerelease;
+}; /* End struct `ParsedVersion' */
+
+
+/** @brief A version appearing in a range, tracking omitted components. */
+struct RangeVersion
+{
+  ParsedVersion version;
+  bool          hasMinor = false;
+  bool          hasPatch = false;
+}; /* End struct `RangeVersion' */
+
+
+/** @brief A single comparison against a version, e.g. `>=1.2.0'. */
+struct Comparator
+{
+  enum Op { LT, LE, GT, GE, EQ } op;
+  ParsedVersion version;
+}; /* End struct `Comparator' */
+
+/** Comparators joined by _and_. */
+using ComparatorSet = std::vector<Comparator>;
+/** Comparator sets joined by `||`. */
+using SemverRange = std::vector<ComparatorSet>;
+
+
+/* -------------------------------------------------------------------------- */
+
+[[nodiscard]] static std::string
+trimWS( const std::string & str )
+{
+  size_t begin = str.find_first_not_of( " \t" );
+  if ( begin == std::string::npos ) { return ""; }
+  size_t end = str.find_last_not_of( " \t" );
+  return str.substr( begin, ( end - begin ) + 1 );
+}
+
+
+/** @brief Parse a ( possibly loose, possibly partial ) version string. */
+[[nodiscard]] static std::optional<RangeVersion>
+parseRangeVersion( const std::string & version )
+{
+  static const std::regex looseRE( std::string( "[=vV]*" ) + semverLooseREStr,
+                                   std::regex::ECMAScript );
+  std::smatch             match;
+  if ( ! std::regex_match( version, match, looseRE ) ) { return std::nullopt; }
+
+  /* Convert submatches right to left for the same reason as `coerceSemver'. */
+  std::string tag( match[6].str() );
+  std::string patch( match[5].str() );
+  std::string minor( match[3].str() );
+  std::string major( match[1].str() );
+
+  RangeVersion rsl;
+  rsl.version.major = static_cast<unsigned>( std::stoul( major ) );
+  if ( ! minor.empty() )
+    {
+      rsl.version.minor = static_cast<unsigned>( std::stoul( minor ) );
+      rsl.hasMinor      = true;
+    }
+  if ( ! patch.empty() )
+    {
+      rsl.version.patch = static_cast<unsigned>( std::stoul( patch ) );
+      rsl.hasPatch      = true;
+    }
+  if ( ! tag.empty() )
+    {
+      /* Drop the leading '-' and split on '.'. */
+      std::stringstream oss( tag.substr( 1 ) );
+      std::string       part;
+      while ( std::getline( oss, part, '.' ) )
+        {
+          rsl.version.prerelease.push_back( part );
+        }
+    }
+  return rsl;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+/** @brief Compare pre-release identifiers per the semver specification. */
+[[nodiscard]] static int
+compareIdentifier( const std::string & lhs, const std::string & rhs )
+{
+  auto isNumeric = []( const std::string & str )
+  {
+    return ( ! str.empty() )
+           && std::all_of( str.begin(),
+                           str.end(),
+                           []( unsigned char chr )
+                           { return std::isdigit( chr ) != 0; } );
+  };
+  bool lhsNum = isNumeric( lhs );
+  bool rhsNum = isNumeric( rhs );
+  /* Numeric identifiers compare numerically and rank below alphanumerics. */
+  if ( lhsNum && rhsNum )
+    {
+      unsigned long long lval = std::stoull( lhs );
+      unsigned long long rval = std::stoull( rhs );
+      return ( lval < rval ) ? -1 : ( ( rval < lval ) ? 1 : 0 );
+    }
+  if ( lhsNum != rhsNum ) { return lhsNum ? -1 : 1; }
+  return ( lhs < rhs ) ? -1 : ( ( rhs < lhs ) ? 1 : 0 );
+}
+
+
+/** @brief Three-way comparison of versions by semver precedence. */
+[[nodiscard]] static int
+compareVersions( const ParsedVersion & lhs, const ParsedVersion & rhs )
+{
+  if ( lhs.major != rhs.major ) { return ( lhs.major < rhs.major ) ? -1 : 1; }
+  if ( lhs.minor != rhs.minor ) { return ( lhs.minor < rhs.minor ) ? -1 : 1; }
+  if ( lhs.patch != rhs.patch ) { return ( lhs.patch < rhs.patch ) ? -1 : 1; }
+  /* A pre-release ranks below the release it precedes. */
+  if ( lhs.prerelease.empty() ) { return rhs.prerelease.empty() ? 0 : 1; }
+  if ( rhs.prerelease.empty() ) { return -1; }
+  for ( size_t idx = 0;
+        ( idx < lhs.prerelease.size() ) && ( idx < rhs.prerelease.size() );
+        ++idx )
+    {
+      int cmp
+        = compareIdentifier( lhs.prerelease[idx], rhs.prerelease[idx] );
+      if ( cmp != 0 ) { return cmp; }
+    }
+  if ( lhs.prerelease.size() != rhs.prerelease.size() )
+    {
+      return ( lhs.prerelease.size() < rhs.prerelease.size() ) ? -1 : 1;
+    }
+  return 0;
+}
+
+
+[[nodiscard]] static bool
+matchComparator( const ParsedVersion & version, const Comparator & comp )
+{
+  int cmp = compareVersions( version, comp.version );
+  switch ( comp.op )
+    {
+      case Comparator::LT: return cmp < 0;
+      case Comparator::LE: return cmp <= 0;
+      case Comparator::GT: return 0 < cmp;
+      case Comparator::GE: return 0 <= cmp;
+      case Comparator::EQ: return cmp == 0;
+    }
+  return false;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+/** @brief An exclusive upper bound `<X.Y.Z-0', the lowest pre-release. */
+[[nodiscard]] static Comparator
+upperBound( unsigned major, unsigned minor, unsigned patch )
+{
+  return Comparator { Comparator::LT,
+                      ParsedVersion { major, minor, patch, { "0" } } };
+}
+
+
+/** @brief Expand a single `[op]version' token into comparators. */
+static bool
+expandComparator( const std::string & ops,
+                  const std::string & version,
+                  ComparatorSet &     rsl )
+{
+  std::optional<RangeVersion> parsed = parseRangeVersion( version );
+  if ( ! parsed.has_value() ) { return false; }
+  const ParsedVersion & vsn = parsed->version;
+
+  if ( ops.empty() || ( ops == "=" ) )
+    {
+      if ( parsed->hasPatch )
+        {
+          rsl.push_back( Comparator { Comparator::EQ, vsn } );
+        }
+      else if ( parsed->hasMinor )
+        {
+          rsl.push_back( Comparator { Comparator::GE, vsn } );
+          rsl.push_back( upperBound( vsn.major, vsn.minor + 1, 0 ) );
+        }
+      else
+        {
+          rsl.push_back( Comparator { Comparator::GE, vsn } );
+          rsl.push_back( upperBound( vsn.major + 1, 0, 0 ) );
+        }
+    }
+  else if ( ops == "^" )
+    {
+      rsl.push_back( Comparator { Comparator::GE, vsn } );
+      if ( 0 < vsn.major ) { rsl.push_back( upperBound( vsn.major + 1, 0, 0 ) ); }
+      else if ( parsed->hasMinor && ( 0 < vsn.minor ) )
+        {
+          rsl.push_back( upperBound( 0, vsn.minor + 1, 0 ) );
+        }
+      else if ( parsed->hasPatch )
+        {
+          rsl.push_back( upperBound( 0, vsn.minor, vsn.patch + 1 ) );
+        }
+      else if ( parsed->hasMinor )
+        {
+          rsl.push_back( upperBound( 0, vsn.minor + 1, 0 ) );
+        }
+      else { rsl.push_back( upperBound( 1, 0, 0 ) ); }
+    }
+  else if ( ops == "~" )
+    {
+      rsl.push_back( Comparator { Comparator::GE, vsn } );
+      if ( parsed->hasMinor )
+        {
+          rsl.push_back( upperBound( vsn.major, vsn.minor + 1, 0 ) );
+        }
+      else { rsl.push_back( upperBound( vsn.major + 1, 0, 0 ) ); }
+    }
+  else if ( ops == ">" )
+    {
+      if ( parsed->hasPatch )
+        {
+          rsl.push_back( Comparator { Comparator::GT, vsn } );
+        }
+      else if ( parsed->hasMinor )
+        {
+          rsl.push_back( Comparator {
+            Comparator::GE,
+            ParsedVersion { vsn.major, vsn.minor + 1, 0, {} } } );
+        }
+      else
+        {
+          rsl.push_back( Comparator {
+            Comparator::GE, ParsedVersion { vsn.major + 1, 0, 0, {} } } );
+        }
+    }
+  else if ( ops == ">=" )
+    {
+      rsl.push_back( Comparator { Comparator::GE, vsn } );
+    }
+  else if ( ops == "<" )
+    {
+      if ( parsed->hasPatch )
+        {
+          rsl.push_back( Comparator { Comparator::LT, vsn } );
+        }
+      else { rsl.push_back( upperBound( vsn.major, vsn.minor, 0 ) ); }
+    }
+  else if ( ops == "<=" )
+    {
+      if ( parsed->hasPatch )
+        {
+          rsl.push_back( Comparator { Comparator::LE, vsn } );
+        }
+      else if ( parsed->hasMinor )
+        {
+          rsl.push_back( upperBound( vsn.major, vsn.minor + 1, 0 ) );
+        }
+      else { rsl.push_back( upperBound( vsn.major + 1, 0, 0 ) ); }
+    }
+  else { return false; }
+  return true;
+}
+
+
+/** @brief Parse one `||` branch of a range into its comparators. */
+[[nodiscard]] static std::optional<ComparatorSet>
+parseComparatorSet( const std::string & set )
+{
+  ComparatorSet rsl;
+
+  /* Hyphen ranges, e.g. `1.2 - 2'. */
+  if ( size_t pos = set.find( " - " ); pos != std::string::npos )
+    {
+      std::optional<RangeVersion> low
+        = parseRangeVersion( trimWS( set.substr( 0, pos ) ) );
+      std::optional<RangeVersion> high
+        = parseRangeVersion( trimWS( set.substr( pos + 3 ) ) );
+      if ( ! ( low.has_value() && high.has_value() ) )
+        {
+          return std::nullopt;
+        }
+      rsl.push_back( Comparator { Comparator::GE, low->version } );
+      if ( ! high->hasMinor )
+        {
+          rsl.push_back( upperBound( high->version.major + 1, 0, 0 ) );
+        }
+      else if ( ! high->hasPatch )
+        {
+          rsl.push_back(
+            upperBound( high->version.major, high->version.minor + 1, 0 ) );
+        }
+      else { rsl.push_back( Comparator { Comparator::LE, high->version } ); }
+      return rsl;
+    }
+
+  /* Split `[op]version' tokens on whitespace; `,' and `&' also act as
+   * separators after `cleanRange'. */
+  std::string spaced = set;
+  std::replace( spaced.begin(), spaced.end(), ',', ' ' );
+  std::replace( spaced.begin(), spaced.end(), '&', ' ' );
+
+  static const std::regex tokenRE( "(>=|<=|[><=^~])?\\s*(.*)",
+                                   std::regex::ECMAScript );
+
+  std::stringstream tokens( spaced );
+  std::string       token;
+  std::string       pendingOp;
+  while ( tokens >> token )
+    {
+      /* Special glob tokens match everything. */
+      if ( ( token == "any" ) || ( token == "latest" ) ) { continue; }
+      std::smatch match;
+      if ( ! std::regex_match( token, match, tokenRE ) )
+        {
+          return std::nullopt;
+        }
+      std::string ops( match[1].str() );
+      std::string version( match[2].str() );
+      /* Allow whitespace between an operator and its version. */
+      if ( version.empty() && ( ! ops.empty() ) )
+        {
+          pendingOp = ops;
+          continue;
+        }
+      if ( ops.empty() && ( ! pendingOp.empty() ) )
+        {
+          ops = pendingOp;
+        }
+      pendingOp.clear();
+      if ( ! expandComparator( ops, version, rsl ) ) { return std::nullopt; }
+    }
+  if ( ! pendingOp.empty() ) { return std::nullopt; }
+  return rsl;
+}
+
+
+/** @brief Parse a full range; `std::nullopt` marks a grammar error. */
+[[nodiscard]] static std::optional<SemverRange>
+parseSemverRange( const std::string & range )
 {
-  std::list<std::string> args
-    = { "--include-prerelease", "--loose", "--range", cleanRange( range ) };
-  for ( const auto & version : versions ) { args.push_back( version ); }
-  auto [ec, lines] = runSemver( args );
-  /* TODO: determine parse error vs. empty list result. */
-  if ( ! nix::statusOk( ec ) ) { return {}; }
+  SemverRange rsl;
+  size_t      begin = 0;
+  while ( begin <= range.size() )
+    {
+      size_t      end  = range.find( "||", begin );
+      std::string part = trimWS( ( end == std::string::npos )
+                                   ? range.substr( begin )
+                                   : range.substr( begin, end - begin ) );
+      std::optional<ComparatorSet> set = parseComparatorSet( part );
+      if ( ! set.has_value() ) { return std::nullopt; }
+      rsl.push_back( std::move( *set ) );
+      if ( end == std::string::npos ) { break; }
+      begin = end + 2;
+    }
+  /* An empty range matches everything. */
+  if ( rsl.empty() ) { rsl.push_back( {} ); }
+  return rsl;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+std::string
+versionSortKey( const std::string & version )
+{
+  /* Split on '.' and '-' into identifiers. */
+  std::vector<std::string> idents;
+  std::string              current;
+  for ( const char chr : version )
+    {
+      if ( ( chr == '.' ) || ( chr == '-' ) )
+        {
+          idents.push_back( std::move( current ) );
+          current.clear();
+        }
+      else { current.push_back( chr ); }
+    }
+  idents.push_back( std::move( current ) );
+
+  std::string key;
+  bool        first = true;
+  for ( const std::string & ident : idents )
+    {
+      /* A separator below any printable byte preserves the rule that a
+       * version extending another sorts after it. */
+      if ( first ) { first = false; }
+      else { key.push_back( '\x01' ); }
+
+      bool numeric
+        = ( ! ident.empty() )
+          && std::all_of( ident.begin(),
+                          ident.end(),
+                          []( unsigned char chr )
+                          { return std::isdigit( chr ) != 0; } );
+      if ( numeric )
+        {
+          /* Numeric identifiers rank below alphanumerics and compare by
+           * value: a two-digit length prefix makes longer ( larger ) numbers
+           * order after shorter ones under binary comparison. */
+          std::string digits = ident.substr(
+            std::min( ident.find_first_not_of( '0' ), ident.size() - 1 ) );
+          key.push_back( '0' );
+          key.push_back(
+            static_cast<char>( '0' + ( ( digits.size() / 10 ) % 10 ) ) );
+          key.push_back( static_cast<char>( '0' + ( digits.size() % 10 ) ) );
+          key += digits;
+        }
+      else
+        {
+          key.push_back( '1' );
+          key += ident;
+        }
+    }
+  return key;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+/** @brief Evaluate a range against a version list ( no memoization ). */
+[[nodiscard]] static std::list<std::string>
+semverSatUncached( const std::string &            range,
+                   const std::list<std::string> & versions )
+{
+  std::optional<SemverRange> parsed = parseSemverRange( cleanRange( range ) );
+  /* Treat grammar errors as an empty result, matching the old behavior when
+   * the external tool exited non-zero. */
+  if ( ! parsed.has_value() ) { return {}; }
+
   std::list<std::string> rsl;
-  std::stringstream      oss( lines );
-  std::string            line;
-  while ( std::getline( oss, line, '\n' ) )
+  for ( const auto & version : versions )
     {
-      if ( ! line.empty() ) { rsl.push_back( std::move( line ) ); }
+      std::optional<RangeVersion> pvsn = parseRangeVersion( version );
+      if ( ! pvsn.has_value() ) { continue; }
+      for ( const auto & cset : *parsed )
+        {
+          bool matched = std::all_of( cset.begin(),
+                                      cset.end(),
+                                      [&]( const Comparator & comp ) {
+                                        return matchComparator( pvsn->version,
+                                                                comp );
+                                      } );
+          if ( matched )
+            {
+              rsl.push_back( version );
+              break;
+            }
+        }
     }
   return rsl;
 }
 
 
+std::list<std::string>
+semverSat( const std::string & range, const std::list<std::string> & versions )
+{
+  /* Resolution runs evaluate the same handful of ranges against the same
+   * candidate sets over and over - descriptors pinned to an identical range
+   * repeat the evaluation per group, system, and input.
+   * `semverSat' is a pure function, so results are memoized for the life of
+   * the process keyed by the range and candidate list; one evaluation per
+   * distinct pair covers a whole `createLockfile' run ( and the daemon's
+   * repeated runs ). */
+  static std::unordered_map<std::string, std::list<std::string>> memo;
+
+  /* Versions cannot contain a newline, so the joined form is a faithful key
+   * for the ( range, version-set ) pair. */
+  std::string key = range;
+  key.push_back( '\n' );
+  for ( const auto & version : versions )
+    {
+      key += version;
+      key.push_back( '\n' );
+    }
+
+  if ( auto itr = memo.find( key ); itr != memo.end() ) { return itr->second; }
+
+  auto itr
+    = memo.emplace( std::move( key ), semverSatUncached( range, versions ) )
+        .first;
+  return itr->second;
+}
+
+
 /* -------------------------------------------------------------------------- */
 
 }  // namespace versions
@@ -7,9 +7,15 @@
  *
  * -------------------------------------------------------------------------- */
 
+#include <cstdint>
+#include <map>
+#include <sstream>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <nlohmann/json.hpp>
+#include <yaml-cpp/eventhandler.h>
 #include <yaml-cpp/yaml.h>
 
 #include "flox/core/exceptions.hh"
@@ -35,80 +41,251 @@ FLOX_DEFINE_EXCEPTION( YAMLToJSONException,
 
 /* -------------------------------------------------------------------------- */
 
-nlohmann::json
-yamlToJSON( std::string_view yaml )
+/** @brief Convert a scalar's text to the JSON type `YAML::Node::as' picks. */
+static nlohmann::json
+scalarToJSON( const std::string & value )
+{
+  /* Detect integers, floats, bools, and real strings! */
+  YAML::Node scalar( value );
+  try
+    {
+      return scalar.as<int64_t>();
+    }
+  catch ( ... )
+    {}
+  try
+    {
+      return scalar.as<double>();
+    }
+  catch ( ... )
+    {}
+  try
+    {
+      return scalar.as<bool>();
+    }
+  catch ( ... )
+    {}
+  return value;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Builds a `nlohmann::json` value directly from YAML parse events.
+ *
+ * Unlike `YAML::Load` followed by a recursive conversion this never
+ * materializes a `YAML::Node` tree, so working memory is bounded by nesting
+ * depth ( one open container per level ) rather than document size.
+ */
+class JSONBuilder : public YAML::EventHandler
 {
-  std::function<void( nlohmann::json &, const YAML::Node & )> visit;
 
-  visit = [&]( nlohmann::json & jto, const YAML::Node & yfrom )
+private:
+
+  /** @brief A sequence or map that is still receiving children. */
+  struct Frame
+  {
+    nlohmann::json container;
+    bool           isMap     = false;
+    /** In a map, whether the next event forms the key or the value. */
+    bool           expectKey = false;
+    std::string    key;
+    YAML::anchor_t anchor = YAML::NullAnchor;
+  }; /* End struct `Frame' */
+
+  nlohmann::json     root = nullptr;
+  std::vector<Frame> stack;
+
+  /** Completed values of anchored nodes, resolved by @a OnAlias. */
+  std::map<YAML::anchor_t, nlohmann::json> anchors;
+  /** Raw text of anchored scalars, used when an alias forms a map key. */
+  std::map<YAML::anchor_t, std::string> anchorScalars;
+
+
+  /** @brief Whether the next event would form a map key. */
+  [[nodiscard]] bool
+  atKeyPosition() const
+  {
+    return ( ! this->stack.empty() ) && this->stack.back().isMap
+           && this->stack.back().expectKey;
+  }
+
+  /** @brief Attach a completed value to the enclosing container. */
+  void
+  placeValue( nlohmann::json value, YAML::anchor_t anchor )
   {
-    switch ( yfrom.Type() )
+    if ( anchor != YAML::NullAnchor ) { this->anchors[anchor] = value; }
+    if ( this->stack.empty() )
       {
-        case YAML::NodeType::Null: jto = nullptr; break;
-
-        case YAML::NodeType::Scalar:
-          /* Detect integers, floats, bools, and real strings! */
-          try
-            {
-              jto = yfrom.as<int64_t>();
-            }
-          catch ( ... )
-            {
-              try
-                {
-                  jto = yfrom.as<double>();
-                }
-              catch ( ... )
-                {
-                  try
-                    {
-                      jto = yfrom.as<bool>();
-                    }
-                  catch ( ... )
-                    {
-                      jto = yfrom.as<std::string>();
-                    }
-                }
-            }
-          break;
-
-        case YAML::NodeType::Sequence:
-          jto = nlohmann::json::array();
-          for ( const auto & elem : yfrom )
-            {
-              nlohmann::json jval;
-              visit( jval, elem );
-              jto.emplace_back( std::move( jval ) );
-            }
-          break;
-
-        case YAML::NodeType::Map:
-          jto = nlohmann::json::object();
-          for ( const auto & elem : yfrom )
-            {
-              nlohmann::json jval;
-              visit( jval, elem.second );
-              jto.emplace( elem.first.as<std::string>(), std::move( jval ) );
-            }
-          break;
-
-        case YAML::NodeType::Undefined:
-          throw YAMLToJSONException( "YAML node has an undefined type" );
-          break;
-
-        default:
-          throw YAMLToJSONException( "YAML node has an unrecognized type" );
-          break;
+        this->root = std::move( value );
+        return;
       }
-  }; /* End fn `visit()' */
+    Frame & top = this->stack.back();
+    if ( top.isMap )
+      {
+        /* Matching the DOM conversion, the first occurrence of a
+         * duplicated key wins. */
+        top.container.emplace( std::move( top.key ), std::move( value ) );
+        top.expectKey = true;
+      }
+    else { top.container.emplace_back( std::move( value ) ); }
+  }
+
+  /** @brief Open a nested sequence or map. */
+  void
+  pushContainer( nlohmann::json container, bool isMap, YAML::anchor_t anchor )
+  {
+    if ( this->atKeyPosition() )
+      {
+        throw YAMLToJSONException( "YAML map keys must be scalars" );
+      }
+    Frame frame;
+    frame.container = std::move( container );
+    frame.isMap     = isMap;
+    frame.expectKey = isMap;
+    frame.anchor    = anchor;
+    this->stack.push_back( std::move( frame ) );
+  }
+
+  /** @brief Close the innermost container and attach it to its parent. */
+  void
+  popContainer()
+  {
+    Frame frame = std::move( this->stack.back() );
+    this->stack.pop_back();
+    this->placeValue( std::move( frame.container ), frame.anchor );
+  }
+
+
+public:
 
+  void
+  OnDocumentStart( const YAML::Mark & /* mark */ ) override
+  {}
+
+  void
+  OnDocumentEnd() override
+  {}
+
+  void
+  OnNull( const YAML::Mark & /* mark */, YAML::anchor_t anchor ) override
+  {
+    if ( anchor != YAML::NullAnchor )
+      {
+        this->anchors[anchor]       = nullptr;
+        this->anchorScalars[anchor] = "null";
+      }
+    if ( this->atKeyPosition() )
+      {
+        /* Any null spelling used as a key stringifies to `null`. */
+        Frame & top   = this->stack.back();
+        top.key       = "null";
+        top.expectKey = false;
+        return;
+      }
+    this->placeValue( nullptr, YAML::NullAnchor );
+  }
+
+  void
+  OnScalar( const YAML::Mark & /* mark */,
+            const std::string & /* tag */,
+            YAML::anchor_t      anchor,
+            const std::string & value ) override
+  {
+    if ( anchor != YAML::NullAnchor )
+      {
+        this->anchors[anchor]       = scalarToJSON( value );
+        this->anchorScalars[anchor] = value;
+      }
+    if ( this->atKeyPosition() )
+      {
+        Frame & top   = this->stack.back();
+        top.key       = value;
+        top.expectKey = false;
+        return;
+      }
+    this->placeValue( scalarToJSON( value ), YAML::NullAnchor );
+  }
+
+  void
+  OnAlias( const YAML::Mark & /* mark */, YAML::anchor_t anchor ) override
+  {
+    auto found = this->anchors.find( anchor );
+    if ( found == this->anchors.end() )
+      {
+        throw YAMLToJSONException( "YAML alias references an unknown anchor" );
+      }
+    if ( this->atKeyPosition() )
+      {
+        auto raw = this->anchorScalars.find( anchor );
+        if ( raw == this->anchorScalars.end() )
+          {
+            throw YAMLToJSONException( "YAML map keys must be scalars" );
+          }
+        Frame & top   = this->stack.back();
+        top.key       = raw->second;
+        top.expectKey = false;
+        return;
+      }
+    this->placeValue( found->second, YAML::NullAnchor );
+  }
+
+  void
+  OnSequenceStart( const YAML::Mark & /* mark */,
+                   const std::string & /* tag */,
+                   YAML::anchor_t anchor,
+                   YAML::EmitterStyle::value /* style */ ) override
+  {
+    this->pushContainer( nlohmann::json::array(), false, anchor );
+  }
+
+  void
+  OnSequenceEnd() override
+  {
+    this->popContainer();
+  }
+
+  void
+  OnMapStart( const YAML::Mark & /* mark */,
+              const std::string & /* tag */,
+              YAML::anchor_t anchor,
+              YAML::EmitterStyle::value /* style */ ) override
+  {
+    this->pushContainer( nlohmann::json::object(), true, anchor );
+  }
+
+  void
+  OnMapEnd() override
+  {
+    this->popContainer();
+  }
+
+  /** @brief Yield the completed document ( `null` for an empty one ). */
+  [[nodiscard]] nlohmann::json
+  take()
+  {
+    return std::move( this->root );
+  }
+
+
+}; /* End class `JSONBuilder' */
+
+
+/* -------------------------------------------------------------------------- */
+
+nlohmann::json
+yamlToJSON( std::string_view yaml )
+{
   try
     {
-      std::string    yamlStr( yaml );
-      YAML::Node     yaml = YAML::Load( yamlStr );
-      nlohmann::json rsl;
-      visit( rsl, yaml );
-      return rsl;
+      std::string        yamlStr( yaml );
+      std::istringstream input( yamlStr );
+      YAML::Parser       parser( input );
+      JSONBuilder        builder;
+      /* Like `YAML::Load' only the first document is converted. */
+      parser.HandleNextDocument( builder );
+      return builder.take();
     }
   catch ( const std::exception & e )
     {
@@ -119,9 +296,6 @@ yamlToJSON( std::string_view yaml )
       throw YAMLToJSONException( "while parsing a YAML string" );
     }
 
-  assert( false ); /* Unreachable */
-  return nlohmann::json();
-
 } /* End fn `yamlToJSON()' */
 
 
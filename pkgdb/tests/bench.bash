@@ -0,0 +1,160 @@
+# ============================================================================ #
+#
+# End-to-end benchmark harness for `pkgdb'.
+#
+# Measures three hot paths against a pinned nixpkgs revision ( the same one
+# the bats suites use, so fetcher caches are shared ):
+#   - scrape wall time for a small package set, cold and warm;
+#   - search latency distribution against a prebuilt database;
+#   - lock time for a reference manifest.
+#
+# Results are emitted as JSON ( `BENCH_OUT', default `bench-results.json' ).
+# Thresholds are opt-in: set any of
+#   BENCH_MAX_SCRAPE_COLD_MS  BENCH_MAX_SEARCH_P95_MS  BENCH_MAX_LOCK_MS
+# and the run fails when the measurement exceeds them, making regressions
+# fail CI instead of landing blind.
+#
+# The search/lock cache directory persists across runs ( `BENCH_CACHEDIR',
+# default `tests/.bench-cache' ) so the first invocation pays the corpus
+# scrape and later invocations measure warm behavior; delete it to
+# re-measure cold.
+#
+# ---------------------------------------------------------------------------- #
+
+set -euo pipefail;
+
+# ---------------------------------------------------------------------------- #
+
+SCRIPT_DIR="$( cd "$( dirname "${BASH_SOURCE[0]}" )" > /dev/null 2>&1 && pwd; )";
+
+: "${PKGDB_BIN:=$SCRIPT_DIR/../bin/pkgdb}";
+: "${BENCH_OUT:=bench-results.json}";
+: "${BENCH_CACHEDIR:=$SCRIPT_DIR/.bench-cache}";
+: "${BENCH_SEARCH_ITERATIONS:=20}";
+
+# Pinned corpus: keep aligned with `tests/setup_suite.bash'.
+NIXPKGS_REV="ab5fd150146dcfe41fda501134e6503932cc8dfd";
+NIXPKGS_REF="github:NixOS/nixpkgs/$NIXPKGS_REV";
+
+if [[ -z "${NIX_SYSTEM:-}" ]]; then
+  NIX_SYSTEM="$( nix eval --raw --impure --expr builtins.currentSystem; )";
+fi
+
+export PKGDB_CACHEDIR="$BENCH_CACHEDIR";
+export _PKGDB_GA_REGISTRY_REF_OR_REV="$NIXPKGS_REV";
+
+mkdir -p "$BENCH_CACHEDIR";
+workdir="$( mktemp -d; )";
+trap 'rm -rf "$workdir"' EXIT;
+
+
+# ---------------------------------------------------------------------------- #
+
+# Millisecond wall-clock timestamp.
+now_ms() { date '+%s%3N'; }
+
+# time_ms CMD...  ->  prints elapsed milliseconds, output discarded.
+time_ms() {
+  local _start _end;
+  _start="$( now_ms; )";
+  "$@" > /dev/null 2>&1;
+  _end="$( now_ms; )";
+  echo "$(( _end - _start ))";
+}
+
+
+# ---------------------------------------------------------------------------- #
+# Scrape: cold into a fresh database, then warm ( resume should no-op ).
+
+scrape_db="$workdir/scrape.sqlite";
+scrape_cold_ms="$( time_ms "$PKGDB_BIN" scrape --database "$scrape_db"  \
+                     "$NIXPKGS_REF" legacyPackages "$NIX_SYSTEM"        \
+                     'akkoma-emoji'; )";
+scrape_warm_ms="$( time_ms "$PKGDB_BIN" scrape --database "$scrape_db"  \
+                     "$NIXPKGS_REF" legacyPackages "$NIX_SYSTEM"        \
+                     'akkoma-emoji'; )";
+
+
+# ---------------------------------------------------------------------------- #
+# Search: one excluded cold run builds the database, then measure the
+# latency distribution over warm runs.
+
+search_params='{ "query": { "match": "hello" } }';
+
+"$PKGDB_BIN" search --ga-registry "$search_params" > /dev/null;
+
+search_samples=();
+for (( i = 0; i < BENCH_SEARCH_ITERATIONS; ++i )); do
+  search_samples+=(
+    "$( time_ms "$PKGDB_BIN" search --ga-registry "$search_params"; )"
+  );
+done
+
+search_sorted="$( printf '%s\n' "${search_samples[@]}" | sort -n; )";
+search_min="$( echo "$search_sorted" | head -n 1; )";
+search_max="$( echo "$search_sorted" | tail -n 1; )";
+search_p50="$( echo "$search_sorted"  \
+  | awk '{ a[NR] = $1; } END { print a[int( ( NR + 1 ) * 0.50 )]; }'; )";
+search_p95="$( echo "$search_sorted"  \
+  | awk '{ a[NR] = $1; } END { i = int( ( NR + 1 ) * 0.95 );
+           if ( NR < i ) { i = NR; } print a[i]; }'; )";
+
+
+# ---------------------------------------------------------------------------- #
+# Lock: reference manifest against the same warm cache.
+
+lock_manifest="$SCRIPT_DIR/data/manifest/ga0.toml";
+lock_ms="$( time_ms "$PKGDB_BIN" manifest lock --ga-registry  \
+              --manifest "$lock_manifest"; )";
+
+
+# ---------------------------------------------------------------------------- #
+
+cat > "$BENCH_OUT" <<EOF
+{
+  "meta": {
+    "rev": "$NIXPKGS_REV"
+  , "system": "$NIX_SYSTEM"
+  , "searchIterations": $BENCH_SEARCH_ITERATIONS
+  , "date": "$( date -u '+%Y-%m-%dT%H:%M:%SZ'; )"
+  }
+, "scrape": { "coldMs": $scrape_cold_ms, "warmMs": $scrape_warm_ms }
+, "search": {
+    "minMs": $search_min
+  , "p50Ms": $search_p50
+  , "p95Ms": $search_p95
+  , "maxMs": $search_max
+  }
+, "lock": { "ms": $lock_ms }
+}
+EOF
+
+echo "bench: results written to $BENCH_OUT" >&2;
+cat "$BENCH_OUT";
+
+
+# ---------------------------------------------------------------------------- #
+# Regression thresholds ( opt-in ).
+
+_ec=0;
+
+check_threshold() {
+  local name="$1" limit="$2" actual="$3";
+  if [[ -n "$limit" ]] && (( limit < actual )); then
+    echo "bench: FAIL $name: ${actual}ms exceeds threshold ${limit}ms" >&2;
+    _ec=1;
+  fi
+}
+
+check_threshold 'scrape cold' "${BENCH_MAX_SCRAPE_COLD_MS:-}" "$scrape_cold_ms";
+check_threshold 'search p95'  "${BENCH_MAX_SEARCH_P95_MS:-}"  "$search_p95";
+check_threshold 'lock'        "${BENCH_MAX_LOCK_MS:-}"        "$lock_ms";
+
+exit "$_ec";
+
+
+# ---------------------------------------------------------------------------- #
+#
+#
+#
+# ============================================================================ #
@@ -0,0 +1,181 @@
+/* ========================================================================== *
+ *
+ * @file buildenv.cc
+ *
+ * @brief Tests for the `buildenv' link pass.
+ *
+ * The build itself is covered by `buildenv.bats'; these tests pin the
+ * conflict semantics of the in-memory link plan against plain directories,
+ * in particular the directory-vs-file cases inherited from the sequential
+ * link pass.
+ *
+ *
+ * -------------------------------------------------------------------------- */
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <nix/util.hh>
+
+#include "flox/buildenv/buildenv.hh"
+
+#include "test.hh"
+
+
+/* -------------------------------------------------------------------------- */
+
+/** Create a fake package directory with one entry under it. */
+static std::string
+mkFakePkg( const std::string & root,
+           const std::string & name,
+           const std::string & entry,
+           bool                isDir )
+{
+  std::filesystem::path pkgDir = std::filesystem::path( root ) / name;
+  std::filesystem::create_directories( pkgDir );
+  if ( isDir )
+    {
+      std::filesystem::create_directories( pkgDir / entry );
+      std::ofstream( pkgDir / entry / "inner" ) << name;
+    }
+  else { std::ofstream( pkgDir / entry ) << name; }
+  return pkgDir.string();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * A stronger ( numerically lower priority ) directory contributor wins
+ * silently over a weaker file at the same destination, just as the
+ * sequential link pass resolved it.
+ */
+bool
+test_dirBeatsWeakerFile()
+{
+  auto tempdir = nix::createTempDir();
+  auto pkgA    = mkFakePkg( tempdir, "pkgA", "etc", true );
+  auto pkgB    = mkFakePkg( tempdir, "pkgB", "etc", false );
+
+  std::vector<flox::buildenv::RealisedPackage> pkgs {
+    flox::buildenv::RealisedPackage( pkgA,
+                                     true,
+                                     flox::buildenv::Priority( 1 ) ),
+    flox::buildenv::RealisedPackage( pkgB,
+                                     true,
+                                     flox::buildenv::Priority( 5 ) ),
+  };
+
+  std::string out = tempdir + "/env0";
+  flox::buildenv::buildEnvironment( out, pkgs );
+
+  std::filesystem::path dst = std::filesystem::path( out ) / "etc";
+  EXPECT( std::filesystem::is_symlink( dst ) );
+  EXPECT_EQ( std::filesystem::read_symlink( dst ).string(), pkgA + "/etc" );
+  return true;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * A directory contributor arriving after a stronger file is a hard
+ * collision; priority never resolves a directory losing to a file.
+ */
+bool
+test_dirAfterFileCollides()
+{
+  auto tempdir = nix::createTempDir();
+  auto pkgA    = mkFakePkg( tempdir, "pkgA", "etc", false );
+  auto pkgB    = mkFakePkg( tempdir, "pkgB", "etc", true );
+
+  std::vector<flox::buildenv::RealisedPackage> pkgs {
+    flox::buildenv::RealisedPackage( pkgA,
+                                     true,
+                                     flox::buildenv::Priority( 1 ) ),
+    flox::buildenv::RealisedPackage( pkgB,
+                                     true,
+                                     flox::buildenv::Priority( 5 ) ),
+  };
+
+  std::string out = tempdir + "/env1";
+  try
+    {
+      flox::buildenv::buildEnvironment( out, pkgs );
+      return false;
+    }
+  catch ( const nix::Error & )
+    {
+      return true;
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * A file never merges into a destination already expanded into a real
+ * directory by multiple directory contributors, regardless of priority.
+ */
+bool
+test_fileVsMergedDirCollides()
+{
+  auto tempdir = nix::createTempDir();
+  auto pkgA    = mkFakePkg( tempdir, "pkgA", "etc", true );
+  auto pkgB    = mkFakePkg( tempdir, "pkgB", "etc", true );
+  auto pkgC    = mkFakePkg( tempdir, "pkgC", "etc", false );
+
+  std::vector<flox::buildenv::RealisedPackage> pkgs {
+    flox::buildenv::RealisedPackage( pkgA,
+                                     true,
+                                     flox::buildenv::Priority( 1 ) ),
+    flox::buildenv::RealisedPackage( pkgB,
+                                     true,
+                                     flox::buildenv::Priority( 2 ) ),
+    flox::buildenv::RealisedPackage( pkgC,
+                                     true,
+                                     flox::buildenv::Priority( 9 ) ),
+  };
+
+  std::string out = tempdir + "/env2";
+  try
+    {
+      flox::buildenv::buildEnvironment( out, pkgs );
+      return false;
+    }
+  catch ( const nix::Error & )
+    {
+      return true;
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+int
+main( int argc, char * argv[] )
+{
+  int exitStatus = EXIT_SUCCESS;
+#define RUN_TEST( ... ) _RUN_TEST( exitStatus, __VA_ARGS__ )
+
+  nix::verbosity = nix::lvlWarn;
+  if ( ( 1 < argc ) && ( std::string_view( argv[1] ) == "-v" ) )
+    {
+      nix::verbosity = nix::lvlDebug;
+    }
+
+  RUN_TEST( dirBeatsWeakerFile );
+  RUN_TEST( dirAfterFileCollides );
+  RUN_TEST( fileVsMergedDirCollides );
+
+  return exitStatus;
+}
+
+
+/* -------------------------------------------------------------------------- *
+ *
+ *
+ *
+ * ========================================================================== */
@@ -0,0 +1,188 @@
+/* ========================================================================== *
+ *
+ * @file tests/microbench.cc
+ *
+ * @brief Microbenchmarks for the inner loops of search: the `versions'
+ *        helpers and `PkgQuery' SQL generation.
+ *
+ * This is a self-contained harness in the google-benchmark style: each
+ * benchmark body is run for an auto-scaled number of iterations and the
+ * mean wall time per operation is reported.
+ * Run it with `make microbench'; it is intentionally excluded from
+ * `cc-check' because it measures rather than asserts.
+ *
+ *
+ * -------------------------------------------------------------------------- */
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "flox/pkgdb/pkg-query.hh"
+#include "versions.hh"
+
+
+/* -------------------------------------------------------------------------- */
+
+/* Accumulator read by `main' so benchmark bodies cannot be optimized away. */
+static volatile std::uint64_t benchSink = 0;
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Run @a body repeatedly, scaling the iteration count until the
+ *        measurement window is long enough to be meaningful, then print
+ *        the mean time per operation.
+ */
+static void
+runBench( const std::string & name, const std::function<void()> & body )
+{
+  using clock = std::chrono::steady_clock;
+  static const std::chrono::milliseconds minWindow( 100 );
+
+  std::uint64_t iterations = 1;
+  for ( ;; )
+    {
+      auto start = clock::now();
+      for ( std::uint64_t i = 0; i < iterations; ++i ) { body(); }
+      auto elapsed = clock::now() - start;
+      if ( minWindow <= elapsed )
+        {
+          auto nanos
+            = std::chrono::duration_cast<std::chrono::nanoseconds>( elapsed )
+                .count();
+          std::printf( "%-32s %12.1f ns/op %12llu iters\n",
+                       name.c_str(),
+                       static_cast<double>( nanos )
+                         / static_cast<double>( iterations ),
+                       static_cast<unsigned long long>( iterations ) );
+          return;
+        }
+      iterations *= 2;
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+/* A corpus shaped like real nixpkgs version strings: plain semvers, `v'
+ * prefixes, partial versions, dates, and unstable snapshots. */
+static const std::vector<std::string> versionCorpus = {
+  "1.2.3",       "4.2.0",
+  "0.1.0",       "2.38",
+  "18",          "v4.2.0",
+  "v1.0",        "1.2.3-pre.1",
+  "4.2.0-alpha", "2023-07-14",
+  "10-25-1917",  "unstable-2023-01-01",
+  "0.0.0-unstable-2023-07-14",
+  "10.5.4p1",    "20230715",
+  "not-a-version",
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+static void
+bench_isSemver()
+{
+  std::uint64_t hits = 0;
+  for ( const auto & version : versionCorpus )
+    {
+      if ( versions::isSemver( version ) ) { ++hits; }
+    }
+  benchSink += hits;
+}
+
+
+static void
+bench_coerceSemver()
+{
+  std::uint64_t chars = 0;
+  for ( const auto & version : versionCorpus )
+    {
+      auto coerced = versions::coerceSemver( version );
+      if ( coerced.has_value() ) { chars += coerced->size(); }
+    }
+  benchSink += chars;
+}
+
+
+static void
+bench_isSemverRange()
+{
+  std::uint64_t hits = 0;
+  for ( const auto & range :
+        { "^4.2.0", "~1.2.3 || 2.0 - 2.1", "*", "latest", "howdy" } )
+    {
+      if ( versions::isSemverRange( range ) ) { ++hits; }
+    }
+  benchSink += hits;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+static void
+bench_pkgQueryInitPname()
+{
+  flox::pkgdb::PkgQueryArgs args;
+  args.pname  = "hello";
+  args.semver = "^2.12";
+  flox::pkgdb::PkgQuery query( args );
+  benchSink += query.str().size();
+}
+
+
+static void
+bench_pkgQueryInitMatch()
+{
+  /* `match' exercises the `LIKE' pattern escaping ( `mkPatternString' )
+   * and FTS phrase quoting along with the ranking selections. */
+  flox::pkgdb::PkgQueryArgs args;
+  args.partialMatch = "50%_off_quoted\"phrase";
+  flox::pkgdb::PkgQuery query( args );
+  benchSink += query.str().size();
+}
+
+
+static void
+bench_pkgQueryStr()
+{
+  static const flox::pkgdb::PkgQuery query = []()
+  {
+    flox::pkgdb::PkgQueryArgs args;
+    args.pname  = "hello";
+    args.semver = "^2.12";
+    return flox::pkgdb::PkgQuery( args );
+  }();
+  benchSink += query.str().size();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+int
+main()
+{
+  runBench( "versions/isSemver", bench_isSemver );
+  runBench( "versions/coerceSemver", bench_coerceSemver );
+  runBench( "versions/isSemverRange", bench_isSemverRange );
+  runBench( "pkgQuery/init+str[pname]", bench_pkgQueryInitPname );
+  runBench( "pkgQuery/init+str[match]", bench_pkgQueryInitMatch );
+  runBench( "pkgQuery/str", bench_pkgQueryStr );
+
+  /* Keep the sink alive. */
+  return ( benchSink == UINT64_MAX ) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+
+/* -------------------------------------------------------------------------- *
+ *
+ *
+ *
+ * ========================================================================== */
@@ -75,6 +75,8 @@ clearTables( flox::pkgdb::PkgDb & db )
   /* Clear DB */
   db.execute_all(
     "DELETE FROM Packages; DELETE FROM AttrSets; DELETE FROM Descriptions" );
+  /* Session caches hold ids for the rows just deleted. */
+  db.clearSessionCaches();
 }
 
 /* -------------------------------------------------------------------------- */
@@ -274,6 +276,36 @@ test_descriptions0( flox::pkgdb::PkgDb & db )
   return true;
 }
 
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Round-trips a description long enough to be stored as a `zstd` frame.
+ * Frames contain NUL bytes, so this catches C-string truncation anywhere
+ * between `addOrGetDescriptionId` and `getDescription`.
+ */
+bool
+test_descriptions1( flox::pkgdb::PkgDb & db )
+{
+  std::string description;
+  for ( size_t i = 0; i < 64; ++i )
+    {
+      description += "A remarkably repetitive description of a program. ";
+    }
+  std::string stored = flox::pkgdb::compressDescription( description );
+  /* The premise of the test: the stored form is compressed and embeds at
+   * least one NUL byte. */
+  EXPECT( stored.size() < description.size() );
+  EXPECT( stored.find( '\0' ) != std::string::npos );
+
+  row_id id = db.addOrGetDescriptionId( description );
+  /* Dedup must match against the full stored bytes, not a NUL-truncated
+   * prefix of them. */
+  EXPECT_EQ( id, db.addOrGetDescriptionId( description ) );
+  EXPECT_EQ( description, db.getDescription( id ) );
+  return true;
+}
+
+
 /* -------------------------------------------------------------------------- */
 
 /* Tests `systems', `name', `pname', `version', and `subtree' filtering. */
@@ -986,6 +1018,7 @@ main( int argc, char * argv[] )
     RUN_TEST( hasPackage0, db );
 
     RUN_TEST( descriptions0, db );
+    RUN_TEST( descriptions1, db );
 
     RUN_TEST( PkgQuery0, db );
     RUN_TEST( PkgQuery1, db );
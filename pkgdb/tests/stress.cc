@@ -0,0 +1,299 @@
+/* ========================================================================== *
+ *
+ * @file tests/stress.cc
+ *
+ * @brief Concurrency stress harness: concurrent readers against one writer.
+ *
+ * Reproduces the production contention pattern where many `search' processes
+ * query a fingerprint database while a scrape is committing pages into it.
+ * The writer commits batches of synthetic `Packages' rows in WAL mode while
+ * a configurable number of reader threads run `PkgQuery::execute' on their
+ * own connections with a zero busy timeout, so every `SQLITE_BUSY' surfaces
+ * and is counted instead of hiding inside a blocking wait.
+ *
+ * Run it with `make stress'.  Configuration and thresholds are opt-in
+ * environment variables in the `tests/bench.bash' style:
+ *   STRESS_READERS           reader thread count        ( default 8 )
+ *   STRESS_DURATION_MS       measurement window         ( default 2000 )
+ *   STRESS_SEED_PACKAGES     corpus size                ( default 5000 )
+ *   STRESS_WRITE_BATCH       rows per writer commit     ( default 500 )
+ *   STRESS_MAX_P99_MS        fail when reader p99 exceeds this
+ *   STRESS_MAX_BUSY_RETRIES  fail when total busy retries exceed this
+ * Setting either threshold makes regressions fail CI instead of
+ * landing blind.
+ *
+ *
+ * -------------------------------------------------------------------------- */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <nix/hash.hh>
+#include <nix/util.hh>
+#include <sqlite3pp.hh>
+
+#include "flox/pkgdb/pkg-query.hh"
+#include "flox/pkgdb/write.hh"
+
+
+/* -------------------------------------------------------------------------- */
+
+/** @brief Read a numeric environment variable, falling back to @a fallback. */
+static long long
+getEnvNum( const char * name, long long fallback )
+{
+  const char * maybe = std::getenv( name );
+  if ( ( maybe == nullptr ) || ( std::string_view( maybe ).empty() ) )
+    {
+      return fallback;
+    }
+  return std::stoll( maybe );
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Seed a database file so `PkgDb' can open it without a flake.
+ *
+ * `PkgDb( dbPath )' loads input metadata on open, so the harness writes a
+ * synthetic `LockedFlake' row first; the DDL matches `schemas.hh' and the
+ * real triggers/tables are asserted by `PkgDb::init' afterwards.
+ * WAL mode is set here to match production scrape databases.
+ */
+static void
+seedInputMetadata( const std::filesystem::path & dbPath )
+{
+  sqlite3pp::database db( dbPath.c_str() );
+  db.execute( "PRAGMA journal_mode = WAL" );
+  db.execute( "CREATE TABLE IF NOT EXISTS LockedFlake ("
+              "  fingerprint  TEXT  PRIMARY KEY"
+              ", string       TEXT  NOT NULL"
+              ", attrs        JSON  NOT NULL"
+              ")" );
+  std::string fingerprint
+    = nix::hashString( nix::htSHA256, "pkgdb-stress-harness" )
+        .to_string( nix::Base16, false );
+  sqlite3pp::command cmd(
+    db,
+    "INSERT OR IGNORE INTO LockedFlake ( fingerprint, string, attrs )"
+    "  VALUES ( ?, 'github:flox/stress-fixture', '{}' )" );
+  cmd.bind( 1, fingerprint, sqlite3pp::copy );
+  cmd.execute();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Insert @a count synthetic packages under @a parentId.
+ *
+ * Attribute names cycle through `pkg0' .. `pkg<corpus-1>' so repeated calls
+ * replace existing rows like a re-scrape rather than growing the database.
+ */
+static void
+insertBatch( flox::pkgdb::PkgDb & pdb,
+             flox::pkgdb::row_id  parentId,
+             long long            start,
+             long long            count,
+             long long            corpus )
+{
+  sqlite3pp::command cmd( pdb.db, R"SQL(
+    INSERT OR REPLACE INTO Packages (
+      parentId, attrName, name, pname, version, semver
+    , major, minor, patch, preTag, license
+    , outputs, outputsToInstall, broken, unfree, descriptionId
+    ) VALUES ( ?, ?, ?, ?, ?, '1.0.0'
+             , 1, 0, 0, NULL, NULL
+             , '["out"]', '["out"]', FALSE, FALSE, NULL )
+  )SQL" );
+  for ( long long idx = start; idx < ( start + count ); ++idx )
+    {
+      std::string attrName = "pkg" + std::to_string( idx % corpus );
+      std::string name     = attrName + "-1.0";
+      cmd.reset();
+      cmd.bind( 1, static_cast<long long>( parentId ) );
+      cmd.bind( 2, attrName, sqlite3pp::copy );
+      cmd.bind( 3, name, sqlite3pp::copy );
+      cmd.bind( 4, attrName, sqlite3pp::copy );
+      cmd.bind( 5, "1.0", sqlite3pp::copy );
+      cmd.execute();
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+/** @brief The @a pct percentile of @a sorted latencies, in milliseconds. */
+static double
+percentileMs( const std::vector<std::int64_t> & sorted, double pct )
+{
+  if ( sorted.empty() ) { return 0.0; }
+  auto rank = static_cast<std::size_t>( pct * static_cast<double>(
+                                          sorted.size() - 1 ) );
+  return static_cast<double>( sorted[rank] ) / 1000.0;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+int
+main()
+{
+  using clock = std::chrono::steady_clock;
+
+  const long long readers    = getEnvNum( "STRESS_READERS", 8 );
+  const long long durationMs = getEnvNum( "STRESS_DURATION_MS", 2000 );
+  const long long seedPkgs   = getEnvNum( "STRESS_SEED_PACKAGES", 5000 );
+  const long long batch      = getEnvNum( "STRESS_WRITE_BATCH", 500 );
+
+  auto [fd, path] = nix::createTempFile( "stress-pkgdb.sql" );
+  fd.close();
+
+  seedInputMetadata( path );
+  flox::pkgdb::PkgDb pdb( static_cast<std::string_view>( path ) );
+
+  /* Seed the corpus in one transaction so readers always see a full view. */
+  auto prefixId = pdb.addOrGetAttrSetId(
+    flox::AttrPath { "legacyPackages", "x86_64-linux" } );
+  pdb.execute( "BEGIN IMMEDIATE TRANSACTION" );
+  insertBatch( pdb, prefixId, 0, seedPkgs, seedPkgs );
+  pdb.execute( "COMMIT TRANSACTION" );
+
+  std::atomic<bool>          stop( false );
+  std::atomic<std::uint64_t> readerBusy( 0 );
+  std::atomic<std::uint64_t> writerBusy( 0 );
+  std::atomic<std::uint64_t> writerTxns( 0 );
+
+  /* Per-reader latency logs, merged after the run; a query's latency spans
+   * every busy retry it needed, so contention shows up in the tail. */
+  std::vector<std::vector<std::int64_t>> latencies( readers );
+
+  std::vector<std::thread> threads;
+  threads.reserve( readers + 1 );
+  for ( long long tid = 0; tid < readers; ++tid )
+    {
+      threads.emplace_back(
+        [&, tid]()
+        {
+          sqlite3pp::database db;
+          db.connect( path.c_str(), SQLITE_OPEN_READONLY );
+          db.set_busy_timeout( 0 );
+          std::uint64_t iter = 0;
+          while ( ! stop.load( std::memory_order_relaxed ) )
+            {
+              flox::pkgdb::PkgQueryArgs args;
+              args.pname = "pkg" + std::to_string( ( tid + 31 * iter++ )
+                                                   % seedPkgs );
+              flox::pkgdb::PkgQuery query( args );
+              auto                  start = clock::now();
+              for ( ;; )
+                {
+                  try
+                    {
+                      ( void ) query.execute( db );
+                      break;
+                    }
+                  catch ( const sqlite3pp::database_error & )
+                    {
+                      readerBusy.fetch_add( 1, std::memory_order_relaxed );
+                      std::this_thread::sleep_for(
+                        std::chrono::microseconds( 100 ) );
+                    }
+                }
+              latencies[tid].push_back(
+                std::chrono::duration_cast<std::chrono::microseconds>(
+                  clock::now() - start )
+                  .count() );
+            }
+        } );
+    }
+
+  /* Single writer: commit batches like scrape page commits. */
+  threads.emplace_back(
+    [&]()
+    {
+      long long cursor = 0;
+      while ( ! stop.load( std::memory_order_relaxed ) )
+        {
+          while ( pdb.execute( "BEGIN IMMEDIATE TRANSACTION" ) == SQLITE_BUSY )
+            {
+              writerBusy.fetch_add( 1, std::memory_order_relaxed );
+              std::this_thread::sleep_for( std::chrono::microseconds( 100 ) );
+            }
+          insertBatch( pdb, prefixId, cursor, batch, seedPkgs );
+          pdb.execute( "COMMIT TRANSACTION" );
+          cursor += batch;
+          writerTxns.fetch_add( 1, std::memory_order_relaxed );
+        }
+    } );
+
+  std::this_thread::sleep_for( std::chrono::milliseconds( durationMs ) );
+  stop.store( true );
+  for ( auto & thread : threads ) { thread.join(); }
+
+  std::vector<std::int64_t> merged;
+  for ( const auto & log : latencies )
+    {
+      merged.insert( merged.end(), log.begin(), log.end() );
+    }
+  std::sort( merged.begin(), merged.end() );
+
+  double p50 = percentileMs( merged, 0.50 );
+  double p99 = percentileMs( merged, 0.99 );
+
+  std::printf( "stress/readers      %12lld\n", readers );
+  std::printf( "stress/queries      %12zu\n", merged.size() );
+  std::printf( "stress/p50          %12.3f ms\n", p50 );
+  std::printf( "stress/p99          %12.3f ms\n", p99 );
+  std::printf( "stress/busy-retries %12llu\n",
+               static_cast<unsigned long long>( readerBusy.load() ) );
+  std::printf( "stress/writer-busy  %12llu\n",
+               static_cast<unsigned long long>( writerBusy.load() ) );
+  std::printf( "stress/writer-txns  %12llu\n",
+               static_cast<unsigned long long>( writerTxns.load() ) );
+
+  std::filesystem::remove( path );
+  std::filesystem::remove( path + "-wal" );
+  std::filesystem::remove( path + "-shm" );
+
+  int ec = EXIT_SUCCESS;
+  if ( const char * maybe = std::getenv( "STRESS_MAX_P99_MS" );
+       ( maybe != nullptr ) && ( std::stod( maybe ) < p99 ) )
+    {
+      std::fprintf( stderr,
+                    "FAIL: p99 %.3f ms exceeds STRESS_MAX_P99_MS=%s\n",
+                    p99,
+                    maybe );
+      ec = EXIT_FAILURE;
+    }
+  if ( const char * maybe = std::getenv( "STRESS_MAX_BUSY_RETRIES" );
+       ( maybe != nullptr )
+       && ( static_cast<std::uint64_t>( std::stoll( maybe ) )
+            < readerBusy.load() ) )
+    {
+      std::fprintf( stderr,
+                    "FAIL: %llu busy retries exceed "
+                    "STRESS_MAX_BUSY_RETRIES=%s\n",
+                    static_cast<unsigned long long>( readerBusy.load() ),
+                    maybe );
+      ec = EXIT_FAILURE;
+    }
+  return ec;
+}
+
+
+/* -------------------------------------------------------------------------- *
+ *
+ *
+ *
+ * ========================================================================== */
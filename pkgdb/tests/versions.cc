@@ -23,6 +23,106 @@ test_semverSat1()
 }
 
 
+/* -------------------------------------------------------------------------- */
+
+bool
+test_semverSat2()
+{
+  /* `~' ranges, `||' alternatives, and hyphen ranges. */
+  std::list<std::string> sats
+    = versions::semverSat( "~1.2.3 || 2.0 - 2.1",
+                           { "1.2.2", "1.2.3", "1.2.9", "1.3.0", "2.0.5",
+                             "2.1.7", "2.2.0" } );
+  EXPECT( sats.size() == 4 );
+  EXPECT( std::find( sats.begin(), sats.end(), "1.2.3" ) != sats.end() );
+  EXPECT( std::find( sats.begin(), sats.end(), "1.2.9" ) != sats.end() );
+  EXPECT( std::find( sats.begin(), sats.end(), "2.0.5" ) != sats.end() );
+  EXPECT( std::find( sats.begin(), sats.end(), "2.1.7" ) != sats.end() );
+  return true;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+bool
+test_semverSat3()
+{
+  /* Pre-releases participate by precedence ( `--include-prerelease' ). */
+  std::list<std::string> sats
+    = versions::semverSat( ">=4.2.0-alpha",
+                           { "4.2.0-alpha", "4.2.0-beta.2", "4.2.0", "4.1.9" } );
+  EXPECT( sats.size() == 3 );
+  EXPECT( std::find( sats.begin(), sats.end(), "4.1.9" ) == sats.end() );
+
+  /* Partial versions behave as ranges. */
+  sats = versions::semverSat( "18", { "18.0.1", "18.16.0", "19.0.0" } );
+  EXPECT( sats.size() == 2 );
+
+  /* Wildcards match everything with a valid version. */
+  sats = versions::semverSat( "*", { "1.0.0", "2.0.0-rc.1" } );
+  EXPECT( sats.size() == 2 );
+  return true;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+bool
+test_semverSatMemo0()
+{
+  /* Results are memoized by the ( range, version list ) pair; a repeated
+   * call and the same range against a different candidate set must both
+   * stay correct. */
+  std::list<std::string> first
+    = versions::semverSat( "^1.2.0", { "1.2.0", "1.3.0", "2.0.0" } );
+  std::list<std::string> again
+    = versions::semverSat( "^1.2.0", { "1.2.0", "1.3.0", "2.0.0" } );
+  EXPECT( first == again );
+  EXPECT( first.size() == 2 );
+
+  std::list<std::string> other
+    = versions::semverSat( "^1.2.0", { "1.2.5", "0.9.0" } );
+  EXPECT( other.size() == 1 );
+  EXPECT( other.front() == "1.2.5" );
+  return true;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+bool
+test_parseSemverParts0()
+{
+  auto parts = versions::parseSemverParts( "4.2.1-pre.1" );
+  EXPECT( parts.has_value() );
+  EXPECT( parts->major == 4 );
+  EXPECT( parts->minor == 2 );
+  EXPECT( parts->patch == 1 );
+  EXPECT( parts->preTag.has_value() && ( *parts->preTag == "pre.1" ) );
+  EXPECT( ! versions::parseSemverParts( "not-a-version" ).has_value() );
+  return true;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+bool
+test_versionSortKey0()
+{
+  auto key = versions::versionSortKey;
+  /* Numeric identifiers compare by value. */
+  EXPECT( key( "9" ) < key( "10" ) );
+  EXPECT( key( "1.2.9" ) < key( "1.2.10" ) );
+  EXPECT( key( "beta.9" ) < key( "beta.10" ) );
+  /* Numbers rank below alphanumerics. */
+  EXPECT( key( "1" ) < key( "alpha" ) );
+  /* A version extending another sorts after it. */
+  EXPECT( key( "1.2" ) < key( "1.2.3" ) );
+  EXPECT( key( "alpha" ) < key( "alpha.1" ) );
+  return true;
+}
+
+
 /* -------------------------------------------------------------------------- */
 
 bool
@@ -91,6 +191,11 @@ main()
 #define RUN_TEST( ... ) _RUN_TEST( ec, __VA_ARGS__ )
 
   RUN_TEST( semverSat1 );
+  RUN_TEST( semverSat2 );
+  RUN_TEST( semverSat3 );
+  RUN_TEST( semverSatMemo0 );
+  RUN_TEST( parseSemverParts0 );
+  RUN_TEST( versionSortKey0 );
   RUN_TEST( isSemver0 );
   RUN_TEST( isDate0 );
   RUN_TEST( isSemverRange0 );
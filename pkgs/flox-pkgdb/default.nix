@@ -13,7 +13,6 @@
   nlohmann_json,
   pkg-config,
   remake,
-  semver,
   sqlite,
   sqlite3pp,
   toml11,
@@ -46,7 +45,6 @@
     toml_CFLAGS = "-isystem " + toml11.outPath + "/include";
     yaml_PREFIX = yaml-cpp.outPath;
     libExt = stdenv.hostPlatform.extensions.sharedLibrary;
-    SEMVER_PATH = semver.outPath + "/bin/semver";
     # Used by `buildenv' to provide activation hook extensions.
     PROFILE_D_SCRIPTS_DIR = let
       path = builtins.path {
@@ -147,8 +145,6 @@ in
           notIgnored && notResult;
       };
 
-      propagatedBuildInputs = [semver];
-
       nativeBuildInputs = [pkg-config coreutils gnugrep];
 
       buildInputs = [
@@ -191,7 +187,6 @@ in
         inherit
           envs
           nix
-          semver
           ;
 
         ciPackages = [